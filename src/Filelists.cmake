@@ -33,8 +33,11 @@ endif ("${LWIP_VERSION_RC}" STREQUAL "LWIP_RC_RELEASE")
 # The minimum set of files needed for lwIP.
 set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/init.c
+    ${LWIP_DIR}/src/core/alloc_profile.c
     ${LWIP_DIR}/src/core/def.c
     ${LWIP_DIR}/src/core/dns.c
+    ${LWIP_DIR}/src/core/gro.c
+    ${LWIP_DIR}/src/core/gso.c
     ${LWIP_DIR}/src/core/inet_chksum.c
     ${LWIP_DIR}/src/core/ip.c
     ${LWIP_DIR}/src/core/mem.c
@@ -42,12 +45,14 @@ set(lwipcore_SRCS
     ${LWIP_DIR}/src/core/netif.c
     ${LWIP_DIR}/src/core/pbuf.c
     ${LWIP_DIR}/src/core/raw.c
+    ${LWIP_DIR}/src/core/route.c
     ${LWIP_DIR}/src/core/stats.c
     ${LWIP_DIR}/src/core/sys.c
     ${LWIP_DIR}/src/core/altcp.c
     ${LWIP_DIR}/src/core/altcp_alloc.c
     ${LWIP_DIR}/src/core/altcp_tcp.c
     ${LWIP_DIR}/src/core/tcp.c
+    ${LWIP_DIR}/src/core/tcp_cc.c
     ${LWIP_DIR}/src/core/tcp_in.c
     ${LWIP_DIR}/src/core/tcp_out.c
     ${LWIP_DIR}/src/core/timeouts.c
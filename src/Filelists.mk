@@ -31,8 +31,11 @@
 
 # COREFILES, CORE4FILES: The minimum set of files needed for lwIP.
 COREFILES=$(LWIPDIR)/core/init.c \
+	$(LWIPDIR)/core/alloc_profile.c \
 	$(LWIPDIR)/core/def.c \
 	$(LWIPDIR)/core/dns.c \
+	$(LWIPDIR)/core/gro.c \
+	$(LWIPDIR)/core/gso.c \
 	$(LWIPDIR)/core/inet_chksum.c \
 	$(LWIPDIR)/core/ip.c \
 	$(LWIPDIR)/core/mem.c \
@@ -40,12 +43,14 @@ COREFILES=$(LWIPDIR)/core/init.c \
 	$(LWIPDIR)/core/netif.c \
 	$(LWIPDIR)/core/pbuf.c \
 	$(LWIPDIR)/core/raw.c \
+	$(LWIPDIR)/core/route.c \
 	$(LWIPDIR)/core/stats.c \
 	$(LWIPDIR)/core/sys.c \
 	$(LWIPDIR)/core/altcp.c \
 	$(LWIPDIR)/core/altcp_alloc.c \
 	$(LWIPDIR)/core/altcp_tcp.c \
 	$(LWIPDIR)/core/tcp.c \
+	$(LWIPDIR)/core/tcp_cc.c \
 	$(LWIPDIR)/core/tcp_in.c \
 	$(LWIPDIR)/core/tcp_out.c \
 	$(LWIPDIR)/core/timeouts.c \
@@ -956,6 +956,51 @@ netconn_send(struct netconn *conn, struct netbuf *buf)
   return err;
 }
 
+/**
+ * @ingroup netconn_udp
+ * Send several netbufs over a UDP or RAW netconn with a single API message
+ * (or a single core lock acquisition). Each netbuf is sent like with
+ * netconn_send(): to its own address if set, else to the connected peer.
+ * Sending stops at the first netbuf that fails.
+ *
+ * @param conn the UDP or RAW netconn over which to send data
+ * @param bufs array of netbufs containing the data to send
+ * @param count number of netbufs in 'bufs'
+ * @param sent if not NULL, receives the number of netbufs sent
+ * @return ERR_OK if all netbufs were sent, else the error of the first that
+ *         could not be sent
+ */
+err_t
+netconn_send_batch(struct netconn *conn, struct netbuf *bufs, u16_t count, u16_t *sent)
+{
+  API_MSG_VAR_DECLARE(msg);
+  err_t err;
+
+  if (sent != NULL) {
+    *sent = 0;
+  }
+  LWIP_ERROR("netconn_send_batch: invalid conn",  (conn != NULL), return ERR_ARG;);
+  LWIP_ERROR("netconn_send_batch: invalid bufs",  (bufs != NULL) || (count == 0), return ERR_ARG;);
+
+  if (count == 0) {
+    return ERR_OK;
+  }
+
+  LWIP_DEBUGF(API_LIB_DEBUG, ("netconn_send_batch: sending %"U16_F" netbufs\n", count));
+
+  API_MSG_VAR_ALLOC(msg);
+  API_MSG_VAR_REF(msg).conn = conn;
+  API_MSG_VAR_REF(msg).msg.sb.bufs = bufs;
+  API_MSG_VAR_REF(msg).msg.sb.cnt = count;
+  err = netconn_apimsg(lwip_netconn_do_send_batch, &API_MSG_VAR_REF(msg));
+  if (sent != NULL) {
+    *sent = API_MSG_VAR_REF(msg).msg.sb.sent;
+  }
+  API_MSG_VAR_FREE(msg);
+
+  return err;
+}
+
 /**
  * @ingroup netconn_tcp
  * Send data over a TCP netconn.
@@ -59,6 +59,14 @@
 /* netconns are polled once per second (e.g. continue write on memory error) */
 #define NETCONN_TCP_POLL_INTERVAL 2
 
+#if LWIP_TCP_TIMER_WHEEL
+/* poll_tcp() unhooks itself from idle netconns so that the TCP timers can
+   park their pcbs: hook it again when there is something to retry */
+#define NETCONN_TCP_POLL_ARM(conn) tcp_poll((conn)->pcb.tcp, poll_tcp, NETCONN_TCP_POLL_INTERVAL)
+#else /* LWIP_TCP_TIMER_WHEEL */
+#define NETCONN_TCP_POLL_ARM(conn)
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
 #define SET_NONBLOCKING_CONNECT(conn, val)  do { if (val) { \
   netconn_set_flags(conn, NETCONN_FLAG_IN_NONBLOCKING_CONNECT); \
 } else { \
@@ -384,6 +392,14 @@ poll_tcp(void *arg, struct tcp_pcb *pcb)
     }
   }
 
+#if LWIP_TCP_TIMER_WHEEL
+  if ((conn->state == NETCONN_NONE) && !(conn->flags & NETCONN_FLAG_CHECK_WRITESPACE) &&
+      (conn->pcb.tcp != NULL)) {
+    /* nothing left to retry */
+    tcp_poll(conn->pcb.tcp, NULL, NETCONN_TCP_POLL_INTERVAL);
+  }
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
   return ERR_OK;
 }
 
@@ -1523,55 +1539,95 @@ lwip_netconn_do_listen(void *m)
 #endif /* LWIP_TCP */
 
 /**
- * Send some data on a RAW or UDP pcb contained in a netconn
- * Called from netconn_send
+ * Send one netbuf on the RAW or UDP pcb of a netconn.
+ * Helper for lwip_netconn_do_send and lwip_netconn_do_send_batch.
  *
- * @param m the api_msg pointing to the connection
+ * @param conn the netconn to send on
+ * @param b the netbuf to send
+ * @return ERR_OK if sent, another err_t otherwise
  */
-void
-lwip_netconn_do_send(void *m)
+static err_t
+lwip_netconn_send_netbuf(struct netconn *conn, struct netbuf *b)
 {
-  struct api_msg *msg = (struct api_msg *)m;
+  err_t err;
 
-  err_t err = netconn_err(msg->conn);
-  if (err == ERR_OK) {
-    if (msg->conn->pcb.tcp != NULL) {
-      switch (NETCONNTYPE_GROUP(msg->conn->type)) {
+  if (conn->pcb.tcp == NULL) {
+    return ERR_CONN;
+  }
+  switch (NETCONNTYPE_GROUP(conn->type)) {
 #if LWIP_RAW
-        case NETCONN_RAW:
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = raw_send(msg->conn->pcb.raw, msg->msg.b->p);
-          } else {
-            err = raw_sendto(msg->conn->pcb.raw, msg->msg.b->p, &msg->msg.b->addr);
-          }
-          break;
+    case NETCONN_RAW:
+      if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+        err = raw_send(conn->pcb.raw, b->p);
+      } else {
+        err = raw_sendto(conn->pcb.raw, b->p, &b->addr);
+      }
+      break;
 #endif
 #if LWIP_UDP
-        case NETCONN_UDP:
+    case NETCONN_UDP:
 #if LWIP_CHECKSUM_ON_COPY
-          if (ip_addr_isany(&msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                  msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-          } else {
-            err = udp_sendto_chksum(msg->conn->pcb.udp, msg->msg.b->p,
-                                    &msg->msg.b->addr, msg->msg.b->port,
-                                    msg->msg.b->flags & NETBUF_FLAG_CHKSUM, msg->msg.b->toport_chksum);
-          }
+      if (ip_addr_isany(&b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+        err = udp_send_chksum(conn->pcb.udp, b->p,
+                              b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
+      } else {
+        err = udp_sendto_chksum(conn->pcb.udp, b->p,
+                                &b->addr, b->port,
+                                b->flags & NETBUF_FLAG_CHKSUM, b->toport_chksum);
+      }
 #else /* LWIP_CHECKSUM_ON_COPY */
-          if (ip_addr_isany_val(msg->msg.b->addr) || IP_IS_ANY_TYPE_VAL(msg->msg.b->addr)) {
-            err = udp_send(msg->conn->pcb.udp, msg->msg.b->p);
-          } else {
-            err = udp_sendto(msg->conn->pcb.udp, msg->msg.b->p, &msg->msg.b->addr, msg->msg.b->port);
-          }
+      if (ip_addr_isany_val(b->addr) || IP_IS_ANY_TYPE_VAL(b->addr)) {
+        err = udp_send(conn->pcb.udp, b->p);
+      } else {
+        err = udp_sendto(conn->pcb.udp, b->p, &b->addr, b->port);
+      }
 #endif /* LWIP_CHECKSUM_ON_COPY */
-          break;
+      break;
 #endif /* LWIP_UDP */
-        default:
-          err = ERR_CONN;
-          break;
-      }
-    } else {
+    default:
       err = ERR_CONN;
+      break;
+  }
+  return err;
+}
+
+/**
+ * Send some data on a RAW or UDP pcb contained in a netconn
+ * Called from netconn_send
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+
+  err_t err = netconn_err(msg->conn);
+  if (err == ERR_OK) {
+    err = lwip_netconn_send_netbuf(msg->conn, msg->msg.b);
+  }
+  msg->err = err;
+  TCPIP_APIMSG_ACK(msg);
+}
+
+/**
+ * Send an array of netbufs on a RAW or UDP pcb contained in a netconn,
+ * stopping at the first error.
+ * Called from netconn_send_batch
+ *
+ * @param m the api_msg pointing to the connection
+ */
+void
+lwip_netconn_do_send_batch(void *m)
+{
+  struct api_msg *msg = (struct api_msg *)m;
+
+  err_t err = netconn_err(msg->conn);
+  msg->msg.sb.sent = 0;
+  while ((err == ERR_OK) && (msg->msg.sb.sent < msg->msg.sb.cnt)) {
+    err = lwip_netconn_send_netbuf(msg->conn, &msg->msg.sb.bufs[msg->msg.sb.sent]);
+    if (err == ERR_OK) {
+      msg->msg.sb.sent++;
     }
   }
   msg->err = err;
@@ -1732,6 +1788,7 @@ err_mem:
            and let poll_tcp check writable space to mark the pcb writable again */
         API_EVENT(conn, NETCONN_EVT_SENDMINUS, 0);
         conn->flags |= NETCONN_FLAG_CHECK_WRITESPACE;
+        NETCONN_TCP_POLL_ARM(conn);
       } else if ((tcp_sndbuf(conn->pcb.tcp) <= TCP_SNDLOWAT) ||
                  (tcp_sndqueuelen(conn->pcb.tcp) >= TCP_SNDQUEUELOWAT)) {
         /* The queued byte- or pbuf-count exceeds the configured low-water limit,
@@ -1823,6 +1880,7 @@ lwip_netconn_do_write(void *m)
         err = ERR_INPROGRESS;
       } else if (msg->conn->pcb.tcp != NULL) {
         msg->conn->state = NETCONN_WRITE;
+        NETCONN_TCP_POLL_ARM(msg->conn);
         /* set all the variables used by lwip_netconn_do_writemore */
         LWIP_ASSERT("already writing or closing", msg->conn->current_msg == NULL);
         LWIP_ASSERT("msg->msg.w.len != 0", msg->msg.w.len != 0);
@@ -278,6 +278,23 @@ static volatile int select_cb_ctr;
 static struct lwip_select_cb *select_cb_list;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** The global array of epoll instances, their fds follow the socket fds */
+static struct lwip_epoll epolls[MEMP_NUM_EPOLL];
+#define LWIP_EPOLL_FD_BASE    (LWIP_SOCKET_OFFSET + NUM_SOCKETS)
+#define LWIP_EPOLL_IS_FD(fd)  (((fd) >= LWIP_EPOLL_FD_BASE) && ((fd) < LWIP_EPOLL_FD_BASE + MEMP_NUM_EPOLL))
+#if LWIP_TCPIP_CORE_LOCKING
+/* event_callback() is called with the core lock held */
+#define LWIP_EPOLL_EVENT_DECL_PROTECT(lev)
+#define LWIP_EPOLL_EVENT_PROTECT(lev)
+#define LWIP_EPOLL_EVENT_UNPROTECT(lev)
+#else /* LWIP_TCPIP_CORE_LOCKING */
+#define LWIP_EPOLL_EVENT_DECL_PROTECT(lev)  SYS_ARCH_DECL_PROTECT(lev)
+#define LWIP_EPOLL_EVENT_PROTECT(lev)       SYS_ARCH_PROTECT(lev)
+#define LWIP_EPOLL_EVENT_UNPROTECT(lev)     SYS_ARCH_UNPROTECT(lev)
+#endif /* LWIP_TCPIP_CORE_LOCKING */
+#endif /* LWIP_SOCKET_EPOLL */
+
 #define sock_set_errno(sk, e) do { \
   const int sockerr = (e); \
   set_errno(sockerr); \
@@ -291,6 +308,11 @@ static void select_check_waiters(int s, int has_recvevent, int has_sendevent, in
 #else
 #define DEFAULT_SOCKET_EVENTCB NULL
 #endif
+#if LWIP_SOCKET_EPOLL
+static void lwip_epoll_sock_event(struct lwip_sock *sock);
+static void lwip_epoll_drop_sock(struct lwip_sock *sock);
+static int lwip_epoll_close(int epfd);
+#endif /* LWIP_SOCKET_EPOLL */
 #if !LWIP_TCPIP_CORE_LOCKING
 static void lwip_getsockopt_callback(void *arg);
 static void lwip_setsockopt_callback(void *arg);
@@ -530,6 +552,9 @@ alloc_socket(struct netconn *newconn, int accepted)
       sockets[i].sendevent  = (NETCONNTYPE_GROUP(newconn->type) == NETCONN_TCP ? (accepted != 0) : 1);
       sockets[i].errevent   = 0;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+      LWIP_ASSERT("sockets[i].epoll_items == NULL", sockets[i].epoll_items == NULL);
+#endif /* LWIP_SOCKET_EPOLL */
       return i + LWIP_SOCKET_OFFSET;
     }
     SYS_ARCH_UNPROTECT(lev);
@@ -777,6 +802,12 @@ lwip_close(int s)
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_close(%d)\n", s));
 
+#if LWIP_SOCKET_EPOLL
+  if (LWIP_EPOLL_IS_FD(s)) {
+    return lwip_epoll_close(s);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
+
   sock = get_socket(s);
   if (!sock) {
     return -1;
@@ -804,6 +835,11 @@ lwip_close(int s)
     return -1;
   }
 
+#if LWIP_SOCKET_EPOLL
+  /* take the socket off all epoll instances watching it */
+  lwip_epoll_drop_sock(sock);
+#endif /* LWIP_SOCKET_EPOLL */
+
   free_socket(sock, is_tcp);
   set_errno(0);
   return 0;
@@ -1277,11 +1313,38 @@ lwip_recv(int s, void *mem, size_t len, int flags)
   return lwip_recvfrom(s, mem, len, flags, NULL, NULL);
 }
 
+/* Helper function to check the IO vectors of a msghdr passed to recvmsg()
+ * and sum up their lengths.
+ * Returns 0 or the errno to report.
+ */
+static int
+lwip_recvmsg_buflen(const struct msghdr *message, ssize_t *buflen)
+{
+  int i;
+
+  if ((message->msg_iovlen <= 0) || (message->msg_iovlen > IOV_MAX)) {
+    return EMSGSIZE;
+  }
+  if (message->msg_iov == NULL) {
+    return err_to_errno(ERR_VAL);
+  }
+  *buflen = 0;
+  for (i = 0; i < message->msg_iovlen; i++) {
+    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
+        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
+        ((ssize_t)(*buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
+      return err_to_errno(ERR_VAL);
+    }
+    *buflen = (ssize_t)(*buflen + (ssize_t)message->msg_iov[i].iov_len);
+  }
+  return 0;
+}
+
 ssize_t
 lwip_recvmsg(int s, struct msghdr *message, int flags)
 {
   struct lwip_sock *sock;
-  int i;
+  int err_num;
   ssize_t buflen;
 
   LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmsg(%d, message=%p, flags=0x%x)\n", s, (void *)message, flags));
@@ -1300,20 +1363,16 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
   }
 
   /* check for valid vectors */
-  buflen = 0;
-  for (i = 0; i < message->msg_iovlen; i++) {
-    if ((message->msg_iov[i].iov_base == NULL) || ((ssize_t)message->msg_iov[i].iov_len <= 0) ||
-        ((size_t)(ssize_t)message->msg_iov[i].iov_len != message->msg_iov[i].iov_len) ||
-        ((ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len) <= 0)) {
-      sock_set_errno(sock, err_to_errno(ERR_VAL));
-      done_socket(sock);
-      return -1;
-    }
-    buflen = (ssize_t)(buflen + (ssize_t)message->msg_iov[i].iov_len);
+  err_num = lwip_recvmsg_buflen(message, &buflen);
+  if (err_num != 0) {
+    sock_set_errno(sock, err_num);
+    done_socket(sock);
+    return -1;
   }
 
   if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
 #if LWIP_TCP
+    int i;
     int recv_flags = flags;
     message->msg_flags = 0;
     /* recv the data */
@@ -1378,6 +1437,134 @@ lwip_recvmsg(int s, struct msghdr *message, int flags)
 #endif /* LWIP_UDP || LWIP_RAW */
 }
 
+/**
+ * Receive up to 'vlen' datagrams into 'msgvec' with one socket lookup.
+ * Stops early when no datagram is pending once MSG_WAITFORONE has turned
+ * on MSG_DONTWAIT, or when 'timeout' has expired. As on Linux, the timeout
+ * is only checked after a datagram was received, so a blocking wait for
+ * the next one is not cut short by it.
+ * Stream sockets fill one entry per recvmsg().
+ */
+int
+lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+              struct timeval *timeout)
+{
+  struct lwip_sock *sock;
+  unsigned int i;
+  int recv_flags;
+  int err_num = 0;
+  u32_t time_started = 0;
+  u32_t timeout_ms = 0;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n",
+                              s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_recvmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_recvmmsg: unsupported flags", (flags & ~(MSG_PEEK | MSG_DONTWAIT | MSG_WAITFORONE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+
+  if (vlen == 0) {
+    return 0;
+  }
+  if (timeout != NULL) {
+    if ((timeout->tv_sec < 0) || (timeout->tv_usec < 0)) {
+      set_errno(EINVAL);
+      return -1;
+    }
+    timeout_ms = (u32_t)(timeout->tv_sec * 1000 + ((timeout->tv_usec + 500) / 1000));
+    time_started = sys_now();
+  }
+  recv_flags = flags & ~MSG_WAITFORONE;
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+#if LWIP_TCP
+    ssize_t ret = 0;
+    /* no datagram boundaries: let recvmsg() fill the entries one by one */
+    done_socket(sock);
+    for (i = 0; i < vlen; i++) {
+      ret = lwip_recvmsg(s, &msgvec[i].msg_hdr, recv_flags);
+      if (ret < 0) {
+        break;
+      }
+      msgvec[i].msg_len = (unsigned int)ret;
+      if ((ret == 0) || (flags & MSG_PEEK)) {
+        i++;
+        break;
+      }
+      if (flags & MSG_WAITFORONE) {
+        recv_flags |= MSG_DONTWAIT;
+      }
+      if ((timeout != NULL) && ((u32_t)(sys_now() - time_started) >= timeout_ms)) {
+        i++;
+        break;
+      }
+    }
+    /* recvmsg() has set errno if nothing was received */
+    return ((i == 0) && (ret < 0)) ? -1 : (int)i;
+#else /* LWIP_TCP */
+    sock_set_errno(sock, err_to_errno(ERR_ARG));
+    done_socket(sock);
+    return -1;
+#endif /* LWIP_TCP */
+  }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  for (i = 0; i < vlen; i++) {
+    struct msghdr *message = &msgvec[i].msg_hdr;
+    ssize_t buflen;
+    u16_t datagram_len = 0;
+    err_t err;
+
+    err_num = lwip_recvmsg_buflen(message, &buflen);
+    if (err_num != 0) {
+      break;
+    }
+    err = lwip_recvfrom_udp_raw(sock, recv_flags, message, &datagram_len, s);
+    if (err != ERR_OK) {
+      LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_recvmmsg[UDP/RAW](%d): entry %u, error is \"%s\"!\n",
+                                  s, i, lwip_strerr(err)));
+      err_num = err_to_errno(err);
+      break;
+    }
+    if (datagram_len > buflen) {
+      message->msg_flags |= MSG_TRUNC;
+    }
+    msgvec[i].msg_len = datagram_len;
+    if (flags & MSG_PEEK) {
+      /* peeking again would return the same datagram */
+      i++;
+      break;
+    }
+    if (flags & MSG_WAITFORONE) {
+      recv_flags |= MSG_DONTWAIT;
+    }
+    if ((timeout != NULL) && ((u32_t)(sys_now() - time_started) >= timeout_ms)) {
+      i++;
+      break;
+    }
+  }
+  if (i == 0) {
+    sock_set_errno(sock, err_num);
+    done_socket(sock);
+    return -1;
+  }
+  /* like on Linux, a failure after the first datagram is not reported */
+  sock_set_errno(sock, 0);
+  done_socket(sock);
+  return (int)i;
+#else /* LWIP_UDP || LWIP_RAW */
+  LWIP_UNUSED_ARG(err_num);
+  sock_set_errno(sock, err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
 ssize_t
 lwip_send(int s, const void *data, size_t size, int flags)
 {
@@ -1418,6 +1605,124 @@ lwip_send(int s, const void *data, size_t size, int flags)
   return (err == ERR_OK ? (ssize_t)written : -1);
 }
 
+#if LWIP_UDP || LWIP_RAW
+/* Helper function to build the netbuf for one datagram passed to sendmsg():
+ * sets the destination from msg_name and references (or copies, with
+ * LWIP_NETIF_TX_SINGLE_PBUF) the IO vectors.
+ * Returns ERR_VAL if the datagram is too big (EMSGSIZE); on any error,
+ * 'chain_buf' has already been freed.
+ */
+static err_t
+lwip_sendmsg_netbuf(const struct msghdr *msg, struct netbuf *chain_buf, ssize_t *size)
+{
+  err_t err = ERR_OK;
+  int i;
+
+  /* initialize chain buffer with destination */
+  memset(chain_buf, 0, sizeof(struct netbuf));
+
+  LWIP_ERROR("lwip_sendmsg: invalid msghdr iov", msg->msg_iov != NULL, return ERR_ARG;);
+  LWIP_ERROR("lwip_sendmsg: maximum iovs exceeded", (msg->msg_iovlen > 0) && (msg->msg_iovlen <= IOV_MAX),
+             return ERR_VAL;);
+  LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
+             IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
+             return ERR_ARG;);
+
+  if (msg->msg_name) {
+    u16_t remote_port;
+    SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf->addr, remote_port);
+    netbuf_fromport(chain_buf) = remote_port;
+  }
+  *size = 0;
+#if LWIP_NETIF_TX_SINGLE_PBUF
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    *size += msg->msg_iov[i].iov_len;
+    if ((msg->msg_iov[i].iov_len > INT_MAX) || (*size < (int)msg->msg_iov[i].iov_len)) {
+      /* overflow */
+      return ERR_VAL;
+    }
+  }
+  if (*size > 0xFFFF) {
+    /* overflow */
+    return ERR_VAL;
+  }
+  /* Allocate a new netbuf and copy the data into it. */
+  if (netbuf_alloc(chain_buf, (u16_t)*size) == NULL) {
+    err = ERR_MEM;
+  } else {
+    /* flatten the IO vectors */
+    size_t offset = 0;
+#if LWIP_CHECKSUM_ON_COPY
+    /* sum the data while copying each IO vector */
+    u16_t chksum = 0;
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      if (msg->msg_iov[i].iov_len > 0) {
+        pbuf_fill_chksum(chain_buf->p, (u16_t)offset, msg->msg_iov[i].iov_base,
+                         (u16_t)msg->msg_iov[i].iov_len, &chksum);
+      }
+      offset += msg->msg_iov[i].iov_len;
+    }
+    netbuf_set_chksum(chain_buf, chksum);
+#else /* LWIP_CHECKSUM_ON_COPY */
+    for (i = 0; i < msg->msg_iovlen; i++) {
+      MEMCPY(&((u8_t *)chain_buf->p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
+      offset += msg->msg_iov[i].iov_len;
+    }
+#endif /* LWIP_CHECKSUM_ON_COPY */
+    err = ERR_OK;
+  }
+#else /* LWIP_NETIF_TX_SINGLE_PBUF */
+  /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
+     manually to avoid having to allocate, chain, and delete a netbuf for each iov */
+  for (i = 0; i < msg->msg_iovlen; i++) {
+    struct pbuf *p;
+    if (msg->msg_iov[i].iov_len > 0xFFFF) {
+      /* overflow */
+      err = ERR_VAL;
+      break;
+    }
+    p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
+    if (p == NULL) {
+      err = ERR_MEM; /* let netbuf_free() cleanup chain_buf */
+      break;
+    }
+    p->payload = msg->msg_iov[i].iov_base;
+    p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
+    /* netbuf empty, add new pbuf */
+    if (chain_buf->p == NULL) {
+      chain_buf->p = chain_buf->ptr = p;
+      /* add pbuf to existing pbuf chain */
+    } else {
+      if (chain_buf->p->tot_len + p->len > 0xffff) {
+        /* overflow */
+        pbuf_free(p);
+        err = ERR_VAL;
+        break;
+      }
+      pbuf_cat(chain_buf->p, p);
+    }
+  }
+  /* save size of total chain */
+  if (err == ERR_OK) {
+    *size = netbuf_len(chain_buf);
+  }
+#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
+
+  if (err != ERR_OK) {
+    netbuf_free(chain_buf);
+    return err;
+  }
+#if LWIP_IPV4 && LWIP_IPV6
+  /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
+  if (IP_IS_V6_VAL(chain_buf->addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf->addr))) {
+    unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf->addr), ip_2_ip6(&chain_buf->addr));
+    IP_SET_TYPE_VAL(chain_buf->addr, IPADDR_TYPE_V4);
+  }
+#endif /* LWIP_IPV4 && LWIP_IPV6 */
+  return ERR_OK;
+}
+#endif /* LWIP_UDP || LWIP_RAW */
+
 ssize_t
 lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 {
@@ -1468,111 +1773,124 @@ lwip_sendmsg(int s, const struct msghdr *msg, int flags)
 #if LWIP_UDP || LWIP_RAW
   {
     struct netbuf chain_buf;
-    int i;
     ssize_t size = 0;
 
     LWIP_UNUSED_ARG(flags);
-    LWIP_ERROR("lwip_sendmsg: invalid msghdr name", (((msg->msg_name == NULL) && (msg->msg_namelen == 0)) ||
-               IS_SOCK_ADDR_LEN_VALID(msg->msg_namelen)),
-               sock_set_errno(sock, err_to_errno(ERR_ARG)); done_socket(sock); return -1;);
-
-    /* initialize chain buffer with destination */
-    memset(&chain_buf, 0, sizeof(struct netbuf));
-    if (msg->msg_name) {
-      u16_t remote_port;
-      SOCKADDR_TO_IPADDR_PORT((const struct sockaddr *)msg->msg_name, &chain_buf.addr, remote_port);
-      netbuf_fromport(&chain_buf) = remote_port;
-    }
-#if LWIP_NETIF_TX_SINGLE_PBUF
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      size += msg->msg_iov[i].iov_len;
-      if ((msg->msg_iov[i].iov_len > INT_MAX) || (size < (int)msg->msg_iov[i].iov_len)) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
-    }
-    if (size > 0xFFFF) {
-      /* overflow */
-      goto sendmsg_emsgsize;
-    }
-    /* Allocate a new netbuf and copy the data into it. */
-    if (netbuf_alloc(&chain_buf, (u16_t)size) == NULL) {
-      err = ERR_MEM;
-    } else {
-      /* flatten the IO vectors */
-      size_t offset = 0;
-      for (i = 0; i < msg->msg_iovlen; i++) {
-        MEMCPY(&((u8_t *)chain_buf.p->payload)[offset], msg->msg_iov[i].iov_base, msg->msg_iov[i].iov_len);
-        offset += msg->msg_iov[i].iov_len;
-      }
-#if LWIP_CHECKSUM_ON_COPY
-      {
-        /* This can be improved by using LWIP_CHKSUM_COPY() and aggregating the checksum for each IO vector */
-        u16_t chksum = ~inet_chksum_pbuf(chain_buf.p);
-        netbuf_set_chksum(&chain_buf, chksum);
-      }
-#endif /* LWIP_CHECKSUM_ON_COPY */
-      err = ERR_OK;
-    }
-#else /* LWIP_NETIF_TX_SINGLE_PBUF */
-    /* create a chained netbuf from the IO vectors. NOTE: we assemble a pbuf chain
-       manually to avoid having to allocate, chain, and delete a netbuf for each iov */
-    for (i = 0; i < msg->msg_iovlen; i++) {
-      struct pbuf *p;
-      if (msg->msg_iov[i].iov_len > 0xFFFF) {
-        /* overflow */
-        goto sendmsg_emsgsize;
-      }
-      p = pbuf_alloc(PBUF_TRANSPORT, 0, PBUF_REF);
-      if (p == NULL) {
-        err = ERR_MEM; /* let netbuf_delete() cleanup chain_buf */
-        break;
-      }
-      p->payload = msg->msg_iov[i].iov_base;
-      p->len = p->tot_len = (u16_t)msg->msg_iov[i].iov_len;
-      /* netbuf empty, add new pbuf */
-      if (chain_buf.p == NULL) {
-        chain_buf.p = chain_buf.ptr = p;
-        /* add pbuf to existing pbuf chain */
-      } else {
-        if (chain_buf.p->tot_len + p->len > 0xffff) {
-          /* overflow */
-          pbuf_free(p);
-          goto sendmsg_emsgsize;
-        }
-        pbuf_cat(chain_buf.p, p);
-      }
-    }
-    /* save size of total chain */
-    if (err == ERR_OK) {
-      size = netbuf_len(&chain_buf);
+    err = lwip_sendmsg_netbuf(msg, &chain_buf, &size);
+    if (err == ERR_VAL) {
+      sock_set_errno(sock, EMSGSIZE);
+      done_socket(sock);
+      return -1;
     }
-#endif /* LWIP_NETIF_TX_SINGLE_PBUF */
-
     if (err == ERR_OK) {
-#if LWIP_IPV4 && LWIP_IPV6
-      /* Dual-stack: Unmap IPv4 mapped IPv6 addresses */
-      if (IP_IS_V6_VAL(chain_buf.addr) && ip6_addr_isipv4mappedipv6(ip_2_ip6(&chain_buf.addr))) {
-        unmap_ipv4_mapped_ipv6(ip_2_ip4(&chain_buf.addr), ip_2_ip6(&chain_buf.addr));
-        IP_SET_TYPE_VAL(chain_buf.addr, IPADDR_TYPE_V4);
-      }
-#endif /* LWIP_IPV4 && LWIP_IPV6 */
-
       /* send the data */
       err = netconn_send(sock->conn, &chain_buf);
-    }
 
-    /* deallocated the buffer */
-    netbuf_free(&chain_buf);
+      /* deallocated the buffer */
+      netbuf_free(&chain_buf);
+    }
 
     sock_set_errno(sock, err_to_errno(err));
     done_socket(sock);
     return (err == ERR_OK ? size : -1);
-sendmsg_emsgsize:
-    sock_set_errno(sock, EMSGSIZE);
-    netbuf_free(&chain_buf);
+  }
+#else /* LWIP_UDP || LWIP_RAW */
+  sock_set_errno(sock, err_to_errno(ERR_ARG));
+  done_socket(sock);
+  return -1;
+#endif /* LWIP_UDP || LWIP_RAW */
+}
+
+/**
+ * Send up to 'vlen' datagrams from 'msgvec'. Datagrams are built in batches
+ * of LWIP_SOCKET_MMSG_BATCH, each batch handed to the stack with a single
+ * API message (or core lock acquisition) via netconn_send_batch().
+ * Returns the number of entries sent (with msg_len set) or -1 if the first
+ * one failed. Stream sockets send one entry per sendmsg().
+ */
+int
+lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+  struct lwip_sock *sock;
+  unsigned int done;
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_sendmmsg(%d, msgvec=%p, vlen=%u, flags=0x%x)\n",
+                              s, (void *)msgvec, vlen, flags));
+  LWIP_ERROR("lwip_sendmmsg: invalid msgvec", (msgvec != NULL) || (vlen == 0),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_sendmmsg: unsupported flags", (flags & ~(MSG_DONTWAIT | MSG_MORE)) == 0,
+             set_errno(EOPNOTSUPP); return -1;);
+
+  if (vlen == 0) {
+    return 0;
+  }
+
+  sock = get_socket(s);
+  if (!sock) {
+    return -1;
+  }
+
+  if (NETCONNTYPE_GROUP(netconn_type(sock->conn)) == NETCONN_TCP) {
+#if LWIP_TCP
+    ssize_t ret = 0;
+    done_socket(sock);
+    for (done = 0; done < vlen; done++) {
+      ret = lwip_sendmsg(s, &msgvec[done].msg_hdr, flags);
+      if (ret < 0) {
+        break;
+      }
+      msgvec[done].msg_len = (unsigned int)ret;
+    }
+    /* sendmsg() has set errno if nothing was sent */
+    return ((done == 0) && (ret < 0)) ? -1 : (int)done;
+#else /* LWIP_TCP */
+    sock_set_errno(sock, err_to_errno(ERR_ARG));
     done_socket(sock);
     return -1;
+#endif /* LWIP_TCP */
+  }
+  /* else, UDP and RAW NETCONNs */
+#if LWIP_UDP || LWIP_RAW
+  {
+    struct netbuf bufs[LWIP_SOCKET_MMSG_BATCH];
+    int err_num = 0;
+
+    LWIP_UNUSED_ARG(flags);
+    done = 0;
+    while ((done < vlen) && (err_num == 0)) {
+      u16_t built, sent, i;
+      u16_t cnt = (u16_t)LWIP_MIN(vlen - done, LWIP_SOCKET_MMSG_BATCH);
+      err_t err = ERR_OK;
+
+      for (built = 0; built < cnt; built++) {
+        ssize_t size;
+        err = lwip_sendmsg_netbuf(&msgvec[done + built].msg_hdr, &bufs[built], &size);
+        if (err != ERR_OK) {
+          err_num = (err == ERR_VAL) ? EMSGSIZE : err_to_errno(err);
+          break;
+        }
+        msgvec[done + built].msg_len = (unsigned int)size;
+      }
+
+      err = netconn_send_batch(sock->conn, bufs, built, &sent);
+      for (i = 0; i < built; i++) {
+        netbuf_free(&bufs[i]);
+      }
+      if (err != ERR_OK) {
+        err_num = err_to_errno(err);
+      }
+      done += sent;
+    }
+
+    if (done == 0) {
+      sock_set_errno(sock, err_num);
+      done_socket(sock);
+      return -1;
+    }
+    /* like on Linux, a failure after the first datagram is not reported */
+    sock_set_errno(sock, 0);
+    done_socket(sock);
+    return (int)done;
   }
 #else /* LWIP_UDP || LWIP_RAW */
   sock_set_errno(sock, err_to_errno(ERR_ARG));
@@ -2557,6 +2875,13 @@ event_callback(struct netconn *conn, enum netconn_evt evt, u16_t len)
   } else {
     SYS_ARCH_UNPROTECT(lev);
   }
+#if LWIP_SOCKET_EPOLL
+  if ((evt != NETCONN_EVT_RCVMINUS) && (evt != NETCONN_EVT_SENDMINUS)) {
+    /* every new event re-queues the registrations of this socket, so that
+       EPOLLET ones see each new arrival */
+    lwip_epoll_sock_event(sock);
+  }
+#endif /* LWIP_SOCKET_EPOLL */
   done_socket(sock);
 }
 
@@ -2648,6 +2973,399 @@ again:
 }
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
 
+#if LWIP_SOCKET_EPOLL
+/** Map an epoll fd to its instance, NULL (and errno set) if not valid */
+static struct lwip_epoll *
+lwip_epoll_get(int epfd)
+{
+  struct lwip_epoll *ep;
+
+  if (!LWIP_EPOLL_IS_FD(epfd)) {
+    set_errno(EBADF);
+    return NULL;
+  }
+  ep = &epolls[epfd - LWIP_EPOLL_FD_BASE];
+  if (!ep->used) {
+    set_errno(EBADF);
+    return NULL;
+  }
+  return ep;
+}
+
+/** Events of 'item' that its socket currently signals (epoll lock held) */
+static u32_t
+lwip_epoll_item_revents(const struct lwip_epoll_item *item)
+{
+  struct lwip_sock *sock = item->sock;
+  u32_t revents = 0;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  if (!item->armed) {
+    return 0;
+  }
+  SYS_ARCH_PROTECT(lev);
+  if ((item->events & EPOLLIN) && ((sock->lastdata.pbuf != NULL) || (sock->rcvevent > 0))) {
+    revents |= EPOLLIN;
+  }
+  if ((item->events & EPOLLOUT) && (sock->sendevent != 0)) {
+    revents |= EPOLLOUT;
+  }
+  if (sock->errevent != 0) {
+    revents |= EPOLLERR;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return revents;
+}
+
+/** Append 'item' to the ready list of its instance (epoll lock held) */
+static void
+lwip_epoll_ready_append(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  LWIP_ASSERT("item not ready", !item->ready);
+  item->ready = 1;
+  item->ready_next = NULL;
+  item->ready_prev = ep->ready_last;
+  if (ep->ready_last != NULL) {
+    ep->ready_last->ready_next = item;
+  } else {
+    ep->ready_first = item;
+  }
+  ep->ready_last = item;
+}
+
+/** Remove 'item' from the ready list of its instance (epoll lock held) */
+static void
+lwip_epoll_ready_remove(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  LWIP_ASSERT("item ready", item->ready);
+  if (item->ready_prev != NULL) {
+    item->ready_prev->ready_next = item->ready_next;
+  } else {
+    ep->ready_first = item->ready_next;
+  }
+  if (item->ready_next != NULL) {
+    item->ready_next->ready_prev = item->ready_prev;
+  } else {
+    ep->ready_last = item->ready_prev;
+  }
+  item->ready_next = item->ready_prev = NULL;
+  item->ready = 0;
+}
+
+/** Queue 'item' if its socket is ready and wake up a waiter (epoll lock held) */
+static void
+lwip_epoll_item_check(struct lwip_epoll_item *item)
+{
+  struct lwip_epoll *ep = item->ep;
+
+  if (!item->ready && (lwip_epoll_item_revents(item) != 0)) {
+    lwip_epoll_ready_append(item);
+    if (ep->waiting && !ep->sem_signalled) {
+      ep->sem_signalled = 1;
+      sys_sem_signal(&ep->sem);
+    }
+  }
+}
+
+/** Called from event_callback() for new events on 'sock' */
+static void
+lwip_epoll_sock_event(struct lwip_sock *sock)
+{
+  struct lwip_epoll_item *item;
+  LWIP_EPOLL_EVENT_DECL_PROTECT(lev);
+
+  if (sock->epoll_items == NULL) {
+    return;
+  }
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_EPOLL_EVENT_PROTECT(lev);
+  for (item = sock->epoll_items; item != NULL; item = item->sock_next) {
+    lwip_epoll_item_check(item);
+  }
+  LWIP_EPOLL_EVENT_UNPROTECT(lev);
+}
+
+/** Unlink 'item' from its socket and ready list and free it (epoll lock held) */
+static void
+lwip_epoll_item_free(struct lwip_epoll_item **pitem)
+{
+  struct lwip_epoll_item *item = *pitem;
+
+  *pitem = item->sock_next;
+  if (item->ready) {
+    lwip_epoll_ready_remove(item);
+  }
+  memp_free(MEMP_EPOLL_ITEM, item);
+}
+
+/** Drop all registrations of a socket that is being closed */
+static void
+lwip_epoll_drop_sock(struct lwip_sock *sock)
+{
+  LWIP_SOCKET_SELECT_DECL_PROTECT(lev);
+
+  LWIP_SOCKET_SELECT_PROTECT(lev);
+  while (sock->epoll_items != NULL) {
+    lwip_epoll_item_free(&sock->epoll_items);
+  }
+  LWIP_SOCKET_SELECT_UNPROTECT(lev);
+}
+
+/**
+ * Create an epoll instance. Its fd is closed with lwip_close().
+ *
+ * @param size ignored (must be > 0, as on Linux)
+ * @return the epoll fd; -1 on error
+ */
+int
+lwip_epoll_create(int size)
+{
+  int i;
+  LWIP_SOCKET_SELECT_DECL_PROTECT(lev);
+
+  LWIP_ERROR("lwip_epoll_create: invalid size", size > 0, set_errno(EINVAL); return -1;);
+
+  LWIP_SOCKET_SELECT_PROTECT(lev);
+  for (i = 0; i < MEMP_NUM_EPOLL; i++) {
+    if (!epolls[i].used) {
+      epolls[i].used = 1;
+      break;
+    }
+  }
+  LWIP_SOCKET_SELECT_UNPROTECT(lev);
+  if (i == MEMP_NUM_EPOLL) {
+    set_errno(EMFILE);
+    return -1;
+  }
+
+  epolls[i].ready_first = epolls[i].ready_last = NULL;
+  epolls[i].waiting = 0;
+  epolls[i].sem_signalled = 0;
+  if (sys_sem_new(&epolls[i].sem, 0) != ERR_OK) {
+    epolls[i].used = 0;
+    set_errno(ENOMEM);
+    return -1;
+  }
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_create() = %d\n", i + LWIP_EPOLL_FD_BASE));
+  return i + LWIP_EPOLL_FD_BASE;
+}
+
+/** Close an epoll instance: drop its registrations from all sockets */
+static int
+lwip_epoll_close(int epfd)
+{
+  struct lwip_epoll *ep = lwip_epoll_get(epfd);
+  int i;
+  LWIP_SOCKET_SELECT_DECL_PROTECT(lev);
+
+  if (ep == NULL) {
+    return -1;
+  }
+  LWIP_SOCKET_SELECT_PROTECT(lev);
+  LWIP_ASSERT("no thread waiting on a closed epoll instance", ep->waiting == 0);
+  for (i = 0; i < NUM_SOCKETS; i++) {
+    struct lwip_epoll_item **pitem = &sockets[i].epoll_items;
+    while (*pitem != NULL) {
+      if ((*pitem)->ep == ep) {
+        lwip_epoll_item_free(pitem);
+      } else {
+        pitem = &(*pitem)->sock_next;
+      }
+    }
+  }
+  LWIP_ASSERT("ready list empty", ep->ready_first == NULL);
+  ep->used = 0;
+  LWIP_SOCKET_SELECT_UNPROTECT(lev);
+  sys_sem_free(&ep->sem);
+  set_errno(0);
+  return 0;
+}
+
+/**
+ * Add, modify or remove the registration of socket 'fd' with epoll
+ * instance 'epfd'. Costs O(registrations of 'fd'), independent of the
+ * number of sockets watched by the instance.
+ */
+int
+lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event)
+{
+  struct lwip_epoll *ep;
+  struct lwip_sock *sock;
+  struct lwip_epoll_item **pitem;
+  int err_num = 0;
+  LWIP_SOCKET_SELECT_DECL_PROTECT(lev);
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_ctl(%d, op=%d, fd=%d)\n", epfd, op, fd));
+  LWIP_ERROR("lwip_epoll_ctl: invalid op", (op == EPOLL_CTL_ADD) || (op == EPOLL_CTL_DEL) || (op == EPOLL_CTL_MOD),
+             set_errno(EINVAL); return -1;);
+  LWIP_ERROR("lwip_epoll_ctl: invalid event", (event != NULL) || (op == EPOLL_CTL_DEL),
+             set_errno(EFAULT); return -1;);
+
+  ep = lwip_epoll_get(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+  sock = get_socket(fd);
+  if (!sock) {
+    return -1;
+  }
+
+  LWIP_SOCKET_SELECT_PROTECT(lev);
+  for (pitem = &sock->epoll_items; *pitem != NULL; pitem = &(*pitem)->sock_next) {
+    if ((*pitem)->ep == ep) {
+      break;
+    }
+  }
+  switch (op) {
+    case EPOLL_CTL_ADD:
+      if (*pitem != NULL) {
+        err_num = EEXIST;
+      } else {
+        struct lwip_epoll_item *item = (struct lwip_epoll_item *)memp_malloc(MEMP_EPOLL_ITEM);
+        if (item == NULL) {
+          err_num = ENOMEM;
+        } else {
+          memset(item, 0, sizeof(struct lwip_epoll_item));
+          item->ep = ep;
+          item->sock = sock;
+          item->events = event->events;
+          item->data = event->data;
+          item->armed = 1;
+          item->sock_next = sock->epoll_items;
+          sock->epoll_items = item;
+          lwip_epoll_item_check(item);
+        }
+      }
+      break;
+    case EPOLL_CTL_MOD:
+      if (*pitem == NULL) {
+        err_num = ENOENT;
+      } else {
+        (*pitem)->events = event->events;
+        (*pitem)->data = event->data;
+        (*pitem)->armed = 1;
+        lwip_epoll_item_check(*pitem);
+      }
+      break;
+    default: /* EPOLL_CTL_DEL */
+      if (*pitem == NULL) {
+        err_num = ENOENT;
+      } else {
+        lwip_epoll_item_free(pitem);
+      }
+      break;
+  }
+  LWIP_SOCKET_SELECT_UNPROTECT(lev);
+
+  sock_set_errno(sock, err_num);
+  done_socket(sock);
+  return (err_num == 0) ? 0 : -1;
+}
+
+/**
+ * Move up to 'maxevents' events of ready registrations to 'events'
+ * (epoll lock held). Registrations found not ready anymore leave the ready
+ * list, EPOLLET/EPOLLONESHOT ones leave it once reported and level-triggered
+ * ones go to its end, so that a small 'maxevents' still serves all sockets.
+ */
+static int
+lwip_epoll_collect(struct lwip_epoll *ep, struct epoll_event *events, int maxevents)
+{
+  struct lwip_epoll_item *item, *next;
+  struct lwip_epoll_item *requeue = NULL;
+  struct lwip_epoll_item **requeue_last = &requeue;
+  int nready = 0;
+
+  for (item = ep->ready_first; (item != NULL) && (nready < maxevents); item = next) {
+    u32_t revents = lwip_epoll_item_revents(item);
+    next = item->ready_next;
+    lwip_epoll_ready_remove(item);
+    if (revents == 0) {
+      continue;
+    }
+    events[nready].events = revents;
+    events[nready].data = item->data;
+    nready++;
+    if (item->events & EPOLLONESHOT) {
+      item->armed = 0;
+    } else if (!(item->events & EPOLLET)) {
+      /* level-triggered: stays ready until found otherwise */
+      *requeue_last = item;
+      requeue_last = &item->ready_next;
+    }
+  }
+  /* requeue the level-triggered registrations behind the ones not visited */
+  for (item = requeue; item != NULL; item = next) {
+    next = item->ready_next;
+    lwip_epoll_ready_append(item);
+  }
+  return nready;
+}
+
+/**
+ * Wait for events on the sockets registered with 'epfd'.
+ * Only ready registrations are visited, so the cost does not grow with the
+ * number of watched sockets. Several threads may wait on one instance, but
+ * each readiness change wakes only one of them.
+ *
+ * @param timeout in milliseconds, -1 waits forever, 0 does not wait
+ * @return number of events stored in 'events', 0 on timeout, -1 on error
+ */
+int
+lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout)
+{
+  struct lwip_epoll *ep;
+  int nready;
+  u32_t waitres = 0;
+  u32_t time_started = sys_now();
+  LWIP_SOCKET_SELECT_DECL_PROTECT(lev);
+
+  LWIP_ERROR("lwip_epoll_wait: invalid events", (events != NULL) && (maxevents > 0),
+             set_errno(EINVAL); return -1;);
+
+  ep = lwip_epoll_get(epfd);
+  if (ep == NULL) {
+    return -1;
+  }
+
+  for (;;) {
+    u32_t msectimeout = 0;
+
+    LWIP_SOCKET_SELECT_PROTECT(lev);
+    nready = lwip_epoll_collect(ep, events, maxevents);
+    if ((nready > 0) || (timeout == 0) || (waitres == SYS_ARCH_TIMEOUT)) {
+      LWIP_SOCKET_SELECT_UNPROTECT(lev);
+      break;
+    }
+    if (timeout > 0) {
+      u32_t elapsed = sys_now() - time_started;
+      if (elapsed >= (u32_t)timeout) {
+        LWIP_SOCKET_SELECT_UNPROTECT(lev);
+        break;
+      }
+      msectimeout = (u32_t)timeout - elapsed;
+    }
+    ep->waiting++;
+    ep->sem_signalled = 0;
+    LWIP_SOCKET_SELECT_UNPROTECT(lev);
+
+    waitres = sys_arch_sem_wait(&ep->sem, msectimeout);
+
+    LWIP_SOCKET_SELECT_PROTECT(lev);
+    ep->waiting--;
+    LWIP_SOCKET_SELECT_UNPROTECT(lev);
+  }
+
+  LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_epoll_wait(%d): nready=%d\n", epfd, nready));
+  set_errno(0);
+  return nready;
+}
+#endif /* LWIP_SOCKET_EPOLL */
+
 /**
  * Close one end of a full-duplex connection.
  */
@@ -3111,6 +3829,20 @@ lwip_getsockopt_impl(int s, int level, int optname, void *optval, socklen_t *opt
                                       s, *(int *)optval));
           break;
 #endif /* LWIP_TCP_KEEPALIVE */
+        case TCP_CONGESTION:
+          if (tcp_get_cc(sock->conn->pcb.tcp) == &tcp_cc_newreno) {
+            *(int *)optval = TCP_CA_NEWRENO;
+#if LWIP_TCP_CC_CUBIC
+          } else if (tcp_get_cc(sock->conn->pcb.tcp) == &tcp_cc_cubic) {
+            *(int *)optval = TCP_CA_CUBIC;
+#endif /* LWIP_TCP_CC_CUBIC */
+          } else {
+            /* an algorithm set through the raw API */
+            *(int *)optval = -1;
+          }
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) = %d\n",
+                                      s, *(int *)optval));
+          break;
         default:
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_getsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                                       s, optname));
@@ -3588,6 +4320,23 @@ lwip_setsockopt_impl(int s, int level, int optname, const void *optval, socklen_
                                       s, sock->conn->pcb.tcp->keep_cnt));
           break;
 #endif /* LWIP_TCP_KEEPALIVE */
+        case TCP_CONGESTION:
+          switch (*(const int *)optval) {
+            case TCP_CA_NEWRENO:
+              tcp_set_cc(sock->conn->pcb.tcp, &tcp_cc_newreno);
+              break;
+#if LWIP_TCP_CC_CUBIC
+            case TCP_CA_CUBIC:
+              tcp_set_cc(sock->conn->pcb.tcp, &tcp_cc_cubic);
+              break;
+#endif /* LWIP_TCP_CC_CUBIC */
+            default:
+              err = EINVAL;
+              break;
+          }
+          LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, TCP_CONGESTION) -> %s\n",
+                                      s, tcp_get_cc(sock->conn->pcb.tcp)->name));
+          break;
         default:
           LWIP_DEBUGF(SOCKETS_DEBUG, ("lwip_setsockopt(%d, IPPROTO_TCP, UNIMPL: optname=0x%x, ..)\n",
                                       s, optname));
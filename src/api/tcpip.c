@@ -49,6 +49,9 @@
 #include "lwip/pbuf.h"
 #include "lwip/etharp.h"
 #include "netif/ethernet.h"
+#include "lwip/gro.h"
+
+#include <string.h>
 
 #define TCPIP_MSG_VAR_REF(name)     API_VAR_REF(name)
 #define TCPIP_MSG_VAR_DECLARE(name) API_VAR_DECLARE(struct tcpip_msg, name)
@@ -127,6 +130,9 @@ static void
 tcpip_thread(void *arg)
 {
   struct tcpip_msg *msg;
+#if LWIP_TCP_GRO
+  u16_t gro_batch = 0;
+#endif /* LWIP_TCP_GRO */
   LWIP_UNUSED_ARG(arg);
 
   LWIP_MARK_TCPIP_THREAD();
@@ -138,8 +144,20 @@ tcpip_thread(void *arg)
 
   while (1) {                          /* MAIN Loop */
     LWIP_TCPIP_THREAD_ALIVE();
+#if LWIP_TCP_GRO
+    /* a full fetch processes due timeouts and releases the core lock, so
+       a busy mbox must not keep the loop on the tryfetch path for ever */
+    if (!gro_pending() || (++gro_batch >= TCP_GRO_MAX_BATCH) ||
+        (sys_arch_mbox_tryfetch(&tcpip_mbox, (void **)&msg) == SYS_MBOX_EMPTY)) {
+      /* end of a batch of input: pass on coalesced segments before waiting */
+      gro_flush(NULL);
+      gro_batch = 0;
+      TCPIP_MBOX_FETCH(&tcpip_mbox, (void **)&msg);
+    }
+#else /* LWIP_TCP_GRO */
     /* wait for a message, timeouts are processed while waiting */
     TCPIP_MBOX_FETCH(&tcpip_mbox, (void **)&msg);
+#endif /* LWIP_TCP_GRO */
     if (msg == NULL) {
       LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: invalid message: NULL\n"));
       LWIP_ASSERT("tcpip_thread: invalid message", 0);
@@ -176,6 +194,20 @@ tcpip_thread_handle_msg(struct tcpip_msg *msg)
       }
       memp_free(MEMP_TCPIP_MSG_INPKT, msg);
       break;
+#if LWIP_TCPIP_BATCH_INPUT
+    case TCPIP_MSG_INPKT_BATCH: {
+      struct tcpip_inpkt_batch_msg *bmsg = (struct tcpip_inpkt_batch_msg *)msg;
+      u16_t i;
+      LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_thread: PACKET BATCH %p (%"U16_F")\n", (void *)msg, bmsg->num));
+      for (i = 0; i < bmsg->num; i++) {
+        if (bmsg->input_fn(bmsg->p[i], bmsg->netif) != ERR_OK) {
+          pbuf_free(bmsg->p[i]);
+        }
+      }
+      memp_free(MEMP_TCPIP_MSG_INPKT_BATCH, bmsg);
+      break;
+    }
+#endif /* LWIP_TCPIP_BATCH_INPUT */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
@@ -290,6 +322,86 @@ tcpip_input(struct pbuf *p, struct netif *inp)
     return tcpip_inpkt(p, inp, ip_input);
 }
 
+#if LWIP_TCPIP_BATCH_INPUT
+/**
+ * Pass a burst of received packets to tcpip_thread for input processing.
+ * The packets travel in messages of up to TCPIP_BATCH_INPUT_MAX packets, so
+ * tcpip_thread handles a whole burst per wakeup instead of one packet each.
+ *
+ * @param pkts array of received packets
+ * @param num number of packets in pkts
+ * @param inp the network interface on which the packets were received
+ * @param input_fn input function to call
+ * @return number of packets taken over: pkts[0] up to (excluding) the returned
+ *         index now belong to the stack, the rest (if the mbox or the
+ *         message pool ran out) still belong to the caller
+ */
+u16_t
+tcpip_inpkt_batch(struct pbuf **pkts, u16_t num, struct netif *inp, netif_input_fn input_fn)
+{
+#if LWIP_TCPIP_CORE_LOCKING_INPUT
+  u16_t i;
+  LWIP_DEBUGF(TCPIP_DEBUG, ("tcpip_inpkt_batch: %"U16_F" PACKETS/%p\n", num, (void *)inp));
+  LOCK_TCPIP_CORE();
+  for (i = 0; i < num; i++) {
+    /* same as the tcpip_thread path: a packet refused by input_fn is dropped */
+    if (input_fn(pkts[i], inp) != ERR_OK) {
+      pbuf_free(pkts[i]);
+    }
+  }
+  UNLOCK_TCPIP_CORE();
+  return num;
+#else /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+  struct tcpip_inpkt_batch_msg *msg;
+  u16_t done = 0;
+
+  LWIP_ASSERT("Invalid mbox", sys_mbox_valid_val(tcpip_mbox));
+  LWIP_ASSERT("invalid packet array", (pkts != NULL) || (num == 0));
+
+  while (done < num) {
+    u16_t n = (u16_t)LWIP_MIN(num - done, TCPIP_BATCH_INPUT_MAX);
+
+    msg = (struct tcpip_inpkt_batch_msg *)memp_malloc(MEMP_TCPIP_MSG_INPKT_BATCH);
+    if (msg == NULL) {
+      break;
+    }
+    msg->type = TCPIP_MSG_INPKT_BATCH;
+    msg->netif = inp;
+    msg->input_fn = input_fn;
+    msg->num = n;
+    MEMCPY(msg->p, &pkts[done], n * sizeof(struct pbuf *));
+    if (sys_mbox_trypost(&tcpip_mbox, msg) != ERR_OK) {
+      memp_free(MEMP_TCPIP_MSG_INPKT_BATCH, msg);
+      break;
+    }
+    done = (u16_t)(done + n);
+  }
+  return done;
+#endif /* LWIP_TCPIP_CORE_LOCKING_INPUT */
+}
+
+/**
+ * @ingroup lwip_os
+ * Pass a burst of received packets to tcpip_thread for input processing
+ * with ethernet_input or ip_input (see tcpip_input()).
+ *
+ * @param pkts array of received packets
+ * @param num number of packets in pkts
+ * @param inp the network interface on which the packets were received
+ * @return number of packets taken over, see tcpip_inpkt_batch()
+ */
+u16_t
+tcpip_input_batch(struct pbuf **pkts, u16_t num, struct netif *inp)
+{
+#if LWIP_ETHERNET
+  if (inp->flags & (NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET)) {
+    return tcpip_inpkt_batch(pkts, num, inp, ethernet_input);
+  } else
+#endif /* LWIP_ETHERNET */
+    return tcpip_inpkt_batch(pkts, num, inp, ip_input);
+}
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+
 /**
  * @ingroup lwip_os
  * Call a specific function in the thread context of
@@ -589,6 +701,186 @@ tcpip_callbackmsg_trycallback_fromisr(struct tcpip_callback_msg *msg)
   return sys_mbox_trypost_fromisr(&tcpip_mbox, msg);
 }
 
+#if LWIP_TCPIP_BATCH_INPUT
+/** Drain a receive ring in tcpip_thread. At most one ring's worth of packets
+ * is handled per call so a busy ring can't starve the mbox; if more arrived
+ * meanwhile, the drain is posted again. */
+static void
+tcpip_rx_ring_drain(void *arg)
+{
+  struct tcpip_rx_ring *ring = (struct tcpip_rx_ring *)arg;
+  u16_t head;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  head = ring->head;
+  SYS_ARCH_UNPROTECT(lev);
+
+  while (ring->tail != head) {
+    u16_t idx = (u16_t)(ring->tail & (ring->size - 1));
+    struct pbuf *p = ring->slots[idx];
+    ring->slots[idx] = NULL;
+    SYS_ARCH_PROTECT(lev);
+    ring->tail++;
+    SYS_ARCH_UNPROTECT(lev);
+    if (ring->input_fn(p, ring->netif) != ERR_OK) {
+      pbuf_free(p);
+    }
+  }
+
+  SYS_ARCH_PROTECT(lev);
+  if (ring->head == ring->tail) {
+    ring->scheduled = 0;
+  } else if (tcpip_callbackmsg_trycallback(ring->msg) != ERR_OK) {
+    /* mbox full: the next kick posts the drain again */
+    ring->scheduled = 0;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * @ingroup lwip_os
+ * Initialize a receive ring: the driver puts received packets into the ring
+ * with tcpip_rx_ring_put() and kicks tcpip_thread once per burst with
+ * tcpip_rx_ring_kick(); tcpip_thread then passes all of them to input_fn in
+ * one go, without allocating a message per packet.
+ *
+ * @param ring the ring to initialize
+ * @param slots storage for the ring, 'size' entries
+ * @param size number of slots, must be a power of two (max. 32768)
+ * @param inp the network interface the packets are received on
+ * @param input_fn input function to call (e.g. ethernet_input)
+ * @return ERR_OK or ERR_MEM if the drain message could not be allocated
+ */
+err_t
+tcpip_rx_ring_init(struct tcpip_rx_ring *ring, struct pbuf **slots, u16_t size,
+                   struct netif *inp, netif_input_fn input_fn)
+{
+  LWIP_ERROR("tcpip_rx_ring_init: invalid arguments",
+             (ring != NULL) && (slots != NULL) && (input_fn != NULL), return ERR_ARG;);
+  LWIP_ERROR("tcpip_rx_ring_init: size must be a power of two",
+             (size != 0) && ((size & (size - 1)) == 0) && (size <= 0x8000), return ERR_ARG;);
+
+  memset(ring, 0, sizeof(*ring));
+  memset(slots, 0, size * sizeof(struct pbuf *));
+  ring->slots = slots;
+  ring->size = size;
+  ring->netif = inp;
+  ring->input_fn = input_fn;
+  ring->msg = tcpip_callbackmsg_new(tcpip_rx_ring_drain, ring);
+  if (ring->msg == NULL) {
+    return ERR_MEM;
+  }
+  return ERR_OK;
+}
+
+/**
+ * @ingroup lwip_os
+ * Free the packets left in a receive ring and its drain message.
+ * The drain must not be pending, i.e. call this from tcpip_thread or
+ * after the ring stopped being kicked and the mbox was processed.
+ *
+ * @param ring the ring to deinitialize
+ */
+void
+tcpip_rx_ring_deinit(struct tcpip_rx_ring *ring)
+{
+  LWIP_ASSERT("tcpip_rx_ring_deinit: drain still pending", !ring->scheduled);
+  while (ring->tail != ring->head) {
+    u16_t idx = (u16_t)(ring->tail & (ring->size - 1));
+    pbuf_free(ring->slots[idx]);
+    ring->slots[idx] = NULL;
+    ring->tail++;
+  }
+  if (ring->msg != NULL) {
+    tcpip_callbackmsg_delete(ring->msg);
+    ring->msg = NULL;
+  }
+}
+
+/**
+ * @ingroup lwip_os
+ * Put a received packet into a receive ring. Only one context (the driver's
+ * receive path or ISR) may put packets into a ring.
+ *
+ * @param ring the ring to fill
+ * @param p the received packet
+ * @return ERR_OK if the ring took over the packet, ERR_MEM if it is full
+ *         (the packet still belongs to the caller then)
+ */
+err_t
+tcpip_rx_ring_put(struct tcpip_rx_ring *ring, struct pbuf *p)
+{
+  u16_t head;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  head = ring->head;
+  if ((u16_t)(head - ring->tail) >= ring->size) {
+    SYS_ARCH_UNPROTECT(lev);
+    return ERR_MEM;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+
+  ring->slots[head & (ring->size - 1)] = p;
+
+  SYS_ARCH_PROTECT(lev);
+  ring->head = (u16_t)(head + 1);
+  SYS_ARCH_UNPROTECT(lev);
+  return ERR_OK;
+}
+
+/**
+ * @ingroup lwip_os
+ * Schedule tcpip_thread to drain a receive ring. Nothing is posted if a
+ * drain is already pending, so this can be called after every put.
+ *
+ * @param ring the ring to drain
+ * @return ERR_OK or the tcpip_callbackmsg_trycallback() error
+ */
+err_t
+tcpip_rx_ring_kick(struct tcpip_rx_ring *ring)
+{
+  err_t err = ERR_OK;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if (!ring->scheduled) {
+    err = tcpip_callbackmsg_trycallback(ring->msg);
+    if (err == ERR_OK) {
+      ring->scheduled = 1;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return err;
+}
+
+/**
+ * @ingroup lwip_os
+ * Same as tcpip_rx_ring_kick() but posts with
+ * tcpip_callbackmsg_trycallback_fromisr().
+ *
+ * @param ring the ring to drain
+ * @return ERR_OK or the tcpip_callbackmsg_trycallback_fromisr() error
+ */
+err_t
+tcpip_rx_ring_kick_fromisr(struct tcpip_rx_ring *ring)
+{
+  err_t err = ERR_OK;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  if (!ring->scheduled) {
+    err = tcpip_callbackmsg_trycallback_fromisr(ring->msg);
+    if (err == ERR_OK) {
+      ring->scheduled = 1;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+  return err;
+}
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+
 /**
  * @ingroup lwip_os
  * Initialize this module:
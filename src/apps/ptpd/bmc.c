@@ -55,18 +55,18 @@ bcm_init_data(ptp_clock_t* clock)
   clock->port_ds.log_min_delay_req_interval = PTPD_DEFAULT_DELAYREQ_INTERVAL;
   clock->port_ds.peer_mean_path_delay.seconds = clock->port_ds.peer_mean_path_delay.nanoseconds = 0;
   clock->port_ds.log_announce_interval = opts->announce_interval;
-  clock->port_ds.announce_receipt_timeout = PTPD_DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT;
+  clock->port_ds.announce_receipt_timeout = opts->announce_receipt_timeout;
   clock->port_ds.log_sync_interval = opts->sync_interval;
   clock->port_ds.delay_mechanism = opts->delay_mechanism;
-  clock->port_ds.log_min_pdelay_req_interval = PTPD_DEFAULT_PDELAYREQ_INTERVAL;
+  clock->port_ds.log_min_pdelay_req_interval = opts->pdelay_req_interval;
   clock->port_ds.versionNumber = PTPD_VERSION_PTP;
+  clock->port_ds.delay_asymmetry = opts->delay_asymmetry;
 
   /* Init other stuff */
   clock->foreign_master_ds.count = 0;
   clock->foreign_master_ds.capacity = opts->max_foreign_records;
 
-  clock->inbound_latency = opts->inbound_latency;
-  clock->outbound_latency = opts->outbound_latency;
+  servo_set_link_speed(clock, clock->link_speed);
 
   clock->servo.s_delay = opts->servo.s_delay;
   clock->servo.s_offset = opts->servo.s_offset;
@@ -75,6 +75,9 @@ bcm_init_data(ptp_clock_t* clock)
   clock->servo.no_adjust = opts->servo.no_adjust;
   clock->servo.no_reset_clock = opts->servo.no_reset_clock;
 
+  clock->calibration.samples = 0;
+  servo_calibrate_asymmetry(clock, opts->calibration_samples, NULL);
+
   clock->stats = opts->stats;
 }
 
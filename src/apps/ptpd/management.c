@@ -0,0 +1,460 @@
+/* management.c */
+
+#include <lwip/apps/ptpd.h>
+
+/* Offset of the dataField of a management TLV */
+#define MM_DATA (PTPD_MANAGEMENT_LENGTH + PTPD_MANAGEMENT_TLV_LENGTH)
+
+/* Pack TimeInterval (5.3.2) */
+static void
+pack_time_interval(octet_t *buf, const time_interval_t *internal)
+{
+  int64_t scaled = ((int64_t)internal->seconds * 1000000000 + internal->nanoseconds) * 65536;
+
+  *(int32_t*)(buf + 0) = flip32((int32_t)(scaled >> 32));
+  *(int32_t*)(buf + 4) = flip32((int32_t)scaled);
+}
+
+static void
+pack_port_identity(octet_t *buf, const port_identity_t *identity)
+{
+  memcpy(buf, identity->clock_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  *(int16_t*)(buf + 8) = flip16(identity->port_number);
+}
+
+static void
+pack_clock_quality(octet_t *buf, const clock_quality_t *quality)
+{
+  *(uint8_t*)(buf + 0) = quality->clock_class;
+  *(enum8bit_t*)(buf + 1) = quality->clock_accuracy;
+  *(int16_t*)(buf + 2) = flip16(quality->offset_scaled_log_variance);
+}
+
+/* Pack the dataField of a GET response (15.5.3) from a snapshot, returns its
+   length or the negated managementErrorId */
+static int32_t
+pack_data(const ptpd_snapshot_t *ds, enum16bit_t management_id, octet_t *buf)
+{
+  time_interval_t now;
+  timestamp_t timestamp;
+
+  switch (management_id)
+  {
+    case MM_NULL_MANAGEMENT:
+      return 0;
+
+    case MM_DEFAULT_DATA_SET:
+      *(uint8_t*)(buf + 0) = (ds->default_ds.two_step_flag ? 0x01 : 0) | (ds->default_ds.slave_only ? 0x02 : 0);
+      *(uint8_t*)(buf + 1) = 0;
+      *(int16_t*)(buf + 2) = flip16(ds->default_ds.number_ports);
+      *(uint8_t*)(buf + 4) = ds->default_ds.priority1;
+      pack_clock_quality(buf + 5, &ds->default_ds.clock_quality);
+      *(uint8_t*)(buf + 9) = ds->default_ds.priority2;
+      memcpy((buf + 10), ds->default_ds.clock_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+      *(uint8_t*)(buf + 18) = ds->default_ds.domain_number;
+      *(uint8_t*)(buf + 19) = 0;
+      return 20;
+
+    case MM_CURRENT_DATA_SET:
+      *(int16_t*)(buf + 0) = flip16(ds->current_ds.steps_removed);
+      pack_time_interval(buf + 2, &ds->current_ds.offset_from_master);
+      pack_time_interval(buf + 10, &ds->current_ds.mean_path_delay);
+      return 18;
+
+    case MM_PARENT_DATA_SET:
+      pack_port_identity(buf + 0, &ds->parent_ds.parent_port_identity);
+      *(uint8_t*)(buf + 10) = ds->parent_ds.parent_stats ? 0x01 : 0;
+      *(uint8_t*)(buf + 11) = 0;
+      *(int16_t*)(buf + 12) = flip16(ds->parent_ds.observed_parent_offset_scaled_log_variance);
+      *(int32_t*)(buf + 14) = flip32(ds->parent_ds.observed_parent_clock_phase_change_rate);
+      *(uint8_t*)(buf + 18) = ds->parent_ds.grandmaster_priority1;
+      pack_clock_quality(buf + 19, &ds->parent_ds.grandmaster_clock_quality);
+      *(uint8_t*)(buf + 23) = ds->parent_ds.grandmaster_priority2;
+      memcpy((buf + 24), ds->parent_ds.grandmaster_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+      return 32;
+
+    case MM_TIME_PROPERTIES_DATA_SET:
+      *(int16_t*)(buf + 0) = flip16(ds->time_properties_ds.current_utc_offset);
+      *(uint8_t*)(buf + 2) = (ds->time_properties_ds.leap61 ? FLAG1_LEAP61 : 0) |
+                             (ds->time_properties_ds.leap59 ? FLAG1_LEAP59 : 0) |
+                             (ds->time_properties_ds.current_utc_offset_valid ? FLAG1_UTC_OFFSET_VALID : 0) |
+                             (ds->time_properties_ds.ptp_timescale ? FLAG1_PTP_TIMESCALE : 0) |
+                             (ds->time_properties_ds.time_traceable ? FLAG1_TIME_TRACEABLE : 0) |
+                             (ds->time_properties_ds.frequency_traceable ? FLAG1_FREQUENCY_TRACEABLE : 0);
+      *(enum8bit_t*)(buf + 3) = ds->time_properties_ds.time_source;
+      return 4;
+
+    case MM_PORT_DATA_SET:
+      pack_port_identity(buf + 0, &ds->port_ds.port_identity);
+      *(enum8bit_t*)(buf + 10) = ds->port_ds.port_state + 1; /* Table 8 starts at INITIALIZING = 1 */
+      *(int8_t*)(buf + 11) = ds->port_ds.log_min_delay_req_interval;
+      pack_time_interval(buf + 12, &ds->port_ds.peer_mean_path_delay);
+      *(int8_t*)(buf + 20) = ds->port_ds.log_announce_interval;
+      *(uint8_t*)(buf + 21) = ds->port_ds.announce_receipt_timeout;
+      *(int8_t*)(buf + 22) = ds->port_ds.log_sync_interval;
+      *(enum8bit_t*)(buf + 23) = ds->port_ds.delay_mechanism;
+      *(int8_t*)(buf + 24) = ds->port_ds.log_min_pdelay_req_interval;
+      *(uint8_t*)(buf + 25) = ds->port_ds.versionNumber & 0x0F;
+      return 26;
+
+    case MM_PRIORITY1:
+      *(uint8_t*)(buf + 0) = ds->default_ds.priority1;
+      break;
+
+    case MM_PRIORITY2:
+      *(uint8_t*)(buf + 0) = ds->default_ds.priority2;
+      break;
+
+    case MM_DOMAIN:
+      *(uint8_t*)(buf + 0) = ds->default_ds.domain_number;
+      break;
+
+    case MM_SLAVE_ONLY:
+      *(uint8_t*)(buf + 0) = ds->default_ds.slave_only ? 0x01 : 0;
+      break;
+
+    case MM_LOG_ANNOUNCE_INTERVAL:
+      *(int8_t*)(buf + 0) = ds->port_ds.log_announce_interval;
+      break;
+
+    case MM_ANNOUNCE_RECEIPT_TIMEOUT:
+      *(uint8_t*)(buf + 0) = ds->port_ds.announce_receipt_timeout;
+      break;
+
+    case MM_LOG_SYNC_INTERVAL:
+      *(int8_t*)(buf + 0) = ds->port_ds.log_sync_interval;
+      break;
+
+    case MM_VERSION_NUMBER:
+      *(uint8_t*)(buf + 0) = ds->port_ds.versionNumber & 0x0F;
+      break;
+
+    case MM_TIME:
+      sys_get_clocktime(&now);
+      ptp_time_from_internal(&now, &timestamp);
+      *(int16_t*)(buf + 0) = flip16(timestamp.seconds_field.msb);
+      *(uint32_t*)(buf + 2) = flip32(timestamp.seconds_field.lsb);
+      *(uint32_t*)(buf + 6) = flip32(timestamp.nanoseconds_field);
+      return 10;
+
+    case MM_CLOCK_ACCURACY:
+      *(enum8bit_t*)(buf + 0) = ds->default_ds.clock_quality.clock_accuracy;
+      break;
+
+    case MM_UTC_PROPERTIES:
+      *(int16_t*)(buf + 0) = flip16(ds->time_properties_ds.current_utc_offset);
+      *(uint8_t*)(buf + 2) = (ds->time_properties_ds.leap61 ? FLAG1_LEAP61 : 0) |
+                             (ds->time_properties_ds.leap59 ? FLAG1_LEAP59 : 0) |
+                             (ds->time_properties_ds.current_utc_offset_valid ? FLAG1_UTC_OFFSET_VALID : 0);
+      *(uint8_t*)(buf + 3) = 0;
+      return 4;
+
+    case MM_TRACEABILITY_PROPERTIES:
+      *(uint8_t*)(buf + 0) = (ds->time_properties_ds.time_traceable ? FLAG1_TIME_TRACEABLE : 0) |
+                             (ds->time_properties_ds.frequency_traceable ? FLAG1_FREQUENCY_TRACEABLE : 0);
+      break;
+
+    case MM_TIMESCALE_PROPERTIES:
+      *(uint8_t*)(buf + 0) = ds->time_properties_ds.ptp_timescale ? FLAG1_PTP_TIMESCALE : 0;
+      *(enum8bit_t*)(buf + 1) = ds->time_properties_ds.time_source;
+      return 2;
+
+    case MM_DELAY_MECHANISM:
+      *(enum8bit_t*)(buf + 0) = ds->port_ds.delay_mechanism;
+      break;
+
+    case MM_LOG_MIN_PDELAY_REQ_INTERVAL:
+      *(int8_t*)(buf + 0) = ds->port_ds.log_min_pdelay_req_interval;
+      break;
+
+    default:
+      return -MM_ERROR_NO_SUCH_ID;
+  }
+
+  /* One octet values are followed by a reserved octet */
+  *(uint8_t*)(buf + 1) = 0;
+  return 2;
+}
+
+/* Apply the dataField of a SET (15.5.3) to the data sets and to the run
+   time options, so that the value survives a reinitialization. Returns 0 or
+   the negated managementErrorId. Interval changes are taken into account
+   by the timers when they are next started. */
+static int32_t
+apply_set(ptp_clock_t *clock, enum16bit_t management_id, const octet_t *data, uint16_t length)
+{
+  uint8_t value;
+
+  switch (management_id)
+  {
+    case MM_PRIORITY1:
+    case MM_PRIORITY2:
+    case MM_DOMAIN:
+    case MM_SLAVE_ONLY:
+    case MM_LOG_ANNOUNCE_INTERVAL:
+    case MM_ANNOUNCE_RECEIPT_TIMEOUT:
+    case MM_LOG_SYNC_INTERVAL:
+    case MM_CLOCK_ACCURACY:
+    case MM_DELAY_MECHANISM:
+    case MM_LOG_MIN_PDELAY_REQ_INTERVAL:
+      if (length < 2)
+      {
+        return -MM_ERROR_WRONG_LENGTH;
+      }
+      value = *(uint8_t*)(data + 0);
+      break;
+
+    case MM_NULL_MANAGEMENT:
+      return 0;
+
+    case MM_DEFAULT_DATA_SET:
+    case MM_CURRENT_DATA_SET:
+    case MM_PARENT_DATA_SET:
+    case MM_TIME_PROPERTIES_DATA_SET:
+    case MM_PORT_DATA_SET:
+    case MM_VERSION_NUMBER:
+    case MM_TIME:
+    case MM_UTC_PROPERTIES:
+    case MM_TRACEABILITY_PROPERTIES:
+    case MM_TIMESCALE_PROPERTIES:
+      return -MM_ERROR_NOT_SETABLE;
+
+    default:
+      return -MM_ERROR_NO_SUCH_ID;
+  }
+
+  switch (management_id)
+  {
+    case MM_PRIORITY1:
+      clock->default_ds.priority1 = clock->opts->priority1 = value;
+      break;
+
+    case MM_PRIORITY2:
+      clock->default_ds.priority2 = clock->opts->priority2 = value;
+      break;
+
+    case MM_DOMAIN:
+      if (value > 127)
+      {
+        return -MM_ERROR_WRONG_VALUE;
+      }
+      /* Foreign masters of the previous domain are meaningless */
+      clock->default_ds.domain_number = clock->opts->domain_number = value;
+      ptp_to_state(clock, PTP_INITIALIZING);
+      break;
+
+    case MM_SLAVE_ONLY:
+      clock->default_ds.slave_only = clock->opts->slave_only = (value & 0x01) ? TRUE : FALSE;
+      clock->opts->clock_quality.clock_class = clock->opts->slave_only ? PTPD_DEFAULT_CLOCK_CLASS_SLAVE_ONLY :
+                                                                          PTPD_DEFAULT_CLOCK_CLASS;
+      clock->default_ds.clock_quality.clock_class = clock->opts->clock_quality.clock_class;
+      break;
+
+    case MM_LOG_ANNOUNCE_INTERVAL:
+      clock->port_ds.log_announce_interval = clock->opts->announce_interval = (int8_t)value;
+      break;
+
+    case MM_ANNOUNCE_RECEIPT_TIMEOUT:
+      if (value < 2)
+      {
+        return -MM_ERROR_WRONG_VALUE;
+      }
+      clock->port_ds.announce_receipt_timeout = clock->opts->announce_receipt_timeout = value;
+      break;
+
+    case MM_LOG_SYNC_INTERVAL:
+      clock->port_ds.log_sync_interval = clock->opts->sync_interval = (int8_t)value;
+      break;
+
+    case MM_CLOCK_ACCURACY:
+      clock->default_ds.clock_quality.clock_accuracy = clock->opts->clock_quality.clock_accuracy = value;
+      break;
+
+    case MM_DELAY_MECHANISM:
+      if ((value != E2E) && (value != P2P))
+      {
+        return -MM_ERROR_WRONG_VALUE;
+      }
+      /* The delay request timers of the new mechanism start from scratch */
+      clock->port_ds.delay_mechanism = clock->opts->delay_mechanism = value;
+      ptp_to_state(clock, PTP_INITIALIZING);
+      break;
+
+    case MM_LOG_MIN_PDELAY_REQ_INTERVAL:
+      clock->port_ds.log_min_pdelay_req_interval = clock->opts->pdelay_req_interval = (int8_t)value;
+      break;
+
+    default:
+      break;
+  }
+
+  return 0;
+}
+
+/* 15.3.2 targetPortIdentity, all ones is a wildcard */
+static bool
+is_target(const ptp_clock_t *clock, const port_identity_t *target)
+{
+  int i;
+  bool all_ones = TRUE;
+
+  for (i = 0; i < PTPD_CLOCK_IDENTITY_LENGTH; i++)
+  {
+    all_ones = all_ones && ((uint8_t)target->clock_identity[i] == 0xFF);
+  }
+
+  if (!all_ones && memcmp(target->clock_identity, clock->port_ds.port_identity.clock_identity, PTPD_CLOCK_IDENTITY_LENGTH))
+  {
+    return FALSE;
+  }
+
+  return (target->port_number == (int16_t)0xFFFF) || (target->port_number == clock->port_ds.port_identity.port_number);
+}
+
+void
+management_handle(ptp_clock_t *clock)
+{
+  msg_management *manage = &clock->msgTmp.manage;
+  msg_management reply;
+  octet_t *out = clock->bfr_mgmt_out;
+  const ptpd_snapshot_t *ds;
+  uint16_t length;
+  int32_t ret = 0;
+
+  if (clock->msg_bfr_in_len < MM_DATA)
+  {
+    DBGV("management_handle: no management TLV\n");
+    return;
+  }
+
+  msg_unpack_management(clock->bfr_msg_in, manage);
+
+  if (!is_target(clock, &manage->target_port_identity))
+  {
+    DBGV("management_handle: not for us\n");
+    return;
+  }
+
+  /* Only the manager acts on RESPONSE and ACKNOWLEDGE */
+  if ((manage->action_field != MM_GET) && (manage->action_field != MM_SET) && (manage->action_field != MM_COMMAND))
+  {
+    DBGV("management_handle: ignore action %d\n", manage->action_field);
+    return;
+  }
+
+  /* 15.3.4 response header */
+  memcpy(&reply.target_port_identity, &clock->bfr_header.source_port_identity, sizeof(port_identity_t));
+  reply.starting_boundary_hops = manage->starting_boundary_hops - manage->boundary_hops;
+  reply.boundary_hops = reply.starting_boundary_hops;
+  reply.action_field = (manage->action_field == MM_COMMAND) ? MM_ACKNOWLEDGE : MM_RESPONSE;
+  reply.tlv_type = TLV_MANAGEMENT;
+  reply.management_id = manage->management_id;
+
+  if ((manage->tlv_type != TLV_MANAGEMENT) || (manage->length_field < 2) ||
+      (PTPD_MANAGEMENT_LENGTH + 4 + manage->length_field > clock->msg_bfr_in_len))
+  {
+    ret = -MM_ERROR_WRONG_LENGTH;
+  }
+  else
+  {
+    length = manage->length_field - 2;
+
+    switch (manage->action_field)
+    {
+      case MM_SET:
+        ret = apply_set(clock, manage->management_id, manage->data_field, length);
+        if (ret == 0)
+        {
+          /* Answer with the value in effect */
+          management_publish(clock);
+        }
+        break;
+
+      case MM_COMMAND:
+        switch (manage->management_id)
+        {
+          case MM_NULL_MANAGEMENT:
+            break;
+
+          case MM_ENABLE_PORT:
+            /* DESIGNATED_ENABLED */
+            if (clock->port_ds.port_state == PTP_DISABLED)
+            {
+              ptp_to_state(clock, PTP_INITIALIZING);
+            }
+            break;
+
+          case MM_DISABLE_PORT:
+            /* DESIGNATED_DISABLED */
+            ptp_to_state(clock, PTP_DISABLED);
+            break;
+
+          default:
+            ret = -MM_ERROR_NOT_SUPPORTED;
+            break;
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  if ((ret == 0) && (manage->action_field != MM_COMMAND))
+  {
+    /* GET and SET are answered from the snapshot, never from the data sets
+       the protocol engine is updating */
+    ds = &clock->snapshot[clock->snapshot_seq & 1];
+    ret = pack_data(ds, manage->management_id, out + MM_DATA);
+  }
+
+  if (ret < 0)
+  {
+    DBG("management_handle: error %d for id 0x%04x\n", -ret, manage->management_id);
+    reply.tlv_type = TLV_MANAGEMENT_ERROR_STATUS;
+    /* 15.5.4.4: reserved, then an empty displayData PTPText (length octet
+       and pad octet) */
+    reply.length_field = 10;
+    *(enum16bit_t*)(out + 52) = flip16((enum16bit_t)-ret);
+    *(enum16bit_t*)(out + 54) = flip16(manage->management_id);
+    memset((out + 56), 0, 6);
+  }
+  else
+  {
+    reply.length_field = 2 + ret;
+  }
+
+  ptpd_send_general(&clock->net_path, out,
+                    msg_pack_management(clock, out, clock->bfr_header.sequence_id, &reply));
+}
+
+void
+management_publish(ptp_clock_t *clock)
+{
+  ptpd_snapshot_t *next = &clock->snapshot[(clock->snapshot_seq + 1) & 1];
+
+  next->default_ds = clock->default_ds;
+  next->current_ds = clock->current_ds;
+  next->parent_ds = clock->parent_ds;
+  next->time_properties_ds = clock->time_properties_ds;
+  next->port_ds = clock->port_ds;
+
+  /* Readers of the current snapshot are not disturbed, those of the
+     previous one retry */
+  PTPD_MEMORY_BARRIER();
+  clock->snapshot_seq++;
+}
+
+void
+ptpd_get_snapshot(const ptp_clock_t *clock, ptpd_snapshot_t *snapshot)
+{
+  uint32_t seq;
+
+  do
+  {
+    seq = clock->snapshot_seq;
+    PTPD_MEMORY_BARRIER();
+    *snapshot = clock->snapshot[seq & 1];
+    PTPD_MEMORY_BARRIER();
+  } while (seq != clock->snapshot_seq);
+}
@@ -305,4 +305,55 @@ msg_unpack_pdelay_resp_followup(const octet_t *buf, msg_pdelay_resp_followup_t*p
   prespfollow->response_origin_timestamp.nanoseconds_field = flip32(*(uint32_t*)(buf + 40));
   memcpy(prespfollow->requesting_port_identity.clock_identity, (buf + 44), PTPD_CLOCK_IDENTITY_LENGTH);
   prespfollow->requesting_port_identity.port_number = flip16(*(int16_t*)(buf + 52));
-}
\ No newline at end of file
+}
+/* Unpack Management message, up to the managementId of its TLV */
+void
+msg_unpack_management(const octet_t *buf, msg_management*manage)
+{
+  memcpy(manage->target_port_identity.clock_identity, (buf + 34), PTPD_CLOCK_IDENTITY_LENGTH);
+  manage->target_port_identity.port_number = flip16(*(int16_t*)(buf + 42));
+  manage->starting_boundary_hops = *(uint8_t*)(buf + 44);
+  manage->boundary_hops = *(uint8_t*)(buf + 45);
+  manage->action_field = (*(enum4bit_t*)(buf + 46)) & 0x0F;
+  manage->tlv_type = flip16(*(enum16bit_t*)(buf + 48));
+  manage->length_field = flip16(*(uint16_t*)(buf + 50));
+  manage->management_id = flip16(*(enum16bit_t*)(buf + 52));
+  manage->data_field = buf + 54;
+}
+
+/* Pack Management message. The TLV value following lengthField is expected
+   in buf already, only the managementId of a management TLV is packed */
+int16_t
+msg_pack_management(const ptp_clock_t*ptpClock, octet_t *buf, int16_t sequence_id, const msg_management*manage)
+{
+  int16_t length = PTPD_MANAGEMENT_LENGTH + 4 + manage->length_field;
+
+  msg_pack_header(ptpClock, buf);
+
+  /* Changes in header */
+  *(char*)(buf + 0) = *(char*)(buf + 0) & 0xF0; //RAZ messageType
+  *(char*)(buf + 0) = *(char*)(buf + 0) | MANAGEMENT; //Table 19
+  *(int16_t*)(buf + 2)  = flip16(length);
+  memset((buf + 6), 0, 2); /* flagField */
+  *(int16_t*)(buf + 30) = flip16(sequence_id);
+  *(uint8_t*)(buf + 32) = CTRL_MANAGEMENT; //Table 23
+  *(int8_t*)(buf + 33) = 0x7F; //Table 24
+
+  /* Management message */
+  memcpy((buf + 34), manage->target_port_identity.clock_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  *(int16_t*)(buf + 42) = flip16(manage->target_port_identity.port_number);
+  *(uint8_t*)(buf + 44) = manage->starting_boundary_hops;
+  *(uint8_t*)(buf + 45) = manage->boundary_hops;
+  *(enum4bit_t*)(buf + 46) = manage->action_field;
+  *(uint8_t*)(buf + 47) = 0;
+
+  /* TLV */
+  *(enum16bit_t*)(buf + 48) = flip16(manage->tlv_type);
+  *(uint16_t*)(buf + 50) = flip16(manage->length_field);
+  if (manage->tlv_type == TLV_MANAGEMENT)
+  {
+    *(enum16bit_t*)(buf + 52) = flip16(manage->management_id);
+  }
+
+  return length;
+}
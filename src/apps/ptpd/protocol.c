@@ -460,6 +460,9 @@ void ptp_do_state(ptp_clock_t*ptpClock)
     DBG("doState: do unrecognized state %d\n", ptpClock->port_ds.port_state);
       break;
   }
+
+  /* Data sets as served to management */
+  management_publish(ptpClock);
 }
 
 
@@ -1237,11 +1240,36 @@ static void on_pdelay_respFollowUp(ptp_clock_t*ptpClock, bool isFromSelf)
 
 static void on_management(ptp_clock_t*ptpClock, bool isFromSelf)
 {
-  /* ENABLE_PORT -> DESIGNATED_ENABLED -> toState(PTP_INITIALIZING) */
-  /* DISABLE_PORT -> DESIGNATED_DISABLED -> toState(PTP_DISABLED) */
+  DBGV("on_management: received in state %s\n", stateString(ptpClock->port_ds.port_state));
+
+  /* A short management message is the manager's problem, not a port fault */
+  if (ptpClock->msg_bfr_in_len < PTPD_MANAGEMENT_LENGTH)
+  {
+    ERROR("on_management: short message\n");
+    return;
+  }
 
-  (void) ptpClock;
-  (void) isFromSelf;
+  if (isFromSelf)
+  {
+    DBGV("on_management: ignore from self\n");
+    return;
+  }
+
+  switch (ptpClock->port_ds.port_state)
+  {
+    case PTP_INITIALIZING:
+    case PTP_FAULTY:
+
+      DBGV("on_management: disreguard\n");
+      break;
+
+    default:
+
+      /* ENABLE_PORT -> DESIGNATED_ENABLED -> toState(PTP_INITIALIZING) */
+      /* DISABLE_PORT -> DESIGNATED_DISABLED -> toState(PTP_DISABLED) */
+      management_handle(ptpClock);
+      break;
+  }
 }
 
 static void on_signaling(ptp_clock_t*ptpClock, bool  isFromSelf)
@@ -12,6 +12,7 @@ void
 ptpd_opts_init()
 {
   // Initialize run time options.
+  ptpd_opts_set_defaults(&opts);
   if (ptp_startup(&ptp_clock, &opts, foreign_records) != 0)
   {
     DBG("ptpd: startup failed");
@@ -187,6 +188,11 @@ ptpd_net_init(net_path_t* net_path, ptp_clock_t* clock)
     goto fail01;
   }
 
+#if MIB2_STATS
+  /* Select the PHY latencies of the link speed, see servo_set_link_speed() */
+  clock->link_speed = netif_default->link_speed / 1000000;
+#endif
+
   /* Open lwIP raw udp interfaces for the event port. */
   net_path->event_pcb = udp_new();
   if (NULL == net_path->event_pcb)
@@ -384,6 +390,9 @@ ptpd_net_send(const octet_t* buf, int16_t length, time_interval_t* time, const i
 {
   err_t result;
   struct pbuf* p;
+#if LWIP_CHECKSUM_ON_COPY && CHECKSUM_GEN_UDP
+  u16_t chksum;
+#endif
 
   /* Allocate the tx pbuf based on the current size. */
   p = pbuf_alloc(PBUF_TRANSPORT, length, PBUF_RAM);
@@ -394,7 +403,11 @@ ptpd_net_send(const octet_t* buf, int16_t length, time_interval_t* time, const i
   }
 
   /* Copy the incoming data into the pbuf payload. */
+#if LWIP_CHECKSUM_ON_COPY && CHECKSUM_GEN_UDP
+  result = pbuf_take_chksum(p, buf, length, &chksum);
+#else
   result = pbuf_take(p, buf, length);
+#endif
   if (ERR_OK != result)
   {
     ERROR("ptpd_net_send: Failed to copy data to Pbuf (%d)\n", result);
@@ -403,7 +416,11 @@ ptpd_net_send(const octet_t* buf, int16_t length, time_interval_t* time, const i
 
   /* send the buffer. */
   // @note cast u32 to ip_addr_t works?
+#if LWIP_CHECKSUM_ON_COPY && CHECKSUM_GEN_UDP
+  result = udp_sendto_chksum(pcb, p, (ip_addr_t*)addr, pcb->local_port, 1, chksum);
+#else
   result = udp_sendto(pcb, p, (ip_addr_t*)addr, pcb->local_port);
+#endif
   if (ERR_OK != result)
   {
     ERROR("ptpd_net_send: Failed to send data (%d)\n", result);
@@ -1,5 +1,7 @@
 #include <lwip/apps/ptpd.h>
 
+static const ptpd_link_latency_t default_latency_table[] = PTPD_DEFAULT_LATENCY_TABLE;
+
 void
 servo_init_clock(ptp_clock_t* clock)
 {
@@ -126,6 +128,93 @@ static void filter(int32_t * nsec_current, Filter * filt)
   *nsec_current = filt->y_prev;
 }
 
+/* The offset from master, before the delayAsymmetry correction, is the
+   offset from the reference plus the asymmetry of the path */
+static void calibrate_asymmetry(ptp_clock_t* clock)
+{
+  time_interval_t sample;
+
+  /* Mean path delay valid ? */
+  if (0 == clock->owd_filt.n)
+  {
+    return;
+  }
+
+  ptp_sub_time(&sample, &clock->current_ds.offset_from_master, &clock->calibration.reference_offset);
+  if (sample.seconds != 0)
+  {
+    DBGV("calibrate_asymmetry: sample out of range\n");
+    return;
+  }
+
+  clock->calibration.sum += sample.nanoseconds;
+  clock->calibration.n++;
+  if (clock->calibration.n < clock->calibration.samples)
+  {
+    return;
+  }
+
+  clock->port_ds.delay_asymmetry.seconds = 0;
+  clock->port_ds.delay_asymmetry.nanoseconds = (int32_t)(clock->calibration.sum / clock->calibration.n);
+  DBG("calibrate_asymmetry: delay asymmetry %d nsec\n", clock->port_ds.delay_asymmetry.nanoseconds);
+
+  /* Hand the clock back to the servo, with the offset filter restarted */
+  clock->calibration.samples = 0;
+  clock->servo.no_adjust = clock->calibration.no_adjust;
+  clock->ofm_filt.n = 0;
+}
+
+void
+servo_set_link_speed(ptp_clock_t* clock, uint32_t link_speed)
+{
+  const ptpd_link_latency_t* entry;
+
+  clock->link_speed = link_speed;
+  clock->inbound_latency = clock->opts->inbound_latency;
+  clock->outbound_latency = clock->opts->outbound_latency;
+
+  entry = (clock->opts->latency_table != NULL) ? clock->opts->latency_table : default_latency_table;
+  for (; entry->link_speed != 0; entry++)
+  {
+    if (entry->link_speed == link_speed)
+    {
+      clock->inbound_latency.seconds = 0;
+      clock->inbound_latency.nanoseconds = entry->inbound_latency;
+      clock->outbound_latency.seconds = 0;
+      clock->outbound_latency.nanoseconds = entry->outbound_latency;
+      break;
+    }
+  }
+
+  DBG("servo_set_link_speed: %u Mbit/s, inbound latency %d nsec, outbound latency %d nsec\n", link_speed,
+      clock->inbound_latency.nanoseconds, clock->outbound_latency.nanoseconds);
+}
+
+void
+servo_calibrate_asymmetry(ptp_clock_t* clock, uint16_t samples, const time_interval_t* reference_offset)
+{
+  /* Keep the servo setting of the calibration already running, if any */
+  if (0 == clock->calibration.samples)
+  {
+    clock->calibration.no_adjust = clock->servo.no_adjust;
+  }
+
+  clock->calibration.samples = samples;
+  clock->calibration.n = 0;
+  clock->calibration.sum = 0;
+  if (reference_offset != NULL)
+  {
+    clock->calibration.reference_offset = *reference_offset;
+  }
+  else
+  {
+    clock->calibration.reference_offset.seconds = clock->calibration.reference_offset.nanoseconds = 0;
+  }
+
+  /* The reference steers the local clock while calibrating */
+  clock->servo.no_adjust = (samples != 0) ? TRUE : clock->calibration.no_adjust;
+}
+
 /* 11.2 */
 void
 servo_update_offset(ptp_clock_t* clock, const time_interval_t* sync_event_ingress_timestamp,
@@ -159,6 +248,15 @@ servo_update_offset(ptp_clock_t* clock, const time_interval_t* sync_event_ingres
       break;
   }
 
+  if (clock->calibration.samples != 0)
+  {
+    calibrate_asymmetry(clock);
+  }
+
+  /* 11.6.2 delayAsymmetry correction */
+  ptp_sub_time(&clock->current_ds.offset_from_master, &clock->current_ds.offset_from_master,
+               &clock->port_ds.delay_asymmetry);
+
   if (clock->current_ds.offset_from_master.seconds != 0)
   {
     if (clock->port_ds.port_state == PTP_SLAVE)
@@ -6,6 +6,37 @@ void ptpdShutdown(ptp_clock_t* clock)
   ptpd_shutdown(&clock->net_path);
 }
 
+/* Fill the run-time options with the PTPD_DEFAULT_* compile time options */
+void
+ptpd_opts_set_defaults(ptpd_opts* opts)
+{
+  memset(opts, 0, sizeof(*opts));
+  opts->announce_interval = PTPD_DEFAULT_ANNOUNCE_INTERVAL;
+  opts->announce_receipt_timeout = PTPD_DEFAULT_ANNOUNCE_RECEIPT_TIMEOUT;
+  opts->sync_interval = PTPD_DEFAULT_SYNC_INTERVAL;
+  opts->pdelay_req_interval = PTPD_DEFAULT_PDELAYREQ_INTERVAL;
+  opts->clock_quality.clock_accuracy = PTPD_DEFAULT_CLOCK_ACCURACY;
+  opts->clock_quality.clock_class = PTPD_DEFAULT_CLOCK_CLASS;
+  opts->clock_quality.offset_scaled_log_variance = PTPD_DEFAULT_CLOCK_VARIANCE;
+  opts->priority1 = PTPD_DEFAULT_PRIORITY1;
+  opts->priority2 = PTPD_DEFAULT_PRIORITY2;
+  opts->domain_number = PTPD_DEFAULT_DOMAIN_NUMBER;
+  opts->slave_only = PTPD_SLAVE_ONLY;
+  opts->current_utc_offset = PTPD_DEFAULT_UTC_OFFSET;
+  opts->stats = PTP_NO_STATS;
+  opts->inbound_latency.nanoseconds = PTPD_DEFAULT_INBOUND_LATENCY;
+  opts->outbound_latency.nanoseconds = PTPD_DEFAULT_OUTBOUND_LATENCY;
+  opts->delay_asymmetry.nanoseconds = PTPD_DEFAULT_DELAY_ASYMMETRY;
+  opts->calibration_samples = PTPD_DEFAULT_CALIBRATION_SAMPLES;
+  opts->max_foreign_records = PTPD_DEFAULT_MAX_FOREIGN_RECORDS;
+  opts->delay_mechanism = PTPD_DEFAULT_DELAY_MECHANISM;
+  opts->servo.no_reset_clock = PTPD_DEFAULT_NO_RESET_CLOCK;
+  opts->servo.no_adjust = PTPD_NO_ADJUST;
+  opts->servo.ap = PTPD_DEFAULT_AP;
+  opts->servo.ai = PTPD_DEFAULT_AI;
+  opts->servo.s_delay = PTPD_DEFAULT_DELAY_S;
+  opts->servo.s_offset = PTPD_DEFAULT_OFFSET_S;
+}
 
 int16_t
 ptp_startup(ptp_clock_t* clock, ptpd_opts* opts, foreign_master_record_t* foreign)
@@ -0,0 +1,320 @@
+/**
+ * @file
+ * Allocation profiler
+ *
+ * Keeps a table of call sites (file, line and pool) and a table of live
+ * allocations keyed by pointer. mem.c and memp.c report every allocation,
+ * free and trim; frees of allocations the live table does not know (made
+ * before a reset or while it was full) are ignored.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_ALLOC_PROFILE /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/alloc_profile.h"
+#include "lwip/sys.h"
+#include "lwip/def.h"
+#include "lwip/priv/memp_priv.h"
+
+#include <string.h>
+
+#if (ALLOC_PROFILE_MAX_LIVE & (ALLOC_PROFILE_MAX_LIVE - 1)) != 0
+#error "ALLOC_PROFILE_MAX_LIVE must be a power of two"
+#endif
+
+/** index of the site collecting what doesn't fit into the site table */
+#define ALLOC_PROFILE_OTHER   ALLOC_PROFILE_MAX_SITES
+
+/** A live allocation */
+struct alloc_profile_live {
+  void *mem;
+  u32_t born;
+  u32_t size;
+  u16_t site;
+};
+
+static struct alloc_profile_site alloc_profile_sites[ALLOC_PROFILE_MAX_SITES + 1];
+static struct alloc_profile_live alloc_profile_table[ALLOC_PROFILE_MAX_LIVE];
+static u16_t alloc_profile_num_live;
+static u32_t alloc_profile_num_untracked;
+
+static u32_t
+alloc_profile_hash(mem_ptr_t key)
+{
+  return (u32_t)(key ^ (key >> 16)) * 2654435761UL;
+}
+
+/** Find or create the site of a call, the overflow site if the table is full */
+static u16_t
+alloc_profile_site_get(u16_t pool, const char *file, int line)
+{
+  u16_t i, idx = (u16_t)(alloc_profile_hash((mem_ptr_t)file + (mem_ptr_t)line * 31 + pool) % ALLOC_PROFILE_MAX_SITES);
+
+  for (i = 0; i < ALLOC_PROFILE_MAX_SITES; i++) {
+    struct alloc_profile_site *site = &alloc_profile_sites[idx];
+    if (site->file == NULL) {
+      site->file = file;
+      site->line = line;
+      site->pool = pool;
+      return idx;
+    }
+    if ((site->file == file) && (site->line == line) && (site->pool == pool)) {
+      return idx;
+    }
+    idx = (u16_t)((idx + 1) % ALLOC_PROFILE_MAX_SITES);
+  }
+  alloc_profile_sites[ALLOC_PROFILE_OTHER].file = "(other)";
+  alloc_profile_sites[ALLOC_PROFILE_OTHER].pool = pool;
+  return ALLOC_PROFILE_OTHER;
+}
+
+/** @return the slot of 'mem' in the live table or ALLOC_PROFILE_MAX_LIVE */
+static u16_t
+alloc_profile_live_find(void *mem)
+{
+  u16_t i, idx = (u16_t)(alloc_profile_hash((mem_ptr_t)mem) & (ALLOC_PROFILE_MAX_LIVE - 1));
+
+  for (i = 0; i < ALLOC_PROFILE_MAX_LIVE; i++) {
+    if (alloc_profile_table[idx].mem == mem) {
+      return idx;
+    }
+    if (alloc_profile_table[idx].mem == NULL) {
+      break;
+    }
+    idx = (u16_t)((idx + 1) & (ALLOC_PROFILE_MAX_LIVE - 1));
+  }
+  return ALLOC_PROFILE_MAX_LIVE;
+}
+
+/** Remove a slot from the live table, moving later entries of its probe
+ * sequence up so that lookups don't stop early */
+static void
+alloc_profile_live_remove(u16_t idx)
+{
+  u16_t next = idx;
+
+  for (;;) {
+    u16_t home;
+    next = (u16_t)((next + 1) & (ALLOC_PROFILE_MAX_LIVE - 1));
+    if (alloc_profile_table[next].mem == NULL) {
+      break;
+    }
+    home = (u16_t)(alloc_profile_hash((mem_ptr_t)alloc_profile_table[next].mem) & (ALLOC_PROFILE_MAX_LIVE - 1));
+    /* move the entry if its home slot is not in (idx, next] */
+    if (((next > idx) && ((home <= idx) || (home > next))) ||
+        ((next < idx) && (home <= idx) && (home > next))) {
+      alloc_profile_table[idx] = alloc_profile_table[next];
+      idx = next;
+    }
+  }
+  alloc_profile_table[idx].mem = NULL;
+  alloc_profile_num_live--;
+}
+
+/**
+ * Account an allocation: called by mem.c and memp.c
+ *
+ * @param pool memp_t of the pool, ALLOC_PROFILE_CUSTOM_POOL or ALLOC_PROFILE_HEAP
+ * @param mem the allocated memory or NULL if the allocation failed
+ * @param size requested size
+ * @param file file of the call site
+ * @param line line of the call site
+ */
+void
+alloc_profile_alloc(u16_t pool, void *mem, mem_size_t size, const char *file, const int line)
+{
+  struct alloc_profile_site *site;
+  u16_t site_idx;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  site_idx = alloc_profile_site_get(pool, file, line);
+  site = &alloc_profile_sites[site_idx];
+  if (mem == NULL) {
+    site->fails++;
+  } else {
+    site->allocs++;
+    if (alloc_profile_num_live < ALLOC_PROFILE_MAX_LIVE - 1) {
+      /* keep one slot empty so that probing always terminates */
+      u16_t idx = (u16_t)(alloc_profile_hash((mem_ptr_t)mem) & (ALLOC_PROFILE_MAX_LIVE - 1));
+      while (alloc_profile_table[idx].mem != NULL) {
+        idx = (u16_t)((idx + 1) & (ALLOC_PROFILE_MAX_LIVE - 1));
+      }
+      alloc_profile_table[idx].mem = mem;
+      alloc_profile_table[idx].born = sys_now();
+      alloc_profile_table[idx].size = size;
+      alloc_profile_table[idx].site = site_idx;
+      alloc_profile_num_live++;
+      site->live++;
+      site->bytes += size;
+      site->live_max = LWIP_MAX(site->live_max, site->live);
+      site->bytes_max = LWIP_MAX(site->bytes_max, site->bytes);
+    } else {
+      alloc_profile_num_untracked++;
+    }
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Account a free: called by mem.c and memp.c before the memory is freed
+ */
+void
+alloc_profile_free(void *mem)
+{
+  u16_t idx;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  idx = alloc_profile_live_find(mem);
+  if (idx != ALLOC_PROFILE_MAX_LIVE) {
+    struct alloc_profile_live *live = &alloc_profile_table[idx];
+    struct alloc_profile_site *site = &alloc_profile_sites[live->site];
+    u32_t age = sys_now() - live->born;
+    u8_t bucket = 0;
+
+    while ((age > 0) && (bucket < ALLOC_PROFILE_LIFETIME_BUCKETS - 1)) {
+      age >>= 2;
+      bucket++;
+    }
+    site->lifetime[bucket]++;
+    site->frees++;
+    site->live--;
+    site->bytes -= live->size;
+    alloc_profile_live_remove(idx);
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Account a mem_trim(): the allocation keeps its site and age
+ */
+void
+alloc_profile_resize(void *mem, mem_size_t size)
+{
+  u16_t idx;
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  idx = alloc_profile_live_find(mem);
+  if (idx != ALLOC_PROFILE_MAX_LIVE) {
+    struct alloc_profile_live *live = &alloc_profile_table[idx];
+    struct alloc_profile_site *site = &alloc_profile_sites[live->site];
+    site->bytes = site->bytes - live->size + size;
+    site->bytes_max = LWIP_MAX(site->bytes_max, site->bytes);
+    live->size = size;
+  }
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Forget all sites and live allocations, e.g. to profile one phase of a
+ * program only.
+ */
+void
+alloc_profile_reset(void)
+{
+  SYS_ARCH_DECL_PROTECT(lev);
+
+  SYS_ARCH_PROTECT(lev);
+  memset(alloc_profile_sites, 0, sizeof(alloc_profile_sites));
+  memset(alloc_profile_table, 0, sizeof(alloc_profile_table));
+  alloc_profile_num_live = 0;
+  alloc_profile_num_untracked = 0;
+  SYS_ARCH_UNPROTECT(lev);
+}
+
+/**
+ * Access the site table: indices 0 to ALLOC_PROFILE_MAX_SITES - 1 are the
+ * call sites in no particular order, ALLOC_PROFILE_MAX_SITES collects the
+ * sites that didn't fit.
+ *
+ * @return the site or NULL if idx is not in use
+ */
+const struct alloc_profile_site *
+alloc_profile_get_site(u16_t idx)
+{
+  if ((idx > ALLOC_PROFILE_MAX_SITES) || (alloc_profile_sites[idx].file == NULL)) {
+    return NULL;
+  }
+  return &alloc_profile_sites[idx];
+}
+
+/**
+ * @return number of allocations made while the live table was full
+ */
+u32_t
+alloc_profile_untracked(void)
+{
+  return alloc_profile_num_untracked;
+}
+
+/**
+ * Print all call sites and the fragmentation map of the heap
+ */
+void
+alloc_profile_display(void)
+{
+  u16_t i;
+  u8_t b;
+
+  LWIP_PLATFORM_DIAG(("\nALLOC PROFILE (lifetimes in ms: <1 <4 <16 <64 <256 <1k <4k more)\n"));
+  for (i = 0; i <= ALLOC_PROFILE_MAX_SITES; i++) {
+    const struct alloc_profile_site *site = alloc_profile_get_site(i);
+    if (site == NULL) {
+      continue;
+    }
+    if (site->pool == ALLOC_PROFILE_HEAP) {
+      LWIP_PLATFORM_DIAG(("%s:%d heap\n\t", site->file, site->line));
+#if defined(LWIP_DEBUG) || MEMP_OVERFLOW_CHECK || LWIP_STATS_DISPLAY
+    } else if (site->pool < MEMP_MAX) {
+      LWIP_PLATFORM_DIAG(("%s:%d %s\n\t", site->file, site->line, memp_pools[site->pool]->desc));
+#endif
+    } else {
+      LWIP_PLATFORM_DIAG(("%s:%d pool %"U16_F"\n\t", site->file, site->line, site->pool));
+    }
+    LWIP_PLATFORM_DIAG(("allocs: %"U32_F" frees: %"U32_F" fails: %"U32_F"\n\t", site->allocs, site->frees, site->fails));
+    LWIP_PLATFORM_DIAG(("live: %"U32_F" (max %"U32_F") bytes: %"U32_F" (max %"U32_F")\n\t",
+                        site->live, site->live_max, site->bytes, site->bytes_max));
+    LWIP_PLATFORM_DIAG(("lifetime:"));
+    for (b = 0; b < ALLOC_PROFILE_LIFETIME_BUCKETS; b++) {
+      LWIP_PLATFORM_DIAG((" %"U32_F, site->lifetime[b]));
+    }
+    LWIP_PLATFORM_DIAG(("\n"));
+  }
+  LWIP_PLATFORM_DIAG(("untracked: %"U32_F"\n", alloc_profile_num_untracked));
+  mem_map_display();
+}
+
+#endif /* LWIP_ALLOC_PROFILE */
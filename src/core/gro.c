@@ -0,0 +1,308 @@
+/**
+ * @file
+ * TCP generic receive offload (GRO)
+ *
+ * ethernet_input() passes IPv4 packets through gro_input(), which holds back
+ * TCP data segments addressed to this host and appends the data of the
+ * following in-order segments of the same flow to them. The merged segment
+ * is passed to ip4_input() when a segment arrives that does not continue it,
+ * or when gro_flush() is called at the end of a batch of received packets.
+ * tcp_input() then processes (and ACKs, and hands to the application) the
+ * whole batch of data at once.
+ *
+ * The tcpip_thread calls gro_flush() whenever its mbox runs empty, and after
+ * TCP_GRO_MAX_BATCH messages at the latest. With NO_SYS=1 or
+ * LWIP_TCPIP_CORE_LOCKING_INPUT=1, the code calling netif->input must call
+ * gro_flush() after each batch of packets.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP_GRO /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/gro.h"
+#include "lwip/ip4.h"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/prot/ip.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/tcp.h"
+
+#include <string.h>
+
+/** A flow with a segment held back for coalescing */
+struct gro_flow {
+  /** the held segment (payload pointing to the IP header), NULL if unused */
+  struct pbuf *p;
+  /** the netif p was received on */
+  struct netif *inp;
+  /** sequence number the next segment must have to be appended */
+  u32_t next_seqno;
+  /** data length of the first segment, appended ones may not be larger */
+  u16_t seg_len;
+  /** number of segments merged into p */
+  u8_t segs;
+};
+
+static struct gro_flow gro_flows[TCP_GRO_MAX_FLOWS];
+/** next flow to flush when all of them are in use */
+static u8_t gro_evict;
+
+#define GRO_TCPHDR(p) ((struct tcp_hdr *)((u8_t *)(p)->payload + IP_HLEN))
+
+/** Pass the segment held by a flow on to ip4_input */
+static void
+gro_flow_flush(struct gro_flow *flow)
+{
+  struct pbuf *p = flow->p;
+
+  if (p == NULL) {
+    return;
+  }
+  flow->p = NULL;
+  if (flow->segs > 1) {
+    struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+    IPH_LEN_SET(iphdr, lwip_htons(p->tot_len));
+    IPH_CHKSUM_SET(iphdr, 0);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  }
+  /* the TCP checksum of every segment merged into p has been checked */
+  p->flags |= PBUF_FLAG_GRO;
+  ip4_input(p, flow->inp);
+}
+
+/**
+ * Check if p is an IPv4 TCP packet (without IP options and not fragmented)
+ * addressed to this host and if it may be coalesced.
+ *
+ * @param p the received packet, payload pointing to the IP header
+ * @param inp the netif p was received on
+ * @param len receives the TCP data length if p is a data segment that may be
+ *        coalesced, 0 otherwise
+ * @return 1 if p belongs to a TCP flow, 0 if it is not handled by GRO
+ */
+static u8_t
+gro_check(struct pbuf *p, struct netif *inp, u16_t *len)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+  struct tcp_hdr *tcphdr;
+  u16_t iplen, hdrlen;
+
+  *len = 0;
+  if ((p->len < IP_HLEN + TCP_HLEN) || (IPH_V(iphdr) != 4) ||
+      (IPH_HL_BYTES(iphdr) != IP_HLEN) || (IPH_PROTO(iphdr) != IP_PROTO_TCP) ||
+      ((IPH_OFFSET(iphdr) & PP_HTONS(IP_OFFMASK | IP_MF)) != 0)) {
+    return 0;
+  }
+  /* forwarded packets must keep their size */
+  if (!ip4_addr_cmp(&iphdr->dest, netif_ip4_addr(inp))) {
+    return 0;
+  }
+  tcphdr = GRO_TCPHDR(p);
+  hdrlen = (u16_t)(IP_HLEN + TCPH_HDRLEN_BYTES(tcphdr));
+  if ((TCPH_HDRLEN_BYTES(tcphdr) < TCP_HLEN) || (p->len < hdrlen)) {
+    return 0;
+  }
+
+  iplen = lwip_ntohs(IPH_LEN(iphdr));
+  if ((iplen <= hdrlen) || (iplen > p->tot_len) ||
+      ((TCPH_FLAGS(tcphdr) & ~TCP_PSH) != TCP_ACK)) {
+    /* no data, or SYN, FIN, RST or URG: passed on unchanged */
+    return 1;
+  }
+#if CHECKSUM_CHECK_IP
+  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_IP) {
+    if (inet_chksum(iphdr, IP_HLEN) != 0) {
+      return 1;
+    }
+  }
+#endif /* CHECKSUM_CHECK_IP */
+  if (iplen < p->tot_len) {
+    /* remove link layer padding */
+    pbuf_realloc(p, iplen);
+  }
+#if CHECKSUM_CHECK_TCP
+  IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
+    ip4_addr_t src, dest;
+    u16_t chksum;
+    ip4_addr_copy(src, iphdr->src);
+    ip4_addr_copy(dest, iphdr->dest);
+    pbuf_remove_header(p, IP_HLEN);
+    chksum = inet_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len, &src, &dest);
+    pbuf_add_header_force(p, IP_HLEN);
+    if (chksum != 0) {
+      /* tcp_input drops it */
+      return 1;
+    }
+  }
+#endif /* CHECKSUM_CHECK_TCP */
+  *len = (u16_t)(iplen - hdrlen);
+  return 1;
+}
+
+/** Check if p belongs to the flow of the held segment */
+static int
+gro_flow_match(const struct gro_flow *flow, struct pbuf *p, struct netif *inp)
+{
+  const struct ip_hdr *held = (const struct ip_hdr *)flow->p->payload;
+  const struct ip_hdr *iphdr = (const struct ip_hdr *)p->payload;
+  const struct tcp_hdr *held_tcphdr = GRO_TCPHDR(flow->p);
+  const struct tcp_hdr *tcphdr = GRO_TCPHDR(p);
+
+  return (flow->inp == inp) &&
+         ip4_addr_cmp(&held->src, &iphdr->src) && ip4_addr_cmp(&held->dest, &iphdr->dest) &&
+         (held_tcphdr->src == tcphdr->src) && (held_tcphdr->dest == tcphdr->dest);
+}
+
+/** Check if the data of p (len bytes) directly continues the held segment
+ * and all of its header fields but the sequence number are the same */
+static int
+gro_flow_continues(const struct gro_flow *flow, struct pbuf *p, u16_t len)
+{
+  const struct tcp_hdr *held_tcphdr = GRO_TCPHDR(flow->p);
+  const struct tcp_hdr *tcphdr = GRO_TCPHDR(p);
+
+  return (lwip_ntohl(tcphdr->seqno) == flow->next_seqno) &&
+         (len <= flow->seg_len) &&
+         ((u32_t)flow->p->tot_len + len <= 0xFFFF) &&
+         (held_tcphdr->ackno == tcphdr->ackno) && (held_tcphdr->wnd == tcphdr->wnd) &&
+         (TCPH_HDRLEN(held_tcphdr) == TCPH_HDRLEN(tcphdr)) &&
+         (memcmp(held_tcphdr + 1, tcphdr + 1, TCPH_HDRLEN_BYTES(tcphdr) - TCP_HLEN) == 0);
+}
+
+/**
+ * Coalesce received TCP segments before passing them to ip4_input.
+ * Packets that cannot be coalesced are passed on directly, after the held
+ * segment of their flow (if any) to keep the order.
+ *
+ * @param p the received IPv4 packet, payload pointing to the IP header
+ * @param inp the netif p was received on
+ * @return ERR_OK (p is always taken over)
+ */
+err_t
+gro_input(struct pbuf *p, struct netif *inp)
+{
+  struct gro_flow *flow = NULL, *free_flow = NULL;
+  struct tcp_hdr *tcphdr;
+  u16_t len;
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  if (!gro_check(p, inp, &len)) {
+    return ip4_input(p, inp);
+  }
+  tcphdr = GRO_TCPHDR(p);
+
+  for (i = 0; i < TCP_GRO_MAX_FLOWS; i++) {
+    if (gro_flows[i].p == NULL) {
+      if (free_flow == NULL) {
+        free_flow = &gro_flows[i];
+      }
+    } else if (gro_flow_match(&gro_flows[i], p, inp)) {
+      flow = &gro_flows[i];
+      break;
+    }
+  }
+
+  if (flow != NULL) {
+    if ((len != 0) && gro_flow_continues(flow, p, len)) {
+      u8_t last = (len < flow->seg_len) || (TCPH_FLAGS(tcphdr) & TCP_PSH);
+      if (TCPH_FLAGS(tcphdr) & TCP_PSH) {
+        TCPH_SET_FLAG(GRO_TCPHDR(flow->p), TCP_PSH);
+      }
+      pbuf_remove_header(p, (u16_t)(IP_HLEN + TCPH_HDRLEN_BYTES(tcphdr)));
+      pbuf_cat(flow->p, p);
+      flow->next_seqno += len;
+      flow->segs++;
+      if (last) {
+        /* a short or pushed segment ends the burst */
+        gro_flow_flush(flow);
+      }
+      return ERR_OK;
+    }
+    gro_flow_flush(flow);
+    free_flow = flow;
+  }
+
+  if ((len == 0) || (TCPH_FLAGS(tcphdr) & TCP_PSH)) {
+    return ip4_input(p, inp);
+  }
+  if (free_flow == NULL) {
+    free_flow = &gro_flows[gro_evict];
+    gro_evict = (u8_t)((gro_evict + 1) % TCP_GRO_MAX_FLOWS);
+    gro_flow_flush(free_flow);
+  }
+  free_flow->p = p;
+  free_flow->inp = inp;
+  free_flow->next_seqno = lwip_ntohl(tcphdr->seqno) + len;
+  free_flow->seg_len = len;
+  free_flow->segs = 1;
+  return ERR_OK;
+}
+
+/**
+ * Pass all held segments on to ip4_input. Call this after each batch of
+ * received packets.
+ *
+ * @param netif flush only the segments received on this netif (NULL: all)
+ */
+void
+gro_flush(struct netif *netif)
+{
+  u8_t i;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  for (i = 0; i < TCP_GRO_MAX_FLOWS; i++) {
+    if ((gro_flows[i].p != NULL) && ((netif == NULL) || (gro_flows[i].inp == netif))) {
+      gro_flow_flush(&gro_flows[i]);
+    }
+  }
+}
+
+/** Check if segments are held for coalescing */
+u8_t
+gro_pending(void)
+{
+  u8_t i;
+
+  for (i = 0; i < TCP_GRO_MAX_FLOWS; i++) {
+    if (gro_flows[i].p != NULL) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#endif /* LWIP_TCP_GRO */
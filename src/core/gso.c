@@ -0,0 +1,232 @@
+/**
+ * @file
+ * TCP generic segmentation offload (GSO)
+ *
+ * With LWIP_TCP_GSO, TCP passes super-segments of up to TCP_GSO_MAX_SIZE
+ * bytes down to IP as one packet, with pbuf->gso_size set to the amount of
+ * data each segment on the wire may carry. Netifs with NETIF_FLAG_GSO get
+ * them unchanged and have to segment them (and update the IP and TCP
+ * checksums) themselves. When a super-segment is sent over a netif without
+ * that flag (e.g. after a route change), the IP layer calls the functions
+ * in this file, which split it into normal packets right before
+ * netif->output.
+ *
+ * Super-segments are complete TCP segments with valid checksums, so they can
+ * be looped back to the stack unsplit.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP_GSO /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/gso.h"
+#include "lwip/def.h"
+#include "lwip/inet_chksum.h"
+#include "lwip/stats.h"
+#include "lwip/prot/ip4.h"
+#include "lwip/prot/ip6.h"
+#include "lwip/prot/tcp.h"
+#include "lwip/prot/ip.h"
+
+#include <string.h>
+
+/**
+ * Build the next packet of a super-segment: a copy of its IP and TCP headers
+ * followed by 'len' bytes of data starting at 'offset'.
+ * The TCP sequence number and flags are adjusted, the IP header and the
+ * checksums are left to the caller.
+ *
+ * @param p the super-segment, p->payload pointing to the IP header
+ * @param iphlen length of the IP header
+ * @param hdrlen length of the IP and TCP headers
+ * @param offset offset of the data into the TCP payload
+ * @param len amount of data to put into this packet
+ * @return the new packet with payload pointing to the IP header, or NULL
+ */
+static struct pbuf *
+gso_segment(struct pbuf *p, u16_t iphlen, u16_t hdrlen, u16_t offset, u16_t len)
+{
+  struct pbuf *q;
+  struct tcp_hdr *tcphdr;
+  u16_t datalen = (u16_t)(p->tot_len - hdrlen);
+
+  q = pbuf_alloc(PBUF_LINK, (u16_t)(hdrlen + len), PBUF_RAM);
+  if (q == NULL) {
+    return NULL;
+  }
+  /* headers are always in the first pbuf of a TCP segment */
+  MEMCPY(q->payload, p->payload, hdrlen);
+  if (pbuf_copy_partial(p, (u8_t *)q->payload + hdrlen, len, (u16_t)(hdrlen + offset)) != len) {
+    pbuf_free(q);
+    return NULL;
+  }
+
+  tcphdr = (struct tcp_hdr *)((u8_t *)q->payload + iphlen);
+  tcphdr->seqno = lwip_htonl(lwip_ntohl(tcphdr->seqno) + offset);
+  if (offset + len < datalen) {
+    /* only the last segment finishes the push or the connection */
+    TCPH_UNSET_FLAG(tcphdr, TCP_PSH | TCP_FIN);
+  }
+  return q;
+}
+
+#if LWIP_IPV4
+/**
+ * Split an IPv4 TCP super-segment into packets carrying at most
+ * p->gso_size bytes of data and send them via netif->output().
+ * p is not freed.
+ *
+ * @param p the super-segment, p->payload pointing to the IP header
+ * @param netif the netif on which to send
+ * @param dest destination ip address to which to send
+ * @return ERR_OK if sent successfully, an err_t otherwise
+ */
+err_t
+ip4_gso_output(struct pbuf *p, struct netif *netif, const ip4_addr_t *dest)
+{
+  struct ip_hdr *iphdr = (struct ip_hdr *)p->payload;
+  u16_t iphlen, hdrlen, datalen, offset, id;
+  err_t err = ERR_OK;
+
+  LWIP_ASSERT("ip4_gso_output: no gso_size", p->gso_size != 0);
+  LWIP_ASSERT("ip4_gso_output: not TCP", IPH_PROTO(iphdr) == IP_PROTO_TCP);
+
+  iphlen = IPH_HL_BYTES(iphdr);
+  hdrlen = (u16_t)(iphlen + TCPH_HDRLEN_BYTES((struct tcp_hdr *)((u8_t *)p->payload + iphlen)));
+  LWIP_ASSERT("ip4_gso_output: headers not in first pbuf", p->len >= hdrlen);
+  datalen = (u16_t)(p->tot_len - hdrlen);
+  /* the super-segment's own ID never goes on the wire: take a fresh ID for
+     each packet so that later packets don't reuse them */
+  id = ip4_gso_reserve_ids((u16_t)(((u32_t)datalen + p->gso_size - 1) / p->gso_size));
+
+  for (offset = 0; offset < datalen; offset = (u16_t)(offset + p->gso_size)) {
+    u16_t len = LWIP_MIN(p->gso_size, (u16_t)(datalen - offset));
+    struct pbuf *q = gso_segment(p, iphlen, hdrlen, offset, len);
+    struct ip_hdr *qhdr;
+    if (q == NULL) {
+      LWIP_DEBUGF(IP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip4_gso_output: could not allocate segment\n"));
+      IP_STATS_INC(ip.memerr);
+      return ERR_MEM;
+    }
+    qhdr = (struct ip_hdr *)q->payload;
+    IPH_LEN_SET(qhdr, lwip_htons(q->tot_len));
+    IPH_ID_SET(qhdr, lwip_htons(id));
+    id++;
+#if CHECKSUM_GEN_TCP
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
+      struct tcp_hdr *tcphdr = (struct tcp_hdr *)((u8_t *)q->payload + iphlen);
+      ip4_addr_t src, dst;
+      ip4_addr_copy(src, qhdr->src);
+      ip4_addr_copy(dst, qhdr->dest);
+      tcphdr->chksum = 0;
+      pbuf_remove_header(q, iphlen);
+      tcphdr->chksum = inet_chksum_pseudo(q, IP_PROTO_TCP, q->tot_len, &src, &dst);
+      pbuf_add_header(q, iphlen);
+    }
+#endif /* CHECKSUM_GEN_TCP */
+    IPH_CHKSUM_SET(qhdr, 0);
+#if CHECKSUM_GEN_IP
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_IP) {
+      IPH_CHKSUM_SET(qhdr, inet_chksum(qhdr, iphlen));
+    }
+#endif /* CHECKSUM_GEN_IP */
+    err = netif->output(netif, q, dest);
+    pbuf_free(q);
+    if (err != ERR_OK) {
+      break;
+    }
+  }
+  return err;
+}
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV6
+/**
+ * Split an IPv6 TCP super-segment into packets carrying at most
+ * p->gso_size bytes of data and send them via netif->output_ip6().
+ * p is not freed.
+ *
+ * @param p the super-segment, p->payload pointing to the IPv6 header
+ * @param netif the netif on which to send
+ * @param dest destination ip address to which to send
+ * @return ERR_OK if sent successfully, an err_t otherwise
+ */
+err_t
+ip6_gso_output(struct pbuf *p, struct netif *netif, const ip6_addr_t *dest)
+{
+  struct ip6_hdr *ip6hdr = (struct ip6_hdr *)p->payload;
+  u16_t hdrlen, datalen, offset;
+  err_t err = ERR_OK;
+
+  LWIP_ASSERT("ip6_gso_output: no gso_size", p->gso_size != 0);
+  /* TCP does not send extension headers */
+  LWIP_ASSERT("ip6_gso_output: not TCP", IP6H_NEXTH(ip6hdr) == IP6_NEXTH_TCP);
+
+  hdrlen = (u16_t)(IP6_HLEN + TCPH_HDRLEN_BYTES((struct tcp_hdr *)((u8_t *)p->payload + IP6_HLEN)));
+  LWIP_ASSERT("ip6_gso_output: headers not in first pbuf", p->len >= hdrlen);
+  datalen = (u16_t)(p->tot_len - hdrlen);
+
+  for (offset = 0; offset < datalen; offset = (u16_t)(offset + p->gso_size)) {
+    u16_t len = LWIP_MIN(p->gso_size, (u16_t)(datalen - offset));
+    struct pbuf *q = gso_segment(p, IP6_HLEN, hdrlen, offset, len);
+    struct ip6_hdr *qhdr;
+    if (q == NULL) {
+      LWIP_DEBUGF(IP6_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("ip6_gso_output: could not allocate segment\n"));
+      IP6_STATS_INC(ip6.memerr);
+      return ERR_MEM;
+    }
+    qhdr = (struct ip6_hdr *)q->payload;
+    IP6H_PLEN_SET(qhdr, (u16_t)(q->tot_len - IP6_HLEN));
+#if CHECKSUM_GEN_TCP
+    IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
+      struct tcp_hdr *tcphdr = (struct tcp_hdr *)((u8_t *)q->payload + IP6_HLEN);
+      ip6_addr_t src, dst;
+      ip6_addr_copy_from_packed(src, qhdr->src);
+      ip6_addr_copy_from_packed(dst, qhdr->dest);
+      tcphdr->chksum = 0;
+      pbuf_remove_header(q, IP6_HLEN);
+      tcphdr->chksum = ip6_chksum_pseudo(q, IP6_NEXTH_TCP, q->tot_len, &src, &dst);
+      pbuf_add_header(q, IP6_HLEN);
+    }
+#endif /* CHECKSUM_GEN_TCP */
+    err = netif->output_ip6(netif, q, dest);
+    pbuf_free(q);
+    if (err != ERR_OK) {
+      break;
+    }
+  }
+  return err;
+}
+#endif /* LWIP_IPV6 */
+
+#endif /* LWIP_TCP_GSO */
@@ -10,7 +10,11 @@
  * \#define LWIP_CHKSUM your_checksum_routine
  *
  * Or you can select from the implementations below by defining
- * LWIP_CHKSUM_ALGORITHM to 1, 2 or 3.
+ * LWIP_CHKSUM_ALGORITHM to 1, 2, 3 or 4.
+ *
+ * Version #4 needs 64-bit integer support. On x86 (SSE2/AVX2) and ARM (NEON)
+ * compiled with GCC or clang, it adds vector kernels: the best one for the
+ * CPU is selected by lwip_chksum_init(), which lwip_init() calls.
  */
 
 /*
@@ -53,18 +57,6 @@
 
 #include <string.h>
 
-#ifndef LWIP_CHKSUM
-# define LWIP_CHKSUM lwip_standard_chksum
-# ifndef LWIP_CHKSUM_ALGORITHM
-#  define LWIP_CHKSUM_ALGORITHM 2
-# endif
-u16_t lwip_standard_chksum(const void *dataptr, int len);
-#endif
-/* If none set: */
-#ifndef LWIP_CHKSUM_ALGORITHM
-# define LWIP_CHKSUM_ALGORITHM 0
-#endif
-
 #if (LWIP_CHKSUM_ALGORITHM == 1) /* Version #1 */
 /**
  * lwip checksum
@@ -255,6 +247,285 @@ lwip_standard_chksum(const void *dataptr, int len)
 }
 #endif
 
+#if (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2)
+#if !LWIP_HAVE_INT64
+#error "LWIP_CHKSUM_ALGORITHM 4 and LWIP_CHKSUM_COPY_ALGORITHM 2 need u64_t, check your arch/cc.h"
+#endif
+
+/** Fold a 64-bit sum of 16-bit words to 16 bits (end-around carry) */
+static u16_t
+lwip_chksum_fold64(u64_t sum)
+{
+  u32_t lo = (u32_t)sum;
+  u32_t hi = (u32_t)(sum >> 32);
+
+  lo += hi;
+  if (lo < hi) {
+    lo++;                       /* add back carry */
+  }
+  lo = FOLD_U32T(lo);
+  lo = FOLD_U32T(lo);
+  return (u16_t)lo;
+}
+#endif /* (LWIP_CHKSUM_ALGORITHM == 4) || (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
+
+#if (LWIP_CHKSUM_ALGORITHM == 4) /* Alternative version #4 */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define LWIP_CHKSUM_X86 1
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define LWIP_CHKSUM_NEON 1
+#include <arm_neon.h>
+#endif
+
+/** Shorter buffers (mostly headers) are summed by the scalar routine */
+#define LWIP_CHKSUM_VECTOR_MIN  64
+/** Number of vectors summed into the 32-bit lanes before they are spilled.
+ * Each lane takes two 16-bit words per vector, so this must stay below 32768. */
+#define LWIP_CHKSUM_VECTOR_BLOCK 4096
+
+/**
+ * Like version #3, but the inner loop sums 32 bytes at a time into a 64-bit
+ * accumulator. Each 64-bit word is added as two 32-bit halves, so carries
+ * collect in the upper half and need no test in the loop.
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+static u16_t
+lwip_chksum_generic64(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  const u16_t *ps;
+  const u64_t *pq;
+  u64_t sum = 0, sum2 = 0;
+  u16_t t = 0;
+  /* starts at odd byte address? */
+  int odd = ((mem_ptr_t)pb & 1);
+
+  if (odd && len > 0) {
+    ((u8_t *)&t)[1] = *pb++;
+    len--;
+  }
+
+  ps = (const u16_t *)(const void *)pb;
+
+  /* get aligned to u64_t */
+  while (((mem_ptr_t)ps & 7) && len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  pq = (const u64_t *)(const void *)ps;
+
+  while (len > 31) {
+    u64_t a = pq[0], b = pq[1], c = pq[2], d = pq[3];
+    sum  += (a & 0xffffffffUL) + (a >> 32) + (b & 0xffffffffUL) + (b >> 32);
+    sum2 += (c & 0xffffffffUL) + (c >> 32) + (d & 0xffffffffUL) + (d >> 32);
+    pq += 4;
+    len -= 32;
+  }
+  while (len > 7) {
+    u64_t a = *pq++;
+    sum += (a & 0xffffffffUL) + (a >> 32);
+    len -= 8;
+  }
+  sum += sum2;
+
+  ps = (const u16_t *)(const void *)pq;
+
+  /* 16-bit aligned word remaining? */
+  while (len > 1) {
+    sum += *ps++;
+    len -= 2;
+  }
+
+  /* dangling tail byte remaining? */
+  if (len > 0) {                /* include odd byte */
+    ((u8_t *)&t)[0] = *(const u8_t *)ps;
+  }
+
+  sum += t;                     /* add end bytes */
+
+  t = lwip_chksum_fold64(sum);
+  if (odd) {
+    t = (u16_t)SWAP_BYTES_IN_WORD(t);
+  }
+  return t;
+}
+
+#if LWIP_CHKSUM_X86
+/* The vector kernels sum the 16-bit words of whole vectors (which start at an
+ * even offset from dataptr, so byte order is preserved) zero-extended into
+ * 32-bit lanes, and leave the tail to the scalar routine. */
+
+/** SSE2: available on every x86_64 CPU */
+static u16_t
+lwip_chksum_sse2(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  const __m128i zero = _mm_setzero_si128();
+  u64_t sum = 0;
+
+  while (len > 31) {
+    __m128i acc = zero, acc2 = zero;
+    u64_t lanes[2];
+    int n = LWIP_MIN(len / 32, LWIP_CHKSUM_VECTOR_BLOCK);
+
+    len -= n * 32;
+    while (n-- > 0) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(const void *)pb);
+      __m128i w = _mm_loadu_si128((const __m128i *)(const void *)(pb + 16));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(v, zero));
+      acc2 = _mm_add_epi32(acc2, _mm_unpackhi_epi16(v, zero));
+      acc = _mm_add_epi32(acc, _mm_unpacklo_epi16(w, zero));
+      acc2 = _mm_add_epi32(acc2, _mm_unpackhi_epi16(w, zero));
+      pb += 32;
+    }
+    /* widen the 32-bit lanes to 64 bits before adding them up */
+    acc = _mm_add_epi64(_mm_add_epi64(_mm_unpacklo_epi32(acc, zero), _mm_unpackhi_epi32(acc, zero)),
+                        _mm_add_epi64(_mm_unpacklo_epi32(acc2, zero), _mm_unpackhi_epi32(acc2, zero)));
+    _mm_storeu_si128((__m128i *)(void *)lanes, acc);
+    sum += lanes[0] + lanes[1];
+  }
+  sum += lwip_chksum_generic64(pb, len);
+  return lwip_chksum_fold64(sum);
+}
+
+/** AVX2: selected at runtime */
+__attribute__((target("avx2"))) static u16_t
+lwip_chksum_avx2(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  const __m256i zero = _mm256_setzero_si256();
+  u64_t sum = 0;
+
+  while (len > 63) {
+    __m256i acc = zero, acc2 = zero;
+    u64_t lanes[4];
+    int n = LWIP_MIN(len / 64, LWIP_CHKSUM_VECTOR_BLOCK);
+
+    len -= n * 64;
+    while (n-- > 0) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(const void *)pb);
+      __m256i w = _mm256_loadu_si256((const __m256i *)(const void *)(pb + 32));
+      acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(v, zero));
+      acc2 = _mm256_add_epi32(acc2, _mm256_unpackhi_epi16(v, zero));
+      acc = _mm256_add_epi32(acc, _mm256_unpacklo_epi16(w, zero));
+      acc2 = _mm256_add_epi32(acc2, _mm256_unpackhi_epi16(w, zero));
+      pb += 64;
+    }
+    /* widen the 32-bit lanes to 64 bits before adding them up */
+    acc = _mm256_add_epi64(_mm256_add_epi64(_mm256_unpacklo_epi32(acc, zero), _mm256_unpackhi_epi32(acc, zero)),
+                           _mm256_add_epi64(_mm256_unpacklo_epi32(acc2, zero), _mm256_unpackhi_epi32(acc2, zero)));
+    _mm256_storeu_si256((__m256i *)(void *)lanes, acc);
+    sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+  }
+  sum += lwip_chksum_generic64(pb, len);
+  return lwip_chksum_fold64(sum);
+}
+#endif /* LWIP_CHKSUM_X86 */
+
+#if LWIP_CHKSUM_NEON
+/** NEON: pairwise add-accumulate of the 16-bit words into 32-bit lanes */
+static u16_t
+lwip_chksum_neon(const void *dataptr, int len)
+{
+  const u8_t *pb = (const u8_t *)dataptr;
+  u64_t sum = 0;
+
+  while (len > 15) {
+    uint32x4_t acc = vdupq_n_u32(0);
+    uint64x2_t lanes;
+    int n = LWIP_MIN(len / 16, LWIP_CHKSUM_VECTOR_BLOCK);
+
+    len -= n * 16;
+    while (n-- > 0) {
+      acc = vpadalq_u16(acc, vreinterpretq_u16_u8(vld1q_u8(pb)));
+      pb += 16;
+    }
+    lanes = vpaddlq_u32(acc);
+    sum += vgetq_lane_u64(lanes, 0) + vgetq_lane_u64(lanes, 1);
+  }
+  sum += lwip_chksum_generic64(pb, len);
+  return lwip_chksum_fold64(sum);
+}
+#endif /* LWIP_CHKSUM_NEON */
+
+/** Kernel used for buffers of LWIP_CHKSUM_VECTOR_MIN bytes and more */
+static lwip_chksum_kernel_fn lwip_chksum_kernel = lwip_chksum_generic64;
+
+/**
+ * Select the fastest checksum kernel the CPU supports.
+ * Called from lwip_init(); until then, the scalar routine is used.
+ */
+void
+lwip_chksum_init(void)
+{
+#if LWIP_CHKSUM_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    lwip_chksum_kernel = lwip_chksum_avx2;
+  } else {
+    lwip_chksum_kernel = lwip_chksum_sse2;
+  }
+#elif LWIP_CHKSUM_NEON
+  lwip_chksum_kernel = lwip_chksum_neon;
+#endif
+}
+
+#if LWIP_TESTMODE
+/**
+ * Get a compiled-in checksum kernel, so that each one can be tested
+ * regardless of the one lwip_chksum_init() selected.
+ *
+ * @param i index of the kernel, starting at 0 (the scalar routine)
+ * @return the kernel or NULL if i is past the last one the CPU supports
+ */
+lwip_chksum_kernel_fn
+lwip_chksum_get_kernel(int i)
+{
+  static const lwip_chksum_kernel_fn kernels[] = {
+    lwip_chksum_generic64,
+#if LWIP_CHKSUM_X86
+    lwip_chksum_sse2,
+    lwip_chksum_avx2,
+#elif LWIP_CHKSUM_NEON
+    lwip_chksum_neon,
+#endif
+  };
+
+  if ((i < 0) || ((size_t)i >= LWIP_ARRAYSIZE(kernels))) {
+    return NULL;
+  }
+#if LWIP_CHKSUM_X86
+  __builtin_cpu_init();
+  if ((kernels[i] == lwip_chksum_avx2) && !__builtin_cpu_supports("avx2")) {
+    return NULL;
+  }
+#endif /* LWIP_CHKSUM_X86 */
+  return kernels[i];
+}
+#endif /* LWIP_TESTMODE */
+
+/**
+ * lwip checksum
+ *
+ * @param dataptr points to start of data to be summed at any boundary
+ * @param len length of data to be summed
+ * @return host order (!) lwip checksum (non-inverted Internet sum)
+ */
+u16_t
+lwip_standard_chksum(const void *dataptr, int len)
+{
+  if (len < LWIP_CHKSUM_VECTOR_MIN) {
+    return lwip_chksum_generic64(dataptr, len);
+  }
+  return lwip_chksum_kernel(dataptr, len);
+}
+#endif
+
 /** Parts of the pseudo checksum which are common to IPv4 and IPv6 */
 static u16_t
 inet_cksum_pseudo_base(struct pbuf *p, u8_t proto, u16_t proto_len, u32_t acc)
@@ -606,3 +877,49 @@ lwip_chksum_copy(void *dst, const void *src, u16_t len)
   return LWIP_CHKSUM(dst, len);
 }
 #endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 1) */
+
+#if (LWIP_CHKSUM_COPY_ALGORITHM == 2) /* Version #2 */
+/** Copy and sum in one pass, 8 bytes at a time, so the data is only read
+ * once. The words are summed relative to src, so no alignment is needed.
+ */
+u16_t
+lwip_chksum_copy(void *dst, const void *src, u16_t len)
+{
+  u8_t *pd = (u8_t *)dst;
+  const u8_t *ps = (const u8_t *)src;
+  u64_t sum = 0;
+  u16_t t = 0;
+
+  while (len > 31) {
+    u64_t a, b, c, d;
+    memcpy(&a, ps, 8);
+    memcpy(&b, ps + 8, 8);
+    memcpy(&c, ps + 16, 8);
+    memcpy(&d, ps + 24, 8);
+    memcpy(pd, &a, 8);
+    memcpy(pd + 8, &b, 8);
+    memcpy(pd + 16, &c, 8);
+    memcpy(pd + 24, &d, 8);
+    sum += (a & 0xffffffffUL) + (a >> 32) + (b & 0xffffffffUL) + (b >> 32) +
+           (c & 0xffffffffUL) + (c >> 32) + (d & 0xffffffffUL) + (d >> 32);
+    ps += 32;
+    pd += 32;
+    len = (u16_t)(len - 32);
+  }
+  while (len > 1) {
+    u16_t w;
+    memcpy(&w, ps, 2);
+    memcpy(pd, &w, 2);
+    sum += w;
+    ps += 2;
+    pd += 2;
+    len = (u16_t)(len - 2);
+  }
+  if (len > 0) {
+    *pd = *ps;
+    ((u8_t *)&t)[0] = *ps;
+  }
+  sum += t;
+  return lwip_chksum_fold64(sum);
+}
+#endif /* (LWIP_CHKSUM_COPY_ALGORITHM == 2) */
@@ -43,6 +43,7 @@
 #include "lwip/mem.h"
 #include "lwip/memp.h"
 #include "lwip/pbuf.h"
+#include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
 #include "lwip/sockets.h"
 #include "lwip/ip.h"
@@ -169,12 +170,54 @@ PACK_STRUCT_END
 #if (LWIP_TCP && LWIP_TCP_SACK_OUT && (LWIP_TCP_MAX_SACK_NUM < 1))
 #error "LWIP_TCP_MAX_SACK_NUM must be greater than 0"
 #endif
+#if (LWIP_TCP && LWIP_TCP_SACK_IN && !LWIP_TCP_SACK_OUT)
+#error "To use LWIP_TCP_SACK_IN, LWIP_TCP_SACK_OUT needs to be enabled"
+#endif
+#if (LWIP_TCP_GRO && !(LWIP_TCP && LWIP_IPV4))
+#error "LWIP_TCP_GRO needs LWIP_TCP and LWIP_IPV4 to be enabled"
+#endif
+#if (LWIP_TCP && LWIP_TCP_ZEROCOPY && LWIP_NETIF_TX_SINGLE_PBUF)
+#error "LWIP_TCP_ZEROCOPY cannot be used with LWIP_NETIF_TX_SINGLE_PBUF, which needs all tx data copied"
+#endif
+#if (MEMP_THREAD_CACHE && (MEMP_MEM_MALLOC || !LWIP_HAVE_INT64))
+#error "MEMP_THREAD_CACHE needs the pool allocator (MEMP_MEM_MALLOC==0) and u64_t"
+#endif
+#if (MEMP_THREAD_CACHE && (MEMP_THREAD_CACHE_SIZE < 2))
+#error "MEMP_THREAD_CACHE_SIZE must be at least 2"
+#endif
 #if (LWIP_NETIF_API && (NO_SYS==1))
 #error "If you want to use NETIF API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
 #if ((LWIP_SOCKET || LWIP_NETCONN) && (NO_SYS==1))
 #error "If you want to use Sequential API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
+#if (LWIP_SOCKET && ((LWIP_SOCKET_MMSG_BATCH < 1) || (LWIP_SOCKET_MMSG_BATCH > 0xFFFF)))
+#error "LWIP_SOCKET_MMSG_BATCH must be in the range 1..65535"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_EPOLL && !(LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL))
+#error "If you want to use LWIP_SOCKET_EPOLL, you have to define LWIP_SOCKET_SELECT=1 and/or LWIP_SOCKET_POLL=1 in your lwipopts.h"
+#endif
+#if (LWIP_SOCKET && LWIP_SOCKET_EPOLL && (MEMP_NUM_EPOLL <= 0))
+#error "If you want to use LWIP_SOCKET_EPOLL, you have to define MEMP_NUM_EPOLL>=1 in your lwipopts.h"
+#endif
+#if (LWIP_ARP && (ETHARP_TABLE_HASH_SIZE & (ETHARP_TABLE_HASH_SIZE - 1)))
+#error "ETHARP_TABLE_HASH_SIZE must be a power of 2 in your lwipopts.h"
+#endif
+#if (LWIP_ARP && (ETHARP_TABLE_HASH_SIZE > 0) && (ETHARP_AGE_SLICE < 1))
+#error "ETHARP_AGE_SLICE must be at least 1 in your lwipopts.h"
+#endif
+#if (LWIP_ARP && ETHARP_LOCKLESS_READ && (ETHARP_TABLE_HASH_SIZE == 0))
+#error "If you want to use ETHARP_LOCKLESS_READ, you have to define ETHARP_TABLE_HASH_SIZE > 0 in your lwipopts.h"
+#endif
+#if (LWIP_IPV6 && (LWIP_ND6_CACHE_HASH_SIZE & (LWIP_ND6_CACHE_HASH_SIZE - 1)))
+#error "LWIP_ND6_CACHE_HASH_SIZE must be a power of 2 in your lwipopts.h"
+#endif
+#if (LWIP_ROUTE_TABLE && LWIP_SINGLE_NETIF)
+#error "LWIP_ROUTE_TABLE needs LWIP_SINGLE_NETIF=0 in your lwipopts.h"
+#endif
+#if (LWIP_ROUTE_TABLE && (MEMP_NUM_ROUTE_NODE < MEMP_NUM_ROUTE))
+#error "MEMP_NUM_ROUTE_NODE must be at least MEMP_NUM_ROUTE in your lwipopts.h"
+#endif
 #if (LWIP_PPP_API && (NO_SYS==1))
 #error "If you want to use PPP API, you have to define NO_SYS=0 in your lwipopts.h"
 #endif
@@ -202,6 +245,18 @@ PACK_STRUCT_END
 #if (MEM_USE_POOLS && !MEMP_USE_CUSTOM_POOLS)
 #error "MEM_USE_POOLS requires custom pools (MEMP_USE_CUSTOM_POOLS) to be enabled in your lwipopts.h"
 #endif
+#if (MEM_SLAB && (MEM_LIBC_MALLOC || MEM_USE_POOLS))
+#error "MEM_SLAB may not be enabled together with MEM_LIBC_MALLOC or MEM_USE_POOLS in your lwipopts.h"
+#endif
+#if (MEM_SLAB && (MEM_OVERFLOW_CHECK || MEM_SANITY_CHECK))
+#error "MEM_SLAB does not support MEM_OVERFLOW_CHECK or MEM_SANITY_CHECK"
+#endif
+#if (MEM_SLAB && (((MEM_SLAB_PAGE_SIZE) & ((MEM_SLAB_PAGE_SIZE) - 1)) || (MEM_SLAB_PAGE_SIZE < 64) || (MEM_SIZE < (2 * MEM_SLAB_PAGE_SIZE))))
+#error "MEM_SLAB_PAGE_SIZE must be a power of two >= 64 and MEM_SIZE must hold at least two pages"
+#endif
+#if (MEM_SLAB && (MEM_SLAB_PAGE_SIZE > 8192))
+#error "MEM_SLAB_PAGE_SIZE must be <= 8192: the size classes go up to two pages and mem_init() counts them in mem_size_t"
+#endif
 #if (PBUF_POOL_BUFSIZE <= MEM_ALIGNMENT)
 #error "PBUF_POOL_BUFSIZE must be greater than MEM_ALIGNMENT or the offset may take the full first pbuf"
 #endif
@@ -342,6 +397,9 @@ lwip_init(void)
 
   /* Modules initialization */
   stats_init();
+#if LWIP_CHKSUM_ALGORITHM == 4
+  lwip_chksum_init();
+#endif /* LWIP_CHKSUM_ALGORITHM == 4 */
 #if !NO_SYS
   sys_init();
 #endif /* !NO_SYS */
@@ -53,6 +53,7 @@
 #include "lwip/dhcp.h"
 #include "lwip/autoip.h"
 #include "lwip/prot/iana.h"
+#include "lwip/route.h"
 #include "netif/ethernet.h"
 
 #include <string.h>
@@ -98,12 +99,67 @@ struct etharp_entry {
   ip4_addr_t ipaddr;
   struct netif *netif;
   struct eth_addr ethaddr;
+  /** age in ARP_TMR_INTERVAL ticks (hashed table: tick of the last update) */
   u16_t ctime;
   u8_t state;
+#if ETHARP_TABLE_HASH_SIZE
+  /** set while the entry is on the timer list */
+  u8_t on_tlist;
+  /** next entry in the hash bucket or on the free list (index + 1, 0: none) */
+  netif_addr_idx_t next;
+  /** next entry on the timer list (index + 1, 0: none) */
+  netif_addr_idx_t tnext;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 };
 
 static struct etharp_entry arp_table[ARP_TABLE_SIZE];
 
+#if ETHARP_TABLE_HASH_SIZE
+/** Hash buckets: first entry (index + 1, 0: empty) */
+static netif_addr_idx_t etharp_buckets[ETHARP_TABLE_HASH_SIZE];
+/** Freed entries (index + 1, 0: none) */
+static netif_addr_idx_t etharp_free_list;
+/** Entries from this index on have never been used */
+static netif_addr_idx_t etharp_unused;
+/** Pending and re-requesting entries, which etharp_tmr() handles every call */
+static netif_addr_idx_t etharp_tlist;
+/** Next entry etharp_tmr() checks for expiry */
+static netif_addr_idx_t etharp_age_next;
+/** Incremented by etharp_tmr() */
+static u16_t etharp_now;
+
+#define ETHARP_HASH(ipaddr) \
+  ((u32_t)((ip4_addr_get_u32(ipaddr) * 0x9E3779B1UL) >> 16) & (ETHARP_TABLE_HASH_SIZE - 1))
+#define ETHARP_AGE(i)         ((u16_t)(etharp_now - arp_table[i].ctime))
+#define ETHARP_AGE_RESET(i)   (arp_table[i].ctime = etharp_now)
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+#define ETHARP_EXPIRED(i)     ((arp_table[i].state >= ETHARP_STATE_STABLE) && \
+                               (arp_table[i].state != ETHARP_STATE_STATIC) && (ETHARP_AGE(i) >= ARP_MAXAGE))
+#else /* ETHARP_SUPPORT_STATIC_ENTRIES */
+#define ETHARP_EXPIRED(i)     ((arp_table[i].state >= ETHARP_STATE_STABLE) && (ETHARP_AGE(i) >= ARP_MAXAGE))
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+#else /* ETHARP_TABLE_HASH_SIZE */
+#define ETHARP_AGE(i)         (arp_table[i].ctime)
+#define ETHARP_AGE_RESET(i)   (arp_table[i].ctime = 0)
+/** etharp_tmr() frees expired entries right away */
+#define ETHARP_EXPIRED(i)     0
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
+#if ETHARP_LOCKLESS_READ
+/** Odd while the hash chains or a stable entry are being changed */
+static u32_t etharp_seq;
+#define ETHARP_WRITE_BEGIN() do { \
+    __atomic_store_n(&etharp_seq, etharp_seq + 1, __ATOMIC_RELAXED); \
+    __atomic_thread_fence(__ATOMIC_RELEASE); } while(0)
+#define ETHARP_WRITE_END()   __atomic_store_n(&etharp_seq, etharp_seq + 1, __ATOMIC_RELEASE)
+/** etharp_lookup_nolock() reports "not found" after this many attempts, so
+    it cannot spin for ever on a writer it preempted */
+#define ETHARP_NOLOCK_TRIES  4
+#else /* ETHARP_LOCKLESS_READ */
+#define ETHARP_WRITE_BEGIN()
+#define ETHARP_WRITE_END()
+#endif /* ETHARP_LOCKLESS_READ */
+
 #if !LWIP_NETIF_HWADDRHINT
 static netif_addr_idx_t etharp_cached_entry;
 #endif /* !LWIP_NETIF_HWADDRHINT */
@@ -163,6 +219,45 @@ free_etharp_q(struct etharp_q_entry *q)
 
 #endif /* ARP_QUEUEING */
 
+#if ETHARP_TABLE_HASH_SIZE
+/** Insert entry i into the hash bucket of its IP address */
+static void
+etharp_hash_link(int i)
+{
+  u32_t b = ETHARP_HASH(&arp_table[i].ipaddr);
+  arp_table[i].next = etharp_buckets[b];
+  ETHARP_WRITE_BEGIN();
+  etharp_buckets[b] = (netif_addr_idx_t)(i + 1);
+  ETHARP_WRITE_END();
+}
+
+/** Remove entry i from its hash bucket */
+static void
+etharp_hash_unlink(int i)
+{
+  netif_addr_idx_t *pn = &etharp_buckets[ETHARP_HASH(&arp_table[i].ipaddr)];
+  while (*pn != 0) {
+    if (*pn == i + 1) {
+      *pn = arp_table[i].next;
+      return;
+    }
+    pn = &arp_table[*pn - 1].next;
+  }
+  LWIP_ASSERT("etharp_hash_unlink: entry not found", 0);
+}
+
+/** Put entry i on the timer list unless it is already on it */
+static void
+etharp_tlist_add(int i)
+{
+  if (!arp_table[i].on_tlist) {
+    arp_table[i].on_tlist = 1;
+    arp_table[i].tnext = etharp_tlist;
+    etharp_tlist = (netif_addr_idx_t)(i + 1);
+  }
+}
+#endif /* ETHARP_TABLE_HASH_SIZE */
+
 /** Clean up ARP table entries */
 static void
 etharp_free_entry(int i)
@@ -177,7 +272,16 @@ etharp_free_entry(int i)
     arp_table[i].q = NULL;
   }
   /* recycle entry for re-use */
+#if ETHARP_TABLE_HASH_SIZE
+  ETHARP_WRITE_BEGIN();
+  etharp_hash_unlink(i);
   arp_table[i].state = ETHARP_STATE_EMPTY;
+  ETHARP_WRITE_END();
+  arp_table[i].next = etharp_free_list;
+  etharp_free_list = (netif_addr_idx_t)(i + 1);
+#else /* ETHARP_TABLE_HASH_SIZE */
+  arp_table[i].state = ETHARP_STATE_EMPTY;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 #ifdef LWIP_DEBUG
   /* for debugging, clean out the complete entry */
   arp_table[i].ctime = 0;
@@ -197,6 +301,53 @@ void
 etharp_tmr(void)
 {
   int i;
+#if ETHARP_TABLE_HASH_SIZE
+  netif_addr_idx_t *pt;
+  int n;
+
+  LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer\n"));
+  etharp_now++;
+  /* pending entries re-send their request or expire, re-requesting entries
+     go back to stable */
+  pt = &etharp_tlist;
+  while (*pt != 0) {
+    i = *pt - 1;
+    if (arp_table[i].state == ETHARP_STATE_PENDING) {
+      if (ETHARP_AGE(i) < ARP_MAXPENDING) {
+        /* still pending, resend an ARP query */
+        etharp_request(arp_table[i].netif, &arp_table[i].ipaddr);
+        pt = &arp_table[i].tnext;
+        continue;
+      }
+      LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer: expired pending entry %d.\n", i));
+      etharp_free_entry(i);
+    } else if (arp_table[i].state == ETHARP_STATE_STABLE_REREQUESTING_1) {
+      /* Don't send more than one request every 2 seconds. */
+      arp_table[i].state = ETHARP_STATE_STABLE_REREQUESTING_2;
+      pt = &arp_table[i].tnext;
+      continue;
+    } else if (arp_table[i].state == ETHARP_STATE_STABLE_REREQUESTING_2) {
+      /* Reset state to stable, so that the next transmitted packet will
+         re-send an ARP request. */
+      arp_table[i].state = ETHARP_STATE_STABLE;
+    }
+    /* nothing to do on every call for this entry any more */
+    arp_table[i].on_tlist = 0;
+    *pt = arp_table[i].tnext;
+  }
+
+  /* check a slice of the used entries for expiry */
+  for (n = 0; n < LWIP_MIN(ETHARP_AGE_SLICE, etharp_unused); n++) {
+    if (etharp_age_next >= etharp_unused) {
+      etharp_age_next = 0;
+    }
+    i = etharp_age_next++;
+    if (ETHARP_EXPIRED(i)) {
+      LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer: expired stable entry %d.\n", i));
+      etharp_free_entry(i);
+    }
+  }
+#else /* ETHARP_TABLE_HASH_SIZE */
 
   LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_timer\n"));
   /* remove expired entries from the ARP table */
@@ -229,7 +380,103 @@ etharp_tmr(void)
       }
     }
   }
+#endif /* ETHARP_TABLE_HASH_SIZE */
+}
+
+#if ETHARP_TABLE_HASH_SIZE
+/** Find the entry for ipaddr (on netif), freeing it if it has expired */
+static s16_t
+etharp_hash_find(const ip4_addr_t *ipaddr, struct netif *netif)
+{
+  netif_addr_idx_t n = etharp_buckets[ETHARP_HASH(ipaddr)];
+
+  LWIP_UNUSED_ARG(netif);
+
+  while (n != 0) {
+    s16_t i = (s16_t)(n - 1);
+    if (ip4_addr_cmp(ipaddr, &arp_table[i].ipaddr)
+#if ETHARP_TABLE_MATCH_NETIF
+        && ((netif == NULL) || (netif == arp_table[i].netif))
+#endif /* ETHARP_TABLE_MATCH_NETIF */
+       ) {
+      if (ETHARP_EXPIRED(i)) {
+        LWIP_DEBUGF(ETHARP_DEBUG, ("etharp_hash_find: expired stable entry %d.\n", (int)i));
+        etharp_free_entry(i);
+        return -1;
+      }
+      return i;
+    }
+    n = arp_table[i].next;
+  }
+  return -1;
+}
+
+/**
+ * Get an empty entry. If the table is full and try_hard is set, recycle the
+ * least important entry, using the same order as the linear table: the
+ * oldest stable entry, the oldest pending entry without queued packets, the
+ * oldest pending entry with queued packets.
+ */
+static s16_t
+etharp_alloc_entry(u8_t try_hard)
+{
+  s16_t i;
+
+  if ((etharp_free_list == 0) && (etharp_unused >= ARP_TABLE_SIZE)) {
+    s16_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
+    s16_t old_queue = ARP_TABLE_SIZE;
+    u16_t age_queue = 0, age_pending = 0, age_stable = 0;
+
+    if (!try_hard) {
+      return (s16_t)ERR_MEM;
+    }
+    for (i = 0; i < ARP_TABLE_SIZE; ++i) {
+      u8_t state = arp_table[i].state;
+      u16_t age = ETHARP_AGE(i);
+      if (state == ETHARP_STATE_PENDING) {
+        if (arp_table[i].q != NULL) {
+          if (age >= age_queue) {
+            old_queue = i;
+            age_queue = age;
+          }
+        } else if (age >= age_pending) {
+          old_pending = i;
+          age_pending = age;
+        }
+      } else if ((state >= ETHARP_STATE_STABLE)
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+                 && (state < ETHARP_STATE_STATIC)
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+                ) {
+        if (age >= age_stable) {
+          old_stable = i;
+          age_stable = age;
+        }
+      }
+    }
+    if (old_stable < ARP_TABLE_SIZE) {
+      i = old_stable;
+    } else if (old_pending < ARP_TABLE_SIZE) {
+      i = old_pending;
+    } else if (old_queue < ARP_TABLE_SIZE) {
+      i = old_queue;
+    } else {
+      LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_alloc_entry: no empty or recyclable entries found\n"));
+      return (s16_t)ERR_MEM;
+    }
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_alloc_entry: recycling entry %d\n", (int)i));
+    etharp_free_entry(i);
+  }
+
+  if (etharp_free_list != 0) {
+    i = (s16_t)(etharp_free_list - 1);
+    etharp_free_list = arp_table[i].next;
+  } else {
+    i = (s16_t)etharp_unused++;
+  }
+  return i;
 }
+#endif /* ETHARP_TABLE_HASH_SIZE */
 
 /**
  * Search the ARP table for a matching or new entry.
@@ -255,6 +502,34 @@ etharp_tmr(void)
 static s16_t
 etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
 {
+#if ETHARP_TABLE_HASH_SIZE
+  s16_t i;
+
+  LWIP_ASSERT("ipaddr != NULL", ipaddr != NULL);
+
+  i = etharp_hash_find(ipaddr, netif);
+  if (i >= 0) {
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: found matching entry %d\n", (int)i));
+    return i;
+  }
+  if ((flags & ETHARP_FLAG_FIND_ONLY) != 0) {
+    return (s16_t)ERR_MEM;
+  }
+  i = etharp_alloc_entry((u8_t)((flags & ETHARP_FLAG_TRY_HARD) != 0));
+  if (i < 0) {
+    LWIP_DEBUGF(ETHARP_DEBUG | LWIP_DBG_TRACE, ("etharp_find_entry: no empty entry found and not allowed to recycle\n"));
+    return i;
+  }
+  LWIP_ASSERT("arp_table[i].state == ETHARP_STATE_EMPTY",
+              arp_table[i].state == ETHARP_STATE_EMPTY);
+  ip4_addr_copy(arp_table[i].ipaddr, *ipaddr);
+  ETHARP_AGE_RESET(i);
+#if ETHARP_TABLE_MATCH_NETIF
+  arp_table[i].netif = netif;
+#endif /* ETHARP_TABLE_MATCH_NETIF */
+  etharp_hash_link(i);
+  return i;
+#else /* ETHARP_TABLE_HASH_SIZE */
   s16_t old_pending = ARP_TABLE_SIZE, old_stable = ARP_TABLE_SIZE;
   s16_t empty = ARP_TABLE_SIZE;
   s16_t i = 0;
@@ -398,6 +673,7 @@ etharp_find_entry(const ip4_addr_t *ipaddr, u8_t flags, struct netif *netif)
   arp_table[i].netif = netif;
 #endif /* ETHARP_TABLE_MATCH_NETIF */
   return (s16_t)i;
+#endif /* ETHARP_TABLE_HASH_SIZE */
 }
 
 /**
@@ -441,12 +717,14 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
     return (err_t)i;
   }
 
+  ETHARP_WRITE_BEGIN();
 #if ETHARP_SUPPORT_STATIC_ENTRIES
   if (flags & ETHARP_FLAG_STATIC_ENTRY) {
     /* record static type */
     arp_table[i].state = ETHARP_STATE_STATIC;
   } else if (arp_table[i].state == ETHARP_STATE_STATIC) {
     /* found entry is a static type, don't overwrite it */
+    ETHARP_WRITE_END();
     return ERR_VAL;
   } else
 #endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
@@ -464,7 +742,8 @@ etharp_update_arp_entry(struct netif *netif, const ip4_addr_t *ipaddr, struct et
   /* update address */
   SMEMCPY(&arp_table[i].ethaddr, ethaddr, ETH_HWADDR_LEN);
   /* reset time stamp */
-  arp_table[i].ctime = 0;
+  ETHARP_AGE_RESET(i);
+  ETHARP_WRITE_END();
   /* this is where we will send out queued packets! */
 #if ARP_QUEUEING
   while (arp_table[i].q != NULL) {
@@ -615,7 +894,7 @@ etharp_get_entry(size_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth
   LWIP_ASSERT("netif != NULL", netif != NULL);
   LWIP_ASSERT("eth_ret != NULL", eth_ret != NULL);
 
-  if ((i < ARP_TABLE_SIZE) && (arp_table[i].state >= ETHARP_STATE_STABLE)) {
+  if ((i < ARP_TABLE_SIZE) && (arp_table[i].state >= ETHARP_STATE_STABLE) && !ETHARP_EXPIRED(i)) {
     *ipaddr  = &arp_table[i].ipaddr;
     *netif   = arp_table[i].netif;
     *eth_ret = &arp_table[i].ethaddr;
@@ -625,6 +904,76 @@ etharp_get_entry(size_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth
   }
 }
 
+#if ETHARP_LOCKLESS_READ
+/**
+ * Look up the Ethernet address of a stable ARP entry without holding the
+ * core lock. Neither creates entries nor sends requests.
+ *
+ * The lookup is retried if the table changed while it was read, so the
+ * result is consistent, but may be outdated by the time it is used. If the
+ * table is still being changed after ETHARP_NOLOCK_TRIES attempts (e.g. the
+ * caller interrupted the core context in the middle of an update), 0 is
+ * returned and the caller has to fall back to the locked path.
+ *
+ * @param netif the netif the entry must belong to (NULL: any netif)
+ * @param ipaddr the IP address to look up
+ * @param ethaddr the Ethernet address is copied here if found
+ * @return 1 if a stable entry was found, 0 otherwise
+ */
+int
+etharp_lookup_nolock(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr)
+{
+  u32_t b = ETHARP_HASH(ipaddr);
+  int tries;
+
+  LWIP_ASSERT("ipaddr != NULL && ethaddr != NULL", ipaddr != NULL && ethaddr != NULL);
+  LWIP_UNUSED_ARG(netif);
+
+  for (tries = 0; tries < ETHARP_NOLOCK_TRIES; tries++) {
+    u32_t seq = __atomic_load_n(&etharp_seq, __ATOMIC_ACQUIRE);
+    u16_t now = __atomic_load_n(&etharp_now, __ATOMIC_RELAXED);
+    netif_addr_idx_t n;
+    int steps;
+    int found = 0;
+
+    if (seq & 1) {
+      /* a writer is active */
+      continue;
+    }
+    n = __atomic_load_n(&etharp_buckets[b], __ATOMIC_RELAXED);
+    /* a concurrent writer may leave us on a stale chain: bound the walk */
+    for (steps = 0; (n != 0) && (n <= ARP_TABLE_SIZE) && (steps < ARP_TABLE_SIZE); steps++) {
+      struct etharp_entry *e = &arp_table[n - 1];
+      if (ip4_addr_cmp(ipaddr, &e->ipaddr)
+#if ETHARP_TABLE_MATCH_NETIF
+          && ((netif == NULL) || (netif == e->netif))
+#endif /* ETHARP_TABLE_MATCH_NETIF */
+         ) {
+        u8_t state = e->state;
+        if ((state >= ETHARP_STATE_STABLE) &&
+#if ETHARP_SUPPORT_STATIC_ENTRIES
+            ((state == ETHARP_STATE_STATIC) || ((u16_t)(now - e->ctime) < ARP_MAXAGE))
+#else /* ETHARP_SUPPORT_STATIC_ENTRIES */
+            ((u16_t)(now - e->ctime) < ARP_MAXAGE)
+#endif /* ETHARP_SUPPORT_STATIC_ENTRIES */
+           ) {
+          SMEMCPY(ethaddr, &e->ethaddr, ETH_HWADDR_LEN);
+          found = 1;
+        }
+        break;
+      }
+      n = __atomic_load_n(&e->next, __ATOMIC_RELAXED);
+    }
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&etharp_seq, __ATOMIC_RELAXED) == seq) {
+      return found;
+    }
+  }
+  /* writers kept changing the table */
+  return 0;
+}
+#endif /* ETHARP_LOCKLESS_READ */
+
 /**
  * Responds to ARP requests to us. Upon ARP replies to us, add entry to cache
  * send out queued IP packets. Updates cache with snooped address pairs.
@@ -753,17 +1102,22 @@ etharp_output_to_arp_index(struct netif *netif, struct pbuf *q, netif_addr_idx_t
      but only if its state is ETHARP_STATE_STABLE to prevent flooding the
      network with ARP requests if this address is used frequently. */
   if (arp_table[arp_idx].state == ETHARP_STATE_STABLE) {
-    if (arp_table[arp_idx].ctime >= ARP_AGE_REREQUEST_USED_BROADCAST) {
+    if (ETHARP_AGE(arp_idx) >= ARP_AGE_REREQUEST_USED_BROADCAST) {
       /* issue a standard request using broadcast */
       if (etharp_request(netif, &arp_table[arp_idx].ipaddr) == ERR_OK) {
         arp_table[arp_idx].state = ETHARP_STATE_STABLE_REREQUESTING_1;
       }
-    } else if (arp_table[arp_idx].ctime >= ARP_AGE_REREQUEST_USED_UNICAST) {
+    } else if (ETHARP_AGE(arp_idx) >= ARP_AGE_REREQUEST_USED_UNICAST) {
       /* issue a unicast request (for 15 seconds) to prevent unnecessary broadcast */
       if (etharp_request_dst(netif, &arp_table[arp_idx].ipaddr, &arp_table[arp_idx].ethaddr) == ERR_OK) {
         arp_table[arp_idx].state = ETHARP_STATE_STABLE_REREQUESTING_1;
       }
     }
+#if ETHARP_TABLE_HASH_SIZE
+    if (arp_table[arp_idx].state == ETHARP_STATE_STABLE_REREQUESTING_1) {
+      etharp_tlist_add(arp_idx);
+    }
+#endif /* ETHARP_TABLE_HASH_SIZE */
   }
 
   return ethernet_output(netif, q, (struct eth_addr *)(netif->hwaddr), &arp_table[arp_idx].ethaddr, ETHTYPE_IP);
@@ -819,7 +1173,9 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     dest = &mcastaddr;
     /* unicast destination IP address? */
   } else {
+#if !ETHARP_TABLE_HASH_SIZE
     netif_addr_idx_t i;
+#endif /* !ETHARP_TABLE_HASH_SIZE */
     /* outside local network? if so, this can neither be a global broadcast nor
        a subnet broadcast. */
     if (!ip4_addr_netcmp(ipaddr, netif_ip4_addr(netif), netif_ip4_netmask(netif)) &&
@@ -833,6 +1189,11 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
       if (!ip4_addr_islinklocal(&iphdr->src))
 #endif /* LWIP_AUTOIP */
       {
+#if LWIP_ROUTE_TABLE
+        /* next hop of the static route to ipaddr over this netif */
+        dst_addr = route_next_hop_ip4(netif, ipaddr);
+        if (dst_addr == NULL)
+#endif /* LWIP_ROUTE_TABLE */
 #ifdef LWIP_HOOK_ETHARP_GET_GW
         /* For advanced routing, a single default gateway might not be enough, so get
            the IP address of the gateway to handle the current destination address. */
@@ -862,7 +1223,8 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
 #if ETHARP_TABLE_MATCH_NETIF
             (arp_table[etharp_cached_entry].netif == netif) &&
 #endif
-            (ip4_addr_cmp(dst_addr, &arp_table[etharp_cached_entry].ipaddr))) {
+            (ip4_addr_cmp(dst_addr, &arp_table[etharp_cached_entry].ipaddr)) &&
+            !ETHARP_EXPIRED(etharp_cached_entry)) {
           /* the per-pcb-cached entry is stable and the right one! */
           ETHARP_STATS_INC(etharp.cachehit);
           return etharp_output_to_arp_index(netif, q, etharp_cached_entry);
@@ -872,6 +1234,16 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
     }
 #endif /* LWIP_NETIF_HWADDRHINT */
 
+#if ETHARP_TABLE_HASH_SIZE
+    /* find stable entry in its hash bucket */
+    {
+      s16_t idx = etharp_hash_find(dst_addr, netif);
+      if ((idx >= 0) && (arp_table[idx].state >= ETHARP_STATE_STABLE)) {
+        ETHARP_SET_ADDRHINT(netif, (netif_addr_idx_t)idx);
+        return etharp_output_to_arp_index(netif, q, (netif_addr_idx_t)idx);
+      }
+    }
+#else /* ETHARP_TABLE_HASH_SIZE */
     /* find stable entry: do this here since this is a critical path for
        throughput and etharp_find_entry() is kind of slow */
     for (i = 0; i < ARP_TABLE_SIZE; i++) {
@@ -885,6 +1257,7 @@ etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr)
         return etharp_output_to_arp_index(netif, q, i);
       }
     }
+#endif /* ETHARP_TABLE_HASH_SIZE */
     /* no stable entry found, use the (slower) query function:
        queue on destination Ethernet address belonging to ipaddr */
     return etharp_query(netif, dst_addr, q);
@@ -967,6 +1340,9 @@ etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q)
     arp_table[i].state = ETHARP_STATE_PENDING;
     /* record network interface for re-sending arp request in etharp_tmr */
     arp_table[i].netif = netif;
+#if ETHARP_TABLE_HASH_SIZE
+    etharp_tlist_add(i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
   }
 
   /* { i is either a STABLE or (new or existing) PENDING entry } */
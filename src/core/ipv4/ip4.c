@@ -46,6 +46,7 @@
 #include "lwip/def.h"
 #include "lwip/mem.h"
 #include "lwip/ip4_frag.h"
+#include "lwip/gso.h"
 #include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
 #include "lwip/icmp.h"
@@ -56,6 +57,7 @@
 #include "lwip/autoip.h"
 #include "lwip/stats.h"
 #include "lwip/prot/iana.h"
+#include "lwip/route.h"
 
 #include <string.h>
 
@@ -106,6 +108,23 @@
 /** The IP header ID of the next outgoing IP packet */
 static u16_t ip_id;
 
+#if LWIP_TCP_GSO
+/**
+ * Reserve IP header IDs for the packets a super-segment is split into, so
+ * that packets sent later do not reuse them.
+ *
+ * @param num the number of IDs to reserve
+ * @return the first reserved ID (host byte order), the others follow it
+ */
+u16_t
+ip4_gso_reserve_ids(u16_t num)
+{
+  u16_t id = ip_id;
+  ip_id = (u16_t)(ip_id + num);
+  return id;
+}
+#endif /* LWIP_TCP_GSO */
+
 #if LWIP_MULTICAST_TX_OPTIONS
 /** The default netif used for multicast */
 static struct netif *ip4_default_multicast_netif;
@@ -143,7 +162,8 @@ ip4_route_src(const ip4_addr_t *src, const ip4_addr_t *dest)
  * Finds the appropriate network interface for a given IP address. It
  * searches the list of network interfaces linearly. A match is found
  * if the masked IP address of the network interface equals the masked
- * IP address given to the function.
+ * IP address given to the function. If no netif matches, the static
+ * route table is searched when LWIP_ROUTE_TABLE is enabled.
  *
  * @param dest the destination IP address for which to find the route
  * @return the netif on which to send to reach dest
@@ -200,6 +220,14 @@ ip4_route(const ip4_addr_t *dest)
   }
 #endif /* LWIP_NETIF_LOOPBACK && !LWIP_HAVE_LOOPIF */
 
+#if LWIP_ROUTE_TABLE
+  /* longest prefix match in the static route table */
+  netif = route_lookup_ip4(dest);
+  if (netif != NULL) {
+    return netif;
+  }
+#endif /* LWIP_ROUTE_TABLE */
+
 #ifdef LWIP_HOOK_IP4_ROUTE_SRC
   netif = LWIP_HOOK_IP4_ROUTE_SRC(NULL, dest);
   if (netif != NULL) {
@@ -996,6 +1024,15 @@ ip4_output_if_opt_src(struct pbuf *p, const ip4_addr_t *src, const ip4_addr_t *d
   }
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 #endif /* ENABLE_LOOPBACK */
+#if LWIP_TCP_GSO
+  if (p->gso_size != 0) {
+    if (netif->flags & NETIF_FLAG_GSO) {
+      /* the netif segments it */
+      return netif->output(netif, p, dest);
+    }
+    return ip4_gso_output(p, netif, dest);
+  }
+#endif /* LWIP_TCP_GSO */
 #if IP_FRAG
   /* don't fragment if interface has mtu set to 0 [loopif] */
   if (netif->mtu && (p->tot_len > netif->mtu)) {
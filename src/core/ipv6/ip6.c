@@ -50,6 +50,7 @@
 #include "lwip/ip6.h"
 #include "lwip/ip6_addr.h"
 #include "lwip/ip6_frag.h"
+#include "lwip/gso.h"
 #include "lwip/icmp6.h"
 #include "lwip/priv/raw_priv.h"
 #include "lwip/udp.h"
@@ -57,6 +58,7 @@
 #include "lwip/dhcp6.h"
 #include "lwip/nd6.h"
 #include "lwip/mld6.h"
+#include "lwip/route.h"
 #include "lwip/debug.h"
 #include "lwip/stats.h"
 
@@ -207,6 +209,14 @@ ip6_route(const ip6_addr_t *src, const ip6_addr_t *dest)
     }
   }
 
+#if LWIP_ROUTE_TABLE
+  /* Static routes take precedence over router-announced ones. */
+  netif = route_lookup_ip6(dest);
+  if (netif != NULL) {
+    return netif;
+  }
+#endif /* LWIP_ROUTE_TABLE */
+
   /* Get the netif for a suitable router-announced route. */
   netif = nd6_find_route(dest);
   if (netif != NULL) {
@@ -1258,6 +1268,15 @@ ip6_output_if_src(struct pbuf *p, const ip6_addr_t *src, const ip6_addr_t *dest,
   }
 #endif /* LWIP_MULTICAST_TX_OPTIONS */
 #endif /* ENABLE_LOOPBACK */
+#if LWIP_TCP_GSO
+  if (p->gso_size != 0) {
+    if (netif->flags & NETIF_FLAG_GSO) {
+      /* the netif segments it */
+      return netif->output_ip6(netif, p, dest);
+    }
+    return ip6_gso_output(p, netif, dest);
+  }
+#endif /* LWIP_TCP_GSO */
 #if LWIP_IPV6_FRAG
   /* don't fragment if interface has mtu set to 0 [loopif] */
   if (netif_mtu6(netif) && (p->tot_len > nd6_get_destination_mtu(dest, netif))) {
@@ -57,6 +57,7 @@
 #include "lwip/inet_chksum.h"
 #include "lwip/netif.h"
 #include "lwip/icmp6.h"
+#include "lwip/route.h"
 #include "lwip/mld6.h"
 #include "lwip/dhcp6.h"
 #include "lwip/ip.h"
@@ -87,6 +88,29 @@ u32_t retrans_timer = LWIP_ND6_RETRANS_TIMER; /* @todo implement this value in t
 static u8_t nd6_cached_neighbor_index;
 static netif_addr_idx_t nd6_cached_destination_index;
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+/* Hash buckets of the neighbor and destination caches (entry index + 1, 0 if empty). */
+static u8_t nd6_neighbor_buckets[LWIP_ND6_CACHE_HASH_SIZE];
+static u16_t nd6_destination_buckets[LWIP_ND6_CACHE_HASH_SIZE];
+/* Destination cache LRU list (index + 1) and number of entries handed out so far.
+ * Unused entries are always kept at the tail. */
+static u16_t nd6_destination_lru_head;
+static u16_t nd6_destination_lru_tail;
+static u16_t nd6_destination_used;
+
+#define ND6_HASH(a) ((u16_t)((u32_t)(((a)->addr[0] ^ (a)->addr[1] ^ (a)->addr[2] ^ (a)->addr[3]) * 0x9E3779B1UL) >> 16) & \
+                     (LWIP_ND6_CACHE_HASH_SIZE - 1))
+#define ND6_NEIGHBOR_HASH_LINK(i)     nd6_neighbor_hash_link(i)
+#define ND6_DESTINATION_HASH_LINK(i)  nd6_destination_hash_link(i)
+#define ND6_DESTINATION_RELEASE(i)    nd6_destination_release(i)
+#define ND6_DESTINATION_TOUCH(i)      nd6_destination_lru_touch(i)
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
+#define ND6_NEIGHBOR_HASH_LINK(i)
+#define ND6_DESTINATION_HASH_LINK(i)
+#define ND6_DESTINATION_RELEASE(i)    ip6_addr_set_any(&destination_cache[i].destination_addr)
+#define ND6_DESTINATION_TOUCH(i)      destination_cache[i].age = 0
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /* Multicast address holder. */
 static ip6_addr_t multicast_address;
 
@@ -109,6 +133,12 @@ static s8_t nd6_new_neighbor_cache_entry(void);
 static void nd6_free_neighbor_cache_entry(s8_t i);
 static s16_t nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr);
 static s16_t nd6_new_destination_cache_entry(void);
+#if LWIP_ND6_CACHE_HASH_SIZE
+static void nd6_neighbor_hash_link(s8_t i);
+static void nd6_destination_hash_link(s16_t i);
+static void nd6_destination_release(s16_t i);
+static void nd6_destination_lru_touch(s16_t i);
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 static int nd6_is_prefix_in_netif(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_select_router(const ip6_addr_t *ip6addr, struct netif *netif);
 static s8_t nd6_get_router(const ip6_addr_t *router_addr, struct netif *netif);
@@ -538,6 +568,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
         neighbor_cache[i].netif = inp;
         MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
         ip6_addr_set(&(neighbor_cache[i].next_hop_address), ip6_current_src_addr());
+        ND6_NEIGHBOR_HASH_LINK(i);
 
         /* Receiving a message does not prove reachability: only in one direction.
          * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
@@ -872,6 +903,7 @@ nd6_input(struct pbuf *p, struct netif *inp)
             neighbor_cache[i].netif = inp;
             MEMCPY(neighbor_cache[i].lladdr, lladdr_opt->addr, inp->hwaddr_len);
             ip6_addr_copy(neighbor_cache[i].next_hop_address, target_address);
+            ND6_NEIGHBOR_HASH_LINK(i);
 
             /* Receiving a message does not prove reachability: only in one direction.
              * Delay probe in case we get confirmation of reachability from upper layer (TCP). */
@@ -1018,10 +1050,12 @@ nd6_tmr(void)
     }
   }
 
+#if !LWIP_ND6_CACHE_HASH_SIZE
   /* Process destination entries. */
   for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
     destination_cache[i].age++;
   }
+#endif /* !LWIP_ND6_CACHE_HASH_SIZE */
 
   /* Process router entries. */
   for (i = 0; i < LWIP_ND6_NUM_ROUTERS; i++) {
@@ -1030,11 +1064,11 @@ nd6_tmr(void)
       if (default_router_list[i].invalidation_timer <= ND6_TMR_INTERVAL / 1000) {
         /* No more than 1 second remaining. Clear this entry. Also clear any of
          * its destination cache entries, as per RFC 4861 Sec. 5.3 and 6.3.5. */
-        s8_t j;
+        s16_t j;
         for (j = 0; j < LWIP_ND6_NUM_DESTINATIONS; j++) {
           if (ip6_addr_cmp(&destination_cache[j].next_hop_addr,
                &default_router_list[i].neighbor_entry->next_hop_address)) {
-             ip6_addr_set_any(&destination_cache[j].destination_addr);
+             ND6_DESTINATION_RELEASE(j);
           }
         }
         default_router_list[i].neighbor_entry->isrouter = 0;
@@ -1400,15 +1434,59 @@ nd6_send_rs(struct netif *netif)
 static s8_t
 nd6_find_neighbor_cache_entry(const ip6_addr_t *ip6addr)
 {
+#if LWIP_ND6_CACHE_HASH_SIZE
+  u8_t idx;
+  for (idx = nd6_neighbor_buckets[ND6_HASH(ip6addr)]; idx != 0; idx = neighbor_cache[idx - 1].hnext) {
+    if (ip6_addr_cmp(ip6addr, &(neighbor_cache[idx - 1].next_hop_address))) {
+      return (s8_t)(idx - 1);
+    }
+  }
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
   s8_t i;
   for (i = 0; i < LWIP_ND6_NUM_NEIGHBORS; i++) {
     if (ip6_addr_cmp(ip6addr, &(neighbor_cache[i].next_hop_address))) {
       return i;
     }
   }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   return -1;
 }
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+/**
+ * Insert a neighbor cache entry into the hash bucket of its (new) address.
+ *
+ * @param i the neighbor cache entry index, must not be linked yet
+ */
+static void
+nd6_neighbor_hash_link(s8_t i)
+{
+  u8_t *bucket = &nd6_neighbor_buckets[ND6_HASH(&neighbor_cache[i].next_hop_address)];
+  neighbor_cache[i].hnext = *bucket;
+  *bucket = (u8_t)(i + 1);
+}
+
+/**
+ * Remove a neighbor cache entry from the hash bucket of its address.
+ * Does nothing if the entry is not linked.
+ *
+ * @param i the neighbor cache entry index
+ */
+static void
+nd6_neighbor_hash_unlink(s8_t i)
+{
+  u8_t *link = &nd6_neighbor_buckets[ND6_HASH(&neighbor_cache[i].next_hop_address)];
+  while (*link != 0) {
+    if (*link == (u8_t)(i + 1)) {
+      *link = neighbor_cache[i].hnext;
+      neighbor_cache[i].hnext = 0;
+      return;
+    }
+    link = &neighbor_cache[*link - 1].hnext;
+  }
+}
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /**
  * Create a new neighbor cache entry.
  *
@@ -1542,6 +1620,9 @@ nd6_free_neighbor_cache_entry(s8_t i)
     neighbor_cache[i].q = NULL;
   }
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+  nd6_neighbor_hash_unlink(i);
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   neighbor_cache[i].state = ND6_NO_ENTRY;
   neighbor_cache[i].isrouter = 0;
   neighbor_cache[i].netif = NULL;
@@ -1559,6 +1640,17 @@ nd6_free_neighbor_cache_entry(s8_t i)
 static s16_t
 nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
 {
+#if LWIP_ND6_CACHE_HASH_SIZE
+  u16_t idx;
+
+  IP6_ADDR_ZONECHECK(ip6addr);
+
+  for (idx = nd6_destination_buckets[ND6_HASH(ip6addr)]; idx != 0; idx = destination_cache[idx - 1].hnext) {
+    if (ip6_addr_cmp(ip6addr, &(destination_cache[idx - 1].destination_addr))) {
+      return (s16_t)(idx - 1);
+    }
+  }
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
   s16_t i;
 
   IP6_ADDR_ZONECHECK(ip6addr);
@@ -1568,9 +1660,111 @@ nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
       return i;
     }
   }
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
   return -1;
 }
 
+#if LWIP_ND6_CACHE_HASH_SIZE
+/**
+ * Insert a destination cache entry into the hash bucket of its (new) address.
+ *
+ * @param i the destination cache entry index, must not be linked yet
+ */
+static void
+nd6_destination_hash_link(s16_t i)
+{
+  u16_t *bucket = &nd6_destination_buckets[ND6_HASH(&destination_cache[i].destination_addr)];
+  destination_cache[i].hnext = *bucket;
+  *bucket = (u16_t)(i + 1);
+}
+
+/**
+ * Remove a destination cache entry from the LRU list.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_destination_lru_remove(s16_t i)
+{
+  struct nd6_destination_cache_entry *entry = &destination_cache[i];
+  if (entry->lru_prev != 0) {
+    destination_cache[entry->lru_prev - 1].lru_next = entry->lru_next;
+  } else {
+    nd6_destination_lru_head = entry->lru_next;
+  }
+  if (entry->lru_next != 0) {
+    destination_cache[entry->lru_next - 1].lru_prev = entry->lru_prev;
+  } else {
+    nd6_destination_lru_tail = entry->lru_prev;
+  }
+  entry->lru_prev = 0;
+  entry->lru_next = 0;
+}
+
+/**
+ * Append a destination cache entry (that is not in the LRU list) to the tail
+ * of the LRU list, where unused entries are kept.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_destination_lru_add_tail(s16_t i)
+{
+  destination_cache[i].lru_prev = nd6_destination_lru_tail;
+  destination_cache[i].lru_next = 0;
+  if (nd6_destination_lru_tail != 0) {
+    destination_cache[nd6_destination_lru_tail - 1].lru_next = (u16_t)(i + 1);
+  } else {
+    nd6_destination_lru_head = (u16_t)(i + 1);
+  }
+  nd6_destination_lru_tail = (u16_t)(i + 1);
+}
+
+/**
+ * Mark a destination cache entry as the most recently used one.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_destination_lru_touch(s16_t i)
+{
+  /* entries that were never handed out are not in the list */
+  if ((nd6_destination_lru_head != (u16_t)(i + 1)) && (destination_cache[i].lru_prev != 0)) {
+    nd6_destination_lru_remove(i);
+    destination_cache[i].lru_next = nd6_destination_lru_head;
+    destination_cache[nd6_destination_lru_head - 1].lru_prev = (u16_t)(i + 1);
+    nd6_destination_lru_head = (u16_t)(i + 1);
+  }
+}
+
+/**
+ * Clear a destination cache entry: remove it from its hash bucket and move
+ * it to the tail of the LRU list so that it is reused first.
+ *
+ * @param i the destination cache entry index
+ */
+static void
+nd6_destination_release(s16_t i)
+{
+  if (!ip6_addr_isany(&destination_cache[i].destination_addr)) {
+    u16_t *link = &nd6_destination_buckets[ND6_HASH(&destination_cache[i].destination_addr)];
+    while (*link != 0) {
+      if (*link == (u16_t)(i + 1)) {
+        *link = destination_cache[i].hnext;
+        break;
+      }
+      link = &destination_cache[*link - 1].hnext;
+    }
+    destination_cache[i].hnext = 0;
+    ip6_addr_set_any(&destination_cache[i].destination_addr);
+  }
+  if ((nd6_destination_lru_head == (u16_t)(i + 1)) || (destination_cache[i].lru_prev != 0)) {
+    nd6_destination_lru_remove(i);
+    nd6_destination_lru_add_tail(i);
+  }
+}
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
 /**
  * Create a new destination cache entry. If no unused entry is found,
  * will recycle oldest entry.
@@ -1581,6 +1775,25 @@ nd6_find_destination_cache_entry(const ip6_addr_t *ip6addr)
 static s16_t
 nd6_new_destination_cache_entry(void)
 {
+#if LWIP_ND6_CACHE_HASH_SIZE
+  s16_t i;
+
+  if ((nd6_destination_lru_tail != 0) &&
+      ip6_addr_isany(&destination_cache[nd6_destination_lru_tail - 1].destination_addr)) {
+    /* Reuse an empty entry. */
+    return (s16_t)(nd6_destination_lru_tail - 1);
+  }
+  if (nd6_destination_used < LWIP_ND6_NUM_DESTINATIONS) {
+    /* Take an entry that has never been used. */
+    i = (s16_t)nd6_destination_used++;
+    nd6_destination_lru_add_tail(i);
+    return i;
+  }
+  /* Recycle the least recently used entry. */
+  i = (s16_t)(nd6_destination_lru_tail - 1);
+  nd6_destination_release(i);
+  return i;
+#else /* LWIP_ND6_CACHE_HASH_SIZE */
   s16_t i, j;
   u32_t age;
 
@@ -1601,6 +1814,7 @@ nd6_new_destination_cache_entry(void)
   }
 
   return j;
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 }
 
 /**
@@ -1616,7 +1830,14 @@ nd6_clear_destination_cache(void)
 
   for (i = 0; i < LWIP_ND6_NUM_DESTINATIONS; i++) {
     ip6_addr_set_any(&destination_cache[i].destination_addr);
-  }
+#if LWIP_ND6_CACHE_HASH_SIZE
+    destination_cache[i].hnext = 0;
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+  }
+#if LWIP_ND6_CACHE_HASH_SIZE
+  /* all entries are unused now, so the LRU order does not matter */
+  memset(nd6_destination_buckets, 0, sizeof(nd6_destination_buckets));
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 }
 
 /**
@@ -1820,6 +2041,7 @@ nd6_new_router(const ip6_addr_t *router_addr, struct netif *netif)
       return -1;
     }
     ip6_addr_set(&(neighbor_cache[neighbor_index].next_hop_address), router_addr);
+    ND6_NEIGHBOR_HASH_LINK(neighbor_index);
     neighbor_cache[neighbor_index].netif = netif;
     neighbor_cache[neighbor_index].q = NULL;
     neighbor_cache[neighbor_index].state = ND6_INCOMPLETE;
@@ -1923,9 +2145,9 @@ nd6_new_onlink_prefix(const ip6_addr_t *prefix, struct netif *netif)
 static s8_t
 nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 {
-#ifdef LWIP_HOOK_ND6_GET_GW
+#if defined(LWIP_HOOK_ND6_GET_GW) || LWIP_ROUTE_TABLE
   const ip6_addr_t *next_hop_addr;
-#endif /* LWIP_HOOK_ND6_GET_GW */
+#endif /* LWIP_HOOK_ND6_GET_GW || LWIP_ROUTE_TABLE */
   s8_t i;
   s16_t dst_idx;
 
@@ -1967,6 +2189,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
 
       /* Copy dest address to destination cache. */
       ip6_addr_set(&(destination_cache[nd6_cached_destination_index].destination_addr), ip6addr);
+      ND6_DESTINATION_HASH_LINK(nd6_cached_destination_index);
 
       /* Now find the next hop. is it a neighbor? */
       if (ip6_addr_islinklocal(ip6addr) ||
@@ -1974,6 +2197,12 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
         /* Destination in local link. */
         destination_cache[nd6_cached_destination_index].pmtu = netif_mtu6(netif);
         ip6_addr_copy(destination_cache[nd6_cached_destination_index].next_hop_addr, destination_cache[nd6_cached_destination_index].destination_addr);
+#if LWIP_ROUTE_TABLE
+      } else if ((next_hop_addr = route_next_hop_ip6(netif, ip6addr)) != NULL) {
+        /* Next hop for destination from the static route table. */
+        destination_cache[nd6_cached_destination_index].pmtu = netif_mtu6(netif);
+        ip6_addr_set(&destination_cache[nd6_cached_destination_index].next_hop_addr, next_hop_addr);
+#endif /* LWIP_ROUTE_TABLE */
 #ifdef LWIP_HOOK_ND6_GET_GW
       } else if ((next_hop_addr = LWIP_HOOK_ND6_GET_GW(netif, ip6addr)) != NULL) {
         /* Next hop for destination provided by hook function. */
@@ -1985,7 +2214,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
         i = nd6_select_router(ip6addr, netif);
         if (i < 0) {
           /* No router found. */
-          ip6_addr_set_any(&(destination_cache[nd6_cached_destination_index].destination_addr));
+          ND6_DESTINATION_RELEASE(nd6_cached_destination_index);
           return ERR_RTE;
         }
         destination_cache[nd6_cached_destination_index].pmtu = netif_mtu6(netif); /* Start with netif mtu, correct through ICMPv6 if necessary */
@@ -2026,6 +2255,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
       /* Initialize fields. */
       ip6_addr_copy(neighbor_cache[i].next_hop_address,
                    destination_cache[nd6_cached_destination_index].next_hop_addr);
+      ND6_NEIGHBOR_HASH_LINK(i);
       neighbor_cache[i].isrouter = 0;
       neighbor_cache[i].netif = netif;
       neighbor_cache[i].state = ND6_INCOMPLETE;
@@ -2035,7 +2265,7 @@ nd6_get_next_hop_entry(const ip6_addr_t *ip6addr, struct netif *netif)
   }
 
   /* Reset this destination's age. */
-  destination_cache[nd6_cached_destination_index].age = 0;
+  ND6_DESTINATION_TOUCH(nd6_cached_destination_index);
 
   return nd6_cached_neighbor_index;
 }
@@ -66,6 +66,27 @@
 #include <stdlib.h> /* for malloc()/free() */
 #endif
 
+#if LWIP_ALLOC_PROFILE
+#include "lwip/alloc_profile.h"
+
+/** width of the fragmentation map printed by mem_map_display() */
+#define MEM_MAP_COLUMNS 64
+static void mem_map(char *map);
+
+/* The allocator backends below are wrapped by the profiling entry points
+   at the end of this file */
+#undef mem_malloc
+#undef mem_calloc
+#define mem_malloc mem_malloc_backend
+#define mem_calloc mem_calloc_backend
+#define mem_free   mem_free_backend
+#define mem_trim   mem_trim_backend
+static void *mem_malloc_backend(mem_size_t size);
+static void *mem_calloc_backend(mem_size_t count, mem_size_t size);
+static void  mem_free_backend(void *mem);
+static void *mem_trim_backend(void *mem, mem_size_t size);
+#endif /* LWIP_ALLOC_PROFILE */
+
 /* This is overridable for tests only... */
 #ifndef LWIP_MEM_ILLEGAL_FREE
 #define LWIP_MEM_ILLEGAL_FREE(msg)         LWIP_ASSERT(msg, 0)
@@ -171,6 +192,21 @@ mem_trim(void *mem, mem_size_t size)
   LWIP_UNUSED_ARG(size);
   return mem;
 }
+
+#if LWIP_ALLOC_PROFILE
+/** The heap is not ours: nothing to report */
+void
+mem_frag_info(struct mem_frag_info *info)
+{
+  memset(info, 0, sizeof(*info));
+}
+
+static void
+mem_map(char *map)
+{
+  map[0] = 0;
+}
+#endif /* LWIP_ALLOC_PROFILE */
 #endif /* MEM_LIBC_MALLOC || MEM_USE_POOLS */
 
 #if MEM_LIBC_MALLOC
@@ -338,6 +374,583 @@ mem_free(void *rmem)
   memp_free(hmem->poolnr, hmem);
 }
 
+#elif MEM_SLAB
+/* lwIP heap implemented as a segregated size-class (slab) allocator */
+
+#define MEM_SIZE_ALIGNED     LWIP_MEM_ALIGN_SIZE(MEM_SIZE)
+/** number of pages the heap is cut into */
+#define MEM_SLAB_PAGES       (MEM_SIZE_ALIGNED / MEM_SLAB_PAGE_SIZE)
+/** smallest size class: a free object has to hold the free list link */
+#define MEM_SLAB_MIN_SIZE    LWIP_MEM_ALIGN_SIZE(LWIP_MAX(16, sizeof(mem_size_t)))
+/** largest size class: bigger requests get a run of whole pages */
+#define MEM_SLAB_MAX_SIZE    (2 * MEM_SLAB_PAGE_SIZE)
+/** a slab spans up to this many pages to keep the unused tail small */
+#define MEM_SLAB_MAX_SPAN    4
+#define MEM_SLAB_MAX_CLASSES 48
+/** words of the per-slab bitmap of objects in use */
+#define MEM_SLAB_MAP_WORDS   ((((MEM_SLAB_MAX_SPAN * MEM_SLAB_PAGE_SIZE) / MEM_SLAB_MIN_SIZE) + 31) / 32)
+
+/* values of mem_slab_page::kind besides a size class index */
+#define MEM_SLAB_KIND_FREE      0xff
+#define MEM_SLAB_KIND_RUN       0xfe
+#define MEM_SLAB_KIND_TAIL      0xfd
+
+/** Descriptor of one page of the heap, kept outside the page itself.
+ * The first page of a slab or run describes all of it, the other pages
+ * are MEM_SLAB_KIND_TAIL. */
+struct mem_slab_page {
+  /** links of the partial list of the size class or of the free run list */
+  struct mem_slab_page *next;
+  struct mem_slab_page *prev;
+  /** slab: offset + 1 of the first free object (0: none)
+   *  tail page and last page of a free run: index of the first page */
+  mem_size_t link;
+  /** slab: objects in use; run and free run: length in pages */
+  mem_size_t count;
+  /** slab: objects carved from the slab so far (carving is done lazily) */
+  mem_size_t carved;
+  /** size class index or one of MEM_SLAB_KIND_* */
+  u8_t kind;
+  /** slab: one bit per object, set while the object is in use */
+  u32_t used[MEM_SLAB_MAP_WORDS];
+};
+
+/** Geometry of a size class */
+struct mem_slab_class {
+  /** object size */
+  mem_size_t size;
+  /** objects per slab */
+  mem_size_t objs;
+  /** pages per slab */
+  u8_t span;
+};
+
+/** If you want to relocate the heap to external memory, simply define
+ * LWIP_RAM_HEAP_POINTER as a void-pointer to that location.
+ * If so, make sure the memory at that location is big enough (see below on
+ * how that space is calculated). */
+#ifndef LWIP_RAM_HEAP_POINTER
+/** the heap. page descriptors are kept apart, so it is just the pages */
+LWIP_DECLARE_MEMORY_ALIGNED(ram_heap, MEM_SIZE_ALIGNED);
+#define LWIP_RAM_HEAP_POINTER ram_heap
+#endif /* LWIP_RAM_HEAP_POINTER */
+
+/** pointer to the heap (ram_heap): for alignment, ram is now a pointer instead of an array */
+static u8_t *ram;
+static struct mem_slab_page mem_slab_pages[MEM_SLAB_PAGES];
+/** per size class: slabs with at least one free object */
+static struct mem_slab_page *mem_slab_partial[MEM_SLAB_MAX_CLASSES];
+/** runs of free pages, each one described by its first page */
+static struct mem_slab_page *mem_slab_free_runs;
+static struct mem_slab_class mem_slab_classes[MEM_SLAB_MAX_CLASSES];
+/** size class index by size in units of MEM_ALIGNMENT */
+static u8_t mem_slab_class_of[(MEM_SLAB_MAX_SIZE / MEM_ALIGNMENT) + 1];
+
+/** concurrent access protection */
+#if !NO_SYS
+static sys_mutex_t mem_mutex;
+#endif
+
+#if LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT
+/* every operation is short and bounded, so the whole allocator can run
+   with interrupts disabled */
+#define LWIP_MEM_SLAB_DECL_PROTECT()  SYS_ARCH_DECL_PROTECT(lev_slab)
+#define LWIP_MEM_SLAB_PROTECT()       SYS_ARCH_PROTECT(lev_slab)
+#define LWIP_MEM_SLAB_UNPROTECT()     SYS_ARCH_UNPROTECT(lev_slab)
+#else /* LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT */
+#define LWIP_MEM_SLAB_DECL_PROTECT()
+#define LWIP_MEM_SLAB_PROTECT()       sys_mutex_lock(&mem_mutex)
+#define LWIP_MEM_SLAB_UNPROTECT()     sys_mutex_unlock(&mem_mutex)
+#endif /* LWIP_ALLOW_MEM_FREE_FROM_OTHER_CONTEXT */
+
+#define mem_slab_page_index(pg) ((mem_size_t)((pg) - mem_slab_pages))
+#define mem_slab_page_addr(pg)  (ram + ((mem_ptr_t)mem_slab_page_index(pg) * MEM_SLAB_PAGE_SIZE))
+
+static void
+mem_slab_list_insert(struct mem_slab_page **list, struct mem_slab_page *pg)
+{
+  pg->prev = NULL;
+  pg->next = *list;
+  if (*list != NULL) {
+    (*list)->prev = pg;
+  }
+  *list = pg;
+}
+
+static void
+mem_slab_list_remove(struct mem_slab_page **list, struct mem_slab_page *pg)
+{
+  if (pg->prev != NULL) {
+    pg->prev->next = pg->next;
+  } else {
+    *list = pg->next;
+  }
+  if (pg->next != NULL) {
+    pg->next->prev = pg->prev;
+  }
+  pg->next = pg->prev = NULL;
+}
+
+/** Describe pages [first, first + num) as one free run */
+static void
+mem_slab_run_init(mem_size_t first, mem_size_t num)
+{
+  mem_slab_pages[first].kind = MEM_SLAB_KIND_FREE;
+  mem_slab_pages[first].count = num;
+  mem_slab_pages[first + num - 1].kind = MEM_SLAB_KIND_FREE;
+  mem_slab_pages[first + num - 1].link = first;
+  mem_slab_list_insert(&mem_slab_free_runs, &mem_slab_pages[first]);
+}
+
+/** Return pages [first, first + num) to the free runs, merging them with
+ * free neighbours so that runs never fragment below page granularity */
+static void
+mem_slab_pages_free(mem_size_t first, mem_size_t num)
+{
+  mem_size_t i;
+
+  for (i = first; i < first + num; i++) {
+    mem_slab_pages[i].kind = MEM_SLAB_KIND_FREE;
+  }
+  if ((first + num < MEM_SLAB_PAGES) && (mem_slab_pages[first + num].kind == MEM_SLAB_KIND_FREE)) {
+    /* the page after us can only be the first page of a free run */
+    struct mem_slab_page *next = &mem_slab_pages[first + num];
+    mem_slab_list_remove(&mem_slab_free_runs, next);
+    num = (mem_size_t)(num + next->count);
+  }
+  if ((first > 0) && (mem_slab_pages[first - 1].kind == MEM_SLAB_KIND_FREE)) {
+    /* the page before us can only be the last page of a free run */
+    mem_size_t head = mem_slab_pages[first - 1].link;
+    mem_slab_list_remove(&mem_slab_free_runs, &mem_slab_pages[head]);
+    num = (mem_size_t)(num + first - head);
+    first = head;
+  }
+  mem_slab_run_init(first, num);
+}
+
+/** First-fit allocation of 'num' contiguous pages, the pages after the
+ * first one are marked as its tail
+ * @return the first page or NULL if there is no such run */
+static struct mem_slab_page *
+mem_slab_pages_alloc(mem_size_t num)
+{
+  struct mem_slab_page *run;
+
+  for (run = mem_slab_free_runs; run != NULL; run = run->next) {
+    if (run->count >= num) {
+      mem_size_t first = mem_slab_page_index(run);
+      mem_size_t i;
+      mem_slab_list_remove(&mem_slab_free_runs, run);
+      if (run->count > num) {
+        mem_slab_run_init((mem_size_t)(first + num), (mem_size_t)(run->count - num));
+      }
+      for (i = 1; i < num; i++) {
+        mem_slab_pages[first + i].kind = MEM_SLAB_KIND_TAIL;
+        mem_slab_pages[first + i].link = first;
+      }
+      return run;
+    }
+  }
+  return NULL;
+}
+
+/** Like mem_slab_pages_alloc, but if that fails give the empty slabs kept
+ * by the size classes back and try again */
+static struct mem_slab_page *
+mem_slab_pages_alloc_reclaim(mem_size_t num)
+{
+  struct mem_slab_page *run = mem_slab_pages_alloc(num);
+  if (run == NULL) {
+    u8_t cls;
+    for (cls = 0; cls < MEM_SLAB_MAX_CLASSES; cls++) {
+      struct mem_slab_page *pg = mem_slab_partial[cls];
+      while (pg != NULL) {
+        struct mem_slab_page *next = pg->next;
+        if (pg->count == 0) {
+          mem_slab_list_remove(&mem_slab_partial[cls], pg);
+          mem_slab_pages_free(mem_slab_page_index(pg), mem_slab_classes[cls].span);
+        }
+        pg = next;
+      }
+    }
+    run = mem_slab_pages_alloc(num);
+  }
+  return run;
+}
+
+/**
+ * Set up the size classes and put all pages of the heap into one free run
+ */
+void
+mem_init(void)
+{
+  mem_size_t size, prev = 0;
+  u8_t num_classes = 0;
+  mem_size_t i;
+
+  /* align the heap */
+  ram = (u8_t *)LWIP_MEM_ALIGN(LWIP_RAM_HEAP_POINTER);
+
+  /* four size classes per power of two from MEM_SLAB_MIN_SIZE up to two
+     pages: at most 20% of an object is lost to rounding up its size */
+  for (size = MEM_SLAB_MIN_SIZE; size <= MEM_SLAB_MAX_SIZE; size = (mem_size_t)(size * 2)) {
+    u8_t q;
+    for (q = 0; q < 4; q++) {
+      mem_size_t csize = (mem_size_t)LWIP_MEM_ALIGN_SIZE(size + (size / 4) * q);
+      struct mem_slab_class *c = &mem_slab_classes[num_classes];
+      u8_t span;
+      if ((csize <= prev) || (csize > MEM_SLAB_MAX_SIZE) || (num_classes >= MEM_SLAB_MAX_CLASSES)) {
+        continue;
+      }
+      /* use the smallest slab that wastes no more than 1/8 of its pages,
+         or the one wasting the least if there is none */
+      c->size = csize;
+      c->span = 0;
+      for (span = 1; span <= MEM_SLAB_MAX_SPAN; span++) {
+        u32_t bytes = (u32_t)span * MEM_SLAB_PAGE_SIZE;
+        if ((bytes < csize) || (bytes / csize < 2)) {
+          continue;
+        }
+        if ((c->span == 0) || ((bytes % csize) * c->span * MEM_SLAB_PAGE_SIZE <
+                               ((u32_t)c->span * MEM_SLAB_PAGE_SIZE % csize) * bytes)) {
+          c->span = span;
+        }
+        if ((bytes % csize) * 8 <= bytes) {
+          break;
+        }
+      }
+      c->objs = (mem_size_t)(((u32_t)c->span * MEM_SLAB_PAGE_SIZE) / csize);
+      for (i = (mem_size_t)(prev / MEM_ALIGNMENT + 1); i <= csize / MEM_ALIGNMENT; i++) {
+        mem_slab_class_of[i] = num_classes;
+      }
+      prev = csize;
+      num_classes++;
+    }
+  }
+  LWIP_ASSERT("mem_init: size classes do not cover two pages", prev == MEM_SLAB_MAX_SIZE);
+
+  for (i = 0; i < MEM_SLAB_MAX_CLASSES; i++) {
+    mem_slab_partial[i] = NULL;
+  }
+  mem_slab_free_runs = NULL;
+  memset(mem_slab_pages, 0, sizeof(mem_slab_pages));
+  for (i = 0; i < MEM_SLAB_PAGES; i++) {
+    mem_slab_pages[i].kind = MEM_SLAB_KIND_FREE;
+  }
+  mem_slab_run_init(0, MEM_SLAB_PAGES);
+
+  MEM_STATS_AVAIL(avail, (mem_size_t)(MEM_SLAB_PAGES * MEM_SLAB_PAGE_SIZE));
+
+  if (sys_mutex_new(&mem_mutex) != ERR_OK) {
+    LWIP_ASSERT("failed to create mem_mutex", 0);
+  }
+}
+
+/**
+ * Allocate a block of memory with a minimum of 'size' bytes.
+ * Requests up to two pages are served from a slab of the smallest size
+ * class that fits, bigger requests get a run of whole pages.
+ *
+ * @param size_in is the minimum size of the requested block in bytes.
+ * @return pointer to allocated memory or NULL if no free memory was found.
+ *
+ * Note that the returned value will always be aligned (as defined by MEM_ALIGNMENT).
+ */
+void *
+mem_malloc(mem_size_t size_in)
+{
+  mem_size_t size;
+  struct mem_slab_page *pg;
+  u8_t *ret;
+  LWIP_MEM_SLAB_DECL_PROTECT();
+
+  if (size_in == 0) {
+    return NULL;
+  }
+  size = (mem_size_t)LWIP_MEM_ALIGN_SIZE(size_in);
+  if ((size > MEM_SIZE_ALIGNED) || (size < size_in)) {
+    return NULL;
+  }
+
+  /* protect the heap from concurrent access */
+  LWIP_MEM_SLAB_PROTECT();
+  if (size <= MEM_SLAB_MAX_SIZE) {
+    u8_t cls = mem_slab_class_of[size / MEM_ALIGNMENT];
+    const struct mem_slab_class *c = &mem_slab_classes[cls];
+    mem_size_t obj;
+
+    pg = mem_slab_partial[cls];
+    if (pg == NULL) {
+      /* no slab with a free object left: start a new one */
+      pg = mem_slab_pages_alloc_reclaim(c->span);
+      if (pg == NULL) {
+        goto out_of_memory;
+      }
+      pg->kind = cls;
+      pg->count = 0;
+      pg->carved = 0;
+      pg->link = 0;
+      memset(pg->used, 0, sizeof(pg->used));
+      mem_slab_list_insert(&mem_slab_partial[cls], pg);
+    }
+    if (pg->link != 0) {
+      /* reuse a freed object */
+      ret = mem_slab_page_addr(pg) + pg->link - 1;
+      pg->link = *(mem_size_t *)(void *)ret;
+    } else {
+      /* carve a new object from the slab */
+      ret = mem_slab_page_addr(pg) + (mem_ptr_t)pg->carved * c->size;
+      pg->carved++;
+    }
+    obj = (mem_size_t)((mem_size_t)(ret - mem_slab_page_addr(pg)) / c->size);
+    pg->used[obj / 32] |= (u32_t)1 << (obj % 32);
+    pg->count++;
+    if ((pg->link == 0) && (pg->carved == c->objs)) {
+      /* slab is full */
+      mem_slab_list_remove(&mem_slab_partial[cls], pg);
+    }
+    MEM_STATS_INC_USED(used, c->size);
+  } else {
+    mem_size_t num = (mem_size_t)((size + MEM_SLAB_PAGE_SIZE - 1) / MEM_SLAB_PAGE_SIZE);
+
+    pg = mem_slab_pages_alloc_reclaim(num);
+    if (pg == NULL) {
+      goto out_of_memory;
+    }
+    pg->kind = MEM_SLAB_KIND_RUN;
+    pg->count = num;
+    ret = mem_slab_page_addr(pg);
+    MEM_STATS_INC_USED(used, (mem_size_t)(num * MEM_SLAB_PAGE_SIZE));
+  }
+  LWIP_MEM_SLAB_UNPROTECT();
+  LWIP_ASSERT("mem_malloc: allocated memory not aligned",
+              ((mem_ptr_t)ret % MEM_ALIGNMENT) == 0);
+  return ret;
+
+out_of_memory:
+  MEM_STATS_INC(err);
+  LWIP_MEM_SLAB_UNPROTECT();
+  LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("mem_malloc: could not allocate %"S16_F" bytes\n", (s16_t)size));
+  return NULL;
+}
+
+/**
+ * Find the slab or run a pointer returned by mem_malloc() belongs to and
+ * check that it really points to an allocated block. Call with the heap
+ * protected.
+ *
+ * @return NULL if the pointer is fine, an error message otherwise
+ */
+static const char *
+mem_slab_check(void *rmem, struct mem_slab_page **page, mem_size_t *obj)
+{
+  mem_size_t offset;
+  struct mem_slab_page *pg;
+
+  if (((u8_t *)rmem < ram) || ((u8_t *)rmem >= ram + (mem_ptr_t)MEM_SLAB_PAGES * MEM_SLAB_PAGE_SIZE)) {
+    return "mem_free: illegal memory";
+  }
+  pg = &mem_slab_pages[(mem_size_t)((mem_ptr_t)((u8_t *)rmem - ram) / MEM_SLAB_PAGE_SIZE)];
+  if (pg->kind == MEM_SLAB_KIND_TAIL) {
+    pg = &mem_slab_pages[pg->link];
+  }
+  offset = (mem_size_t)((u8_t *)rmem - mem_slab_page_addr(pg));
+  *page = pg;
+  switch (pg->kind) {
+    case MEM_SLAB_KIND_FREE:
+      return "mem_free: illegal memory: double free";
+    case MEM_SLAB_KIND_RUN:
+      return (offset != 0) ? "mem_free: illegal memory" : NULL;
+    default:
+      if ((offset % mem_slab_classes[pg->kind].size) != 0) {
+        return "mem_free: illegal memory";
+      }
+      *obj = (mem_size_t)(offset / mem_slab_classes[pg->kind].size);
+      if ((*obj >= pg->carved) || !(pg->used[*obj / 32] & ((u32_t)1 << (*obj % 32)))) {
+        return "mem_free: illegal memory: double free";
+      }
+      return NULL;
+  }
+}
+
+/**
+ * Put a block back to its slab or its pages back to the free runs
+ *
+ * @param rmem is the pointer as returned by a previous call to mem_malloc()
+ */
+void
+mem_free(void *rmem)
+{
+  struct mem_slab_page *pg = NULL;
+  mem_size_t obj = 0;
+  const char *err;
+  LWIP_MEM_SLAB_DECL_PROTECT();
+
+  if (rmem == NULL) {
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_LEVEL_SERIOUS, ("mem_free(p == NULL) was called.\n"));
+    return;
+  }
+  if ((((mem_ptr_t)rmem) & (MEM_ALIGNMENT - 1)) != 0) {
+    LWIP_MEM_ILLEGAL_FREE("mem_free: sanity check alignment");
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_free: sanity check alignment\n"));
+    /* protect mem stats from concurrent access */
+    MEM_STATS_INC_LOCKED(illegal);
+    return;
+  }
+
+  /* protect the heap from concurrent access */
+  LWIP_MEM_SLAB_PROTECT();
+  err = mem_slab_check(rmem, &pg, &obj);
+  if (err != NULL) {
+    LWIP_MEM_SLAB_UNPROTECT();
+    LWIP_MEM_ILLEGAL_FREE(err);
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("%s\n", err));
+    /* protect mem stats from concurrent access */
+    MEM_STATS_INC_LOCKED(illegal);
+    return;
+  }
+
+  if (pg->kind == MEM_SLAB_KIND_RUN) {
+    MEM_STATS_DEC_USED(used, (mem_size_t)(pg->count * MEM_SLAB_PAGE_SIZE));
+    mem_slab_pages_free(mem_slab_page_index(pg), pg->count);
+  } else {
+    u8_t cls = pg->kind;
+    const struct mem_slab_class *c = &mem_slab_classes[cls];
+    u8_t was_full = (pg->link == 0) && (pg->carved == c->objs);
+
+    pg->used[obj / 32] &= ~((u32_t)1 << (obj % 32));
+    *(mem_size_t *)rmem = pg->link;
+    pg->link = (mem_size_t)((u8_t *)rmem - mem_slab_page_addr(pg) + 1);
+    pg->count--;
+    MEM_STATS_DEC_USED(used, c->size);
+    if (was_full) {
+      mem_slab_list_insert(&mem_slab_partial[cls], pg);
+    } else if ((pg->count == 0) && ((mem_slab_partial[cls] != pg) || (pg->next != NULL))) {
+      /* keep one empty slab per class to avoid page churn, return the rest */
+      mem_slab_list_remove(&mem_slab_partial[cls], pg);
+      mem_slab_pages_free(mem_slab_page_index(pg), c->span);
+    }
+  }
+  LWIP_MEM_SLAB_UNPROTECT();
+}
+
+/**
+ * Shrink memory returned by mem_malloc().
+ * Objects of a size class stay where they are; a run of pages gives the
+ * pages that are no longer needed back.
+ *
+ * @param rmem pointer to memory allocated by mem_malloc the is to be shrinked
+ * @param new_size required size after shrinking (needs to be smaller than or
+ *                equal to the previous size)
+ * @return for compatibility reasons: is always == rmem, at the moment
+ *         or NULL if newsize is > old size, in which case rmem is NOT touched
+ *         or freed!
+ */
+void *
+mem_trim(void *rmem, mem_size_t new_size)
+{
+  struct mem_slab_page *pg = NULL;
+  mem_size_t newsize, obj = 0;
+  const char *err;
+  void *ret = rmem;
+  LWIP_MEM_SLAB_DECL_PROTECT();
+
+  newsize = (mem_size_t)LWIP_MEM_ALIGN_SIZE(new_size);
+  if ((newsize > MEM_SIZE_ALIGNED) || (newsize < new_size)) {
+    return NULL;
+  }
+
+  LWIP_MEM_SLAB_PROTECT();
+  err = mem_slab_check(rmem, &pg, &obj);
+  if (err != NULL) {
+    LWIP_MEM_SLAB_UNPROTECT();
+    LWIP_DEBUGF(MEM_DEBUG | LWIP_DBG_LEVEL_SEVERE, ("mem_trim: illegal memory\n"));
+    /* protect mem stats from concurrent access */
+    MEM_STATS_INC_LOCKED(illegal);
+    return rmem;
+  }
+  if (pg->kind == MEM_SLAB_KIND_RUN) {
+    mem_size_t num = (mem_size_t)((newsize + MEM_SLAB_PAGE_SIZE - 1) / MEM_SLAB_PAGE_SIZE);
+    if (num == 0) {
+      num = 1;
+    }
+    if (num > pg->count) {
+      ret = NULL;
+    } else if (num < pg->count) {
+      MEM_STATS_DEC_USED(used, (mem_size_t)((pg->count - num) * MEM_SLAB_PAGE_SIZE));
+      mem_slab_pages_free((mem_size_t)(mem_slab_page_index(pg) + num), (mem_size_t)(pg->count - num));
+      pg->count = num;
+    }
+  } else if (newsize > mem_slab_classes[pg->kind].size) {
+    ret = NULL;
+  }
+  LWIP_MEM_SLAB_UNPROTECT();
+  return ret;
+}
+
+#if LWIP_ALLOC_PROFILE
+/**
+ * Report the free space of the heap: free objects in slabs and free pages
+ */
+void
+mem_frag_info(struct mem_frag_info *info)
+{
+  struct mem_slab_page *pg;
+  u8_t cls;
+  LWIP_MEM_SLAB_DECL_PROTECT();
+
+  memset(info, 0, sizeof(*info));
+  LWIP_MEM_SLAB_PROTECT();
+  for (pg = mem_slab_free_runs; pg != NULL; pg = pg->next) {
+    mem_size_t size = (mem_size_t)(pg->count * MEM_SLAB_PAGE_SIZE);
+    info->free = (mem_size_t)(info->free + size);
+    info->largest = LWIP_MAX(info->largest, size);
+    info->blocks++;
+  }
+  for (cls = 0; cls < MEM_SLAB_MAX_CLASSES; cls++) {
+    for (pg = mem_slab_partial[cls]; pg != NULL; pg = pg->next) {
+      const struct mem_slab_class *c = &mem_slab_classes[cls];
+      info->free = (mem_size_t)(info->free + (c->objs - pg->count) * c->size);
+      info->largest = LWIP_MAX(info->largest, c->size);
+    }
+  }
+  LWIP_MEM_SLAB_UNPROTECT();
+}
+
+/** Fill the fragmentation map: '.' free pages, '#' runs and full slabs,
+ * '+' slabs with free objects; a column stands for one or more pages */
+static void
+mem_map(char *map)
+{
+  mem_size_t per_col = (mem_size_t)((MEM_SLAB_PAGES + MEM_MAP_COLUMNS - 1) / MEM_MAP_COLUMNS);
+  mem_size_t i;
+  u16_t col = 0;
+  LWIP_MEM_SLAB_DECL_PROTECT();
+
+  LWIP_MEM_SLAB_PROTECT();
+  for (i = 0; i < MEM_SLAB_PAGES; i += per_col) {
+    u8_t free = 0, full = 0;
+    mem_size_t j;
+    for (j = i; (j < i + per_col) && (j < MEM_SLAB_PAGES); j++) {
+      struct mem_slab_page *pg = &mem_slab_pages[j];
+      if (pg->kind == MEM_SLAB_KIND_TAIL) {
+        pg = &mem_slab_pages[pg->link];
+      }
+      if (pg->kind == MEM_SLAB_KIND_FREE) {
+        free = 1;
+      } else if ((pg->kind == MEM_SLAB_KIND_RUN) || (pg->count == mem_slab_classes[pg->kind].objs)) {
+        full = 1;
+      } else {
+        free = full = 1;
+      }
+    }
+    map[col++] = (free && full) ? '+' : (full ? '#' : '.');
+  }
+  LWIP_MEM_SLAB_UNPROTECT();
+  map[col] = 0;
+}
+#endif /* LWIP_ALLOC_PROFILE */
+
 #else /* MEM_USE_POOLS */
 /* lwIP replacement for your libc malloc() */
 
@@ -975,7 +1588,69 @@ mem_malloc_adjust_lfree:
   return NULL;
 }
 
-#endif /* MEM_USE_POOLS */
+#if LWIP_ALLOC_PROFILE
+/**
+ * Report the free space of the heap and how it is split up
+ */
+void
+mem_frag_info(struct mem_frag_info *info)
+{
+  struct mem *mem;
+  LWIP_MEM_ALLOC_DECL_PROTECT();
+
+  memset(info, 0, sizeof(*info));
+  sys_mutex_lock(&mem_mutex);
+  LWIP_MEM_ALLOC_PROTECT();
+  for (mem = (struct mem *)(void *)ram; mem != ram_end; mem = ptr_to_mem(mem->next)) {
+    if (!mem->used) {
+      mem_size_t size = (mem_size_t)(mem->next - mem_to_ptr(mem) - SIZEOF_STRUCT_MEM);
+      info->free = (mem_size_t)(info->free + size);
+      info->largest = LWIP_MAX(info->largest, size);
+      info->blocks++;
+    }
+  }
+  LWIP_MEM_ALLOC_UNPROTECT();
+  sys_mutex_unlock(&mem_mutex);
+}
+
+/** Fill the fragmentation map: one character per MEM_MAP_COLUMNS-th of the heap */
+static void
+mem_map(char *map)
+{
+  mem_size_t used[MEM_MAP_COLUMNS];
+  mem_size_t col_size = (mem_size_t)((MEM_SIZE_ALIGNED + MEM_MAP_COLUMNS - 1) / MEM_MAP_COLUMNS);
+  struct mem *mem;
+  u16_t col;
+  LWIP_MEM_ALLOC_DECL_PROTECT();
+
+  memset(used, 0, sizeof(used));
+  sys_mutex_lock(&mem_mutex);
+  LWIP_MEM_ALLOC_PROTECT();
+  for (mem = (struct mem *)(void *)ram; mem != ram_end; mem = ptr_to_mem(mem->next)) {
+    if (mem->used) {
+      /* spread the block (header included) over the columns it covers */
+      mem_size_t start = mem_to_ptr(mem);
+      while (start < mem->next) {
+        mem_size_t col_end = (mem_size_t)((start / col_size + 1) * col_size);
+        mem_size_t end = LWIP_MIN(col_end, mem->next);
+        used[start / col_size] = (mem_size_t)(used[start / col_size] + end - start);
+        start = end;
+      }
+    }
+  }
+  LWIP_MEM_ALLOC_UNPROTECT();
+  sys_mutex_unlock(&mem_mutex);
+
+  for (col = 0; (col < MEM_MAP_COLUMNS) && ((u32_t)col * col_size < MEM_SIZE_ALIGNED); col++) {
+    u32_t col_start = (u32_t)col * col_size;
+    mem_size_t size = (mem_size_t)(LWIP_MIN(col_start + col_size, (u32_t)MEM_SIZE_ALIGNED) - col_start);
+    map[col] = (used[col] == 0) ? '.' : ((used[col] >= size) ? '#' : '+');
+  }
+  map[col] = 0;
+}
+#endif /* LWIP_ALLOC_PROFILE */
+
+#endif /* MEM_USE_POOLS / MEM_SLAB */
 
 #if MEM_LIBC_MALLOC && (!LWIP_STATS || !MEM_STATS)
 void *
@@ -1015,3 +1690,78 @@ mem_calloc(mem_size_t count, mem_size_t size)
   return p;
 }
 #endif /* MEM_LIBC_MALLOC && (!LWIP_STATS || !MEM_STATS) */
+
+#if LWIP_ALLOC_PROFILE
+#undef mem_malloc
+#undef mem_calloc
+#undef mem_free
+#undef mem_trim
+
+/**
+ * Allocate from the heap and account the allocation to its call site
+ * (use mem_malloc(), which supplies file and line).
+ */
+void *
+mem_malloc_fn(mem_size_t size, const char *file, const int line)
+{
+  void *p = mem_malloc_backend(size);
+  alloc_profile_alloc(ALLOC_PROFILE_HEAP, p, size, file, line);
+  return p;
+}
+
+/**
+ * Profiled version of mem_calloc() (use mem_calloc(), which supplies file
+ * and line).
+ */
+void *
+mem_calloc_fn(mem_size_t count, mem_size_t size, const char *file, const int line)
+{
+  void *p = mem_calloc_backend(count, size);
+  alloc_profile_alloc(ALLOC_PROFILE_HEAP, p, (mem_size_t)(count * size), file, line);
+  return p;
+}
+
+/**
+ * Profiled mem_free(): the profiler is told before the memory can be
+ * handed out again
+ */
+void
+mem_free(void *rmem)
+{
+  if (rmem != NULL) {
+    alloc_profile_free(rmem);
+  }
+  mem_free_backend(rmem);
+}
+
+/**
+ * Profiled mem_trim()
+ */
+void *
+mem_trim(void *rmem, mem_size_t new_size)
+{
+  void *p = mem_trim_backend(rmem, new_size);
+  if (p != NULL) {
+    alloc_profile_resize(p, new_size);
+  }
+  return p;
+}
+
+/**
+ * Print free space, largest free block and a map of the heap
+ */
+void
+mem_map_display(void)
+{
+  struct mem_frag_info info;
+  char map[MEM_MAP_COLUMNS + 1];
+
+  mem_frag_info(&info);
+  mem_map(map);
+  LWIP_PLATFORM_DIAG(("\nHEAP\n\t"));
+  LWIP_PLATFORM_DIAG(("free: %"MEM_SIZE_F"\n\t", info.free));
+  LWIP_PLATFORM_DIAG(("largest: %"MEM_SIZE_F"\n\t", info.largest));
+  LWIP_PLATFORM_DIAG(("blocks: %"MEM_SIZE_F"\n\t", info.blocks));
+  LWIP_PLATFORM_DIAG(("map: [%s]\n", map));
+}
+#endif /* LWIP_ALLOC_PROFILE */
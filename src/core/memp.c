@@ -48,6 +48,7 @@
 #include "lwip/memp.h"
 #include "lwip/sys.h"
 #include "lwip/stats.h"
+#include "lwip/alloc_profile.h"
 
 #include <string.h>
 
@@ -74,6 +75,7 @@
 #include "lwip/priv/nd6_priv.h"
 #include "lwip/ip6_frag.h"
 #include "lwip/mld6.h"
+#include "lwip/route.h"
 
 #define LWIP_MEMPOOL(name,num,size,desc) LWIP_MEMPOOL_DECLARE(name,num,size,desc)
 #include "lwip/priv/memp_std.h"
@@ -93,7 +95,7 @@ const struct memp_desc *const memp_pools[MEMP_MAX] = {
 #define MEMP_OVERFLOW_CHECK 1
 #endif
 
-#if MEMP_SANITY_CHECK && !MEMP_MEM_MALLOC
+#if MEMP_SANITY_CHECK && !MEMP_MEM_MALLOC && !MEMP_THREAD_CACHE
 /**
  * Check that memp-lists don't form a circle, using "Floyd's cycle-finding algorithm".
  */
@@ -114,7 +116,7 @@ memp_sanity(const struct memp_desc *desc)
 
   return 1;
 }
-#endif /* MEMP_SANITY_CHECK && !MEMP_MEM_MALLOC */
+#endif /* MEMP_SANITY_CHECK && !MEMP_MEM_MALLOC && !MEMP_THREAD_CACHE */
 
 #if MEMP_OVERFLOW_CHECK
 /**
@@ -165,6 +167,240 @@ memp_overflow_check_all(void)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if MEMP_THREAD_CACHE
+/* The pools are lock-free: the shared free list of each pool is updated with
+ * compare-and-swap and the statistics with atomic operations. */
+#define MEMP_DECL_PROTECT(lev)
+#define MEMP_PROTECT(lev)
+#define MEMP_UNPROTECT(lev)
+#define MEMP_COUNTER_INC(x)     __atomic_add_fetch(&(x), 1, __ATOMIC_RELAXED)
+#define MEMP_COUNTER_DEC(x)     __atomic_sub_fetch(&(x), 1, __ATOMIC_RELAXED)
+
+#define MEMP_ATOMIC_LOAD(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define MEMP_ATOMIC_CAS(p, expected, desired) \
+  __atomic_compare_exchange_n((p), (expected), (desired), 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+/** Index of an empty list / of a pointer that is no element of the pool */
+#define MEMP_SHARED_EMPTY       0xffffffffUL
+#define MEMP_SHARED_INVALID     0xfffffffeUL
+
+/** Elements moved between a thread cache and the shared pool at once */
+#define MEMP_THREAD_CACHE_BATCH (MEMP_THREAD_CACHE_SIZE / 2)
+/** Pools too small to spread over the caches of several threads are not cached */
+#define MEMP_THREAD_CACHE_USED(desc) ((desc)->num >= 4 * MEMP_THREAD_CACHE_SIZE)
+
+/** Free elements of one pool cached by the current thread */
+struct memp_thread_cache {
+  struct memp *first;
+  u16_t count;
+};
+
+static LWIP_THREAD_LOCAL struct memp_thread_cache memp_thread_cache[MEMP_MAX];
+
+/** Distance between two elements of a pool */
+static mem_ptr_t
+memp_element_size(const struct memp_desc *desc)
+{
+  return MEMP_SIZE + desc->size
+#if MEMP_OVERFLOW_CHECK
+         + MEM_SANITY_REGION_AFTER_ALIGNED
+#endif
+         ;
+}
+
+static struct memp *
+memp_shared_element(const struct memp_desc *desc, u32_t index)
+{
+  if (index == MEMP_SHARED_EMPTY) {
+    return NULL;
+  }
+  return (struct memp *)(void *)((u8_t *)LWIP_MEM_ALIGN(desc->base) + index * memp_element_size(desc));
+}
+
+/** Index of an element, MEMP_SHARED_INVALID if memp does not point to one */
+static u32_t
+memp_shared_index(const struct memp_desc *desc, const struct memp *memp)
+{
+  mem_ptr_t base = (mem_ptr_t)LWIP_MEM_ALIGN(desc->base);
+  mem_ptr_t offset;
+
+  if (memp == NULL) {
+    return MEMP_SHARED_EMPTY;
+  }
+  offset = (mem_ptr_t)memp - base;
+  if (((mem_ptr_t)memp < base) || (offset >= desc->num * memp_element_size(desc)) ||
+      ((offset % memp_element_size(desc)) != 0)) {
+    return MEMP_SHARED_INVALID;
+  }
+  return (u32_t)(offset / memp_element_size(desc));
+}
+
+/** Build a new list head: the counter in the upper half changes on every
+ * update, so a compare-and-swap fails if the list was changed since the head
+ * was read, even if the same element is first again (ABA problem). */
+static u64_t
+memp_shared_head(u64_t old_head, u32_t index)
+{
+  return (((old_head >> 32) + 1) << 32) | index;
+}
+
+/**
+ * Take up to count elements off the shared free list of a pool.
+ *
+ * @param desc the pool
+ * @param count maximum number of elements to take
+ * @param taken receives the number of elements taken
+ * @return the elements taken, linked by their next pointers
+ */
+static struct memp *
+memp_shared_pop(const struct memp_desc *desc, u16_t count, u16_t *taken)
+{
+  u64_t head = MEMP_ATOMIC_LOAD(desc->shared);
+  struct memp *first, *last, *next;
+  u32_t index;
+  u16_t n;
+
+  for (;;) {
+    first = memp_shared_element(desc, (u32_t)head);
+    if (first == NULL) {
+      *taken = 0;
+      return NULL;
+    }
+    /* The elements may be taken by another thread (and their next pointers
+       overwritten) while walking the list: a pointer leaving the pool ends
+       the walk, and the compare-and-swap only succeeds if nothing changed. */
+    last = first;
+    next = __atomic_load_n(&last->next, __ATOMIC_RELAXED);
+    index = memp_shared_index(desc, next);
+    for (n = 1; (n < count) && (next != NULL) && (index != MEMP_SHARED_INVALID); n++) {
+      last = next;
+      next = __atomic_load_n(&last->next, __ATOMIC_RELAXED);
+      index = memp_shared_index(desc, next);
+    }
+    if (index == MEMP_SHARED_INVALID) {
+      /* the list changed under us */
+      head = MEMP_ATOMIC_LOAD(desc->shared);
+    } else if (MEMP_ATOMIC_CAS(desc->shared, &head, memp_shared_head(head, index))) {
+      break;
+    }
+  }
+
+  __atomic_store_n(&last->next, NULL, __ATOMIC_RELAXED);
+  *taken = n;
+  return first;
+}
+
+/**
+ * Put a list of elements onto the shared free list of a pool.
+ *
+ * @param desc the pool
+ * @param first first element of the list
+ * @param last last element of the list
+ */
+static void
+memp_shared_push(const struct memp_desc *desc, struct memp *first, struct memp *last)
+{
+  u64_t head = MEMP_ATOMIC_LOAD(desc->shared);
+  u32_t index = memp_shared_index(desc, first);
+
+  LWIP_ASSERT("memp_free: element of the pool", index < MEMP_SHARED_INVALID);
+  do {
+    __atomic_store_n(&last->next, memp_shared_element(desc, (u32_t)head), __ATOMIC_RELAXED);
+  } while (!MEMP_ATOMIC_CAS(desc->shared, &head, memp_shared_head(head, index)));
+}
+
+/** Get a free element: from the thread cache if the pool is cached
+ * (refilled from the shared pool if empty), else from the shared pool. */
+static struct memp *
+memp_cache_get(const struct memp_desc *desc, memp_t type)
+{
+  struct memp_thread_cache *cache;
+  struct memp *memp;
+  u16_t taken;
+
+  if ((type == MEMP_MAX) || !MEMP_THREAD_CACHE_USED(desc)) {
+    return memp_shared_pop(desc, 1, &taken);
+  }
+  cache = &memp_thread_cache[type];
+  if (cache->first == NULL) {
+    cache->first = memp_shared_pop(desc, MEMP_THREAD_CACHE_BATCH, &cache->count);
+    if (cache->first == NULL) {
+      return NULL;
+    }
+  }
+  memp = cache->first;
+  cache->first = memp->next;
+  cache->count--;
+  return memp;
+}
+
+/** Return a free element: to the thread cache if the pool is cached, else
+ * (or if the shared pool is empty, so other threads can get it) to the
+ * shared pool. A full thread cache returns half of its elements first. */
+static void
+memp_cache_put(const struct memp_desc *desc, memp_t type, struct memp *memp)
+{
+  struct memp_thread_cache *cache;
+
+  if ((type == MEMP_MAX) || !MEMP_THREAD_CACHE_USED(desc) ||
+      ((u32_t)MEMP_ATOMIC_LOAD(desc->shared) == MEMP_SHARED_EMPTY)) {
+    memp_shared_push(desc, memp, memp);
+    return;
+  }
+  cache = &memp_thread_cache[type];
+  if (cache->count >= MEMP_THREAD_CACHE_SIZE) {
+    /* keep the recently freed (cache-hot) half */
+    struct memp *keep_last = cache->first;
+    struct memp *drain_first, *drain_last;
+    u16_t i;
+    for (i = 1; i < MEMP_THREAD_CACHE_BATCH; i++) {
+      keep_last = keep_last->next;
+    }
+    drain_first = keep_last->next;
+    keep_last->next = NULL;
+    drain_last = drain_first;
+    while (drain_last->next != NULL) {
+      drain_last = drain_last->next;
+    }
+    memp_shared_push(desc, drain_first, drain_last);
+    cache->count = MEMP_THREAD_CACHE_BATCH;
+  }
+  memp->next = cache->first;
+  cache->first = memp;
+  cache->count++;
+}
+
+/**
+ * Return all elements cached by the calling thread to their pools.
+ * Threads should call this before they exit, as the elements would be lost
+ * otherwise.
+ */
+void
+memp_thread_cache_flush(void)
+{
+  u16_t i;
+
+  for (i = 0; i < MEMP_MAX; i++) {
+    struct memp_thread_cache *cache = &memp_thread_cache[i];
+    if (cache->first != NULL) {
+      struct memp *last = cache->first;
+      while (last->next != NULL) {
+        last = last->next;
+      }
+      memp_shared_push(memp_pools[i], cache->first, last);
+      cache->first = NULL;
+      cache->count = 0;
+    }
+  }
+}
+#else /* MEMP_THREAD_CACHE */
+#define MEMP_DECL_PROTECT(lev)  SYS_ARCH_DECL_PROTECT(lev)
+#define MEMP_PROTECT(lev)       SYS_ARCH_PROTECT(lev)
+#define MEMP_UNPROTECT(lev)     SYS_ARCH_UNPROTECT(lev)
+#define MEMP_COUNTER_INC(x)     (++(x))
+#define MEMP_COUNTER_DEC(x)     (--(x))
+#endif /* MEMP_THREAD_CACHE */
+
 /**
  * Initialize custom memory pool.
  * Related functions: memp_malloc_pool, memp_free_pool
@@ -204,6 +440,11 @@ memp_init_pool(const struct memp_desc *desc)
 #endif
                                   );
   }
+#if MEMP_THREAD_CACHE
+  /* the list is only accessed through the lock-free head */
+  *desc->shared = memp_shared_index(desc, *desc->tab);
+  *desc->tab = NULL;
+#endif /* MEMP_THREAD_CACHE */
 #if MEMP_STATS
   desc->stats->avail = desc->num;
 #endif /* MEMP_STATS */
@@ -225,6 +466,10 @@ memp_init(void)
 {
   u16_t i;
 
+#if MEMP_THREAD_CACHE
+  memset(memp_thread_cache, 0, sizeof(memp_thread_cache));
+#endif /* MEMP_THREAD_CACHE */
+
   /* for every pool: */
   for (i = 0; i < LWIP_ARRAYSIZE(memp_pools); i++) {
     memp_init_pool(memp_pools[i]);
@@ -241,18 +486,21 @@ memp_init(void)
 }
 
 static void *
-#if !MEMP_OVERFLOW_CHECK
-do_memp_malloc_pool(const struct memp_desc *desc)
+#if !MEMP_OVERFLOW_CHECK && !LWIP_ALLOC_PROFILE
+do_memp_malloc_pool(const struct memp_desc *desc, memp_t type)
 #else
-do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int line)
+do_memp_malloc_pool_fn(const struct memp_desc *desc, memp_t type, const char *file, const int line)
 #endif
 {
   struct memp *memp;
-  SYS_ARCH_DECL_PROTECT(old_level);
+  MEMP_DECL_PROTECT(old_level);
 
+  LWIP_UNUSED_ARG(type);
 #if MEMP_MEM_MALLOC
   memp = (struct memp *)mem_malloc(MEMP_SIZE + MEMP_ALIGN_SIZE(desc->size));
   SYS_ARCH_PROTECT(old_level);
+#elif MEMP_THREAD_CACHE
+  memp = memp_cache_get(desc, type);
 #else /* MEMP_MEM_MALLOC */
   SYS_ARCH_PROTECT(old_level);
 
@@ -265,7 +513,9 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
     memp_overflow_check_element(memp, desc);
 #endif /* MEMP_OVERFLOW_CHECK */
 
+#if !MEMP_THREAD_CACHE
     *desc->tab = memp->next;
+#endif /* !MEMP_THREAD_CACHE */
 #if MEMP_OVERFLOW_CHECK
     memp->next = NULL;
 #endif /* MEMP_OVERFLOW_CHECK */
@@ -280,19 +530,27 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
     LWIP_ASSERT("memp_malloc: memp properly aligned",
                 ((mem_ptr_t)memp % MEM_ALIGNMENT) == 0);
 #if MEMP_STATS
-    desc->stats->used++;
-    if (desc->stats->used > desc->stats->max) {
-      desc->stats->max = desc->stats->used;
+    {
+      mem_size_t used = MEMP_COUNTER_INC(desc->stats->used);
+      if (used > desc->stats->max) {
+        desc->stats->max = used;
+      }
     }
 #endif
-    SYS_ARCH_UNPROTECT(old_level);
+    MEMP_UNPROTECT(old_level);
+#if LWIP_ALLOC_PROFILE
+    alloc_profile_alloc((u16_t)type, (u8_t *)memp + MEMP_SIZE, desc->size, file, line);
+#endif /* LWIP_ALLOC_PROFILE */
     /* cast through u8_t* to get rid of alignment warnings */
     return ((u8_t *)memp + MEMP_SIZE);
   } else {
 #if MEMP_STATS
-    desc->stats->err++;
+    MEMP_COUNTER_INC(desc->stats->err);
 #endif
-    SYS_ARCH_UNPROTECT(old_level);
+    MEMP_UNPROTECT(old_level);
+#if LWIP_ALLOC_PROFILE
+    alloc_profile_alloc((u16_t)type, NULL, desc->size, file, line);
+#endif /* LWIP_ALLOC_PROFILE */
     LWIP_DEBUGF(MEMP_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("memp_malloc: out of memory in pool %s\n", desc->desc));
   }
 
@@ -307,7 +565,7 @@ do_memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int
  * @return a pointer to the allocated memory or a NULL pointer on error
  */
 void *
-#if !MEMP_OVERFLOW_CHECK
+#if !MEMP_OVERFLOW_CHECK && !LWIP_ALLOC_PROFILE
 memp_malloc_pool(const struct memp_desc *desc)
 #else
 memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int line)
@@ -318,10 +576,10 @@ memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int li
     return NULL;
   }
 
-#if !MEMP_OVERFLOW_CHECK
-  return do_memp_malloc_pool(desc);
+#if !MEMP_OVERFLOW_CHECK && !LWIP_ALLOC_PROFILE
+  return do_memp_malloc_pool(desc, MEMP_MAX);
 #else
-  return do_memp_malloc_pool_fn(desc, file, line);
+  return do_memp_malloc_pool_fn(desc, MEMP_MAX, file, line);
 #endif
 }
 
@@ -333,7 +591,7 @@ memp_malloc_pool_fn(const struct memp_desc *desc, const char *file, const int li
  * @return a pointer to the allocated memory or a NULL pointer on error
  */
 void *
-#if !MEMP_OVERFLOW_CHECK
+#if !MEMP_OVERFLOW_CHECK && !LWIP_ALLOC_PROFILE
 memp_malloc(memp_t type)
 #else
 memp_malloc_fn(memp_t type, const char *file, const int line)
@@ -346,41 +604,48 @@ memp_malloc_fn(memp_t type, const char *file, const int line)
   memp_overflow_check_all();
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
-#if !MEMP_OVERFLOW_CHECK
-  memp = do_memp_malloc_pool(memp_pools[type]);
+#if !MEMP_OVERFLOW_CHECK && !LWIP_ALLOC_PROFILE
+  memp = do_memp_malloc_pool(memp_pools[type], type);
 #else
-  memp = do_memp_malloc_pool_fn(memp_pools[type], file, line);
+  memp = do_memp_malloc_pool_fn(memp_pools[type], type, file, line);
 #endif
 
   return memp;
 }
 
 static void
-do_memp_free_pool(const struct memp_desc *desc, void *mem)
+do_memp_free_pool(const struct memp_desc *desc, memp_t type, void *mem)
 {
   struct memp *memp;
-  SYS_ARCH_DECL_PROTECT(old_level);
+  MEMP_DECL_PROTECT(old_level);
 
   LWIP_ASSERT("memp_free: mem properly aligned",
               ((mem_ptr_t)mem % MEM_ALIGNMENT) == 0);
 
+#if LWIP_ALLOC_PROFILE
+  alloc_profile_free(mem);
+#endif /* LWIP_ALLOC_PROFILE */
+
   /* cast through void* to get rid of alignment warnings */
   memp = (struct memp *)(void *)((u8_t *)mem - MEMP_SIZE);
 
-  SYS_ARCH_PROTECT(old_level);
+  LWIP_UNUSED_ARG(type);
+  MEMP_PROTECT(old_level);
 
 #if MEMP_OVERFLOW_CHECK == 1
   memp_overflow_check_element(memp, desc);
 #endif /* MEMP_OVERFLOW_CHECK */
 
 #if MEMP_STATS
-  desc->stats->used--;
+  MEMP_COUNTER_DEC(desc->stats->used);
 #endif
 
 #if MEMP_MEM_MALLOC
   LWIP_UNUSED_ARG(desc);
   SYS_ARCH_UNPROTECT(old_level);
   mem_free(memp);
+#elif MEMP_THREAD_CACHE
+  memp_cache_put(desc, type, memp);
 #else /* MEMP_MEM_MALLOC */
   memp->next = *desc->tab;
   *desc->tab = memp;
@@ -407,7 +672,7 @@ memp_free_pool(const struct memp_desc *desc, void *mem)
     return;
   }
 
-  do_memp_free_pool(desc, mem);
+  do_memp_free_pool(desc, MEMP_MAX, mem);
 }
 
 /**
@@ -434,10 +699,14 @@ memp_free(memp_t type, void *mem)
 #endif /* MEMP_OVERFLOW_CHECK >= 2 */
 
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
+#if MEMP_THREAD_CACHE
+  old_first = memp_shared_element(memp_pools[type], (u32_t)MEMP_ATOMIC_LOAD(memp_pools[type]->shared));
+#else /* MEMP_THREAD_CACHE */
   old_first = *memp_pools[type]->tab;
+#endif /* MEMP_THREAD_CACHE */
 #endif
 
-  do_memp_free_pool(memp_pools[type], mem);
+  do_memp_free_pool(memp_pools[type], type, mem);
 
 #ifdef LWIP_HOOK_MEMP_AVAILABLE
   if (old_first == NULL) {
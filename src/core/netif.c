@@ -66,6 +66,8 @@
 #include "lwip/stats.h"
 #include "lwip/sys.h"
 #include "lwip/ip.h"
+#include "lwip/gro.h"
+#include "lwip/route.h"
 #if ENABLE_LOOPBACK
 #if LWIP_NETIF_LOOPBACK_MULTITHREADING
 #include "lwip/tcpip.h"
@@ -748,6 +750,15 @@ netif_remove(struct netif *netif)
 
   netif_invoke_ext_callback(netif, LWIP_NSC_NETIF_REMOVED, NULL);
 
+#if LWIP_TCP_GRO
+  /* don't keep segments referencing this netif */
+  gro_flush(netif);
+#endif /* LWIP_TCP_GRO */
+
+#if LWIP_ROUTE_TABLE
+  route_remove_netif(netif);
+#endif /* LWIP_ROUTE_TABLE */
+
 #if LWIP_IPV4
   if (!ip4_addr_isany_val(*netif_ip4_addr(netif))) {
     netif_do_ip_addr_changed(netif_ip_addr4(netif), NULL);
@@ -852,6 +863,11 @@ netif_set_up(struct netif *netif)
 
     MIB2_COPY_SYSUPTIME_TO(&netif->ts);
 
+#if LWIP_ROUTE_TABLE
+    /* routes over this netif may now beat the cached ones */
+    route_cache_flush();
+#endif /* LWIP_ROUTE_TABLE */
+
     NETIF_STATUS_CALLBACK(netif);
 
 #if LWIP_NETIF_EXT_STATUS_CALLBACK
@@ -994,6 +1010,11 @@ netif_set_link_up(struct netif *netif)
   if (!(netif->flags & NETIF_FLAG_LINK_UP)) {
     netif_set_flags(netif, NETIF_FLAG_LINK_UP);
 
+#if LWIP_ROUTE_TABLE
+    /* routes over this netif may now beat the cached ones */
+    route_cache_flush();
+#endif /* LWIP_ROUTE_TABLE */
+
 #if LWIP_DHCP
     dhcp_network_changed(netif);
 #endif /* LWIP_DHCP */
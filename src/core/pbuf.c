@@ -186,6 +186,9 @@ pbuf_init_alloced_pbuf(struct pbuf *p, void *payload, u16_t tot_len, u16_t len,
   p->flags = flags;
   p->ref = 1;
   p->if_idx = NETIF_NO_INDEX;
+#if LWIP_TCP_GSO
+  p->gso_size = 0;
+#endif /* LWIP_TCP_GSO */
 }
 
 /**
@@ -1314,6 +1317,10 @@ pbuf_clone(pbuf_layer layer, pbuf_type type, struct pbuf *p)
   err = pbuf_copy(q, p);
   LWIP_UNUSED_ARG(err); /* in case of LWIP_NOASSERT */
   LWIP_ASSERT("pbuf_copy failed", err == ERR_OK);
+#if LWIP_TCP_GSO
+  /* a cloned super-segment must still be segmented */
+  q->gso_size = p->gso_size;
+#endif /* LWIP_TCP_GSO */
   return q;
 }
 
@@ -1356,6 +1363,51 @@ pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
   *chksum = FOLD_U32T(acc);
   return ERR_OK;
 }
+
+/**
+ * Same as pbuf_take() but calculates the checksum of the data while copying
+ * it (using LWIP_CHKSUM_COPY), so the data is only read once.
+ *
+ * @param buf pbuf to fill with data
+ * @param dataptr application supplied data buffer
+ * @param len length of the application supplied data buffer
+ * @param chksum receives the (non-inverted) checksum of the data, as passed
+ *        to udp_sendto_chksum() or netbuf_set_chksum()
+ *
+ * @return ERR_OK if successful, ERR_MEM if the pbuf is not big enough
+ */
+err_t
+pbuf_take_chksum(struct pbuf *buf, const void *dataptr, u16_t len, u16_t *chksum)
+{
+  struct pbuf *p;
+  u16_t copied_total = 0;
+  u32_t acc = 0;
+
+  LWIP_ERROR("pbuf_take_chksum: invalid buf", (buf != NULL), return ERR_ARG;);
+  LWIP_ERROR("pbuf_take_chksum: invalid dataptr", (dataptr != NULL), return ERR_ARG;);
+  LWIP_ERROR("pbuf_take_chksum: invalid chksum", (chksum != NULL), return ERR_ARG;);
+  LWIP_ERROR("pbuf_take_chksum: buf not large enough", (buf->tot_len >= len), return ERR_MEM;);
+
+  for (p = buf; copied_total != len; p = p->next) {
+    u16_t buf_copy_len;
+    u16_t copy_chksum;
+    LWIP_ASSERT("pbuf_take_chksum: invalid pbuf", p != NULL);
+    buf_copy_len = (u16_t)LWIP_MIN(p->len, len - copied_total);
+    if (buf_copy_len == 0) {
+      continue;
+    }
+    copy_chksum = LWIP_CHKSUM_COPY(p->payload, &((const u8_t *)dataptr)[copied_total], buf_copy_len);
+    if ((copied_total & 1) != 0) {
+      /* data copied at an odd offset: swap to keep the byte order */
+      copy_chksum = SWAP_BYTES_IN_WORD(copy_chksum);
+    }
+    acc += copy_chksum;
+    acc = FOLD_U32T(acc);
+    copied_total = (u16_t)(copied_total + buf_copy_len);
+  }
+  *chksum = (u16_t)FOLD_U32T(acc);
+  return ERR_OK;
+}
 #endif /* LWIP_CHECKSUM_ON_COPY */
 
 /**
@@ -0,0 +1,632 @@
+/**
+ * @file
+ * Static route table
+ *
+ * Routes are kept in one path-compressed binary radix trie per IP version.
+ * Every node holds a prefix; the routes for that prefix hang off the node,
+ * sorted by metric. Nodes without routes only join two subtrees whose
+ * prefixes diverge after the join node's prefix length, so a lookup visits
+ * at most one node per distinct prefix length on the path to the
+ * destination, and the deepest node with a usable route is the longest
+ * prefix match.
+ *
+ * A small direct-mapped cache remembers the route found for recent
+ * destinations. It is flushed whenever a route is added or removed and when
+ * a netif comes up; routes over a netif that went down are skipped on a hit.
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_ROUTE_TABLE /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/route.h"
+#include "lwip/memp.h"
+#include "lwip/def.h"
+#include "lwip/nd6.h"
+
+#include <string.h>
+
+#define ROUTE_IDX_V4  0
+#define ROUTE_IDX_V6  1
+
+/** Prefix length of a host route */
+#define ROUTE_MAXLEN(idx)     (((idx) == ROUTE_IDX_V6) ? 128 : 32)
+/** Bit i of a key, bit 0 being the most significant one */
+#define ROUTE_KEY_BIT(key, i) (((key)[(i) >> 5] >> (31 - ((i) & 31))) & 1)
+
+#if LWIP_IPV6
+#define ROUTE_GW_CMP(a, b)    ip_addr_cmp_zoneless(a, b)
+#else /* LWIP_IPV6 */
+#define ROUTE_GW_CMP(a, b)    ip_addr_cmp(a, b)
+#endif /* LWIP_IPV6 */
+
+static struct route_node *route_roots[2];
+
+#if ROUTE_CACHE_SIZE > 0
+struct route_cache_entry {
+  /** route found for key, NULL if unused */
+  struct route_entry *rt;
+  u32_t key[ROUTE_KEY_WORDS];
+  u8_t idx;
+};
+
+static struct route_cache_entry route_cache[ROUTE_CACHE_SIZE];
+#endif /* ROUTE_CACHE_SIZE > 0 */
+
+#if LWIP_IPV4
+static void
+route_key_ip4(const ip4_addr_t *addr, u32_t *key)
+{
+  memset(key, 0, ROUTE_KEY_WORDS * sizeof(u32_t));
+  key[0] = lwip_ntohl(ip4_addr_get_u32(addr));
+}
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV6
+static void
+route_key_ip6(const ip6_addr_t *addr, u32_t *key)
+{
+  int i;
+  for (i = 0; i < 4; i++) {
+    key[i] = lwip_ntohl(addr->addr[i]);
+  }
+}
+#endif /* LWIP_IPV6 */
+
+/** Fill key from addr and return the trie index for its IP version */
+static u8_t
+route_key(const ip_addr_t *addr, u32_t *key)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    route_key_ip6(ip_2_ip6(addr), key);
+    return ROUTE_IDX_V6;
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  route_key_ip4(ip_2_ip4(addr), key);
+#endif /* LWIP_IPV4 */
+  return ROUTE_IDX_V4;
+}
+
+/** Clear all bits of key beyond len */
+static void
+route_key_mask(u32_t *key, u8_t len)
+{
+  int i;
+  for (i = 0; i < ROUTE_KEY_WORDS; i++) {
+    if (len >= 32) {
+      len = (u8_t)(len - 32);
+    } else if (len == 0) {
+      key[i] = 0;
+    } else {
+      key[i] &= ~(0xffffffffUL >> len);
+      len = 0;
+    }
+  }
+}
+
+/** Number of leading bits a and b have in common, at most maxlen */
+static u8_t
+route_key_common(const u32_t *a, const u32_t *b, u8_t maxlen)
+{
+  u8_t len = 0;
+  int i;
+  for (i = 0; (i < ROUTE_KEY_WORDS) && (len < maxlen); i++) {
+    u32_t diff = a[i] ^ b[i];
+    if (diff != 0) {
+      while ((diff & 0x80000000UL) == 0) {
+        diff <<= 1;
+        len++;
+      }
+      break;
+    }
+    len = (u8_t)(len + 32);
+  }
+  return LWIP_MIN(len, maxlen);
+}
+
+static int
+route_usable(const struct route_entry *rt)
+{
+  return netif_is_up(rt->netif) && netif_is_link_up(rt->netif);
+}
+
+/**
+ * Longest prefix match for key. With netif == NULL, the best route over a
+ * netif that is up is returned, else the best route over netif.
+ */
+static struct route_entry *
+route_find(u8_t idx, const u32_t *key, const struct netif *netif)
+{
+  struct route_node *n = route_roots[idx];
+  struct route_entry *best = NULL;
+  struct route_entry *rt;
+
+  while ((n != NULL) && (route_key_common(n->key, key, n->len) == n->len)) {
+    for (rt = n->routes; rt != NULL; rt = rt->next) {
+      if ((netif != NULL) ? (rt->netif == netif) : route_usable(rt)) {
+        best = rt;
+        break;
+      }
+    }
+    if (n->len >= ROUTE_MAXLEN(idx)) {
+      break;
+    }
+    n = n->child[ROUTE_KEY_BIT(key, n->len)];
+  }
+  return best;
+}
+
+#if ROUTE_CACHE_SIZE > 0
+static struct route_cache_entry *
+route_cache_slot(const u32_t *key)
+{
+  u32_t h = 0;
+  int i;
+  for (i = 0; i < ROUTE_KEY_WORDS; i++) {
+    h ^= key[i];
+  }
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return &route_cache[h % ROUTE_CACHE_SIZE];
+}
+#endif /* ROUTE_CACHE_SIZE > 0 */
+
+/** route_find() through the destination cache */
+static struct route_entry *
+route_get(u8_t idx, const u32_t *key, const struct netif *netif)
+{
+#if ROUTE_CACHE_SIZE > 0
+  struct route_cache_entry *ce = route_cache_slot(key);
+  struct route_entry *rt;
+
+  if ((ce->rt != NULL) && (ce->idx == idx) &&
+      (memcmp(ce->key, key, sizeof(ce->key)) == 0)) {
+    /* The cached route is the best usable one, so it is also the best one
+       over its own netif. */
+    if ((netif != NULL) ? (ce->rt->netif == netif) : route_usable(ce->rt)) {
+      return ce->rt;
+    }
+  }
+  rt = route_find(idx, key, netif);
+  if ((rt != NULL) && (netif == NULL)) {
+    ce->rt = rt;
+    ce->idx = idx;
+    memcpy(ce->key, key, sizeof(ce->key));
+  }
+  return rt;
+#else /* ROUTE_CACHE_SIZE > 0 */
+  return route_find(idx, key, netif);
+#endif /* ROUTE_CACHE_SIZE > 0 */
+}
+
+/**
+ * Flush the per-destination route cache. Call this when a netif comes up,
+ * as the routes over it may now be better than the cached ones.
+ */
+void
+route_cache_flush(void)
+{
+#if ROUTE_CACHE_SIZE > 0
+  int i;
+  for (i = 0; i < ROUTE_CACHE_SIZE; i++) {
+    route_cache[i].rt = NULL;
+  }
+#endif /* ROUTE_CACHE_SIZE > 0 */
+}
+
+static void
+route_changed(u8_t idx)
+{
+  route_cache_flush();
+#if LWIP_IPV6
+  if (idx == ROUTE_IDX_V6) {
+    /* nd6 keeps the next hop per destination */
+    nd6_clear_destination_cache();
+  }
+#else /* LWIP_IPV6 */
+  LWIP_UNUSED_ARG(idx);
+#endif /* LWIP_IPV6 */
+}
+
+static struct route_node *
+route_new_node(const u32_t *key, u8_t len)
+{
+  struct route_node *n = (struct route_node *)memp_malloc(MEMP_ROUTE_NODE);
+  if (n != NULL) {
+    memset(n, 0, sizeof(struct route_node));
+    memcpy(n->key, key, sizeof(n->key));
+    route_key_mask(n->key, len);
+    n->len = len;
+  }
+  return n;
+}
+
+/** Find the node for a (masked) prefix, creating it if necessary */
+static struct route_node *
+route_insert_node(u8_t idx, const u32_t *key, u8_t len)
+{
+  struct route_node **pn = &route_roots[idx];
+  struct route_node *n, *node, *join;
+  u8_t common = 0;
+
+  while ((n = *pn) != NULL) {
+    common = route_key_common(n->key, key, LWIP_MIN(n->len, len));
+    if (common < n->len) {
+      break;
+    }
+    if (n->len == len) {
+      return n;
+    }
+    pn = &n->child[ROUTE_KEY_BIT(key, n->len)];
+  }
+
+  node = route_new_node(key, len);
+  if (node == NULL) {
+    return NULL;
+  }
+  if (n == NULL) {
+    *pn = node;
+  } else if (common == len) {
+    /* the new prefix covers n */
+    node->child[ROUTE_KEY_BIT(n->key, len)] = n;
+    *pn = node;
+  } else {
+    /* n and the new prefix diverge after common bits */
+    join = route_new_node(key, common);
+    if (join == NULL) {
+      memp_free(MEMP_ROUTE_NODE, node);
+      return NULL;
+    }
+    join->child[ROUTE_KEY_BIT(key, common)] = node;
+    join->child[ROUTE_KEY_BIT(n->key, common)] = n;
+    *pn = join;
+  }
+  return node;
+}
+
+/**
+ * Find the slot pointing to the node of a (masked) prefix.
+ * *parent_slot is set to the slot pointing to its parent (NULL for a root).
+ */
+static struct route_node **
+route_find_slot(u8_t idx, const u32_t *key, u8_t len, struct route_node ***parent_slot)
+{
+  struct route_node **pn = &route_roots[idx];
+  struct route_node *n;
+
+  *parent_slot = NULL;
+  while ((n = *pn) != NULL) {
+    if (route_key_common(n->key, key, LWIP_MIN(n->len, len)) < n->len) {
+      return NULL;
+    }
+    if (n->len == len) {
+      return pn;
+    }
+    *parent_slot = pn;
+    pn = &n->child[ROUTE_KEY_BIT(key, n->len)];
+  }
+  return NULL;
+}
+
+/** Free the node in *pn if it has no routes left and keep the trie compressed */
+static void
+route_prune(struct route_node **pn, struct route_node **parent_slot)
+{
+  struct route_node *n = *pn;
+  struct route_node *parent;
+
+  if ((n->routes != NULL) || ((n->child[0] != NULL) && (n->child[1] != NULL))) {
+    return;
+  }
+  *pn = (n->child[0] != NULL) ? n->child[0] : n->child[1];
+  memp_free(MEMP_ROUTE_NODE, n);
+
+  if ((*pn == NULL) && (parent_slot != NULL)) {
+    parent = *parent_slot;
+    if (parent->routes == NULL) {
+      /* a join node left with a single subtree */
+      *parent_slot = (parent->child[0] != NULL) ? parent->child[0] : parent->child[1];
+      memp_free(MEMP_ROUTE_NODE, parent);
+    }
+  }
+}
+
+/**
+ * Add a static route.
+ *
+ * @param prefix destination network (bits beyond prefix_len are ignored)
+ * @param prefix_len prefix length in bits (0 for a default route)
+ * @param gw next hop, NULL or IP_ANY if the destination is reachable directly
+ * @param netif the netif to send on
+ * @param metric lower is preferred among routes with the same prefix. Adding
+ *        a route with the same prefix, gateway and netif updates its metric.
+ * @return ERR_OK, ERR_MEM if no more routes or nodes are available
+ */
+err_t
+route_add(const ip_addr_t *prefix, u8_t prefix_len, const ip_addr_t *gw,
+          struct netif *netif, u16_t metric)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_node *n;
+  struct route_entry *rt, *old, **prt;
+  u8_t idx;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("route_add: invalid prefix", prefix != NULL, return ERR_ARG;);
+  LWIP_ERROR("route_add: invalid netif", netif != NULL, return ERR_ARG;);
+  LWIP_ERROR("route_add: gateway of another IP version",
+             ip_addr_isany(gw) || (IP_GET_TYPE(gw) == IP_GET_TYPE(prefix)), return ERR_ARG;);
+  idx = route_key(prefix, key);
+  LWIP_ERROR("route_add: invalid prefix length", prefix_len <= ROUTE_MAXLEN(idx), return ERR_ARG;);
+  route_key_mask(key, prefix_len);
+
+  rt = (struct route_entry *)memp_malloc(MEMP_ROUTE);
+  if (rt == NULL) {
+    return ERR_MEM;
+  }
+  n = route_insert_node(idx, key, prefix_len);
+  if (n == NULL) {
+    memp_free(MEMP_ROUTE, rt);
+    return ERR_MEM;
+  }
+  rt->netif = netif;
+  rt->metric = metric;
+  if (ip_addr_isany(gw)) {
+    ip_addr_set_any(idx == ROUTE_IDX_V6, &rt->gw);
+  } else {
+    ip_addr_copy(rt->gw, *gw);
+#if LWIP_IPV6
+    if (IP_IS_V6(&rt->gw) && ip6_addr_lacks_zone(ip_2_ip6(&rt->gw), IP6_UNICAST)) {
+      ip6_addr_assign_zone(ip_2_ip6(&rt->gw), IP6_UNICAST, netif);
+    }
+#endif /* LWIP_IPV6 */
+  }
+
+  /* replace an existing route to the same next hop */
+  for (prt = &n->routes; *prt != NULL; prt = &(*prt)->next) {
+    old = *prt;
+    if ((old->netif == netif) && ip_addr_cmp(&old->gw, &rt->gw)) {
+      *prt = old->next;
+      memp_free(MEMP_ROUTE, old);
+      break;
+    }
+  }
+  prt = &n->routes;
+  while ((*prt != NULL) && ((*prt)->metric <= metric)) {
+    prt = &(*prt)->next;
+  }
+  rt->next = *prt;
+  *prt = rt;
+
+  route_changed(idx);
+  return ERR_OK;
+}
+
+/**
+ * Remove static routes.
+ *
+ * @param prefix destination network of the routes
+ * @param prefix_len prefix length in bits
+ * @param gw remove only the routes to this next hop (NULL: any next hop)
+ * @param netif remove only the routes over this netif (NULL: any netif)
+ * @return ERR_OK, ERR_VAL if no route matched
+ */
+err_t
+route_remove(const ip_addr_t *prefix, u8_t prefix_len, const ip_addr_t *gw,
+             struct netif *netif)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_node **pn, **parent_slot;
+  struct route_entry *rt, **prt;
+  err_t err = ERR_VAL;
+  u8_t idx;
+
+  LWIP_ASSERT_CORE_LOCKED();
+  LWIP_ERROR("route_remove: invalid prefix", prefix != NULL, return ERR_ARG;);
+  idx = route_key(prefix, key);
+  LWIP_ERROR("route_remove: invalid prefix length", prefix_len <= ROUTE_MAXLEN(idx), return ERR_ARG;);
+  route_key_mask(key, prefix_len);
+
+  pn = route_find_slot(idx, key, prefix_len, &parent_slot);
+  if (pn == NULL) {
+    return ERR_VAL;
+  }
+  prt = &(*pn)->routes;
+  while ((rt = *prt) != NULL) {
+    if (((netif == NULL) || (rt->netif == netif)) &&
+        ((gw == NULL) || ROUTE_GW_CMP(&rt->gw, gw))) {
+      *prt = rt->next;
+      memp_free(MEMP_ROUTE, rt);
+      err = ERR_OK;
+    } else {
+      prt = &rt->next;
+    }
+  }
+  if (err == ERR_OK) {
+    route_prune(pn, parent_slot);
+    route_changed(idx);
+  }
+  return err;
+}
+
+/** Remove the routes over netif below *pn, freeing nodes left empty */
+static void
+route_remove_netif_node(struct route_node **pn, const struct netif *netif)
+{
+  struct route_node *n = *pn;
+  struct route_entry *rt, **prt;
+
+  if (n == NULL) {
+    return;
+  }
+  /* recursion depth is bounded by MEMP_NUM_ROUTE_NODE */
+  route_remove_netif_node(&n->child[0], netif);
+  route_remove_netif_node(&n->child[1], netif);
+
+  prt = &n->routes;
+  while ((rt = *prt) != NULL) {
+    if (rt->netif == netif) {
+      *prt = rt->next;
+      memp_free(MEMP_ROUTE, rt);
+    } else {
+      prt = &rt->next;
+    }
+  }
+  /* children were pruned already, so this also collapses join nodes */
+  if ((n->routes == NULL) && ((n->child[0] == NULL) || (n->child[1] == NULL))) {
+    *pn = (n->child[0] != NULL) ? n->child[0] : n->child[1];
+    memp_free(MEMP_ROUTE_NODE, n);
+  }
+}
+
+/**
+ * Remove all routes over a netif. Called by netif_remove().
+ */
+void
+route_remove_netif(struct netif *netif)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  route_remove_netif_node(&route_roots[ROUTE_IDX_V4], netif);
+  route_changed(ROUTE_IDX_V4);
+#if LWIP_IPV6
+  route_remove_netif_node(&route_roots[ROUTE_IDX_V6], netif);
+  route_changed(ROUTE_IDX_V6);
+#endif /* LWIP_IPV6 */
+}
+
+#if LWIP_IPV4
+/**
+ * Find the netif of the best static route to an IPv4 destination.
+ *
+ * @param dest the destination address
+ * @return the netif or NULL if no route over a netif that is up matches
+ */
+struct netif *
+route_lookup_ip4(const ip4_addr_t *dest)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_entry *rt;
+
+  if (route_roots[ROUTE_IDX_V4] == NULL) {
+    return NULL;
+  }
+  route_key_ip4(dest, key);
+  rt = route_get(ROUTE_IDX_V4, key, NULL);
+  return (rt != NULL) ? rt->netif : NULL;
+}
+
+/**
+ * Find the next hop of the best static route to an IPv4 destination over
+ * netif.
+ *
+ * @param netif the netif the packet is sent on
+ * @param dest the destination address
+ * @return the gateway of the route, dest for a route without gateway or NULL
+ *         if no route over netif matches
+ */
+const ip4_addr_t *
+route_next_hop_ip4(struct netif *netif, const ip4_addr_t *dest)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_entry *rt;
+
+  if (route_roots[ROUTE_IDX_V4] == NULL) {
+    return NULL;
+  }
+  route_key_ip4(dest, key);
+  rt = route_get(ROUTE_IDX_V4, key, netif);
+  if (rt == NULL) {
+    return NULL;
+  }
+  if (ip4_addr_isany_val(*ip_2_ip4(&rt->gw))) {
+    return dest;
+  }
+  return ip_2_ip4(&rt->gw);
+}
+#endif /* LWIP_IPV4 */
+
+#if LWIP_IPV6
+/**
+ * Find the netif of the best static route to an IPv6 destination.
+ *
+ * @param dest the destination address
+ * @return the netif or NULL if no route over a netif that is up matches
+ */
+struct netif *
+route_lookup_ip6(const ip6_addr_t *dest)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_entry *rt;
+
+  if (route_roots[ROUTE_IDX_V6] == NULL) {
+    return NULL;
+  }
+  route_key_ip6(dest, key);
+  rt = route_get(ROUTE_IDX_V6, key, NULL);
+  return (rt != NULL) ? rt->netif : NULL;
+}
+
+/**
+ * Find the next hop of the best static route to an IPv6 destination over
+ * netif.
+ *
+ * @param netif the netif the packet is sent on
+ * @param dest the destination address
+ * @return the gateway of the route, dest for a route without gateway or NULL
+ *         if no route over netif matches
+ */
+const ip6_addr_t *
+route_next_hop_ip6(struct netif *netif, const ip6_addr_t *dest)
+{
+  u32_t key[ROUTE_KEY_WORDS];
+  struct route_entry *rt;
+
+  if (route_roots[ROUTE_IDX_V6] == NULL) {
+    return NULL;
+  }
+  route_key_ip6(dest, key);
+  rt = route_get(ROUTE_IDX_V6, key, netif);
+  if (rt == NULL) {
+    return NULL;
+  }
+  if (ip6_addr_isany(ip_2_ip6(&rt->gw))) {
+    return dest;
+  }
+  return ip_2_ip6(&rt->gw);
+}
+#endif /* LWIP_IPV6 */
+
+#endif /* LWIP_ROUTE_TABLE */
@@ -184,9 +184,45 @@ struct tcp_pcb **const tcp_pcb_lists[] = {&tcp_listen_pcbs.pcbs, &tcp_bound_pcbs
 
 u8_t tcp_active_pcbs_changed;
 
+#if LWIP_TCP_PCB_HASH
+#if (TCP_PCB_HASH_SIZE & (TCP_PCB_HASH_SIZE - 1)) || (TCP_LISTEN_HASH_SIZE & (TCP_LISTEN_HASH_SIZE - 1))
+#error "TCP_PCB_HASH_SIZE and TCP_LISTEN_HASH_SIZE must be powers of 2"
+#endif
+/** Active and TIME-WAIT PCBs hashed on their 4-tuple */
+static struct tcp_pcb *tcp_pcb_hash[TCP_PCB_HASH_SIZE];
+/** LISTEN PCBs hashed on their local port */
+static struct tcp_pcb_listen *tcp_listen_hash[TCP_LISTEN_HASH_SIZE];
+#endif /* LWIP_TCP_PCB_HASH */
+
 /** Timer counter to handle calling slow-timer from tcp_tmr() */
 static u8_t tcp_timer;
 static u8_t tcp_timer_ctr;
+
+#if LWIP_TCP_TIMER_WHEEL
+#if TCP_TIMER_WHEEL_SLOTS & (TCP_TIMER_WHEEL_SLOTS - 1)
+#error "TCP_TIMER_WHEEL_SLOTS must be a power of 2"
+#endif
+/** Active PCBs the TCP timers visit (in the order they got busy) */
+static struct tcp_pcb *tcp_wheel_busy;
+static struct tcp_pcb *tcp_wheel_busy_tail;
+/** Parked active PCBs by the slow timer tick they are due at */
+static struct tcp_pcb *tcp_wheel_slots[TCP_TIMER_WHEEL_SLOTS];
+/** tcp_ticks value the wheel has been expired up to */
+static u32_t tcp_wheel_tick;
+/** set while tcp_slowtmr() processes the current tick */
+static u8_t tcp_wheel_ticking;
+#define TCP_TMR_FIRST()     tcp_wheel_busy
+#define TCP_TMR_NEXT(pcb)   ((pcb)->wheel_next)
+#if LWIP_CALLBACK_API
+/* without poll callback, the poll events of a parked pcb may be skipped */
+#define TCP_WHEEL_POLLS(pcb) ((pcb)->poll != NULL)
+#else /* LWIP_CALLBACK_API */
+#define TCP_WHEEL_POLLS(pcb) 1
+#endif /* LWIP_CALLBACK_API */
+#else /* LWIP_TCP_TIMER_WHEEL */
+#define TCP_TMR_FIRST()     tcp_active_pcbs
+#define TCP_TMR_NEXT(pcb)   ((pcb)->next)
+#endif /* LWIP_TCP_TIMER_WHEEL */
 static u16_t tcp_new_port(void);
 
 static err_t tcp_close_shutdown_fin(struct tcp_pcb *pcb);
@@ -210,6 +246,9 @@ void
 tcp_free(struct tcp_pcb *pcb)
 {
   LWIP_ASSERT("tcp_free: LISTEN", pcb->state != LISTEN);
+#if LWIP_TCP_TIMER_WHEEL
+  LWIP_ASSERT("tcp_free: still on the timer wheel", pcb->wheel_state == TCP_WHEEL_NONE);
+#endif /* LWIP_TCP_TIMER_WHEEL */
 #if LWIP_TCP_PCB_NUM_EXT_ARGS
   tcp_ext_arg_invoke_callbacks_destroyed(pcb->ext_args);
 #endif
@@ -411,6 +450,7 @@ tcp_close_shutdown_fin(struct tcp_pcb *pcb)
   err_t err;
   LWIP_ASSERT("pcb != NULL", pcb != NULL);
 
+  TCP_WHEEL_WAKE(pcb);
   switch (pcb->state) {
     case SYN_RCVD:
       err = tcp_send_fin(pcb);
@@ -1181,6 +1221,221 @@ tcp_connect(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port,
   return ret;
 }
 
+#if LWIP_TCP_TIMER_WHEEL
+static void
+tcp_wheel_unlink(struct tcp_pcb *pcb)
+{
+  struct tcp_pcb **head;
+
+  if (pcb->wheel_state == TCP_WHEEL_PARKED) {
+    head = &tcp_wheel_slots[pcb->wheel_due & (TCP_TIMER_WHEEL_SLOTS - 1)];
+  } else {
+    head = &tcp_wheel_busy;
+    if (tcp_wheel_busy_tail == pcb) {
+      tcp_wheel_busy_tail = pcb->wheel_prev;
+    }
+  }
+  if (pcb->wheel_prev != NULL) {
+    pcb->wheel_prev->wheel_next = pcb->wheel_next;
+  } else {
+    *head = pcb->wheel_next;
+  }
+  if (pcb->wheel_next != NULL) {
+    pcb->wheel_next->wheel_prev = pcb->wheel_prev;
+  }
+  pcb->wheel_next = NULL;
+  pcb->wheel_prev = NULL;
+  pcb->wheel_state = TCP_WHEEL_NONE;
+}
+
+/* Busy pcbs are appended, so that a pcb woken while the timers walk the
+   list is still visited in this run */
+static void
+tcp_wheel_busy_append(struct tcp_pcb *pcb)
+{
+  pcb->wheel_next = NULL;
+  pcb->wheel_prev = tcp_wheel_busy_tail;
+  if (tcp_wheel_busy_tail != NULL) {
+    tcp_wheel_busy_tail->wheel_next = pcb;
+  } else {
+    tcp_wheel_busy = pcb;
+  }
+  tcp_wheel_busy_tail = pcb;
+  pcb->wheel_state = TCP_WHEEL_BUSY;
+}
+
+/**
+ * Adds a PCB registered with the active list to the PCBs the TCP timers
+ * visit. Called from TCP_REG.
+ *
+ * @param pcbs the PCB list the PCB is registered with
+ * @param pcb the PCB to add
+ */
+void
+tcp_wheel_reg(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_active_pcbs) {
+    LWIP_ASSERT("tcp_wheel_reg: already on the wheel", pcb->wheel_state == TCP_WHEEL_NONE);
+    /* TCP_REG puts it in front */
+    pcb->active_prev = NULL;
+    if (pcb->next != NULL) {
+      pcb->next->active_prev = pcb;
+    }
+    tcp_wheel_busy_append(pcb);
+  }
+}
+
+/**
+ * Removes a PCB removed from the active list from the wheel.
+ * Called from TCP_RMV.
+ *
+ * @param pcbs the PCB list the PCB is removed from
+ * @param pcb the PCB to remove
+ */
+void
+tcp_wheel_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if ((pcbs == &tcp_active_pcbs) && (pcb->wheel_state != TCP_WHEEL_NONE)) {
+    if (pcb->next != NULL) {
+      pcb->next->active_prev = pcb->active_prev;
+    }
+    pcb->active_prev = NULL;
+    tcp_wheel_unlink(pcb);
+  }
+}
+
+/* Remove a pcb from the active list through its active_prev pointer,
+   where TCP_RMV would search the list for it */
+static void
+tcp_wheel_active_rmv(struct tcp_pcb *pcb)
+{
+  struct tcp_pcb *prev = pcb->active_prev;
+
+  LWIP_ASSERT("tcp_wheel_active_rmv: active_prev broken",
+              (prev != NULL) ? (prev->next == pcb) : (tcp_active_pcbs == pcb));
+  TCP_HASH_RMV(&tcp_active_pcbs, pcb);
+  tcp_wheel_rmv(&tcp_active_pcbs, pcb);
+  if (prev != NULL) {
+    prev->next = pcb->next;
+  } else {
+    tcp_active_pcbs = pcb->next;
+  }
+}
+
+/**
+ * Moves a parked PCB back to the PCBs visited by the TCP timers and
+ * catches up on the slow timer ticks it missed (only its poll timer
+ * counts while parked).
+ *
+ * @param pcb the parked PCB
+ */
+void
+tcp_wheel_wake(struct tcp_pcb *pcb)
+{
+  u32_t ticks = tcp_ticks - pcb->wheel_parked;
+  u32_t max = pcb->wheel_due - pcb->wheel_parked - 1;
+
+  LWIP_ASSERT("tcp_wheel_wake: pcb not parked", pcb->wheel_state == TCP_WHEEL_PARKED);
+
+  if (tcp_wheel_ticking) {
+    /* the current tick is counted when tcp_slowtmr() visits the pcb */
+    ticks--;
+  }
+  if ((s32_t)ticks < 0) {
+    ticks = 0;
+  } else if (ticks > max) {
+    ticks = max;
+  }
+  if (TCP_WHEEL_POLLS(pcb)) {
+    /* parking ends before the next poll is due */
+    pcb->polltmr = (u8_t)(pcb->polltmr + ticks);
+  } else if (ticks > 0) {
+    /* replay the empty poll events: polltmr wraps at pollinterval */
+    u32_t first = ((u32_t)pcb->polltmr + 1 >= pcb->pollinterval) ? 1 :
+                  (u32_t)(pcb->pollinterval - pcb->polltmr);
+    if (ticks < first) {
+      pcb->polltmr = (u8_t)(pcb->polltmr + ticks);
+    } else {
+      pcb->polltmr = (u8_t)(pcb->pollinterval ? ((ticks - first) % pcb->pollinterval) : 0);
+    }
+  }
+  tcp_wheel_unlink(pcb);
+  tcp_wheel_busy_append(pcb);
+  pcb->last_timer = (u8_t)(tcp_timer_ctr - 1);
+}
+
+/* Park a pcb that tcp_slowtmr() has just visited if it has no timer
+   running apart from polling and keepalive */
+static void
+tcp_wheel_park(struct tcp_pcb *pcb)
+{
+  u32_t due;
+
+  if (((pcb->state != ESTABLISHED) && (pcb->state != CLOSE_WAIT)) ||
+      (pcb->unacked != NULL) || (pcb->unsent != NULL) || (pcb->refused_data != NULL) ||
+#if TCP_QUEUE_OOSEQ
+      (pcb->ooseq != NULL) ||
+#endif /* TCP_QUEUE_OOSEQ */
+      (pcb->rtime >= 0) || (pcb->persist_backoff > 0) ||
+      (pcb->flags & (TF_ACK_DELAY | TF_ACK_NOW | TF_CLOSEPEND | TF_NAGLEMEMERR))) {
+    return;
+  }
+  due = tcp_ticks + TCP_TIMER_WHEEL_SLOTS - 1;
+  if (TCP_WHEEL_POLLS(pcb)) {
+    if (pcb->polltmr >= pcb->pollinterval) {
+      return;
+    }
+    /* the tick polltmr reaches pollinterval */
+    if ((u32_t)(pcb->pollinterval - pcb->polltmr) < TCP_TIMER_WHEEL_SLOTS - 1) {
+      due = tcp_ticks + (u32_t)(pcb->pollinterval - pcb->polltmr);
+    }
+  }
+  if (ip_get_option(pcb, SOF_KEEPALIVE)) {
+    /* the tick the next keepalive (or the keepalive timeout) is due */
+    u32_t keep_due = pcb->tmr + 1 +
+                     (pcb->keep_idle + pcb->keep_cnt_sent * TCP_KEEP_INTVL(pcb)) / TCP_SLOW_INTERVAL;
+    if ((s32_t)(keep_due - due) < 0) {
+      due = keep_due;
+    }
+  }
+  if ((s32_t)(due - tcp_ticks) <= 1) {
+    /* due in the next tick anyway */
+    return;
+  }
+  tcp_wheel_unlink(pcb);
+  pcb->wheel_due = due;
+  pcb->wheel_parked = tcp_ticks;
+  pcb->wheel_prev = NULL;
+  pcb->wheel_next = tcp_wheel_slots[due & (TCP_TIMER_WHEEL_SLOTS - 1)];
+  if (pcb->wheel_next != NULL) {
+    pcb->wheel_next->wheel_prev = pcb;
+  }
+  tcp_wheel_slots[due & (TCP_TIMER_WHEEL_SLOTS - 1)] = pcb;
+  pcb->wheel_state = TCP_WHEEL_PARKED;
+}
+
+/* Wake the pcbs due up to the current tick (all of them if tcp_ticks
+   jumped) */
+static void
+tcp_wheel_expire(void)
+{
+  u32_t n = tcp_ticks - tcp_wheel_tick;
+
+  if ((n == 0) || (n > TCP_TIMER_WHEEL_SLOTS)) {
+    n = TCP_TIMER_WHEEL_SLOTS;
+  }
+  while (n-- > 0) {
+    struct tcp_pcb *pcb = tcp_wheel_slots[(tcp_ticks - n) & (TCP_TIMER_WHEEL_SLOTS - 1)];
+    while (pcb != NULL) {
+      struct tcp_pcb *next = pcb->wheel_next;
+      tcp_wheel_wake(pcb);
+      pcb = next;
+    }
+  }
+  tcp_wheel_tick = tcp_ticks;
+}
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
 /**
  * Called every 500 ms and implements the retransmission timer and the timer that
  * removes PCBs that have been in TIME-WAIT for enough time. It also increments
@@ -1192,7 +1447,6 @@ void
 tcp_slowtmr(void)
 {
   struct tcp_pcb *pcb, *prev;
-  tcpwnd_size_t eff_wnd;
   u8_t pcb_remove;      /* flag if a PCB should be removed */
   u8_t pcb_reset;       /* flag if a RST should be sent when removing */
   err_t err;
@@ -1202,10 +1456,16 @@ tcp_slowtmr(void)
   ++tcp_ticks;
   ++tcp_timer_ctr;
 
+#if LWIP_TCP_TIMER_WHEEL
+  tcp_wheel_ticking = 1;
+  tcp_wheel_expire();
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
 tcp_slowtmr_start:
-  /* Steps through all of the active PCBs. */
+  /* Steps through all of the active PCBs (with LWIP_TCP_TIMER_WHEEL, the
+     ones that are not parked). */
   prev = NULL;
-  pcb = tcp_active_pcbs;
+  pcb = TCP_TMR_FIRST();
   if (pcb == NULL) {
     LWIP_DEBUGF(TCP_DEBUG, ("tcp_slowtmr: no active pcbs\n"));
   }
@@ -1217,7 +1477,7 @@ tcp_slowtmr_start:
     if (pcb->last_timer == tcp_timer_ctr) {
       /* skip this pcb, we have already processed it */
       prev = pcb;
-      pcb = pcb->next;
+      pcb = TCP_TMR_NEXT(pcb);
       continue;
     }
     pcb->last_timer = tcp_timer_ctr;
@@ -1293,16 +1553,10 @@ tcp_slowtmr_start:
             pcb->rtime = 0;
 
             /* Reduce congestion window and ssthresh. */
-            eff_wnd = LWIP_MIN(pcb->cwnd, pcb->snd_wnd);
-            pcb->ssthresh = eff_wnd >> 1;
-            if (pcb->ssthresh < (tcpwnd_size_t)(pcb->mss << 1)) {
-              pcb->ssthresh = (tcpwnd_size_t)(pcb->mss << 1);
-            }
-            pcb->cwnd = pcb->mss;
+            pcb->cc_ops->on_rto(pcb);
             LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_slowtmr: cwnd %"TCPWNDSIZE_F
                                          " ssthresh %"TCPWNDSIZE_F"\n",
                                          pcb->cwnd, pcb->ssthresh));
-            pcb->bytes_acked = 0;
 
             /* The following needs to be called AFTER cwnd is set to one
                mss - STJ */
@@ -1383,8 +1637,17 @@ tcp_slowtmr_start:
 #endif /* LWIP_CALLBACK_API */
       void *err_arg;
       enum tcp_state last_state;
+#if LWIP_TCP_TIMER_WHEEL
+      /* the walk carries on behind the busy pcb before this one */
+      struct tcp_pcb *busy_prev = pcb->wheel_prev;
+#endif /* LWIP_TCP_TIMER_WHEEL */
       tcp_pcb_purge(pcb);
       /* Remove PCB from tcp_active_pcbs list. */
+#if LWIP_TCP_TIMER_WHEEL
+      /* 'prev' is the previous busy pcb, not the previous active one:
+         unlink through active_prev */
+      tcp_wheel_active_rmv(pcb);
+#else /* LWIP_TCP_TIMER_WHEEL */
       if (prev != NULL) {
         LWIP_ASSERT("tcp_slowtmr: middle tcp != tcp_active_pcbs", pcb != tcp_active_pcbs);
         prev->next = pcb->next;
@@ -1393,6 +1656,8 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_active_pcbs", tcp_active_pcbs == pcb);
         tcp_active_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_active_pcbs, pcb);
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
       if (pcb_reset) {
         tcp_rst(pcb, pcb->snd_nxt, pcb->rcv_nxt, &pcb->local_ip, &pcb->remote_ip,
@@ -1410,10 +1675,15 @@ tcp_slowtmr_start:
       if (tcp_active_pcbs_changed) {
         goto tcp_slowtmr_start;
       }
+#if LWIP_TCP_TIMER_WHEEL
+      /* 'busy_prev' is still on the busy list (removing it would have
+         changed the active list), pcbs woken by the callback were appended */
+      pcb = (busy_prev != NULL) ? busy_prev->wheel_next : tcp_wheel_busy;
+#endif /* LWIP_TCP_TIMER_WHEEL */
     } else {
       /* get the 'next' element now and work with 'prev' below (in case of abort) */
       prev = pcb;
-      pcb = pcb->next;
+      pcb = TCP_TMR_NEXT(pcb);
 
       /* We check if we should poll the connection. */
       ++prev->polltmr;
@@ -1430,8 +1700,17 @@ tcp_slowtmr_start:
           tcp_output(prev);
         }
       }
+#if LWIP_TCP_TIMER_WHEEL
+      /* an abort would have restarted the loop, so 'prev' is valid; pcbs
+         woken by the poll callback were appended behind it */
+      pcb = prev->wheel_next;
+      tcp_wheel_park(prev);
+#endif /* LWIP_TCP_TIMER_WHEEL */
     }
   }
+#if LWIP_TCP_TIMER_WHEEL
+  tcp_wheel_ticking = 0;
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
 
   /* Steps through all of the TIME-WAIT PCBs. */
@@ -1459,6 +1738,7 @@ tcp_slowtmr_start:
         LWIP_ASSERT("tcp_slowtmr: first pcb == tcp_tw_pcbs", tcp_tw_pcbs == pcb);
         tcp_tw_pcbs = pcb->next;
       }
+      TCP_HASH_RMV(&tcp_tw_pcbs, pcb);
       pcb2 = pcb;
       pcb = pcb->next;
       tcp_free(pcb2);
@@ -1483,7 +1763,7 @@ tcp_fasttmr(void)
   ++tcp_timer_ctr;
 
 tcp_fasttmr_start:
-  pcb = tcp_active_pcbs;
+  pcb = TCP_TMR_FIRST();
 
   while (pcb != NULL) {
     if (pcb->last_timer != tcp_timer_ctr) {
@@ -1503,7 +1783,7 @@ tcp_fasttmr_start:
         tcp_close_shutdown_fin(pcb);
       }
 
-      next = pcb->next;
+      next = TCP_TMR_NEXT(pcb);
 
       /* If there is data which was previously "refused" by upper layer */
       if (pcb->refused_data != NULL) {
@@ -1513,10 +1793,14 @@ tcp_fasttmr_start:
           /* application callback has changed the pcb list: restart the loop */
           goto tcp_fasttmr_start;
         }
+#if LWIP_TCP_TIMER_WHEEL
+        /* pcbs woken by the callback were appended behind this one */
+        next = pcb->wheel_next;
+#endif /* LWIP_TCP_TIMER_WHEEL */
       }
       pcb = next;
     } else {
-      pcb = pcb->next;
+      pcb = TCP_TMR_NEXT(pcb);
     }
   }
 }
@@ -1593,6 +1877,7 @@ tcp_process_refused_data(struct tcp_pcb *pcb)
       }
 #endif /* TCP_QUEUE_OOSEQ && LWIP_WND_SCALE */
       pcb->refused_data = refused_data;
+      TCP_WHEEL_WAKE(pcb);
       return ERR_INPROGRESS;
     }
   }
@@ -1911,6 +2196,8 @@ tcp_alloc(u8_t prio)
     connection is established. To avoid these complications, we set ssthresh to the
     largest effective cwnd (amount of in-flight data) that the sender can have. */
     pcb->ssthresh = TCP_SND_BUF;
+    pcb->cc_ops = &TCP_CC_DEFAULT;
+    pcb->cc_ops->init(pcb);
 
 #if LWIP_CALLBACK_API
     pcb->recv = tcp_recv_null;
@@ -2109,6 +2396,8 @@ tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
   LWIP_ERROR("tcp_poll: invalid pcb", pcb != NULL, return);
   LWIP_ASSERT("invalid socket state for poll", pcb->state != LISTEN);
 
+  /* a parked pcb is due at the tick of the old poll settings */
+  TCP_WHEEL_WAKE(pcb);
 #if LWIP_CALLBACK_API
   pcb->poll = poll;
 #else /* LWIP_CALLBACK_API */
@@ -2206,6 +2495,171 @@ tcp_pcb_remove(struct tcp_pcb **pcblist, struct tcp_pcb *pcb)
   LWIP_ASSERT("tcp_pcb_remove: tcp_pcbs_sane()", tcp_pcbs_sane());
 }
 
+#if LWIP_TCP_PCB_HASH
+static u32_t
+tcp_hash_addr(const ip_addr_t *addr)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    const u32_t *a = ip_2_ip6(addr)->addr;
+    return a[0] ^ a[1] ^ a[2] ^ a[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  return ip4_addr_get_u32(ip_2_ip4(addr));
+#else /* LWIP_IPV4 */
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+/* Fold the 4-tuple into a bucket index. The multiplication spreads the
+   (often sequential) ephemeral ports over the high bits. */
+static u32_t
+tcp_hash_tuple(u16_t local_port, u16_t remote_port,
+               const ip_addr_t *local_ip, const ip_addr_t *remote_ip)
+{
+  u32_t h = tcp_hash_addr(local_ip) ^ tcp_hash_addr(remote_ip) ^
+            (((u32_t)local_port << 16) | remote_port);
+  h *= 0x9E3779B1UL;
+  return (h ^ (h >> 16)) & (TCP_PCB_HASH_SIZE - 1);
+}
+
+#define TCP_LISTEN_HASH(port) ((u32_t)(port) & (TCP_LISTEN_HASH_SIZE - 1))
+
+/**
+ * Adds a PCB to the hash table matching the list it is registered with.
+ * Called from TCP_REG, so the 4-tuple (or the local port for listeners)
+ * must be set before the PCB is registered and may not change until it is
+ * removed again. Bound PCBs are not hashed.
+ *
+ * @param pcbs the PCB list the PCB is registered with
+ * @param pcb the PCB to add
+ */
+void
+tcp_pcb_hash_reg(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    u32_t idx = TCP_LISTEN_HASH(lpcb->local_port);
+    lpcb->hash_next = tcp_listen_hash[idx];
+    tcp_listen_hash[idx] = lpcb;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    u32_t idx = tcp_hash_tuple(pcb->local_port, pcb->remote_port,
+                               &pcb->local_ip, &pcb->remote_ip);
+    pcb->hash_next = tcp_pcb_hash[idx];
+    tcp_pcb_hash[idx] = pcb;
+  }
+}
+
+/**
+ * Removes a PCB from the hash table matching the list it is removed from.
+ * Called from TCP_RMV.
+ *
+ * @param pcbs the PCB list the PCB is removed from
+ * @param pcb the PCB to remove
+ */
+void
+tcp_pcb_hash_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *pcb)
+{
+  if (pcbs == &tcp_listen_pcbs.pcbs) {
+    struct tcp_pcb_listen *lpcb = (struct tcp_pcb_listen *)pcb;
+    struct tcp_pcb_listen **pp = &tcp_listen_hash[TCP_LISTEN_HASH(lpcb->local_port)];
+    for (; *pp != NULL; pp = &(*pp)->hash_next) {
+      if (*pp == lpcb) {
+        *pp = lpcb->hash_next;
+        break;
+      }
+    }
+    lpcb->hash_next = NULL;
+  } else if ((pcbs == &tcp_active_pcbs) || (pcbs == &tcp_tw_pcbs)) {
+    struct tcp_pcb **pp = &tcp_pcb_hash[tcp_hash_tuple(pcb->local_port, pcb->remote_port,
+                                                        &pcb->local_ip, &pcb->remote_ip)];
+    for (; *pp != NULL; pp = &(*pp)->hash_next) {
+      if (*pp == pcb) {
+        *pp = pcb->hash_next;
+        break;
+      }
+    }
+    pcb->hash_next = NULL;
+  }
+}
+
+/**
+ * Finds the active or TIME-WAIT PCB an incoming segment belongs to.
+ *
+ * @param local_port destination port of the segment
+ * @param remote_port source port of the segment
+ * @param local_ip destination address of the segment
+ * @param remote_ip source address of the segment
+ * @param inp network interface on which the segment was received
+ * @param time_wait 1 to look for a TIME-WAIT PCB, 0 for an active one
+ * @return the matching PCB or NULL
+ */
+struct tcp_pcb *
+tcp_pcb_hash_lookup(u16_t local_port, u16_t remote_port,
+                    const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
+                    struct netif *inp, u8_t time_wait)
+{
+  struct tcp_pcb *pcb;
+
+  pcb = tcp_pcb_hash[tcp_hash_tuple(local_port, remote_port, local_ip, remote_ip)];
+  for (; pcb != NULL; pcb = pcb->hash_next) {
+    if ((pcb->state == TIME_WAIT) != (time_wait != 0)) {
+      continue;
+    }
+    /* check if PCB is bound to specific netif */
+    if ((pcb->netif_idx != NETIF_NO_INDEX) && (pcb->netif_idx != netif_get_index(inp))) {
+      continue;
+    }
+    if (pcb->remote_port == remote_port &&
+        pcb->local_port == local_port &&
+        ip_addr_cmp(&pcb->remote_ip, remote_ip) &&
+        ip_addr_cmp(&pcb->local_ip, local_ip)) {
+      return pcb;
+    }
+  }
+  return NULL;
+}
+
+/**
+ * Finds the LISTEN PCB accepting a connection request. A listener bound to
+ * the exact destination address is preferred over one bound to ANY.
+ *
+ * @param local_port destination port of the segment
+ * @param local_ip destination address of the segment
+ * @param inp network interface on which the segment was received
+ * @return the matching PCB or NULL
+ */
+struct tcp_pcb_listen *
+tcp_listen_hash_lookup(u16_t local_port, const ip_addr_t *local_ip, struct netif *inp)
+{
+  struct tcp_pcb_listen *lpcb;
+  struct tcp_pcb_listen *lpcb_any = NULL;
+
+  for (lpcb = tcp_listen_hash[TCP_LISTEN_HASH(local_port)]; lpcb != NULL; lpcb = lpcb->hash_next) {
+    /* check if PCB is bound to specific netif */
+    if ((lpcb->netif_idx != NETIF_NO_INDEX) && (lpcb->netif_idx != netif_get_index(inp))) {
+      continue;
+    }
+    if (lpcb->local_port == local_port) {
+      if (IP_IS_ANY_TYPE_VAL(lpcb->local_ip)) {
+        /* found an ANY TYPE (IPv4/IPv6) match */
+        lpcb_any = lpcb;
+      } else if (IP_ADDR_PCB_VERSION_MATCH_EXACT(lpcb, local_ip)) {
+        if (ip_addr_cmp(&lpcb->local_ip, local_ip)) {
+          /* found an exact match */
+          return lpcb;
+        } else if (ip_addr_isany(&lpcb->local_ip)) {
+          /* found an ANY-match */
+          lpcb_any = lpcb;
+        }
+      }
+    }
+  }
+  return lpcb_any;
+}
+#endif /* LWIP_TCP_PCB_HASH */
+
 /**
  * Calculates a new initial sequence number for new connections.
  *
@@ -2517,10 +2971,17 @@ s16_t
 tcp_pcbs_sane(void)
 {
   struct tcp_pcb *pcb;
+#if LWIP_TCP_TIMER_WHEEL
+  struct tcp_pcb *prev = NULL;
+#endif /* LWIP_TCP_TIMER_WHEEL */
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != CLOSED", pcb->state != CLOSED);
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != LISTEN", pcb->state != LISTEN);
     LWIP_ASSERT("tcp_pcbs_sane: active pcb->state != TIME-WAIT", pcb->state != TIME_WAIT);
+#if LWIP_TCP_TIMER_WHEEL
+    LWIP_ASSERT("tcp_pcbs_sane: active pcb->active_prev", pcb->active_prev == prev);
+    prev = pcb;
+#endif /* LWIP_TCP_TIMER_WHEEL */
   }
   for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
     LWIP_ASSERT("tcp_pcbs_sane: tw pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
@@ -0,0 +1,288 @@
+/**
+ * @file
+ * Transmission Control Protocol, congestion control algorithms
+ *
+ * The TCP core calls the hooks of the algorithm attached to a pcb
+ * (see struct tcp_cc_ops) to update pcb->cwnd and pcb->ssthresh:
+ * - on_ack for every ACK of new data outside of fast recovery
+ * - on_loss when entering fast retransmit/fast recovery
+ * - on_rto when the retransmission timer expires
+ *
+ * Fast recovery itself (window inflation, SACK based retransmission)
+ * is not part of the algorithm and stays in tcp_in.c/tcp_out.c.
+ *
+ * Available algorithms:
+ * - @ref tcp_cc_newreno: RFC 5681 slow start and congestion avoidance with
+ *   RFC 3465 byte counting (default)
+ * - @ref tcp_cc_cubic: RFC 8312 CUBIC (LWIP_TCP_CC_CUBIC==1)
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "lwip/opt.h"
+
+#if LWIP_TCP /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/priv/tcp_priv.h"
+#include "lwip/sys.h"
+
+#include <string.h>
+
+/** Half of the effective window, but at least 2 MSS (RFC 5681 equation 4) */
+static tcpwnd_size_t
+tcp_cc_half_wnd(const struct tcp_pcb *pcb)
+{
+  tcpwnd_size_t ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
+  if (ssthresh < (tcpwnd_size_t)(2 * pcb->mss)) {
+    ssthresh = (tcpwnd_size_t)(2 * pcb->mss);
+  }
+  return ssthresh;
+}
+
+/** RFC 3465, section 2.2 Slow Start */
+static void
+tcp_cc_slow_start(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  tcpwnd_size_t increase;
+  /* limit to 1 SMSS segment during period following RTO */
+  u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
+
+  increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
+  TCP_WND_INC(pcb->cwnd, increase);
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+}
+
+static void
+tcp_cc_newreno_init(struct tcp_pcb *pcb)
+{
+  LWIP_UNUSED_ARG(pcb);
+}
+
+static void
+tcp_cc_newreno_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcp_cc_slow_start(pcb, acked);
+  } else {
+    /* RFC 3465, section 2.1 Congestion Avoidance */
+    TCP_WND_INC(pcb->bytes_acked, acked);
+    if (pcb->bytes_acked >= pcb->cwnd) {
+      pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
+      TCP_WND_INC(pcb->cwnd, pcb->mss);
+    }
+    LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
+  }
+}
+
+static void
+tcp_cc_newreno_on_loss(struct tcp_pcb *pcb)
+{
+  /* Set ssthresh to half of the minimum of the current
+   * cwnd and the advertised window */
+  pcb->ssthresh = tcp_cc_half_wnd(pcb);
+}
+
+static void
+tcp_cc_newreno_on_rto(struct tcp_pcb *pcb)
+{
+  pcb->ssthresh = tcp_cc_half_wnd(pcb);
+  pcb->cwnd = pcb->mss;
+  pcb->bytes_acked = 0;
+}
+
+/** NewReno congestion control (RFC 5681, RFC 3465) */
+const struct tcp_cc_ops tcp_cc_newreno = {
+  "newreno",
+  tcp_cc_newreno_init,
+  tcp_cc_newreno_on_ack,
+  tcp_cc_newreno_on_loss,
+  tcp_cc_newreno_on_rto
+};
+
+#if LWIP_TCP_CC_CUBIC
+/* Multiplicative decrease factor beta_cubic = 0.7, scaled by 1024 */
+#define TCP_CUBIC_BETA          717
+#define TCP_CUBIC_BETA_SCALE    1024
+/* Limits (t - K) so that the cube times mss fits in 64 bits (~8.7 minutes) */
+#define TCP_CUBIC_MAX_DT_MS     (1UL << 19)
+
+/** Integer cube root, bitwise method (Hacker's Delight, icbrt64) */
+static u32_t
+tcp_cubic_cbrt(u64_t x)
+{
+  u64_t y = 0;
+  u64_t b;
+  int s;
+
+  for (s = 63; s >= 0; s -= 3) {
+    y += y;
+    b = 3 * y * (y + 1) + 1;
+    if ((x >> s) >= b) {
+      x -= b << s;
+      y++;
+    }
+  }
+  return (u32_t)y;
+}
+
+static void
+tcp_cc_cubic_init(struct tcp_pcb *pcb)
+{
+  memset(&pcb->cubic, 0, sizeof(pcb->cubic));
+}
+
+/** Remember the window at a congestion event and start a new epoch */
+static void
+tcp_cc_cubic_reduce(struct tcp_pcb *pcb)
+{
+  tcpwnd_size_t cwnd = pcb->cwnd;
+  tcpwnd_size_t ssthresh;
+
+  if (cwnd < pcb->cubic.w_max) {
+    /* fast convergence: release bandwidth to new flows */
+    pcb->cubic.w_max = (tcpwnd_size_t)(((u64_t)cwnd * (TCP_CUBIC_BETA_SCALE + TCP_CUBIC_BETA)) /
+                                       (2 * TCP_CUBIC_BETA_SCALE));
+  } else {
+    pcb->cubic.w_max = cwnd;
+  }
+  ssthresh = (tcpwnd_size_t)(((u64_t)cwnd * TCP_CUBIC_BETA) / TCP_CUBIC_BETA_SCALE);
+  if (ssthresh < (tcpwnd_size_t)(2 * pcb->mss)) {
+    ssthresh = (tcpwnd_size_t)(2 * pcb->mss);
+  }
+  pcb->ssthresh = ssthresh;
+  pcb->cubic.epoch_start = 0;
+}
+
+static void
+tcp_cc_cubic_on_ack(struct tcp_pcb *pcb, tcpwnd_size_t acked)
+{
+  struct tcp_cubic *cubic = &pcb->cubic;
+  u32_t now, t, dt, srtt;
+  u64_t delta;
+  tcpwnd_size_t target, increase;
+
+  if (pcb->cwnd < pcb->ssthresh) {
+    tcp_cc_slow_start(pcb, acked);
+    return;
+  }
+
+  now = sys_now();
+  if (cubic->epoch_start == 0) {
+    /* first ACK in congestion avoidance after a congestion event */
+    cubic->epoch_start = (now != 0) ? now : 1;
+    if (pcb->cwnd < cubic->w_max) {
+      /* K = cbrt(W_max * (1 - beta) / C) where W_max - cwnd = W_max * (1 - beta):
+         with C = 0.4 segments/s^3, in milliseconds */
+      cubic->k = tcp_cubic_cbrt(((u64_t)(cubic->w_max - pcb->cwnd) * 2500000000UL) / pcb->mss);
+      cubic->origin = cubic->w_max;
+    } else {
+      cubic->k = 0;
+      cubic->origin = pcb->cwnd;
+    }
+    cubic->w_est = pcb->cwnd;
+  }
+
+  /* W_cubic(t + RTT) = C * (t + RTT - K)^3 + W_max (RFC 8312, equation 1) */
+  srtt = (u32_t)(pcb->sa >> 3) * TCP_SLOW_INTERVAL;
+  t = now - cubic->epoch_start + srtt;
+  dt = (t > cubic->k) ? (t - cubic->k) : (cubic->k - t);
+  dt = LWIP_MIN(dt, TCP_CUBIC_MAX_DT_MS);
+  /* C * dt^3 in bytes: 0.4 * (dt / 1000)^3 * mss */
+  delta = (((u64_t)dt * dt * dt) / 1000) * pcb->mss / 2500000UL;
+  if (t > cubic->k) {
+    target = (tcpwnd_size_t)LWIP_MIN((u64_t)cubic->origin + delta, (u64_t)TCPWND_MAX);
+  } else {
+    target = (delta < cubic->origin) ? (tcpwnd_size_t)(cubic->origin - delta) : 0;
+  }
+
+  /* TCP-friendly region: an AIMD estimate with alpha = 3 * (1 - beta) / (1 + beta)
+     (about 9/17 segments per RTT) so that CUBIC never grows slower than Reno */
+  TCP_WND_INC(cubic->w_est, (tcpwnd_size_t)(((u64_t)acked * pcb->mss * 9) / (17 * (u64_t)cubic->w_est)));
+  if (target < cubic->w_est) {
+    target = cubic->w_est;
+  }
+
+  if (target > pcb->cwnd) {
+    /* (target - cwnd) / cwnd per acked segment, at most 1.5 * cwnd per RTT */
+    increase = (tcpwnd_size_t)(((u64_t)(target - pcb->cwnd) * acked) / pcb->cwnd);
+    increase = LWIP_MIN(increase, acked / 2);
+    TCP_WND_INC(pcb->cwnd, increase);
+  }
+  LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: cubic cwnd %"TCPWNDSIZE_F" target %"TCPWNDSIZE_F"\n",
+                               pcb->cwnd, target));
+}
+
+static void
+tcp_cc_cubic_on_loss(struct tcp_pcb *pcb)
+{
+  tcp_cc_cubic_reduce(pcb);
+}
+
+static void
+tcp_cc_cubic_on_rto(struct tcp_pcb *pcb)
+{
+  tcp_cc_cubic_reduce(pcb);
+  pcb->cwnd = pcb->mss;
+  pcb->bytes_acked = 0;
+}
+
+/** CUBIC congestion control (RFC 8312) */
+const struct tcp_cc_ops tcp_cc_cubic = {
+  "cubic",
+  tcp_cc_cubic_init,
+  tcp_cc_cubic_on_ack,
+  tcp_cc_cubic_on_loss,
+  tcp_cc_cubic_on_rto
+};
+#endif /* LWIP_TCP_CC_CUBIC */
+
+/**
+ * @ingroup tcp_raw
+ * Select the congestion control algorithm of a pcb.
+ * The algorithm state is reset, cwnd and ssthresh are kept.
+ *
+ * @param pcb the tcp_pcb to change
+ * @param ops the algorithm, e.g. &tcp_cc_newreno or &tcp_cc_cubic
+ */
+void
+tcp_set_cc(struct tcp_pcb *pcb, const struct tcp_cc_ops *ops)
+{
+  LWIP_ASSERT_CORE_LOCKED();
+
+  LWIP_ERROR("tcp_set_cc: invalid pcb", pcb != NULL, return);
+  LWIP_ERROR("tcp_set_cc: invalid ops", ops != NULL, return);
+  LWIP_ERROR("tcp_set_cc: called on listen-pcb", pcb->state != LISTEN, return);
+
+  pcb->cc_ops = ops;
+  ops->init(pcb);
+}
+
+#endif /* LWIP_TCP */
@@ -85,6 +85,12 @@ static u8_t flags;
 static u8_t recv_flags;
 static struct pbuf *recv_data;
 
+#if LWIP_TCP_SACK_IN
+/* SACK blocks carried by the segment being processed */
+static struct tcp_sack_range tcp_in_sacks[LWIP_TCP_OPT_MAX_SACK_BLOCKS];
+static u8_t tcp_in_sack_num;
+#endif /* LWIP_TCP_SACK_IN */
+
 struct tcp_pcb *tcp_input_pcb;
 
 /* Forward declarations. */
@@ -105,6 +111,10 @@ static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 #endif /* TCP_OOSEQ_BYTES_LIMIT || TCP_OOSEQ_PBUFS_LIMIT */
 #endif /* LWIP_TCP_SACK_OUT */
 
+#if LWIP_TCP_SACK_IN
+static tcpwnd_size_t tcp_sack_update(struct tcp_pcb *pcb, u8_t *head_lost);
+#endif /* LWIP_TCP_SACK_IN */
+
 /**
  * The initial input processing of TCP. It verifies the TCP header, demultiplexes
  * the segment between the PCBs and passes it on to tcp_process(), which implements
@@ -117,12 +127,15 @@ static void tcp_remove_sacks_gt(struct tcp_pcb *pcb, u32_t seq);
 void
 tcp_input(struct pbuf *p, struct netif *inp)
 {
-  struct tcp_pcb *pcb, *prev;
+  struct tcp_pcb *pcb;
   struct tcp_pcb_listen *lpcb;
+#if !LWIP_TCP_PCB_HASH
+  struct tcp_pcb *prev;
 #if SO_REUSE
   struct tcp_pcb *lpcb_prev = NULL;
   struct tcp_pcb_listen *lpcb_any = NULL;
 #endif /* SO_REUSE */
+#endif /* !LWIP_TCP_PCB_HASH */
   u8_t hdrlen_bytes;
   err_t err;
 
@@ -157,6 +170,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
   }
 
 #if CHECKSUM_CHECK_TCP
+#if LWIP_TCP_GRO
+  /* GRO has checked the segments it coalesced */
+  if ((p->flags & PBUF_FLAG_GRO) == 0)
+#endif /* LWIP_TCP_GRO */
   IF__NETIF_CHECKSUM_ENABLED(inp, NETIF_CHECKSUM_CHECK_TCP) {
     /* Verify TCP checksum. */
     u16_t chksum = ip_chksum_pseudo(p, IP_PROTO_TCP, p->tot_len,
@@ -245,6 +262,10 @@ tcp_input(struct pbuf *p, struct netif *inp)
 
   /* Demultiplex an incoming segment. First, we check if it is destined
      for an active connection. */
+#if LWIP_TCP_PCB_HASH
+  pcb = tcp_pcb_hash_lookup(tcphdr->dest, tcphdr->src, ip_current_dest_addr(),
+                            ip_current_src_addr(), ip_current_input_netif(), 0);
+#else /* LWIP_TCP_PCB_HASH */
   prev = NULL;
 
   for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
@@ -269,6 +290,13 @@ tcp_input(struct pbuf *p, struct netif *inp)
       LWIP_ASSERT("tcp_input: pcb->next != pcb (before cache)", pcb->next != pcb);
       if (prev != NULL) {
         prev->next = pcb->next;
+#if LWIP_TCP_TIMER_WHEEL
+        if (pcb->next != NULL) {
+          pcb->next->active_prev = prev;
+        }
+        tcp_active_pcbs->active_prev = pcb;
+        pcb->active_prev = NULL;
+#endif /* LWIP_TCP_TIMER_WHEEL */
         pcb->next = tcp_active_pcbs;
         tcp_active_pcbs = pcb;
       } else {
@@ -279,10 +307,15 @@ tcp_input(struct pbuf *p, struct netif *inp)
     }
     prev = pcb;
   }
+#endif /* LWIP_TCP_PCB_HASH */
 
   if (pcb == NULL) {
     /* If it did not go to an active connection, we check the connections
        in the TIME-WAIT state. */
+#if LWIP_TCP_PCB_HASH
+    pcb = tcp_pcb_hash_lookup(tcphdr->dest, tcphdr->src, ip_current_dest_addr(),
+                              ip_current_src_addr(), ip_current_input_netif(), 1);
+#else /* LWIP_TCP_PCB_HASH */
     for (pcb = tcp_tw_pcbs; pcb != NULL; pcb = pcb->next) {
       LWIP_ASSERT("tcp_input: TIME-WAIT pcb->state == TIME-WAIT", pcb->state == TIME_WAIT);
 
@@ -296,24 +329,32 @@ tcp_input(struct pbuf *p, struct netif *inp)
           pcb->local_port == tcphdr->dest &&
           ip_addr_cmp(&pcb->remote_ip, ip_current_src_addr()) &&
           ip_addr_cmp(&pcb->local_ip, ip_current_dest_addr())) {
-        /* We don't really care enough to move this PCB to the front
-           of the list since we are not very likely to receive that
-           many segments for connections in TIME-WAIT. */
-        LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
+        break;
+      }
+    }
+#endif /* LWIP_TCP_PCB_HASH */
+    if (pcb != NULL) {
+      /* We don't really care enough to move this PCB to the front
+         of the list since we are not very likely to receive that
+         many segments for connections in TIME-WAIT. */
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for TIME_WAITing connection.\n"));
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
-        if (LWIP_HOOK_TCP_INPACKET_PCB(pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
-                                       tcphdr_opt2, p) == ERR_OK)
+      if (LWIP_HOOK_TCP_INPACKET_PCB(pcb, tcphdr, tcphdr_optlen, tcphdr_opt1len,
+                                     tcphdr_opt2, p) == ERR_OK)
 #endif
-        {
-          tcp_timewait_input(pcb);
-        }
-        pbuf_free(p);
-        return;
+      {
+        tcp_timewait_input(pcb);
       }
+      pbuf_free(p);
+      return;
     }
 
     /* Finally, if we still did not get a match, we check all PCBs that
        are LISTENing for incoming connections. */
+#if LWIP_TCP_PCB_HASH
+    lpcb = tcp_listen_hash_lookup(tcphdr->dest, ip_current_dest_addr(),
+                                  ip_current_input_netif());
+#else /* LWIP_TCP_PCB_HASH */
     prev = NULL;
     for (lpcb = tcp_listen_pcbs.listen_pcbs; lpcb != NULL; lpcb = lpcb->next) {
       /* check if PCB is bound to specific netif */
@@ -357,7 +398,9 @@ tcp_input(struct pbuf *p, struct netif *inp)
       prev = lpcb_prev;
     }
 #endif /* SO_REUSE */
+#endif /* LWIP_TCP_PCB_HASH */
     if (lpcb != NULL) {
+#if !LWIP_TCP_PCB_HASH
       /* Move this PCB to the front of the list so that subsequent
          lookups will be faster (we exploit locality in TCP segment
          arrivals). */
@@ -370,6 +413,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
       } else {
         TCP_STATS_INC(tcp.cachehit);
       }
+#endif /* !LWIP_TCP_PCB_HASH */
 
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_input: packed for LISTENing connection.\n"));
 #ifdef LWIP_HOOK_TCP_INPACKET_PCB
@@ -403,6 +447,7 @@ tcp_input(struct pbuf *p, struct netif *inp)
 #if TCP_INPUT_DEBUG
     tcp_debug_print_state(pcb->state);
 #endif /* TCP_INPUT_DEBUG */
+    TCP_WHEEL_WAKE(pcb);
 
     /* Set up a tcp_seg structure. */
     inseg.next = NULL;
@@ -1125,6 +1170,62 @@ tcp_free_acked_segments(struct tcp_pcb *pcb, struct tcp_seg *seg_list, const cha
   return seg_list;
 }
 
+#if LWIP_TCP_SACK_IN
+/**
+ * Update the SACK scoreboard from the SACK blocks of the incoming segment.
+ *
+ * Unacked segments entirely covered by a SACK block are marked SACKed. Blocks
+ * outside of the outstanding data (e.g. D-SACK blocks, RFC 2883) are ignored.
+ *
+ * @param pcb the tcp_pcb for which a segment arrived
+ * @param head_lost set to 1 if the first unacked segment is lost according to
+ *        RFC 6675 IsLost(), 0 otherwise
+ * @return number of bytes SACKed for the first time by this segment
+ */
+static tcpwnd_size_t
+tcp_sack_update(struct tcp_pcb *pcb, u8_t *head_lost)
+{
+  struct tcp_seg *seg;
+  tcpwnd_size_t newly_sacked = 0;
+  u32_t sacked_bytes = 0;
+  u16_t sacked_segs = 0;
+  u32_t left, right, seg_seqno;
+  u8_t i;
+
+  for (i = 0; i < tcp_in_sack_num; i++) {
+    left = tcp_in_sacks[i].left;
+    right = tcp_in_sacks[i].right;
+    if (TCP_SEQ_GEQ(left, right) || TCP_SEQ_LT(left, pcb->lastack) || TCP_SEQ_GT(right, pcb->snd_nxt)) {
+      LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_sack_update: ignoring block %"U32_F":%"U32_F"\n", left, right));
+      continue;
+    }
+    for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+      seg_seqno = lwip_ntohl(seg->tcphdr->seqno);
+      if (TCP_SEQ_GEQ(seg_seqno, right)) {
+        break;
+      }
+      if (!(seg->flags & TF_SEG_SACKED) && (seg->len > 0) &&
+          TCP_SEQ_GEQ(seg_seqno, left) && TCP_SEQ_LEQ(seg_seqno + TCP_TCPLEN(seg), right)) {
+        seg->flags |= TF_SEG_SACKED;
+        newly_sacked = (tcpwnd_size_t)(newly_sacked + seg->len);
+      }
+    }
+  }
+
+  *head_lost = 0;
+  if ((pcb->unacked != NULL) && !(pcb->unacked->flags & TF_SEG_SACKED)) {
+    for (seg = pcb->unacked->next; seg != NULL; seg = seg->next) {
+      if (seg->flags & TF_SEG_SACKED) {
+        sacked_bytes += seg->len;
+        sacked_segs++;
+      }
+    }
+    *head_lost = (u8_t)TCP_SACK_IS_LOST(pcb, sacked_segs, sacked_bytes);
+  }
+  return newly_sacked;
+}
+#endif /* LWIP_TCP_SACK_IN */
+
 /**
  * Called by tcp_process. Checks if the given segment is an ACK for outstanding
  * data, and if so frees the memory of the buffered data. Next, it places the
@@ -1143,6 +1244,10 @@ tcp_receive(struct tcp_pcb *pcb)
   s16_t m;
   u32_t right_wnd_edge;
   int found_dupack = 0;
+#if LWIP_TCP_SACK_IN
+  tcpwnd_size_t sack_new = 0;
+  u8_t sack_head_lost = 0;
+#endif /* LWIP_TCP_SACK_IN */
 
   LWIP_ASSERT("tcp_receive: invalid pcb", pcb != NULL);
   LWIP_ASSERT("tcp_receive: wrong state", pcb->state >= ESTABLISHED);
@@ -1194,12 +1299,23 @@ tcp_receive(struct tcp_pcb *pcb)
      *
      */
 
+#if LWIP_TCP_SACK_IN
+    if (tcp_in_sack_num != 0) {
+      sack_new = tcp_sack_update(pcb, &sack_head_lost);
+    }
+#endif /* LWIP_TCP_SACK_IN */
+
     /* Clause 1 */
     if (TCP_SEQ_LEQ(ackno, pcb->lastack)) {
       /* Clause 2 */
       if (tcplen == 0) {
-        /* Clause 3 */
+        /* Clause 3 (with SACK information, RFC 6675 instead requires that
+           the ACK SACKs new data) */
+#if LWIP_TCP_SACK_IN
+        if ((tcp_in_sack_num != 0) ? (sack_new != 0) : (pcb->snd_wl2 + pcb->snd_wnd == right_wnd_edge)) {
+#else /* LWIP_TCP_SACK_IN */
         if (pcb->snd_wl2 + pcb->snd_wnd == right_wnd_edge) {
+#endif /* LWIP_TCP_SACK_IN */
           /* Clause 4 */
           if (pcb->rtime >= 0) {
             /* Clause 5 */
@@ -1208,13 +1324,25 @@ tcp_receive(struct tcp_pcb *pcb)
               if ((u8_t)(pcb->dupacks + 1) > pcb->dupacks) {
                 ++pcb->dupacks;
               }
-              if (pcb->dupacks > 3) {
-                /* Inflate the congestion window */
-                TCP_WND_INC(pcb->cwnd, pcb->mss);
-              }
-              if (pcb->dupacks >= 3) {
-                /* Do fast retransmit (checked via TF_INFR, not via dupacks count) */
-                tcp_rexmit_fast(pcb);
+#if LWIP_TCP_SACK_IN
+              if (pcb->flags & TF_SACK) {
+                /* RFC 6675: enter loss recovery after DupThresh dupacks
+                   or as soon as the scoreboard shows the first segment lost,
+                   then keep retransmitting lost segments as pipe allows */
+                if ((pcb->dupacks >= 3) || sack_head_lost || (pcb->flags & TF_INFR)) {
+                  tcp_rexmit_fast(pcb);
+                }
+              } else
+#endif /* LWIP_TCP_SACK_IN */
+              {
+                if (pcb->dupacks > 3) {
+                  /* Inflate the congestion window */
+                  TCP_WND_INC(pcb->cwnd, pcb->mss);
+                }
+                if (pcb->dupacks >= 3) {
+                  /* Do fast retransmit (checked via TF_INFR, not via dupacks count) */
+                  tcp_rexmit_fast(pcb);
+                }
               }
             }
           }
@@ -1232,10 +1360,19 @@ tcp_receive(struct tcp_pcb *pcb)
       /* Reset the "IN Fast Retransmit" flag, since we are no longer
          in fast retransmit. Also reset the congestion window to the
          slow start threshold. */
+#if LWIP_TCP_SACK_IN
+      if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK) &&
+          TCP_SEQ_LT(ackno, pcb->recovery_point)) {
+        /* Partial ACK: SACK loss recovery continues (RFC 6675) */
+      } else
+#endif /* LWIP_TCP_SACK_IN */
       if (pcb->flags & TF_INFR) {
         tcp_clear_flags(pcb, TF_INFR);
         pcb->cwnd = pcb->ssthresh;
         pcb->bytes_acked = 0;
+#if LWIP_TCP_SACK_IN
+        tcp_sack_clear(pcb, TF_SEG_SACK_RXT);
+#endif /* LWIP_TCP_SACK_IN */
       }
 
       /* Reset the number of retransmissions. */
@@ -1252,25 +1389,9 @@ tcp_receive(struct tcp_pcb *pcb)
       pcb->lastack = ackno;
 
       /* Update the congestion control variables (cwnd and
-         ssthresh). */
-      if (pcb->state >= ESTABLISHED) {
-        if (pcb->cwnd < pcb->ssthresh) {
-          tcpwnd_size_t increase;
-          /* limit to 1 SMSS segment during period following RTO */
-          u8_t num_seg = (pcb->flags & TF_RTO) ? 1 : 2;
-          /* RFC 3465, section 2.2 Slow Start */
-          increase = LWIP_MIN(acked, (tcpwnd_size_t)(num_seg * pcb->mss));
-          TCP_WND_INC(pcb->cwnd, increase);
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: slow start cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        } else {
-          /* RFC 3465, section 2.1 Congestion Avoidance */
-          TCP_WND_INC(pcb->bytes_acked, acked);
-          if (pcb->bytes_acked >= pcb->cwnd) {
-            pcb->bytes_acked = (tcpwnd_size_t)(pcb->bytes_acked - pcb->cwnd);
-            TCP_WND_INC(pcb->cwnd, pcb->mss);
-          }
-          LWIP_DEBUGF(TCP_CWND_DEBUG, ("tcp_receive: congestion avoidance cwnd %"TCPWNDSIZE_F"\n", pcb->cwnd));
-        }
+         ssthresh). cwnd is not increased during SACK loss recovery. */
+      if ((pcb->state >= ESTABLISHED) && !(pcb->flags & TF_INFR)) {
+        pcb->cc_ops->on_ack(pcb, acked);
       }
       LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_receive: ACK for %"U32_F", unacked->seqno %"U32_F":%"U32_F"\n",
                                     ackno,
@@ -1306,6 +1427,12 @@ tcp_receive(struct tcp_pcb *pcb)
       }
 #endif /* TCP_OVERSIZE */
 
+#if LWIP_TCP_SACK_IN
+      if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK)) {
+        tcp_sack_rexmit_lost(pcb);
+      }
+#endif /* LWIP_TCP_SACK_IN */
+
 #if LWIP_IPV6 && LWIP_ND6_TCP_REACHABILITY_HINTS
       if (ip_current_is_v6()) {
         /* Inform neighbor reachability of forward progress. */
@@ -1622,7 +1749,15 @@ tcp_receive(struct tcp_pcb *pcb)
 
 
         /* Acknowledge the segment(s). */
-        tcp_ack(pcb);
+#if LWIP_TCP_GRO
+        if (tcplen >= 2 * pcb->mss) {
+          /* coalesced by GRO: ACK at least every second full-sized segment */
+          tcp_ack_now(pcb);
+        } else
+#endif /* LWIP_TCP_GRO */
+        {
+          tcp_ack(pcb);
+        }
 
 #if LWIP_TCP_SACK_OUT
         if (LWIP_TCP_SACK_VALID(pcb, 0)) {
@@ -1897,6 +2032,20 @@ tcp_get_next_optbyte(void)
   }
 }
 
+#if LWIP_TCP_SACK_IN
+static u32_t
+tcp_get_next_optu32(void)
+{
+  u32_t val;
+
+  val = (u32_t)tcp_get_next_optbyte() << 24;
+  val |= (u32_t)tcp_get_next_optbyte() << 16;
+  val |= (u32_t)tcp_get_next_optbyte() << 8;
+  val |= tcp_get_next_optbyte();
+  return val;
+}
+#endif /* LWIP_TCP_SACK_IN */
+
 /**
  * Parses the options contained in the incoming segment.
  *
@@ -1913,9 +2062,16 @@ tcp_parseopt(struct tcp_pcb *pcb)
 #if LWIP_TCP_TIMESTAMPS
   u32_t tsval;
 #endif
+#if LWIP_TCP_SACK_IN
+  u32_t left, right;
+#endif
 
   LWIP_ASSERT("tcp_parseopt: invalid pcb", pcb != NULL);
 
+#if LWIP_TCP_SACK_IN
+  tcp_in_sack_num = 0;
+#endif /* LWIP_TCP_SACK_IN */
+
   /* Parse the TCP MSS option, if present. */
   if (tcphdr_optlen != 0) {
     for (tcp_optidx = 0; tcp_optidx < tcphdr_optlen; ) {
@@ -2008,6 +2164,28 @@ tcp_parseopt(struct tcp_pcb *pcb)
           }
           break;
 #endif /* LWIP_TCP_SACK_OUT */
+#if LWIP_TCP_SACK_IN
+        case LWIP_TCP_OPT_SACK:
+          LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: SACK\n"));
+          data = tcp_get_next_optbyte();
+          if ((data < 2 + LWIP_TCP_OPT_LEN_SACK_BLOCK) || (((data - 2) % LWIP_TCP_OPT_LEN_SACK_BLOCK) != 0) ||
+              (tcp_optidx - 2 + data) > tcphdr_optlen) {
+            /* Bad length */
+            LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: bad length\n"));
+            return;
+          }
+          /* TCP SACK option with valid length: only use it if SACK was negotiated */
+          for (data = (u8_t)((data - 2) / LWIP_TCP_OPT_LEN_SACK_BLOCK); data > 0; data--) {
+            left = tcp_get_next_optu32();
+            right = tcp_get_next_optu32();
+            if ((pcb->flags & TF_SACK) && (tcp_in_sack_num < LWIP_TCP_OPT_MAX_SACK_BLOCKS)) {
+              tcp_in_sacks[tcp_in_sack_num].left = left;
+              tcp_in_sacks[tcp_in_sack_num].right = right;
+              tcp_in_sack_num++;
+            }
+          }
+          break;
+#endif /* LWIP_TCP_SACK_IN */
         default:
           LWIP_DEBUGF(TCP_INPUT_DEBUG, ("tcp_parseopt: other\n"));
           data = tcp_get_next_optbyte();
@@ -124,6 +124,14 @@
 #endif
 #endif
 
+#if LWIP_TCP_SACK_IN
+/** SACK retransmissions were already admitted by the RFC 6675 pipe check in
+ * tcp_sack_rexmit_lost(), so they only have to fit the send window, not cwnd */
+#define TCP_OUTPUT_SEG_WND(pcb, seg, wnd) (((seg)->flags & TF_SEG_SACK_RXT) ? (u32_t)(pcb)->snd_wnd : (wnd))
+#else /* LWIP_TCP_SACK_IN */
+#define TCP_OUTPUT_SEG_WND(pcb, seg, wnd) (wnd)
+#endif /* LWIP_TCP_SACK_IN */
+
 /* Forward declarations.*/
 static err_t tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif);
 
@@ -295,6 +303,33 @@ tcp_seg_add_chksum(u16_t chksum, u16_t len, u16_t *seg_chksum,
 }
 #endif /* TCP_CHECKSUM_ON_COPY */
 
+#if LWIP_TCP_GSO
+/**
+ * Maximum size (including options) of the segments tcp_write builds: if the
+ * connection is routed over a netif with NETIF_FLAG_GSO, as many MSS-sized
+ * segments as fit into TCP_GSO_MAX_SIZE, the congestion window and half of
+ * the largest send window seen are combined into one.
+ *
+ * @param pcb the tcp_pcb to enqueue data for
+ * @param mss_local maximum size of a segment on the wire
+ * @param optlen length of the options in each segment
+ */
+static u16_t
+tcp_gso_mss(const struct tcp_pcb *pcb, u16_t mss_local, u8_t optlen)
+{
+  struct netif *netif;
+  u16_t unit = (u16_t)(mss_local - optlen);
+  tcpwnd_size_t limit = LWIP_MIN(pcb->cwnd, pcb->snd_wnd_max / 2);
+  u16_t max_len = (u16_t)LWIP_MIN(limit, TCP_GSO_MAX_SIZE);
+
+  netif = tcp_route(pcb, &pcb->local_ip, &pcb->remote_ip);
+  if ((netif == NULL) || ((netif->flags & NETIF_FLAG_GSO) == 0) || (max_len <= unit)) {
+    return mss_local;
+  }
+  return (u16_t)(optlen + (max_len / unit) * unit);
+}
+#endif /* LWIP_TCP_GSO */
+
 /** Checks if tcp_write is allowed or not (checks state, snd_buf and snd_queuelen).
  *
  * @param pcb the tcp pcb to check for
@@ -433,6 +468,8 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
   if (err != ERR_OK) {
     return err;
   }
+  /* new unsent data needs the timers (tcp_output may not be called at once) */
+  TCP_WHEEL_WAKE(pcb);
   queuelen = pcb->snd_queuelen;
 
 #if LWIP_TCP_TIMESTAMPS
@@ -448,6 +485,9 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
   {
     optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(0, pcb);
   }
+#if LWIP_TCP_GSO
+  mss_local = tcp_gso_mss(pcb, mss_local, optlen);
+#endif /* LWIP_TCP_GSO */
 
 
   /*
@@ -483,8 +523,15 @@ tcp_write(struct tcp_pcb *pcb, const void *arg, u16_t len, u8_t apiflags)
 
     /* Usable space at the end of the last unsent segment */
     unsent_optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(last_unsent->flags, pcb);
+#if LWIP_TCP_GSO
+    /* the super-segment size follows cwnd, it may have shrunk since
+       last_unsent was built */
+    space = (mss_local > last_unsent->len + unsent_optlen) ?
+            (u16_t)(mss_local - (last_unsent->len + unsent_optlen)) : 0;
+#else /* LWIP_TCP_GSO */
     LWIP_ASSERT("mss_local is too small", mss_local >= last_unsent->len + unsent_optlen);
     space = mss_local - (last_unsent->len + unsent_optlen);
+#endif /* LWIP_TCP_GSO */
 
     /*
      * Phase 1: Copy data directly into an oversized pbuf.
@@ -811,6 +858,226 @@ memerr:
   return ERR_MEM;
 }
 
+#if LWIP_TCP_ZEROCOPY
+/** Free-callback function of a 'struct tcp_zc_ref', called by pbuf_free when
+ * the last segment referencing this slice is freed. */
+static void
+tcp_zc_free_pbuf_custom(struct pbuf *p)
+{
+  struct tcp_zc_ref *zc = (struct tcp_zc_ref *)p;
+  LWIP_ASSERT("zc != NULL", zc != NULL);
+  LWIP_ASSERT("zc == p", (void *)zc == (void *)p);
+  pbuf_free(zc->owner);
+  memp_free(MEMP_TCP_ZC_REF, zc);
+}
+
+/**
+ * @ingroup tcp_raw
+ * Enqueue the data of a pbuf chain for sending without copying it.
+ *
+ * The segments reference the payload of 'p' directly. On success, the stack
+ * takes over the caller's reference to 'p': it is released when the last
+ * segment covering its data is freed, i.e. after the data has been
+ * acknowledged by the remote host (and any driver reference is gone) or the
+ * connection is aborted. Allocate 'p' with pbuf_alloced_custom() to get
+ * notified through its custom_free_function when the buffer may be reused.
+ *
+ * The payload must not be modified until then, as it may be retransmitted.
+ * If ERR_MEM is returned, nothing is enqueued and the caller keeps its
+ * reference; try again after some data has been acknowledged.
+ *
+ * @param pcb Protocol control block for the TCP connection to enqueue data for.
+ * @param p pbuf chain holding the data to be enqueued for sending.
+ * @param apiflags combination of following flags :
+ * - TCP_WRITE_FLAG_MORE (0x02) for TCP connection, PSH flag will not be set on last segment sent,
+ * @return ERR_OK if enqueued, another err_t on error
+ */
+err_t
+tcp_write_pbuf(struct tcp_pcb *pcb, struct pbuf *p, u8_t apiflags)
+{
+  struct tcp_seg *seg = NULL, *prev_seg = NULL, *queue = NULL;
+  struct pbuf *q;
+  u16_t qoff = 0; /* position in the current pbuf of 'p' */
+  u16_t pos = 0; /* position in 'p' data */
+  u16_t len;
+  u16_t queuelen;
+  u8_t optlen;
+  u8_t optflags = 0;
+  err_t err;
+  u16_t mss_local;
+
+  LWIP_ERROR("tcp_write_pbuf: invalid pcb", pcb != NULL, return ERR_ARG);
+  LWIP_ERROR("tcp_write_pbuf: invalid pbuf", p != NULL, return ERR_ARG);
+
+  /* don't allocate segments bigger than half the maximum window we ever received */
+  mss_local = LWIP_MIN(pcb->mss, TCPWND_MIN16(pcb->snd_wnd_max / 2));
+  mss_local = mss_local ? mss_local : pcb->mss;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  len = p->tot_len;
+  LWIP_DEBUGF(TCP_OUTPUT_DEBUG, ("tcp_write_pbuf(pcb=%p, p=%p, len=%"U16_F", apiflags=%"U16_F")\n",
+                                 (void *)pcb, (void *)p, len, (u16_t)apiflags));
+
+  err = tcp_write_checks(pcb, len);
+  if (err != ERR_OK) {
+    return err;
+  }
+  TCP_WHEEL_WAKE(pcb);
+  queuelen = pcb->snd_queuelen;
+
+#if LWIP_TCP_TIMESTAMPS
+  if ((pcb->flags & TF_TIMESTAMP)) {
+    optflags = TF_SEG_OPTS_TS;
+    optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(TF_SEG_OPTS_TS, pcb);
+    /* ensure that segments can hold at least one data byte... */
+    mss_local = LWIP_MAX(mss_local, LWIP_TCP_OPT_LEN_TS + 1);
+  } else
+#endif /* LWIP_TCP_TIMESTAMPS */
+  {
+    optlen = LWIP_TCP_OPT_LENGTH_SEGMENT(0, pcb);
+  }
+#if LWIP_TCP_GSO
+  mss_local = tcp_gso_mss(pcb, mss_local, optlen);
+#endif /* LWIP_TCP_GSO */
+
+  /*
+   * Build the segments in a local queue first, so that nothing in pcb
+   * changes if we run out of memory. Each segment is a header pbuf
+   * followed by one PBUF_REF slice per pbuf of 'p' it covers; every
+   * slice holds a reference on 'p'.
+   */
+  q = p;
+  while (pos < len) {
+    struct pbuf *hdr;
+    u16_t left = len - pos;
+    u16_t max_len = mss_local - optlen;
+    u16_t seglen = LWIP_MIN(left, max_len);
+    u16_t filled = 0;
+#if TCP_CHECKSUM_ON_COPY
+    u16_t chksum = 0;
+    u8_t chksum_swapped = 0;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+    if ((hdr = pbuf_alloc(PBUF_TRANSPORT, optlen, PBUF_RAM)) == NULL) {
+      LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write_pbuf: could not allocate memory for header pbuf\n"));
+      goto memerr;
+    }
+    while (filled < seglen) {
+      struct tcp_zc_ref *zc;
+      struct pbuf *slice;
+      u16_t n;
+
+      /* skip to the pbuf holding the next data byte */
+      while (qoff == q->len) {
+        q = q->next;
+        qoff = 0;
+        LWIP_ASSERT("tcp_write_pbuf: tot_len mismatch", q != NULL);
+      }
+      n = LWIP_MIN((u16_t)(seglen - filled), (u16_t)(q->len - qoff));
+
+      zc = (struct tcp_zc_ref *)memp_malloc(MEMP_TCP_ZC_REF);
+      if (zc == NULL) {
+        LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write_pbuf: could not allocate memory for zero-copy pbuf\n"));
+        pbuf_free(hdr);
+        goto memerr;
+      }
+      zc->pc.custom_free_function = tcp_zc_free_pbuf_custom;
+      zc->owner = p;
+      slice = pbuf_alloced_custom(PBUF_RAW, n, PBUF_REF, &zc->pc, (u8_t *)q->payload + qoff, n);
+      LWIP_ASSERT("tcp_write_pbuf: slice != NULL", slice != NULL);
+      pbuf_ref(p);
+#if TCP_CHECKSUM_ON_COPY
+      /* calculate the checksum of nocopy-data */
+      tcp_seg_add_chksum((u16_t)~inet_chksum(slice->payload, n), n, &chksum, &chksum_swapped);
+#endif /* TCP_CHECKSUM_ON_COPY */
+      pbuf_cat(hdr, slice);
+      qoff = (u16_t)(qoff + n);
+      filled = (u16_t)(filled + n);
+    }
+
+    queuelen += pbuf_clen(hdr);
+
+    /* Now that there are more segments queued, we check again if the
+     * length of the queue exceeds the configured maximum or
+     * overflows. */
+    if (queuelen > LWIP_MIN(TCP_SND_QUEUELEN, TCP_SNDQUEUELEN_OVERFLOW)) {
+      LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_LEVEL_SERIOUS, ("tcp_write_pbuf: queue too long %"U16_F" (%d)\n",
+                  queuelen, (int)TCP_SND_QUEUELEN));
+      pbuf_free(hdr);
+      goto memerr;
+    }
+
+    if ((seg = tcp_create_segment(pcb, hdr, 0, pcb->snd_lbb + pos, optflags)) == NULL) {
+      goto memerr;
+    }
+#if TCP_CHECKSUM_ON_COPY
+    seg->chksum = chksum;
+    seg->chksum_swapped = chksum_swapped;
+    seg->flags |= TF_SEG_DATA_CHECKSUMMED;
+#endif /* TCP_CHECKSUM_ON_COPY */
+
+    if (queue == NULL) {
+      queue = seg;
+    } else {
+      LWIP_ASSERT("prev_seg != NULL", prev_seg != NULL);
+      prev_seg->next = seg;
+    }
+    prev_seg = seg;
+
+    LWIP_DEBUGF(TCP_OUTPUT_DEBUG | LWIP_DBG_TRACE, ("tcp_write_pbuf: queueing %"U32_F":%"U32_F"\n",
+                lwip_ntohl(seg->tcphdr->seqno),
+                lwip_ntohl(seg->tcphdr->seqno) + TCP_TCPLEN(seg)));
+
+    pos += seglen;
+  }
+
+  /* All segments were created: append them to pcb->unsent. */
+  if (queue != NULL) {
+    if (pcb->unsent == NULL) {
+      pcb->unsent = queue;
+    } else {
+      struct tcp_seg *useg;
+      for (useg = pcb->unsent; useg->next != NULL; useg = useg->next);
+      useg->next = queue;
+    }
+#if TCP_OVERSIZE
+    /* The new unsent tail references application data and has no space */
+    pcb->unsent_oversize = 0;
+#endif /* TCP_OVERSIZE */
+  }
+
+  pcb->snd_lbb += len;
+  pcb->snd_buf -= len;
+  pcb->snd_queuelen = queuelen;
+
+  LWIP_DEBUGF(TCP_QLEN_DEBUG, ("tcp_write_pbuf: %"S16_F" (after enqueued)\n",
+                               pcb->snd_queuelen));
+  if (pcb->snd_queuelen != 0) {
+    LWIP_ASSERT("tcp_write_pbuf: valid queue length",
+                pcb->unacked != NULL || pcb->unsent != NULL);
+  }
+
+  /* Set the PSH flag in the last segment that we enqueued. */
+  if (seg != NULL && seg->tcphdr != NULL && ((apiflags & TCP_WRITE_FLAG_MORE) == 0)) {
+    TCPH_SET_FLAG(seg->tcphdr, TCP_PSH);
+  }
+
+  /* the segments now hold the references to 'p': drop the caller's one */
+  pbuf_free(p);
+  return ERR_OK;
+memerr:
+  tcp_set_flags(pcb, TF_NAGLEMEMERR);
+  TCP_STATS_INC(tcp.memerr);
+
+  if (queue != NULL) {
+    tcp_segs_free(queue);
+  }
+  LWIP_DEBUGF(TCP_QLEN_DEBUG | LWIP_DBG_STATE, ("tcp_write_pbuf: %"S16_F" (with mem err)\n", pcb->snd_queuelen));
+  return ERR_MEM;
+}
+#endif /* LWIP_TCP_ZEROCOPY */
+
 /**
  * Split segment on the head of the unsent queue.  If return is not
  * ERR_OK, existing head remains intact
@@ -856,7 +1123,9 @@ tcp_split_unsent_seg(struct tcp_pcb *pcb, u16_t split)
     return ERR_OK;
   }
 
+#if !LWIP_TCP_GSO
   LWIP_ASSERT("split <= mss", split <= pcb->mss);
+#endif /* !LWIP_TCP_GSO */
   LWIP_ASSERT("useg->len > 0", useg->len > 0);
 
   /* We should check that we don't exceed TCP_SND_QUEUELEN but we need
@@ -870,6 +1139,10 @@ tcp_split_unsent_seg(struct tcp_pcb *pcb, u16_t split)
   /* Remove since checksum is not stored until after tcp_create_segment() */
   optflags &= ~TF_SEG_DATA_CHECKSUMMED;
 #endif /* TCP_CHECKSUM_ON_COPY */
+#if LWIP_TCP_SACK_IN
+  /* The scoreboard state does not carry over to the new segment */
+  optflags &= (u8_t)~(TF_SEG_SACKED | TF_SEG_SACK_RXT);
+#endif /* LWIP_TCP_SACK_IN */
   optlen = LWIP_TCP_OPT_LENGTH(optflags);
   remainder = useg->len - split;
 
@@ -1042,6 +1315,8 @@ tcp_enqueue_flags(struct tcp_pcb *pcb, u8_t flags)
               (flags & (TCP_SYN | TCP_FIN)) != 0);
   LWIP_ASSERT("tcp_enqueue_flags: invalid pcb", pcb != NULL);
 
+  TCP_WHEEL_WAKE(pcb);
+
   /* No need to check pcb->snd_queuelen if only SYN or FIN are allowed! */
 
   /* Get options for this segment. This is a special case since this is the
@@ -1225,6 +1500,40 @@ tcp_build_wnd_scale_option(u32_t *opts)
 }
 #endif
 
+#if LWIP_TCP_GSO
+/** Amount of data in each segment on the wire when seg is sent as a
+ * super-segment */
+static u16_t
+tcp_gso_size(const struct tcp_pcb *pcb, const struct tcp_seg *seg)
+{
+  return (u16_t)(pcb->mss - LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
+}
+
+/** If the super-segment at the head of pcb->unsent does not fit into the
+ * window, split off the part that does (in multiples of the segment size)
+ * instead of waiting for the window to open for all of it. */
+static void
+tcp_gso_split_unsent(struct tcp_pcb *pcb, u32_t wnd)
+{
+  struct tcp_seg *seg = pcb->unsent;
+  u32_t used, room;
+  u16_t unit;
+
+  if (seg == NULL) {
+    return;
+  }
+  used = lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack;
+  if ((used + seg->len <= wnd) || (used >= wnd)) {
+    return;
+  }
+  room = wnd - used;
+  unit = tcp_gso_size(pcb, seg);
+  if ((seg->len > unit) && (room >= unit)) {
+    tcp_split_unsent_seg(pcb, (u16_t)(room - (room % unit)));
+  }
+}
+#endif /* LWIP_TCP_GSO */
+
 /**
  * @ingroup tcp_raw
  * Find out what we can send and send it
@@ -1259,6 +1568,8 @@ tcp_output(struct tcp_pcb *pcb)
     return ERR_OK;
   }
 
+  TCP_WHEEL_WAKE(pcb);
+
   wnd = LWIP_MIN(pcb->snd_wnd, pcb->cwnd);
 
   seg = pcb->unsent;
@@ -1301,8 +1612,12 @@ tcp_output(struct tcp_pcb *pcb)
     ip_addr_copy(pcb->local_ip, *local_ip);
   }
 
+#if LWIP_TCP_GSO
+  tcp_gso_split_unsent(pcb, wnd);
+  seg = pcb->unsent;
+#endif /* LWIP_TCP_GSO */
   /* Handle the current segment not fitting within the window */
-  if (lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > wnd) {
+  if (lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len > TCP_OUTPUT_SEG_WND(pcb, seg, wnd)) {
     /* We need to start the persistent timer when the next unsent segment does not fit
      * within the remaining (could be 0) send window and RTO timer is not running (we
      * have no in-flight data). If window is still too small after persist timer fires,
@@ -1330,7 +1645,7 @@ tcp_output(struct tcp_pcb *pcb)
   }
   /* data available and window allows it to be sent? */
   while (seg != NULL &&
-         lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len <= wnd) {
+         lwip_ntohl(seg->tcphdr->seqno) - pcb->lastack + seg->len <= TCP_OUTPUT_SEG_WND(pcb, seg, wnd)) {
     LWIP_ASSERT("RST not expected here!",
                 (TCPH_FLAGS(seg->tcphdr) & TCP_RST) == 0);
     /* Stop sending if the nagle algorithm would prevent it
@@ -1405,6 +1720,9 @@ tcp_output(struct tcp_pcb *pcb)
     } else {
       tcp_seg_free(seg);
     }
+#if LWIP_TCP_GSO
+    tcp_gso_split_unsent(pcb, wnd);
+#endif /* LWIP_TCP_GSO */
     seg = pcb->unsent;
   }
 #if TCP_OVERSIZE
@@ -1563,6 +1881,11 @@ tcp_output_segment(struct tcp_seg *seg, struct tcp_pcb *pcb, struct netif *netif
 #endif
   LWIP_ASSERT("options not filled", (u8_t *)opts == ((u8_t *)(seg->tcphdr + 1)) + LWIP_TCP_OPT_LENGTH_SEGMENT(seg->flags, pcb));
 
+#if LWIP_TCP_GSO
+  /* Segments larger than the MSS are split by the netif or the IP layer */
+  seg->p->gso_size = (seg->len > tcp_gso_size(pcb, seg)) ? tcp_gso_size(pcb, seg) : 0;
+#endif /* LWIP_TCP_GSO */
+
 #if CHECKSUM_GEN_TCP
   IF__NETIF_CHECKSUM_ENABLED(netif, NETIF_CHECKSUM_GEN_TCP) {
 #if TCP_CHECKSUM_ON_COPY
@@ -1664,6 +1987,14 @@ tcp_rexmit_rto_prepare(struct tcp_pcb *pcb)
   pcb->unsent = pcb->unacked;
   /* unacked queue is now empty */
   pcb->unacked = NULL;
+#if LWIP_TCP_SACK_IN
+  /* The receiver may have discarded SACKed data (RFC 2018), so everything
+     is sent again. This also ends SACK loss recovery. */
+  tcp_sack_clear(pcb, TF_SEG_SACKED | TF_SEG_SACK_RXT);
+  if (pcb->flags & TF_SACK) {
+    tcp_clear_flags(pcb, TF_INFR);
+  }
+#endif /* LWIP_TCP_SACK_IN */
 
   /* Mark RTO in-progress */
   tcp_set_flags(pcb, TF_RTO);
@@ -1714,25 +2045,18 @@ tcp_rexmit_rto(struct tcp_pcb *pcb)
 }
 
 /**
- * Requeue the first unacked segment for retransmission
+ * Move one unacked segment to the unsent queue for retransmission
  *
- * Called by tcp_receive() for fast retransmit.
- *
- * @param pcb the tcp_pcb for which to retransmit the first unacked segment
+ * @param pcb the tcp_pcb owning the segment
+ * @param useg pointer to the link in pcb->unacked referencing the segment
  */
-err_t
-tcp_rexmit(struct tcp_pcb *pcb)
+static err_t
+tcp_rexmit_unacked(struct tcp_pcb *pcb, struct tcp_seg **useg)
 {
   struct tcp_seg *seg;
   struct tcp_seg **cur_seg;
 
-  LWIP_ASSERT("tcp_rexmit: invalid pcb", pcb != NULL);
-
-  if (pcb->unacked == NULL) {
-    return ERR_VAL;
-  }
-
-  seg = pcb->unacked;
+  seg = *useg;
 
   /* Give up if the segment is still referenced by the netif driver
      due to deferred transmission. */
@@ -1741,9 +2065,9 @@ tcp_rexmit(struct tcp_pcb *pcb)
     return ERR_VAL;
   }
 
-  /* Move the first unacked segment to the unsent queue */
+  /* Move the unacked segment to the unsent queue */
   /* Keep the unsent queue sorted. */
-  pcb->unacked = seg->next;
+  *useg = seg->next;
 
   cur_seg = &(pcb->unsent);
   while (*cur_seg &&
@@ -1773,6 +2097,25 @@ tcp_rexmit(struct tcp_pcb *pcb)
   return ERR_OK;
 }
 
+/**
+ * Requeue the first unacked segment for retransmission
+ *
+ * Called by tcp_receive() for fast retransmit.
+ *
+ * @param pcb the tcp_pcb for which to retransmit the first unacked segment
+ */
+err_t
+tcp_rexmit(struct tcp_pcb *pcb)
+{
+  LWIP_ASSERT("tcp_rexmit: invalid pcb", pcb != NULL);
+
+  if (pcb->unacked == NULL) {
+    return ERR_VAL;
+  }
+
+  return tcp_rexmit_unacked(pcb, &pcb->unacked);
+}
+
 
 /**
  * Handle retransmission after three dupacks received
@@ -1782,6 +2125,10 @@ tcp_rexmit(struct tcp_pcb *pcb)
 void
 tcp_rexmit_fast(struct tcp_pcb *pcb)
 {
+#if LWIP_TCP_SACK_IN
+  struct tcp_seg *seg;
+#endif /* LWIP_TCP_SACK_IN */
+
   LWIP_ASSERT("tcp_rexmit_fast: invalid pcb", pcb != NULL);
 
   if (pcb->unacked != NULL && !(pcb->flags & TF_INFR)) {
@@ -1791,28 +2138,142 @@ tcp_rexmit_fast(struct tcp_pcb *pcb)
                  "), fast retransmit %"U32_F"\n",
                  (u16_t)pcb->dupacks, pcb->lastack,
                  lwip_ntohl(pcb->unacked->tcphdr->seqno)));
+#if LWIP_TCP_SACK_IN
+    seg = pcb->unacked;
+#endif /* LWIP_TCP_SACK_IN */
     if (tcp_rexmit(pcb) == ERR_OK) {
-      /* Set ssthresh to half of the minimum of the current
-       * cwnd and the advertised window */
-      pcb->ssthresh = LWIP_MIN(pcb->cwnd, pcb->snd_wnd) / 2;
-
-      /* The minimum value for ssthresh should be 2 MSS */
-      if (pcb->ssthresh < (2U * pcb->mss)) {
-        LWIP_DEBUGF(TCP_FR_DEBUG,
-                    ("tcp_receive: The minimum value for ssthresh %"TCPWNDSIZE_F
-                     " should be min 2 mss %"U16_F"...\n",
-                     pcb->ssthresh, (u16_t)(2 * pcb->mss)));
-        pcb->ssthresh = 2 * pcb->mss;
+      /* Let the congestion control algorithm reduce ssthresh */
+      pcb->cc_ops->on_loss(pcb);
+
+#if LWIP_TCP_SACK_IN
+      if (pcb->flags & TF_SACK) {
+        /* RFC 6675: no window inflation, the SACK scoreboard tells how much
+           data is still in flight. Recovery lasts until all data sent so far
+           has been acknowledged. */
+        pcb->cwnd = pcb->ssthresh;
+        pcb->recovery_point = pcb->snd_nxt;
+        seg->flags |= TF_SEG_SACK_RXT;
+      } else
+#endif /* LWIP_TCP_SACK_IN */
+      {
+        pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
       }
-
-      pcb->cwnd = pcb->ssthresh + 3 * pcb->mss;
       tcp_set_flags(pcb, TF_INFR);
 
       /* Reset the retransmission timer to prevent immediate rto retransmissions */
       pcb->rtime = 0;
     }
   }
+#if LWIP_TCP_SACK_IN
+  if ((pcb->flags & (TF_INFR | TF_SACK)) == (TF_INFR | TF_SACK)) {
+    tcp_sack_rexmit_lost(pcb);
+  }
+#endif /* LWIP_TCP_SACK_IN */
+}
+
+#if LWIP_TCP_SACK_IN
+/**
+ * Requeue lost segments while the congestion window allows (RFC 6675).
+ *
+ * A segment is lost if enough data above it has been SACKed. The amount of
+ * data in flight ("pipe") counts every segment that is neither SACKed nor
+ * lost, plus every segment retransmitted during this recovery. As long as
+ * pipe leaves room for a full segment in cwnd, the lowest lost segment that
+ * has not been retransmitted yet is moved to the unsent queue. Sending new
+ * data is left to tcp_output().
+ *
+ * Called by tcp_receive() for every ACK received in SACK loss recovery.
+ *
+ * @param pcb the tcp_pcb in loss recovery
+ */
+void
+tcp_sack_rexmit_lost(struct tcp_pcb *pcb)
+{
+  struct tcp_seg *seg;
+  struct tcp_seg **useg;
+  u32_t sacked_bytes = 0;
+  u16_t sacked_segs = 0;
+  u32_t above_bytes, pipe = 0;
+  u16_t above_segs;
+
+  LWIP_ASSERT("tcp_sack_rexmit_lost: invalid pcb", pcb != NULL);
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      sacked_bytes += seg->len;
+      sacked_segs++;
+    }
+  }
+
+  /* SetPipe() */
+  above_bytes = sacked_bytes;
+  above_segs = sacked_segs;
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACKED) {
+      above_bytes -= seg->len;
+      above_segs--;
+      continue;
+    }
+    if (!TCP_SACK_IS_LOST(pcb, above_segs, above_bytes)) {
+      pipe += seg->len;
+    }
+    if (seg->flags & TF_SEG_SACK_RXT) {
+      pipe += seg->len;
+    }
+  }
+  /* retransmissions not sent yet are counted as in flight, too */
+  for (seg = pcb->unsent; seg != NULL; seg = seg->next) {
+    if (seg->flags & TF_SEG_SACK_RXT) {
+      pipe += seg->len;
+    }
+  }
+
+  /* NextSeg(): the lowest lost segment not retransmitted yet */
+  above_bytes = sacked_bytes;
+  above_segs = sacked_segs;
+  useg = &pcb->unacked;
+  while (((seg = *useg) != NULL) && (pipe + pcb->mss <= pcb->cwnd)) {
+    if (seg->flags & TF_SEG_SACKED) {
+      above_bytes -= seg->len;
+      above_segs--;
+    } else if (!TCP_SACK_IS_LOST(pcb, above_segs, above_bytes)) {
+      /* nothing above this segment is known to be lost */
+      break;
+    } else if (!(seg->flags & TF_SEG_SACK_RXT)) {
+      LWIP_DEBUGF(TCP_FR_DEBUG, ("tcp_sack_rexmit_lost: retransmit %"U32_F" pipe %"U32_F"\n",
+                                 lwip_ntohl(seg->tcphdr->seqno), pipe));
+      if (tcp_rexmit_unacked(pcb, useg) == ERR_OK) {
+        seg->flags |= TF_SEG_SACK_RXT;
+        pipe += seg->len;
+        /* *useg now references the next segment */
+        continue;
+      }
+    }
+    useg = &seg->next;
+  }
+}
+
+/**
+ * Clear SACK scoreboard flags on all segments of a pcb.
+ *
+ * @param pcb the tcp_pcb to clear the scoreboard of
+ * @param seg_flags TF_SEG_SACKED and/or TF_SEG_SACK_RXT
+ */
+void
+tcp_sack_clear(struct tcp_pcb *pcb, u8_t seg_flags)
+{
+  struct tcp_seg *seg;
+
+  LWIP_ASSERT("tcp_sack_clear: invalid pcb", pcb != NULL);
+
+  for (seg = pcb->unacked; seg != NULL; seg = seg->next) {
+    seg->flags &= (u8_t)~seg_flags;
+  }
+  for (seg = pcb->unsent; seg != NULL; seg = seg->next) {
+    seg->flags &= (u8_t)~seg_flags;
+  }
 }
+#endif /* LWIP_TCP_SACK_IN */
 
 static struct pbuf *
 tcp_output_alloc_header_common(u32_t ackno, u16_t optlen, u16_t datalen,
@@ -61,6 +61,8 @@
 #include "lwip/sys.h"
 #include "lwip/pbuf.h"
 
+#include <string.h>
+
 #if LWIP_DEBUG_TIMERNAMES
 #define HANDLER(x) x, #x
 #else /* LWIP_DEBUG_TIMERNAMES */
@@ -118,18 +120,318 @@ const int lwip_num_cyclic_timers = LWIP_ARRAYSIZE(lwip_cyclic_timers);
 
 #if LWIP_TIMERS && !LWIP_TIMERS_CUSTOM
 
+#if LWIP_TIMER_WHEEL
+/* The wheel has SYS_TIMEO_LEVELS levels of SYS_TIMEO_SLOTS slots, each slot
+ * being a circular list of timers. A timer is linked into the level of the
+ * highest bit group in which its expiry time differs from sys_timeo_now, in
+ * the slot given by that bit group of its expiry time. Once sys_timeo_now
+ * reaches the start of a slot, its timers move down to a lower level or, when
+ * due, to the due list. */
+#define SYS_TIMEO_BITS      5
+#define SYS_TIMEO_SLOTS     (1 << SYS_TIMEO_BITS)
+#define SYS_TIMEO_LEVELS    ((32 + SYS_TIMEO_BITS - 1) / SYS_TIMEO_BITS)
+/** slot index of the list of expired timers waiting to be called */
+#define SYS_TIMEO_DUE       (SYS_TIMEO_LEVELS * SYS_TIMEO_SLOTS)
+/** buckets of the (handler, arg) hash used by sys_untimeout() (power of 2) */
+#define SYS_TIMEO_HASH_BITS 5
+
+static struct sys_timeo *sys_timeo_slots[SYS_TIMEO_DUE + 1];
+/** one bit per non-empty slot of each level */
+static u32_t sys_timeo_bitmap[SYS_TIMEO_LEVELS];
+static struct sys_timeo *sys_timeo_hash[1 << SYS_TIMEO_HASH_BITS];
+/** all timers expiring up to this time are in the due list */
+static u32_t sys_timeo_now;
+static u16_t sys_timeo_count;
+#else /* LWIP_TIMER_WHEEL */
 /** The one and only timeout list */
 static struct sys_timeo *next_timeout;
+#endif /* LWIP_TIMER_WHEEL */
 
 static u32_t current_timeout_due_time;
 
+#if LWIP_TIMER_WHEEL
+static u8_t
+sys_timeo_lowest_bit(u32_t v)
+{
+  u8_t n = 0;
+  if ((v & 0xffff) == 0) {
+    n += 16;
+    v >>= 16;
+  }
+  if ((v & 0xff) == 0) {
+    n += 8;
+    v >>= 8;
+  }
+  if ((v & 0xf) == 0) {
+    n += 4;
+    v >>= 4;
+  }
+  if ((v & 0x3) == 0) {
+    n += 2;
+    v >>= 2;
+  }
+  if ((v & 0x1) == 0) {
+    n += 1;
+  }
+  return n;
+}
+
+static struct sys_timeo **
+sys_timeo_bucket(sys_timeout_handler handler, void *arg)
+{
+  u32_t h = (u32_t)((mem_ptr_t)handler >> 2) ^ (u32_t)((mem_ptr_t)arg >> 2);
+  return &sys_timeo_hash[(u32_t)(h * 0x9E3779B1UL) >> (32 - SYS_TIMEO_HASH_BITS)];
+}
+
+static void
+sys_timeo_hash_remove(struct sys_timeo *t)
+{
+  struct sys_timeo **pt;
+  for (pt = sys_timeo_bucket(t->h, t->arg); *pt != t; pt = &(*pt)->hnext) {
+    LWIP_ASSERT("timer not in hash", *pt != NULL);
+  }
+  *pt = t->hnext;
+}
+
+/** Append a timer to the list of a slot */
+static void
+sys_timeo_link(struct sys_timeo *t, u16_t idx)
+{
+  struct sys_timeo *head = sys_timeo_slots[idx];
+
+  t->slot = idx;
+  if (head == NULL) {
+    t->next = t;
+    t->prev = t;
+    sys_timeo_slots[idx] = t;
+  } else {
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+  }
+  if (idx != SYS_TIMEO_DUE) {
+    sys_timeo_bitmap[idx / SYS_TIMEO_SLOTS] |= (u32_t)1 << (idx % SYS_TIMEO_SLOTS);
+  }
+}
+
+static void
+sys_timeo_unlink(struct sys_timeo *t)
+{
+  u16_t idx = t->slot;
+
+  if (t->next == t) {
+    sys_timeo_slots[idx] = NULL;
+    if (idx != SYS_TIMEO_DUE) {
+      sys_timeo_bitmap[idx / SYS_TIMEO_SLOTS] &= ~((u32_t)1 << (idx % SYS_TIMEO_SLOTS));
+    }
+  } else {
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    if (sys_timeo_slots[idx] == t) {
+      sys_timeo_slots[idx] = t->next;
+    }
+  }
+}
+
+/** Link a timer into the due list or the wheel slot its expiry time maps to */
+static void
+sys_timeo_place(struct sys_timeo *t)
+{
+  u32_t diff;
+  u8_t level = 0;
+
+  if (!TIME_LESS_THAN(sys_timeo_now, t->time)) {
+    sys_timeo_link(t, SYS_TIMEO_DUE);
+    return;
+  }
+  diff = t->time ^ sys_timeo_now;
+  while ((diff >>= SYS_TIMEO_BITS) != 0) {
+    level++;
+  }
+  sys_timeo_link(t, (u16_t)(level * SYS_TIMEO_SLOTS +
+                            ((t->time >> (level * SYS_TIMEO_BITS)) & (SYS_TIMEO_SLOTS - 1))));
+}
+
+/** Find the wheel slot that starts first.
+ * @param start returns the time the slot starts at
+ * @return slot index or SYS_TIMEO_DUE if the wheel is empty
+ */
+static u16_t
+sys_timeo_next_slot(u32_t *start)
+{
+  u8_t level;
+  u8_t slot;
+  u32_t bits;
+
+  /* the slots of a level all start before those of the levels above */
+  for (level = 0; level < SYS_TIMEO_LEVELS; level++) {
+    if (sys_timeo_bitmap[level] != 0) {
+      break;
+    }
+  }
+  if (level == SYS_TIMEO_LEVELS) {
+    return SYS_TIMEO_DUE;
+  }
+  bits = sys_timeo_bitmap[level];
+  slot = sys_timeo_lowest_bit(bits);
+  if (level < SYS_TIMEO_LEVELS - 1) {
+    *start = (sys_timeo_now & ~(((u32_t)SYS_TIMEO_SLOTS << (level * SYS_TIMEO_BITS)) - 1)) |
+             ((u32_t)slot << (level * SYS_TIMEO_BITS));
+  } else {
+    /* the top level wraps around with u32_t: take the nearest slot */
+    *start = (u32_t)slot << (level * SYS_TIMEO_BITS);
+    for (bits &= bits - 1; bits != 0; bits &= bits - 1) {
+      u8_t s = sys_timeo_lowest_bit(bits);
+      u32_t s_start = (u32_t)s << (level * SYS_TIMEO_BITS);
+      if ((u32_t)(s_start - sys_timeo_now) < (u32_t)(*start - sys_timeo_now)) {
+        slot = s;
+        *start = s_start;
+      }
+    }
+  }
+  return (u16_t)(level * SYS_TIMEO_SLOTS + slot);
+}
+
+/** Move the wheel on to the next slot starting no later than 'now' and
+ * redistribute its timers.
+ * @return 1 if a slot was processed, 0 if nothing in the wheel is due by 'now'
+ */
+static int
+sys_timeo_advance(u32_t now)
+{
+  struct sys_timeo *t;
+  u32_t start;
+  u16_t idx;
+
+  if (TIME_LESS_THAN(now, sys_timeo_now)) {
+    /* sys_timeo_sync() already moved on past 'now' (a handler re-armed a
+       timer on an empty wheel), so nothing more is due by 'now' */
+    return 0;
+  }
+  idx = sys_timeo_next_slot(&start);
+  if ((idx == SYS_TIMEO_DUE) || TIME_LESS_THAN(now, start)) {
+    sys_timeo_now = now;
+    return 0;
+  }
+  sys_timeo_now = start;
+  t = sys_timeo_slots[idx];
+  sys_timeo_slots[idx] = NULL;
+  sys_timeo_bitmap[idx / SYS_TIMEO_SLOTS] &= ~((u32_t)1 << (idx % SYS_TIMEO_SLOTS));
+  t->prev->next = NULL;
+  while (t != NULL) {
+    struct sys_timeo *next = t->next;
+    sys_timeo_place(t);
+    t = next;
+  }
+  return 1;
+}
+
+/** Unlink all timers from the wheel and due list (but not from the hash)
+ * @return the timers as NULL-terminated list
+ */
+static struct sys_timeo *
+sys_timeo_take_all(void)
+{
+  struct sys_timeo *list = NULL;
+  u16_t idx;
+
+  /* due timers end up first so they stay in front when placed again */
+  for (idx = 0; idx <= SYS_TIMEO_DUE; idx++) {
+    struct sys_timeo *head = sys_timeo_slots[idx];
+    if (head != NULL) {
+      head->prev->next = list;
+      list = head;
+      sys_timeo_slots[idx] = NULL;
+    }
+  }
+  memset(sys_timeo_bitmap, 0, sizeof(sys_timeo_bitmap));
+  return list;
+}
+
+/** Follow sys_now() where the wheel cannot simply advance: an empty wheel
+ * jumps to 'now', and if the clock went backwards all timers are placed anew.
+ */
+static void
+sys_timeo_sync(u32_t now)
+{
+  if (sys_timeo_count == 0) {
+    sys_timeo_now = now;
+  } else if (TIME_LESS_THAN(now, sys_timeo_now)) {
+    struct sys_timeo *t = sys_timeo_take_all();
+    sys_timeo_now = now;
+    while (t != NULL) {
+      struct sys_timeo *next = t->next;
+      sys_timeo_place(t);
+      t = next;
+    }
+  }
+}
+
+static void
+sys_timeo_add(struct sys_timeo *t)
+{
+  struct sys_timeo **bucket = sys_timeo_bucket(t->h, t->arg);
+
+  t->hnext = *bucket;
+  *bucket = t;
+  sys_timeo_count++;
+  sys_timeo_place(t);
+}
+
+/** Get the timer expiring first */
+static struct sys_timeo *
+sys_timeo_first(void)
+{
+  struct sys_timeo *first, *t;
+  u32_t start;
+  u16_t idx = SYS_TIMEO_DUE;
+
+  if (sys_timeo_slots[SYS_TIMEO_DUE] == NULL) {
+    idx = sys_timeo_next_slot(&start);
+  }
+  first = sys_timeo_slots[idx];
+  if (first != NULL) {
+    for (t = first->next; t != sys_timeo_slots[idx]; t = t->next) {
+      if (TIME_LESS_THAN(t->time, first->time)) {
+        first = t;
+      }
+    }
+  }
+  return first;
+}
+
 #if LWIP_TESTMODE
+/** Remove all timers, returning them as NULL-terminated list */
+struct sys_timeo *
+sys_timeouts_detach(void)
+{
+  struct sys_timeo *list = sys_timeo_take_all();
+  memset(sys_timeo_hash, 0, sizeof(sys_timeo_hash));
+  sys_timeo_count = 0;
+  return list;
+}
+
+/** Add back timers returned by sys_timeouts_detach() */
+void
+sys_timeouts_attach(struct sys_timeo *list)
+{
+  sys_timeo_sync(sys_now());
+  while (list != NULL) {
+    struct sys_timeo *next = list->next;
+    sys_timeo_add(list);
+    list = next;
+  }
+}
+#endif /* LWIP_TESTMODE */
+
+#elif LWIP_TESTMODE /* LWIP_TIMER_WHEEL */
 struct sys_timeo**
 sys_timeouts_get_next_timeout(void)
 {
   return &next_timeout;
 }
-#endif
+#endif /* LWIP_TIMER_WHEEL */
 
 #if LWIP_TCP
 /** global variable that shows if the tcp timer is currently scheduled or not */
@@ -183,7 +485,10 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg, const ch
 sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
 #endif
 {
-  struct sys_timeo *timeout, *t;
+  struct sys_timeo *timeout;
+#if !LWIP_TIMER_WHEEL
+  struct sys_timeo *t;
+#endif /* !LWIP_TIMER_WHEEL */
 
   timeout = (struct sys_timeo *)memp_malloc(MEMP_SYS_TIMEOUT);
   if (timeout == NULL) {
@@ -202,6 +507,9 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
                              (void *)timeout, abs_time, handler_name, (void *)arg));
 #endif /* LWIP_DEBUG_TIMERNAMES */
 
+#if LWIP_TIMER_WHEEL
+  sys_timeo_add(timeout);
+#else /* LWIP_TIMER_WHEEL */
   if (next_timeout == NULL) {
     next_timeout = timeout;
     return;
@@ -218,6 +526,7 @@ sys_timeout_abs(u32_t abs_time, sys_timeout_handler handler, void *arg)
       }
     }
   }
+#endif /* LWIP_TIMER_WHEEL */
 }
 
 /**
@@ -290,13 +599,18 @@ void
 sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
 #endif /* LWIP_DEBUG_TIMERNAMES */
 {
+  u32_t now;
   u32_t next_timeout_time;
 
   LWIP_ASSERT_CORE_LOCKED();
 
   LWIP_ASSERT("Timeout time too long, max is LWIP_UINT32_MAX/4 msecs", msecs <= (LWIP_UINT32_MAX / 4));
 
-  next_timeout_time = (u32_t)(sys_now() + msecs); /* overflow handled by TIME_LESS_THAN macro */ 
+  now = sys_now();
+#if LWIP_TIMER_WHEEL
+  sys_timeo_sync(now);
+#endif /* LWIP_TIMER_WHEEL */
+  next_timeout_time = (u32_t)(now + msecs); /* overflow handled by TIME_LESS_THAN macro */ 
 
 #if LWIP_DEBUG_TIMERNAMES
   sys_timeout_abs(next_timeout_time, handler, arg, handler_name);
@@ -316,6 +630,25 @@ sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
 void
 sys_untimeout(sys_timeout_handler handler, void *arg)
 {
+#if LWIP_TIMER_WHEEL
+  struct sys_timeo *t, *match = NULL;
+
+  LWIP_ASSERT_CORE_LOCKED();
+
+  /* among several matches, the list implementation removes the first to expire */
+  for (t = *sys_timeo_bucket(handler, arg); t != NULL; t = t->hnext) {
+    if ((t->h == handler) && (t->arg == arg) &&
+        ((match == NULL) || TIME_LESS_THAN(t->time, match->time))) {
+      match = t;
+    }
+  }
+  if (match != NULL) {
+    sys_timeo_hash_remove(match);
+    sys_timeo_unlink(match);
+    sys_timeo_count--;
+    memp_free(MEMP_SYS_TIMEOUT, match);
+  }
+#else /* LWIP_TIMER_WHEEL */
   struct sys_timeo *prev_t, *t;
 
   LWIP_ASSERT_CORE_LOCKED();
@@ -337,7 +670,7 @@ sys_untimeout(sys_timeout_handler handler, void *arg)
       return;
     }
   }
-  return;
+#endif /* LWIP_TIMER_WHEEL */
 }
 
 /**
@@ -357,6 +690,9 @@ sys_check_timeouts(void)
 
   /* Process only timers expired at the start of the function. */
   now = sys_now();
+#if LWIP_TIMER_WHEEL
+  sys_timeo_sync(now);
+#endif /* LWIP_TIMER_WHEEL */
 
   do {
     struct sys_timeo *tmptimeout;
@@ -365,6 +701,24 @@ sys_check_timeouts(void)
 
     PBUF_CHECK_FREE_OOSEQ();
 
+#if LWIP_TIMER_WHEEL
+    tmptimeout = sys_timeo_slots[SYS_TIMEO_DUE];
+    if (tmptimeout == NULL) {
+      if (sys_timeo_advance(now)) {
+        continue;
+      }
+      return;
+    }
+    if (TIME_LESS_THAN(now, tmptimeout->time)) {
+      /* re-armed by a handler after the wheel was synced past 'now' */
+      return;
+    }
+
+    /* Timeout has expired */
+    sys_timeo_unlink(tmptimeout);
+    sys_timeo_hash_remove(tmptimeout);
+    sys_timeo_count--;
+#else /* LWIP_TIMER_WHEEL */
     tmptimeout = next_timeout;
     if (tmptimeout == NULL) {
       return;
@@ -376,6 +730,7 @@ sys_check_timeouts(void)
 
     /* Timeout has expired */
     next_timeout = tmptimeout->next;
+#endif /* LWIP_TIMER_WHEEL */
     handler = tmptimeout->h;
     arg = tmptimeout->arg;
     current_timeout_due_time = tmptimeout->time;
@@ -407,6 +762,24 @@ sys_restart_timeouts(void)
   u32_t base;
   struct sys_timeo *t;
 
+#if LWIP_TIMER_WHEEL
+  t = sys_timeo_first();
+  if (t == NULL) {
+    return;
+  }
+
+  now = sys_now();
+  base = t->time;
+
+  t = sys_timeo_take_all();
+  sys_timeo_now = now;
+  while (t != NULL) {
+    struct sys_timeo *next = t->next;
+    t->time = (t->time - base) + now;
+    sys_timeo_place(t);
+    t = next;
+  }
+#else /* LWIP_TIMER_WHEEL */
   if (next_timeout == NULL) {
     return;
   }
@@ -417,6 +790,7 @@ sys_restart_timeouts(void)
   for (t = next_timeout; t != NULL; t = t->next) {
     t->time = (t->time - base) + now;
   }
+#endif /* LWIP_TIMER_WHEEL */
 }
 
 /** Return the time left before the next timeout is due. If no timeouts are
@@ -426,17 +800,23 @@ u32_t
 sys_timeouts_sleeptime(void)
 {
   u32_t now;
+  struct sys_timeo *first;
 
   LWIP_ASSERT_CORE_LOCKED();
 
-  if (next_timeout == NULL) {
+#if LWIP_TIMER_WHEEL
+  first = sys_timeo_first();
+#else /* LWIP_TIMER_WHEEL */
+  first = next_timeout;
+#endif /* LWIP_TIMER_WHEEL */
+  if (first == NULL) {
     return SYS_TIMEOUTS_SLEEPTIME_INFINITE;
   }
   now = sys_now();
-  if (TIME_LESS_THAN(next_timeout->time, now)) {
+  if (TIME_LESS_THAN(first->time, now)) {
     return 0;
   } else {
-    u32_t ret = (u32_t)(next_timeout->time - now);
+    u32_t ret = (u32_t)(first->time - now);
     LWIP_ASSERT("invalid sleeptime", ret <= LWIP_MAX_TIMEOUT);
     return ret;
   }
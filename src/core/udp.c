@@ -80,6 +80,26 @@ static u16_t udp_port = UDP_LOCAL_PORT_RANGE_START;
 /* exported in udp.h (was static) */
 struct udp_pcb *udp_pcbs;
 
+#if LWIP_UDP_PCB_HASH
+#if UDP_PCB_HASH_SIZE & (UDP_PCB_HASH_SIZE - 1)
+#error "UDP_PCB_HASH_SIZE must be a power of 2"
+#endif
+/** PCBs bound to a specific local address, hashed on address and port */
+static struct udp_pcb *udp_pcb_hash[UDP_PCB_HASH_SIZE];
+/** PCBs bound to any local address, hashed on the port */
+static struct udp_pcb *udp_pcb_wild_hash[UDP_PCB_HASH_SIZE];
+
+#define UDP_LOCAL_PORT_RANGE_SIZE ((u32_t)UDP_LOCAL_PORT_RANGE_END - UDP_LOCAL_PORT_RANGE_START + 1)
+#define UDP_PORT_IN_RANGE(port) (((u32_t)(port) - UDP_LOCAL_PORT_RANGE_START) < UDP_LOCAL_PORT_RANGE_SIZE)
+/** One bit per port of the local port range, set while a PCB uses the port */
+static u32_t udp_port_map[(UDP_LOCAL_PORT_RANGE_SIZE + 31) / 32];
+
+#define UDP_PORT_MAP_IDX(port) ((u32_t)(port) - UDP_LOCAL_PORT_RANGE_START)
+#define UDP_PORT_MAP_TEST(port) (udp_port_map[UDP_PORT_MAP_IDX(port) >> 5] & (1UL << (UDP_PORT_MAP_IDX(port) & 31)))
+#define UDP_PORT_MAP_SET(port) (udp_port_map[UDP_PORT_MAP_IDX(port) >> 5] |= (1UL << (UDP_PORT_MAP_IDX(port) & 31)))
+#define UDP_PORT_MAP_CLR(port) (udp_port_map[UDP_PORT_MAP_IDX(port) >> 5] &= ~(1UL << (UDP_PORT_MAP_IDX(port) & 31)))
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * Initialize this module.
  */
@@ -91,6 +111,83 @@ udp_init(void)
 #endif /* LWIP_RAND */
 }
 
+#if LWIP_UDP_PCB_HASH
+static u32_t
+udp_hash_addr(const ip_addr_t *addr)
+{
+#if LWIP_IPV6
+  if (IP_IS_V6(addr)) {
+    const u32_t *a = ip_2_ip6(addr)->addr;
+    return a[0] ^ a[1] ^ a[2] ^ a[3];
+  }
+#endif /* LWIP_IPV6 */
+#if LWIP_IPV4
+  return ip4_addr_get_u32(ip_2_ip4(addr));
+#else /* LWIP_IPV4 */
+  return 0;
+#endif /* LWIP_IPV4 */
+}
+
+/** Returns the chain a PCB bound to addr and port is hashed into */
+static struct udp_pcb **
+udp_hash_chain(const ip_addr_t *addr, u16_t port)
+{
+  u32_t h;
+
+  if (ip_addr_isany(addr)) {
+    return &udp_pcb_wild_hash[port & (UDP_PCB_HASH_SIZE - 1)];
+  }
+  h = (udp_hash_addr(addr) ^ port) * 0x9E3779B1UL;
+  return &udp_pcb_hash[(h ^ (h >> 16)) & (UDP_PCB_HASH_SIZE - 1)];
+}
+
+/** Adds a PCB to the hash tables, keyed on its current local address and port */
+static void
+udp_hash_insert(struct udp_pcb *pcb)
+{
+  struct udp_pcb **chain = udp_hash_chain(&pcb->local_ip, pcb->local_port);
+
+  pcb->hash_next = *chain;
+  *chain = pcb;
+  if (UDP_PORT_IN_RANGE(pcb->local_port)) {
+    UDP_PORT_MAP_SET(pcb->local_port);
+  }
+}
+
+/**
+ * Removes a PCB from the hash tables. This must be done before its local
+ * address or port is changed.
+ *
+ * @return 1 if the PCB was hashed (i.e. it is on the udp_pcbs list), 0 if not
+ */
+static u8_t
+udp_hash_remove(struct udp_pcb *pcb)
+{
+  struct udp_pcb **pp;
+  struct udp_pcb *ipcb;
+
+  for (pp = udp_hash_chain(&pcb->local_ip, pcb->local_port); *pp != NULL; pp = &(*pp)->hash_next) {
+    if (*pp == pcb) {
+      *pp = pcb->hash_next;
+      pcb->hash_next = NULL;
+      if (UDP_PORT_IN_RANGE(pcb->local_port)) {
+        /* the port stays in use if another PCB shares it (SO_REUSE or
+           bound to another address) */
+        for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
+          if ((ipcb != pcb) && (ipcb->local_port == pcb->local_port)) {
+            return 1;
+          }
+        }
+        UDP_PORT_MAP_CLR(pcb->local_port);
+      }
+      return 1;
+    }
+  }
+  return 0;
+}
+
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * Allocate a new local UDP port.
  *
@@ -99,6 +196,28 @@ udp_init(void)
 static u16_t
 udp_new_port(void)
 {
+#if LWIP_UDP_PCB_HASH
+  u32_t n;
+  u32_t idx;
+
+  /* continue after the last allocated port, skipping fully used words of the map */
+  for (n = 0; n < UDP_LOCAL_PORT_RANGE_SIZE; n++) {
+    if (udp_port++ == UDP_LOCAL_PORT_RANGE_END) {
+      udp_port = UDP_LOCAL_PORT_RANGE_START;
+    }
+    idx = UDP_PORT_MAP_IDX(udp_port);
+    if (((idx & 31) == 0) && (udp_port_map[idx >> 5] == 0xFFFFFFFFUL) &&
+        ((u32_t)UDP_LOCAL_PORT_RANGE_END - udp_port >= 31)) {
+      udp_port = (u16_t)(udp_port + 31);
+      n += 31;
+      continue;
+    }
+    if (!UDP_PORT_MAP_TEST(udp_port)) {
+      return udp_port;
+    }
+  }
+  return 0;
+#else /* LWIP_UDP_PCB_HASH */
   u16_t n = 0;
   struct udp_pcb *pcb;
 
@@ -116,6 +235,7 @@ again:
     }
   }
   return udp_port;
+#endif /* LWIP_UDP_PCB_HASH */
 }
 
 /** Common code to see if the current input packet matches the pcb
@@ -178,6 +298,33 @@ udp_input_local_match(struct udp_pcb *pcb, struct netif *inp, u8_t broadcast)
   return 0;
 }
 
+#if LWIP_UDP_PCB_HASH
+/**
+ * Looks up the PCB an incoming unicast datagram belongs to in one hash chain.
+ * A fully matching (connected) PCB is returned, the first matching
+ * unconnected PCB is stored in uncon_pcb if that is still NULL.
+ */
+static struct udp_pcb *
+udp_hash_input_match(struct udp_pcb *pcb, u16_t src, u16_t dest, struct netif *inp,
+                     struct udp_pcb **uncon_pcb)
+{
+  for (; pcb != NULL; pcb = pcb->hash_next) {
+    if ((pcb->local_port == dest) &&
+        (udp_input_local_match(pcb, inp, 0) != 0)) {
+      if (((pcb->flags & UDP_FLAGS_CONNECTED) == 0) && (*uncon_pcb == NULL)) {
+        *uncon_pcb = pcb;
+      }
+      if ((pcb->remote_port == src) &&
+          (ip_addr_isany_val(pcb->remote_ip) ||
+           ip_addr_cmp(&pcb->remote_ip, ip_current_src_addr()))) {
+        return pcb;
+      }
+    }
+  }
+  return NULL;
+}
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * Process an incoming UDP datagram.
  *
@@ -246,6 +393,19 @@ udp_input(struct pbuf *p, struct netif *inp)
   pcb = NULL;
   prev = NULL;
   uncon_pcb = NULL;
+#if LWIP_UDP_PCB_HASH
+  if (!broadcast) {
+    /* Unicast and multicast only match PCBs bound to the destination address
+     * or to any address: look in the exact chain first so that PCBs bound to
+     * the specific address are preferred, then in the wildcard chain. */
+    pcb = udp_hash_input_match(*udp_hash_chain(ip_current_dest_addr(), dest),
+                               src, dest, inp, &uncon_pcb);
+    if (pcb == NULL) {
+      pcb = udp_hash_input_match(*udp_hash_chain(IP_ANY_TYPE, dest),
+                                 src, dest, inp, &uncon_pcb);
+    }
+  } else
+#endif /* LWIP_UDP_PCB_HASH */
   /* Iterate through the UDP pcb list for a matching pcb.
    * 'Perfect match' pcbs (connected to the remote port & ip address) are
    * preferred. If no perfect match is found, the first unconnected pcb that
@@ -908,6 +1068,44 @@ udp_sendto_if_src_chksum(struct udp_pcb *pcb, struct pbuf *p, const ip_addr_t *d
   return err;
 }
 
+#if LWIP_UDP_PCB_HASH
+/** Finds a PCB other than pcb that prevents binding pcb to ipaddr and port.
+ * With SO_REUSE, binding is allowed if *all* PCBs with that port have the
+ * REUSEADDR flag set.
+ *
+ * @param chain first PCB to check
+ * @param hash_chain 1 to follow hash_next, 0 to follow next (whole list)
+ */
+static struct udp_pcb *
+udp_bind_conflict(struct udp_pcb *pcb, struct udp_pcb *chain, const ip_addr_t *ipaddr,
+                  u16_t port, u8_t hash_chain)
+{
+  struct udp_pcb *ipcb;
+
+  for (ipcb = chain; ipcb != NULL; ipcb = (hash_chain ? ipcb->hash_next : ipcb->next)) {
+    if (pcb != ipcb) {
+#if SO_REUSE
+      if (!ip_get_option(pcb, SOF_REUSEADDR) ||
+          !ip_get_option(ipcb, SOF_REUSEADDR))
+#endif /* SO_REUSE */
+      {
+        if ((ipcb->local_port == port) &&
+            (ip_addr_cmp(&ipcb->local_ip, ipaddr) || ip_addr_isany(ipaddr) ||
+             ip_addr_isany(&ipcb->local_ip))) {
+          return ipcb;
+        }
+      }
+    }
+  }
+  return NULL;
+}
+
+/* A rebound PCB keeps its previous binding if the new one fails */
+#define UDP_BIND_UNDO_REMOVE(pcb, rebind) do { if (rebind) { udp_hash_insert(pcb); } } while(0)
+#else /* LWIP_UDP_PCB_HASH */
+#define UDP_BIND_UNDO_REMOVE(pcb, rebind)
+#endif /* LWIP_UDP_PCB_HASH */
+
 /**
  * @ingroup udp_raw
  * Bind an UDP PCB.
@@ -954,6 +1152,11 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   ip_addr_debug_print(UDP_DEBUG | LWIP_DBG_TRACE, ipaddr);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE, (", port = %"U16_F")\n", port));
 
+#if LWIP_UDP_PCB_HASH
+  /* a PCB is hashed exactly while it is on the active list; take it out of
+     the hash while its address and port may change */
+  rebind = udp_hash_remove(pcb);
+#else /* LWIP_UDP_PCB_HASH */
   rebind = 0;
   /* Check for double bind and rebind of the same pcb */
   for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
@@ -963,6 +1166,7 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
       break;
     }
   }
+#endif /* LWIP_UDP_PCB_HASH */
 
 #if LWIP_IPV6 && LWIP_IPV6_SCOPES
   /* If the given IP address should have a zone but doesn't, assign one now.
@@ -982,9 +1186,32 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     if (port == 0) {
       /* no more ports available in local range */
       LWIP_DEBUGF(UDP_DEBUG, ("udp_bind: out of free UDP ports\n"));
+      UDP_BIND_UNDO_REMOVE(pcb, rebind);
       return ERR_USE;
     }
   } else {
+#if LWIP_UDP_PCB_HASH
+    /* Another PCB can only conflict if it uses the port at all: for ports in
+       the local range, the port map tells. Otherwise, a specific address
+       can only conflict with PCBs in its own chain or in the wildcard chain. */
+    if (UDP_PORT_IN_RANGE(port) && !UDP_PORT_MAP_TEST(port)) {
+      ipcb = NULL;
+    } else if (!ip_addr_isany(ipaddr)) {
+      ipcb = udp_bind_conflict(pcb, *udp_hash_chain(ipaddr, port), ipaddr, port, 1);
+      if (ipcb == NULL) {
+        ipcb = udp_bind_conflict(pcb, *udp_hash_chain(IP_ANY_TYPE, port), ipaddr, port, 1);
+      }
+    } else {
+      ipcb = udp_bind_conflict(pcb, udp_pcbs, ipaddr, port, 0);
+    }
+    if (ipcb != NULL) {
+      /* other PCB already binds to this local IP and port */
+      LWIP_DEBUGF(UDP_DEBUG,
+                  ("udp_bind: local port %"U16_F" already bound by another pcb\n", port));
+      UDP_BIND_UNDO_REMOVE(pcb, rebind);
+      return ERR_USE;
+    }
+#else /* LWIP_UDP_PCB_HASH */
     for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
       if (pcb != ipcb) {
         /* By default, we don't allow to bind to a port that any other udp
@@ -1008,6 +1235,7 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
         }
       }
     }
+#endif /* LWIP_UDP_PCB_HASH */
   }
 
   ip_addr_set_ipaddr(&pcb->local_ip, ipaddr);
@@ -1020,6 +1248,9 @@ udp_bind(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
     pcb->next = udp_pcbs;
     udp_pcbs = pcb;
   }
+#if LWIP_UDP_PCB_HASH
+  udp_hash_insert(pcb);
+#endif /* LWIP_UDP_PCB_HASH */
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, ("udp_bind: bound to "));
   ip_addr_debug_print_val(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, pcb->local_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->local_port));
@@ -1070,7 +1301,9 @@ udp_bind_netif(struct udp_pcb *pcb, const struct netif *netif)
 err_t
 udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
 {
+#if !LWIP_UDP_PCB_HASH
   struct udp_pcb *ipcb;
+#endif /* !LWIP_UDP_PCB_HASH */
 
   LWIP_ASSERT_CORE_LOCKED();
 
@@ -1102,6 +1335,10 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
                           pcb->remote_ip);
   LWIP_DEBUGF(UDP_DEBUG | LWIP_DBG_TRACE | LWIP_DBG_STATE, (", port %"U16_F")\n", pcb->remote_port));
 
+#if !LWIP_UDP_PCB_HASH
+  /* With LWIP_UDP_PCB_HASH, this is not needed: udp_bind() above put the
+     PCB on the list if it had no local port yet, and a PCB with a local
+     port is always on the list. */
   /* Insert UDP PCB into the list of active UDP PCBs. */
   for (ipcb = udp_pcbs; ipcb != NULL; ipcb = ipcb->next) {
     if (pcb == ipcb) {
@@ -1112,6 +1349,7 @@ udp_connect(struct udp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
   /* PCB not yet on the list, add PCB now */
   pcb->next = udp_pcbs;
   udp_pcbs = pcb;
+#endif /* !LWIP_UDP_PCB_HASH */
   return ERR_OK;
 }
 
@@ -1185,6 +1423,9 @@ udp_remove(struct udp_pcb *pcb)
   LWIP_ERROR("udp_remove: invalid pcb", pcb != NULL, return);
 
   mib2_udp_unbind(pcb);
+#if LWIP_UDP_PCB_HASH
+  udp_hash_remove(pcb);
+#endif /* LWIP_UDP_PCB_HASH */
   /* pcb to be removed is first in list? */
   if (udp_pcbs == pcb) {
     /* make list start at 2nd pcb */
@@ -1285,7 +1526,13 @@ void udp_netif_ip_addr_changed(const ip_addr_t *old_addr, const ip_addr_t *new_a
       if (ip_addr_cmp(&upcb->local_ip, old_addr)) {
         /* The PCB is bound to the old ipaddr and
          * is set to bound to the new one instead */
+#if LWIP_UDP_PCB_HASH
+        udp_hash_remove(upcb);
+        ip_addr_copy(upcb->local_ip, *new_addr);
+        udp_hash_insert(upcb);
+#else /* LWIP_UDP_PCB_HASH */
         ip_addr_copy(upcb->local_ip, *new_addr);
+#endif /* LWIP_UDP_PCB_HASH */
       }
     }
   }
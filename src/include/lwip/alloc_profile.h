@@ -0,0 +1,91 @@
+/**
+ * @file
+ * Allocation profiler: per call site accounting of heap and pool allocations
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_ALLOC_PROFILE_H
+#define LWIP_HDR_ALLOC_PROFILE_H
+
+#include "lwip/opt.h"
+
+#if LWIP_ALLOC_PROFILE /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Pool number of private pools (LWIP_MEMPOOL_DECLARE) */
+#define ALLOC_PROFILE_CUSTOM_POOL        MEMP_MAX
+/** Pool number of the heap (mem_malloc) */
+#define ALLOC_PROFILE_HEAP               (MEMP_MAX + 1)
+
+/** Lifetime histogram buckets: bucket 0 counts lifetimes below 1 ms,
+ * bucket n those below 4^n ms, the last one all longer lifetimes */
+#define ALLOC_PROFILE_LIFETIME_BUCKETS   8
+
+/** Accounting of one call site */
+struct alloc_profile_site {
+  /** file and line of the call, file is NULL for an unused site */
+  const char *file;
+  int line;
+  /** memp_t the site allocates from or ALLOC_PROFILE_CUSTOM_POOL/_HEAP */
+  u16_t pool;
+  u32_t allocs;
+  u32_t frees;
+  u32_t fails;
+  /** live elements and bytes (requested size) and their high-water marks */
+  u32_t live;
+  u32_t live_max;
+  u32_t bytes;
+  u32_t bytes_max;
+  u32_t lifetime[ALLOC_PROFILE_LIFETIME_BUCKETS];
+};
+
+void alloc_profile_alloc(u16_t pool, void *mem, mem_size_t size, const char *file, const int line);
+void alloc_profile_free(void *mem);
+void alloc_profile_resize(void *mem, mem_size_t size);
+
+void alloc_profile_reset(void);
+const struct alloc_profile_site *alloc_profile_get_site(u16_t idx);
+u32_t alloc_profile_untracked(void);
+void alloc_profile_display(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_ALLOC_PROFILE */
+
+#endif /* LWIP_HDR_ALLOC_PROFILE_H */
@@ -37,6 +37,7 @@
 #include "lwip/api.h"
 #include "lwip/inet.h"
 #include "lwip/mem.h"
+#include "lwip/sys.h"
 #include "lwip/udp.h"
 #include "lwip/igmp.h"
 #include "lwip/arch.h"
@@ -146,8 +147,7 @@ void msg_unpack_delay_resp(const octet_t* buf, msg_delay_resp_t* resp);
 void msg_unpack_pdelay_req(const octet_t* buf, msg_pdelay_req_t* pdelayreq);
 void msg_unpack_pdelay_resp(const octet_t* buf, msg_pdelay_resp_t* presp);
 void msg_unpack_pdelay_resp_followup(const octet_t* buf, msg_pdelay_resp_followup_t* prespfollow);
-void msgUnpackManagement(const octet_t*, msg_management*);
-void msgUnpackManagementPayload(const octet_t *buf, msg_management*manage);
+void msg_unpack_management(const octet_t* buf, msg_management* manage);
 void msg_pack_header(const ptp_clock_t* ptpClock, octet_t* buf);
 void msg_pack_announce(const ptp_clock_t* ptpClock, octet_t* buf);
 void msg_pack_sync(const ptp_clock_t* ptpClock, octet_t* buf, const timestamp_t* originTimestamp);
@@ -157,8 +157,7 @@ void msg_pack_relay_resp(const ptp_clock_t* ptpClock, octet_t* buf, const msg_he
 void msg_pack_pdelay_req(const ptp_clock_t* ptpClock, octet_t* buf, const timestamp_t* originTimestamp);
 void msg_pack_pdelay_resp(octet_t* buf, const msg_header_t* header, const timestamp_t* requestReceiptTimestamp);
 void msg_pack_pdelay_resp_followup(octet_t* buf, const msg_header_t* header, const timestamp_t* responseOriginTimestamp);
-int16_t msgPackManagement(const ptp_clock_t*,  octet_t*, const msg_management*);
-int16_t msgPackManagementResponse(const ptp_clock_t*,  octet_t*, msg_header_t*, const msg_management*);
+int16_t msg_pack_management(const ptp_clock_t* ptpClock, octet_t* buf, int16_t sequence_id, const msg_management* manage);
 /** \}*/
 
 
@@ -171,6 +170,17 @@ void servo_update_peer_delay(ptp_clock_t* clock, const time_interval_t* correcti
 void servo_update_delay(ptp_clock_t* clock, const time_interval_t* delay_event_egress_timestamp, const time_interval_t* recv_timestamp, const time_interval_t* correction_field);
 void servo_update_offset(ptp_clock_t* clock, const time_interval_t* sync_event_ingress_timestamp, const time_interval_t* precise_origin_timestamp, const time_interval_t* correction_field);
 void servo_update_clock(ptp_clock_t* clock);
+
+/**
+ * \brief Select the inbound and outbound latencies for a link speed in Mbit/s
+ */
+void servo_set_link_speed(ptp_clock_t* clock, uint32_t link_speed);
+
+/**
+ * \brief Estimate the delay asymmetry from the next 'samples' Sync messages,
+ * the local clock being 'reference_offset' (NULL for none) off the reference
+ */
+void servo_calibrate_asymmetry(ptp_clock_t* clock, uint16_t samples, const time_interval_t* reference_offset);
 /** \}*/
 
 /** \name startup.c (Linux API dependent)
@@ -179,6 +189,7 @@ void servo_update_clock(ptp_clock_t* clock);
 
 void ptpd_opts_init(void);
 
+void ptpd_opts_set_defaults(ptpd_opts* opts);
 int16_t ptp_startup(ptp_clock_t* clock, ptpd_opts* opts, foreign_master_record_t* foreign);
 void ptpdShutdown(ptp_clock_t*);
 /** \}*/
@@ -204,6 +215,10 @@ void ptp_timer_start(int32_t index,  uint32_t interval_ms);
 bool ptp_timer_expired(int32_t index);
 /** \}*/
 
+#ifndef __INLINE
+#define __INLINE inline
+#endif
+
 /** \name arith.c
  * -Timing management and arithmetic */
 /**\{*/
@@ -242,7 +257,7 @@ void ptp_time_halve(time_interval_t* r);
  * \brief Returns the floor form of binary logarithm for a 32 bit integer.
  * -1 is returned if ''n'' is 0.
  */
-int32_t ptp_floor_log2(uint32_tn);
+int32_t ptp_floor_log2(uint32_t n);
 
 /**
  * \brief return maximum of two numbers
@@ -306,6 +321,28 @@ void bmc_add_foreign(ptp_clock_t* clock, const msg_header_t* header, const msg_a
 /** \}*/
 
 
+/** \name management.c
+ * -Management messages and the data set snapshot */
+/**\{*/
+
+/**
+ * \brief Handle the management message in the input buffer
+ */
+void management_handle(ptp_clock_t* clock);
+
+/**
+ * \brief Publish a snapshot of the data sets, run by the protocol engine
+ */
+void management_publish(ptp_clock_t* clock);
+
+/**
+ * \brief Copy the last published data sets, from any thread, without
+ * blocking the protocol engine
+ */
+void ptpd_get_snapshot(const ptp_clock_t* clock, ptpd_snapshot_t* snapshot);
+/** \}*/
+
+
 /** \name protocol.c
  * -Execute the protocol engine */
 /**\{*/
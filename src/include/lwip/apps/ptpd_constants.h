@@ -180,6 +180,71 @@ enum
   CTRL_OTHER,
 };
 
+/**
+ * \brief Management message actionField (Table 38)
+ */
+enum
+{
+  MM_GET = 0,
+  MM_SET,
+  MM_RESPONSE,
+  MM_COMMAND,
+  MM_ACKNOWLEDGE
+};
+
+/**
+ * \brief TLV types (Table 34)
+ */
+enum
+{
+  TLV_MANAGEMENT = 0x0001,
+  TLV_MANAGEMENT_ERROR_STATUS = 0x0002
+};
+
+/**
+ * \brief Management TLV managementId values (Table 40)
+ */
+enum
+{
+  MM_NULL_MANAGEMENT = 0x0000,
+  MM_DEFAULT_DATA_SET = 0x2000,
+  MM_CURRENT_DATA_SET = 0x2001,
+  MM_PARENT_DATA_SET = 0x2002,
+  MM_TIME_PROPERTIES_DATA_SET = 0x2003,
+  MM_PORT_DATA_SET = 0x2004,
+  MM_PRIORITY1 = 0x2005,
+  MM_PRIORITY2 = 0x2006,
+  MM_DOMAIN = 0x2007,
+  MM_SLAVE_ONLY = 0x2008,
+  MM_LOG_ANNOUNCE_INTERVAL = 0x2009,
+  MM_ANNOUNCE_RECEIPT_TIMEOUT = 0x200A,
+  MM_LOG_SYNC_INTERVAL = 0x200B,
+  MM_VERSION_NUMBER = 0x200C,
+  MM_ENABLE_PORT = 0x200D,
+  MM_DISABLE_PORT = 0x200E,
+  MM_TIME = 0x200F,
+  MM_CLOCK_ACCURACY = 0x2010,
+  MM_UTC_PROPERTIES = 0x2011,
+  MM_TRACEABILITY_PROPERTIES = 0x2012,
+  MM_TIMESCALE_PROPERTIES = 0x2013,
+  MM_DELAY_MECHANISM = 0x6000,
+  MM_LOG_MIN_PDELAY_REQ_INTERVAL = 0x6001
+};
+
+/**
+ * \brief Management error status managementErrorId values (Table 72)
+ */
+enum
+{
+  MM_ERROR_RESPONSE_TOO_BIG = 0x0001,
+  MM_ERROR_NO_SUCH_ID = 0x0002,
+  MM_ERROR_WRONG_LENGTH = 0x0003,
+  MM_ERROR_WRONG_VALUE = 0x0004,
+  MM_ERROR_NOT_SETABLE = 0x0005,
+  MM_ERROR_NOT_SUPPORTED = 0x0006,
+  MM_ERROR_GENERAL_ERROR = 0xFFFE
+};
+
 /**
  * \brief Output statistics
  */
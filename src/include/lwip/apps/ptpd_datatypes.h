@@ -308,7 +308,10 @@ typedef struct
   uint8_t starting_boundary_hops;
   uint8_t boundary_hops;
   enum4bit_t action_field;
-  char* tlv;
+  enum16bit_t tlv_type;
+  uint16_t length_field;
+  enum16bit_t management_id;
+  const octet_t* data_field; /**< points into the unpacked message */
 } msg_management;
 
 
@@ -423,6 +426,7 @@ typedef struct
   enum8bit_t delay_mechanism;
   int8_t log_min_pdelay_req_interval; /**< spec 7.7.2.5 */
   uint4bit_t  versionNumber;
+  time_interval_t delay_asymmetry; /**< spec 7.4.2 */
 } port_ds_t;
 
 
@@ -442,6 +446,20 @@ typedef struct
   int16_t  best;
 } foreign_master_ds_t;
 
+/**
+ * \struct Snapshot
+ * \brief Copy of the data sets served to management
+ */
+
+typedef struct
+{
+  default_ds_t default_ds;
+  current_ds_t current_ds;
+  parent_ds_t parent_ds;
+  time_properties_t time_properties_ds;
+  port_ds_t port_ds;
+} ptpd_snapshot_t;
+
 /**
  * \struct Servo
  * \brief Clock servo filters and PI regulator values
@@ -456,6 +474,32 @@ typedef struct
   int16_t s_offset;
 } ptpd_servo_t;
 
+/**
+ * \struct LinkLatency
+ * \brief PHY latencies at one link speed
+ */
+
+typedef struct
+{
+  uint32_t link_speed; /**< in Mbit/s, 0 terminates a table */
+  int32_t inbound_latency; /**< in nsec */
+  int32_t outbound_latency; /**< in nsec */
+} ptpd_link_latency_t;
+
+/**
+ * \struct Calibration
+ * \brief Delay asymmetry calibration against a reference
+ */
+
+typedef struct
+{
+  uint16_t samples; /**< samples to average, 0 when not calibrating */
+  uint16_t n;
+  int64_t sum;
+  time_interval_t reference_offset; /**< offset of the local clock from the reference */
+  bool no_adjust; /**< servo setting restored at the end of the calibration */
+} ptpd_calibration_t;
+
 /**
  * \struct RunTimeOpts
  * \brief Program options set at run-time
@@ -464,7 +508,9 @@ typedef struct
 typedef struct
 {
   int8_t announce_interval;
+  uint8_t announce_receipt_timeout;
   int8_t sync_interval;
+  int8_t pdelay_req_interval;
   clock_quality_t clock_quality;
   uint8_t  priority1;
   uint8_t  priority2;
@@ -475,6 +521,9 @@ typedef struct
   enum8bit_t stats;
   octet_t addr_unicast[NET_ADDRESS_LENGTH];
   time_interval_t inbound_latency, outbound_latency;
+  const ptpd_link_latency_t* latency_table; /**< NULL for PTPD_DEFAULT_LATENCY_TABLE */
+  time_interval_t delay_asymmetry;
+  uint16_t calibration_samples;
   int16_t max_foreign_records;
   enum8bit_t delay_mechanism;
   ptpd_servo_t servo;
@@ -514,6 +563,7 @@ typedef struct
 
 
   octet_t bfr_msg_out[PACKET_SIZE]; /**< buffer for outgoing message */
+  octet_t bfr_mgmt_out[PACKET_SIZE]; /**< buffer for outgoing management message */
   octet_t bfr_msg_in[PACKET_SIZE]; /** <buffer for incomming message */
   ssize_t msg_bfr_in_len; /**< length of incomming message */
 
@@ -560,8 +610,13 @@ typedef struct
   octet_t port_uuid_field[PTP_UUID_LENGTH]; /**< Usefull to init network stuff */
 
   time_interval_t inbound_latency, outbound_latency;
+  uint32_t link_speed; /**< in Mbit/s, 0 if unknown */
 
   ptpd_servo_t servo;
+  ptpd_calibration_t calibration;
+
+  ptpd_snapshot_t snapshot[2]; /**< double buffered data sets, see ptpd_get_snapshot() */
+  volatile uint32_t snapshot_seq; /**< snapshot[snapshot_seq & 1] is the current one */
 
   int32_t  events;
 
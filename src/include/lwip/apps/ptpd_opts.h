@@ -28,6 +28,28 @@
 #define PTPD_DEFAULT_OUTBOUND_LATENCY 0       /* in nsec */
 #endif
 
+//! PHY latencies per link speed, as { link speed in Mbit/s, inbound ns, outbound ns }
+//! entries terminated by a zero link speed. The entry matching the speed of
+//! the interface replaces PTPD_DEFAULT_INBOUND_LATENCY/OUTBOUND_LATENCY.
+#if !defined(PTPD_DEFAULT_LATENCY_TABLE)
+#define PTPD_DEFAULT_LATENCY_TABLE { { 0, 0, 0 } }
+#endif
+
+//! delayAsymmetry of the port (spec 7.4.2): the master to slave propagation
+//! time minus the mean path delay, positive when the master to slave
+//! direction is the longer one.
+#if !defined(PTPD_DEFAULT_DELAY_ASYMMETRY)
+#define PTPD_DEFAULT_DELAY_ASYMMETRY 0       /* in nsec */
+#endif
+
+//! Number of Sync samples averaged by the delay asymmetry calibration
+//! started at initialization, 0 disables it. While it runs the local clock
+//! must be kept on the reference time by other means (e.g. a GNSS receiver),
+//! the servo does not adjust it.
+#if !defined(PTPD_DEFAULT_CALIBRATION_SAMPLES)
+#define PTPD_DEFAULT_CALIBRATION_SAMPLES 0
+#endif
+
 #if !defined(PTPD_DEFAULT_NO_RESET_CLOCK)
 #define PTPD_DEFAULT_NO_RESET_CLOCK FALSE
 #endif
@@ -233,6 +255,16 @@
 #define PTPD_NO_ADJUST TRUE
 #endif
 
+//! Memory barrier ordering the data set snapshot read by ptpd_get_snapshot()
+//! against its sequence number. Single core targets only need a compiler barrier.
+#if !defined(PTPD_MEMORY_BARRIER)
+#if defined(__GNUC__)
+#define PTPD_MEMORY_BARRIER() __sync_synchronize()
+#else
+#define PTPD_MEMORY_BARRIER()
+#endif
+#endif
+
 /** \name Packet length
  Minimal length values for each message.
  If TLV used length could be higher.*/
@@ -277,4 +309,9 @@
 #define PTPD_MANAGEMENT_LENGTH 48
 #endif
 
+/* tlvType, lengthField and managementId of a management TLV */
+#if !defined(PTPD_MANAGEMENT_TLV_LENGTH)
+#define PTPD_MANAGEMENT_TLV_LENGTH 6
+#endif
+
 #endif
\ No newline at end of file
@@ -240,6 +240,11 @@ typedef int ssize_t;
 #define LWIP_CONST_CAST(target_type, val) ((target_type)((ptrdiff_t)val))
 #endif
 
+/** Storage class of per-thread variables, only needed for MEMP_THREAD_CACHE */
+#ifndef LWIP_THREAD_LOCAL
+#define LWIP_THREAD_LOCAL __thread
+#endif
+
 /** Get rid of alignment cast warnings (GCC -Wcast-align) */
 #ifndef LWIP_ALIGNMENT_CAST
 #define LWIP_ALIGNMENT_CAST(target_type, val) LWIP_CONST_CAST(target_type, val)
@@ -78,6 +78,9 @@ void etharp_tmr(void);
 ssize_t etharp_find_addr(struct netif *netif, const ip4_addr_t *ipaddr,
          struct eth_addr **eth_ret, const ip4_addr_t **ip_ret);
 int etharp_get_entry(size_t i, ip4_addr_t **ipaddr, struct netif **netif, struct eth_addr **eth_ret);
+#if ETHARP_LOCKLESS_READ
+int etharp_lookup_nolock(struct netif *netif, const ip4_addr_t *ipaddr, struct eth_addr *ethaddr);
+#endif /* ETHARP_LOCKLESS_READ */
 err_t etharp_output(struct netif *netif, struct pbuf *q, const ip4_addr_t *ipaddr);
 err_t etharp_query(struct netif *netif, const ip4_addr_t *ipaddr, struct pbuf *q);
 err_t etharp_request(struct netif *netif, const ip4_addr_t *ipaddr);
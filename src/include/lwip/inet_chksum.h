@@ -52,13 +52,28 @@
 #define FOLD_U32T(u)          ((u32_t)(((u) >> 16) + ((u) & 0x0000ffffUL)))
 #endif
 
+#ifndef LWIP_CHKSUM
+# define LWIP_CHKSUM lwip_standard_chksum
+# ifndef LWIP_CHKSUM_ALGORITHM
+#  define LWIP_CHKSUM_ALGORITHM 2
+# endif
+#endif
+/* If none set: */
+#ifndef LWIP_CHKSUM_ALGORITHM
+# define LWIP_CHKSUM_ALGORITHM 0
+#endif
+
 #if LWIP_CHECKSUM_ON_COPY
 /** Function-like macro: same as MEMCPY but returns the checksum of copied data
     as u16_t */
 # ifndef LWIP_CHKSUM_COPY
 #  define LWIP_CHKSUM_COPY(dst, src, len) lwip_chksum_copy(dst, src, len)
 #  ifndef LWIP_CHKSUM_COPY_ALGORITHM
-#   define LWIP_CHKSUM_COPY_ALGORITHM 1
+#   if LWIP_CHKSUM_ALGORITHM == 4
+#    define LWIP_CHKSUM_COPY_ALGORITHM 2
+#   else
+#    define LWIP_CHKSUM_COPY_ALGORITHM 1
+#   endif
 #  endif /* LWIP_CHKSUM_COPY_ALGORITHM */
 # else /* LWIP_CHKSUM_COPY */
 #  define LWIP_CHKSUM_COPY_ALGORITHM 0
@@ -71,6 +86,18 @@
 extern "C" {
 #endif
 
+#if LWIP_CHKSUM_ALGORITHM
+u16_t lwip_standard_chksum(const void *dataptr, int len);
+#endif /* LWIP_CHKSUM_ALGORITHM */
+#if LWIP_CHKSUM_ALGORITHM == 4
+/** A routine summing len bytes at dataptr like lwip_standard_chksum() */
+typedef u16_t (*lwip_chksum_kernel_fn)(const void *dataptr, int len);
+void lwip_chksum_init(void);
+#if LWIP_TESTMODE
+lwip_chksum_kernel_fn lwip_chksum_get_kernel(int i);
+#endif /* LWIP_TESTMODE */
+#endif /* LWIP_CHKSUM_ALGORITHM == 4 */
+
 u16_t inet_chksum(const void *dataptr, u16_t len);
 u16_t inet_chksum_pbuf(struct pbuf *p);
 #if LWIP_CHKSUM_COPY_ALGORITHM
@@ -71,10 +71,31 @@ typedef u16_t mem_size_t;
 
 void  mem_init(void);
 void *mem_trim(void *mem, mem_size_t size);
+#if LWIP_ALLOC_PROFILE
+void *mem_malloc_fn(mem_size_t size, const char *file, const int line);
+void *mem_calloc_fn(mem_size_t count, mem_size_t size, const char *file, const int line);
+#define mem_malloc(s)    mem_malloc_fn((s), __FILE__, __LINE__)
+#define mem_calloc(c, s) mem_calloc_fn((c), (s), __FILE__, __LINE__)
+#else /* LWIP_ALLOC_PROFILE */
 void *mem_malloc(mem_size_t size);
 void *mem_calloc(mem_size_t count, mem_size_t size);
+#endif /* LWIP_ALLOC_PROFILE */
 void  mem_free(void *mem);
 
+#if LWIP_ALLOC_PROFILE
+/** Free space of the heap as seen by mem_frag_info() */
+struct mem_frag_info {
+  /** bytes that could still be allocated, summed over all free blocks */
+  mem_size_t free;
+  /** largest block that can be allocated in one piece */
+  mem_size_t largest;
+  /** number of free blocks (heap) or free page runs (slab) */
+  mem_size_t blocks;
+};
+void  mem_frag_info(struct mem_frag_info *info);
+void  mem_map_display(void);
+#endif /* LWIP_ALLOC_PROFILE */
+
 #ifdef __cplusplus
 }
 #endif
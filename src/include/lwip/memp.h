@@ -98,6 +98,7 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
   LWIP_MEMPOOL_DECLARE_STATS_INSTANCE(memp_stats_ ## name) \
     \
   static struct memp *memp_tab_ ## name; \
+  LWIP_MEMPOOL_DECLARE_SHARED_INSTANCE(memp_shared_ ## name) \
     \
   const struct memp_desc memp_ ## name = { \
     DECLARE_LWIP_MEMPOOL_DESC(desc) \
@@ -106,6 +107,7 @@ extern const struct memp_desc* const memp_pools[MEMP_MAX];
     (num), \
     memp_memory_ ## name ## _base, \
     &memp_tab_ ## name \
+    LWIP_MEMPOOL_DECLARE_SHARED_REFERENCE(memp_shared_ ## name) \
   };
 
 #endif /* MEMP_MEM_MALLOC */
@@ -140,13 +142,16 @@ struct memp_malloc_helper
 
 void  memp_init(void);
 
-#if MEMP_OVERFLOW_CHECK
+#if MEMP_OVERFLOW_CHECK || LWIP_ALLOC_PROFILE
 void *memp_malloc_fn(memp_t type, const char* file, const int line);
 #define memp_malloc(t) memp_malloc_fn((t), __FILE__, __LINE__)
 #else
 void *memp_malloc(memp_t type);
 #endif
 void  memp_free(memp_t type, void *mem);
+#if MEMP_THREAD_CACHE
+void  memp_thread_cache_flush(void);
+#endif /* MEMP_THREAD_CACHE */
 
 #ifdef __cplusplus
 }
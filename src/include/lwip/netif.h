@@ -105,6 +105,10 @@ extern "C" {
 /** If set, the netif has MLD6 capability.
  * Set by the netif driver in its init function. */
 #define NETIF_FLAG_MLD6         0x40U
+/** If set, the netif segments TCP super-segments (pbuf->gso_size != 0)
+ * itself, e.g. in hardware (TSO). Otherwise, they are split in software.
+ * Set by the netif driver in its init function. */
+#define NETIF_FLAG_GSO          0x80U
 
 /**
  * @}
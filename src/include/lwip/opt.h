@@ -120,6 +120,16 @@
 #if !defined LWIP_TIMERS_CUSTOM || defined __DOXYGEN__
 #define LWIP_TIMERS_CUSTOM              0
 #endif
+
+/**
+ * LWIP_TIMER_WHEEL==1: Keep sys_timeout() timers in a hierarchical timer wheel
+ * instead of a sorted list. sys_timeout() and sys_untimeout() then take
+ * constant time regardless of the number of timers, at the cost of ~1 KByte
+ * of RAM for the wheel. Expiry times stay exact to the millisecond.
+ */
+#if !defined LWIP_TIMER_WHEEL || defined __DOXYGEN__
+#define LWIP_TIMER_WHEEL                0
+#endif
 /**
  * @}
  */
@@ -280,6 +290,29 @@
 #define MEMP_MEM_INIT                   0
 #endif
 
+/**
+ * MEMP_THREAD_CACHE==1: Put a per-thread cache of free elements (a
+ * "magazine") in front of each pool from memp_std.h and make the shared
+ * free lists of all pools lock-free, so pools are not protected with
+ * SYS_ARCH_PROTECT any more. Meant for multi-core ports where
+ * SYS_ARCH_PROTECT is a global lock. Needs a compiler with GCC-style __atomic
+ * builtins, 64-bit atomics and thread-local storage (see LWIP_THREAD_LOCAL),
+ * and must not be used if pools are accessed from interrupts.
+ * Pools with less than 4 * MEMP_THREAD_CACHE_SIZE elements are not cached.
+ * Threads that exit should call memp_thread_cache_flush() first.
+ */
+#if !defined MEMP_THREAD_CACHE || defined __DOXYGEN__
+#define MEMP_THREAD_CACHE               0
+#endif
+
+/**
+ * MEMP_THREAD_CACHE_SIZE: maximum number of free elements per pool cached by
+ * each thread. Half of it is moved from or to the shared pool at once.
+ */
+#if !defined MEMP_THREAD_CACHE_SIZE || defined __DOXYGEN__
+#define MEMP_THREAD_CACHE_SIZE          16
+#endif
+
 /**
  * MEM_ALIGNMENT: should be set to the alignment of the CPU
  *    4 byte alignment -> \#define MEM_ALIGNMENT 4
@@ -357,6 +390,28 @@
 #define MEM_USE_POOLS_TRY_BIGGER_POOL   0
 #endif
 
+/**
+ * MEM_SLAB==1: Replace the first-fit heap by a segregated size-class (slab)
+ * allocator working on the same ram heap. The heap is cut into pages of
+ * MEM_SLAB_PAGE_SIZE bytes; a slab of up to four pages is split into objects
+ * of one size class, requests larger than two pages get a run of whole pages.
+ * mem_malloc() and mem_free() run in constant time for small sizes and the
+ * heap cannot fragment below page granularity.
+ * MEM_OVERFLOW_CHECK and MEM_SANITY_CHECK are not supported with this backend.
+ */
+#if !defined MEM_SLAB || defined __DOXYGEN__
+#define MEM_SLAB                        0
+#endif
+
+/**
+ * MEM_SLAB_PAGE_SIZE: size of a MEM_SLAB page in bytes. Must be a power of
+ * two from 64 to 8192 and MEM_SIZE must hold at least two pages. Allocations
+ * larger than two pages are rounded up to whole pages.
+ */
+#if !defined MEM_SLAB_PAGE_SIZE || defined __DOXYGEN__
+#define MEM_SLAB_PAGE_SIZE              1024
+#endif
+
 /**
  * MEMP_USE_CUSTOM_POOLS==1: whether to include a user file lwippools.h
  * that defines additional pools beyond the "standard" ones required
@@ -452,6 +507,16 @@
 #define MEMP_NUM_TCP_SEG                16
 #endif
 
+/**
+ * MEMP_NUM_TCP_ZC_REF: the number of pbuf slices simultaneously referencing
+ * application buffers handed to tcp_write_pbuf(). Each queued segment uses
+ * one slice per pbuf of the application chain it covers.
+ * (requires the LWIP_TCP_ZEROCOPY option)
+ */
+#if !defined MEMP_NUM_TCP_ZC_REF || defined __DOXYGEN__
+#define MEMP_NUM_TCP_ZC_REF             MEMP_NUM_TCP_SEG
+#endif
+
 /**
  * MEMP_NUM_ALTCP_PCB: the number of simultaneously active altcp layer pcbs.
  * (requires the LWIP_ALTCP option)
@@ -541,6 +606,23 @@
 #define MEMP_NUM_SELECT_CB              4
 #endif
 
+/**
+ * MEMP_NUM_EPOLL: the number of epoll instances (lwip_epoll_create()).
+ * (only needed if you use LWIP_SOCKET_EPOLL)
+ */
+#if !defined MEMP_NUM_EPOLL || defined __DOXYGEN__
+#define MEMP_NUM_EPOLL                  1
+#endif
+
+/**
+ * MEMP_NUM_EPOLL_ITEM: the number of struct lwip_epoll_item, one per socket
+ * registered with an epoll instance (lwip_epoll_ctl(EPOLL_CTL_ADD)).
+ * (only needed if you use LWIP_SOCKET_EPOLL)
+ */
+#if !defined MEMP_NUM_EPOLL_ITEM || defined __DOXYGEN__
+#define MEMP_NUM_EPOLL_ITEM             MEMP_NUM_NETCONN
+#endif
+
 /**
  * MEMP_NUM_TCPIP_MSG_API: the number of struct tcpip_msg, which are used
  * for callback/timeout API communication.
@@ -559,6 +641,16 @@
 #define MEMP_NUM_TCPIP_MSG_INPKT        8
 #endif
 
+/**
+ * MEMP_NUM_TCPIP_MSG_INPKT_BATCH: the number of batch input messages
+ * (LWIP_TCPIP_BATCH_INPUT), each carrying up to TCPIP_BATCH_INPUT_MAX
+ * packets.
+ * (only needed if you use tcpip.c)
+ */
+#if !defined MEMP_NUM_TCPIP_MSG_INPKT_BATCH || defined __DOXYGEN__
+#define MEMP_NUM_TCPIP_MSG_INPKT_BATCH  4
+#endif
+
 /**
  * MEMP_NUM_NETDB: the number of concurrently running lwip_addrinfo() calls
  * (before freeing the corresponding memory using lwip_freeaddrinfo()).
@@ -644,6 +736,39 @@
 #define ARP_MAXAGE                      300
 #endif
 
+/**
+ * ETHARP_TABLE_HASH_SIZE: if > 0, the ARP table is indexed by a hash of the
+ * IP address with this many buckets (a power of 2), so that lookups don't
+ * scan the table and ARP_TABLE_SIZE can go up to NETIF_ADDR_IDX_MAX.
+ * etharp_tmr() then only walks the pending and re-requesting entries and
+ * checks ETHARP_AGE_SLICE entries for expiry per call; stable entries that
+ * expired in between are dropped when they are looked up.
+ */
+#if !defined ETHARP_TABLE_HASH_SIZE || defined __DOXYGEN__
+#define ETHARP_TABLE_HASH_SIZE          0
+#endif
+
+/**
+ * ETHARP_AGE_SLICE: number of ARP table entries etharp_tmr() checks for
+ * expiry per call when ETHARP_TABLE_HASH_SIZE > 0. The whole table is swept
+ * every ARP_TABLE_SIZE / ETHARP_AGE_SLICE calls.
+ */
+#if !defined ETHARP_AGE_SLICE || defined __DOXYGEN__
+#define ETHARP_AGE_SLICE                ((ARP_TABLE_SIZE + 7) / 8)
+#endif
+
+/**
+ * ETHARP_LOCKLESS_READ==1: enable etharp_lookup_nolock(), which finds the
+ * Ethernet address of a stable ARP entry without the core lock (e.g. from a
+ * driver or another thread). Writers bump a sequence counter that readers
+ * check, so reads never block; a read that keeps racing with writers gives
+ * up and reports the entry as not found. Needs ETHARP_TABLE_HASH_SIZE > 0 and a
+ * compiler with GCC-style __atomic builtins.
+ */
+#if !defined ETHARP_LOCKLESS_READ || defined __DOXYGEN__
+#define ETHARP_LOCKLESS_READ            0
+#endif
+
 /**
  * ARP_QUEUEING==1: Multiple outgoing packets are queued during hardware address
  * resolution. By default, only the most recent packet is queued per IP address.
@@ -1187,6 +1312,26 @@
 #define LWIP_UDPLITE                    0
 #endif
 
+/**
+ * LWIP_UDP_PCB_HASH==1: find the pcb of an incoming datagram through hash
+ * tables instead of walking udp_pcbs: pcbs bound to a specific address are
+ * hashed on address and local port, pcbs bound to any address go to a
+ * separate wildcard table hashed on the port. Local ports are allocated from
+ * a bitmap of the local port range (2 KB for the default range).
+ * IPv4 broadcasts are still matched by walking the list.
+ */
+#if !defined LWIP_UDP_PCB_HASH || defined __DOXYGEN__
+#define LWIP_UDP_PCB_HASH               0
+#endif
+
+/**
+ * UDP_PCB_HASH_SIZE: number of buckets of each of the UDP hash tables used
+ * with LWIP_UDP_PCB_HASH. Must be a power of 2.
+ */
+#if !defined UDP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define UDP_PCB_HASH_SIZE               64
+#endif
+
 /**
  * UDP_TTL: Default Time-To-Live value.
  */
@@ -1282,6 +1427,120 @@
 #define LWIP_TCP_MAX_SACK_NUM           4
 #endif
 
+/**
+ * LWIP_TCP_SACK_IN==1: TCP will process selective acknowledgements (SACKs)
+ * received from the remote host: SACK blocks are recorded in a scoreboard on
+ * the unacked queue and fast recovery follows RFC 6675, so multiple losses in
+ * one window are repaired within one round trip instead of one per RTT.
+ * SACK is negotiated by LWIP_TCP_SACK_OUT, which therefore must be enabled, too.
+ */
+#if !defined LWIP_TCP_SACK_IN || defined __DOXYGEN__
+#define LWIP_TCP_SACK_IN                0
+#endif
+
+/**
+ * LWIP_TCP_CC_CUBIC==1: Build the CUBIC congestion control algorithm (RFC 8312),
+ * selectable per connection with tcp_set_cc() or the TCP_CONGESTION socket option.
+ * CUBIC grows the window independent of the RTT, which fills long fat pipes
+ * much faster than NewReno's linear growth.
+ */
+#if !defined LWIP_TCP_CC_CUBIC || defined __DOXYGEN__
+#define LWIP_TCP_CC_CUBIC               0
+#endif
+
+/**
+ * TCP_CC_DEFAULT: The congestion control algorithm new pcbs start with
+ * (tcp_cc_newreno or, with LWIP_TCP_CC_CUBIC, tcp_cc_cubic).
+ */
+#if !defined TCP_CC_DEFAULT || defined __DOXYGEN__
+#define TCP_CC_DEFAULT                  tcp_cc_newreno
+#endif
+
+/**
+ * LWIP_TCP_ZEROCOPY==1: Provide tcp_write_pbuf(), which enqueues an application
+ * pbuf without copying it. The stack takes over the caller's reference and
+ * frees the pbuf once all of its data has been acknowledged, so a pbuf_custom
+ * free function serves as the send completion callback.
+ */
+#if !defined LWIP_TCP_ZEROCOPY || defined __DOXYGEN__
+#define LWIP_TCP_ZEROCOPY               0
+#endif
+
+/**
+ * LWIP_TCP_GSO==1: Generic segmentation offload. For connections routed over a
+ * netif with NETIF_FLAG_GSO set, tcp_write() combines data into super-segments
+ * of up to TCP_GSO_MAX_SIZE bytes, which are passed down as one packet marked
+ * with pbuf->gso_size and segmented by the netif (e.g. TSO hardware). This
+ * saves the per-segment cost of tcp_output() and the IP layer. Super-segments
+ * that end up on another netif (route change, loopback) are split in software
+ * right before netif->output.
+ */
+#if !defined LWIP_TCP_GSO || defined __DOXYGEN__
+#define LWIP_TCP_GSO                    0
+#endif
+
+/**
+ * TCP_GSO_MAX_SIZE: The maximum amount of data in a TCP super-segment. The
+ * default leaves room for all headers in a 64 KByte pbuf.
+ */
+#if !defined TCP_GSO_MAX_SIZE || defined __DOXYGEN__
+#define TCP_GSO_MAX_SIZE                (0xFFFF - (PBUF_LINK_ENCAPSULATION_HLEN + PBUF_LINK_HLEN + PBUF_IP_HLEN + PBUF_TRANSPORT_HLEN + 40))
+#endif
+
+/**
+ * LWIP_TCP_GRO==1: Generic receive offload. ethernet_input() holds back TCP
+ * data segments for this host and appends the data of following in-order
+ * segments of the same flow, so that tcp_input() processes, ACKs and passes
+ * to the application a whole batch of received data at once. Held segments
+ * are passed on by gro_flush(), which the tcpip_thread calls whenever its
+ * mbox runs empty (or after TCP_GRO_MAX_BATCH messages). With NO_SYS or
+ * LWIP_TCPIP_CORE_LOCKING_INPUT, call it after each batch of packets passed
+ * to netif->input.
+ */
+#if !defined LWIP_TCP_GRO || defined __DOXYGEN__
+#define LWIP_TCP_GRO                    0
+#endif
+
+/**
+ * TCP_GRO_MAX_FLOWS: The number of TCP flows GRO can hold segments for at
+ * the same time.
+ */
+#if !defined TCP_GRO_MAX_FLOWS || defined __DOXYGEN__
+#define TCP_GRO_MAX_FLOWS               4
+#endif
+
+/**
+ * TCP_GRO_MAX_BATCH: The maximum number of messages the tcpip_thread handles
+ * while holding back segments before it flushes them, processes timeouts
+ * and releases the core lock, even if its mbox is not empty.
+ */
+#if !defined TCP_GRO_MAX_BATCH || defined __DOXYGEN__
+#define TCP_GRO_MAX_BATCH               32
+#endif
+
+/**
+ * LWIP_TCP_TIMER_WHEEL==1: Let the TCP timers skip idle connections. An
+ * established pcb without unacknowledged or unsent data, delayed ACK or
+ * pending close is parked in a wheel of slow timer ticks until its next poll
+ * or keepalive event, so tcp_slowtmr() and tcp_fasttmr() only walk the pcbs
+ * that have timer work to do. Receiving, sending, queueing data or a FIN
+ * (tcp_write(), tcp_close()) and tcp_poll() wake a parked pcb. A parked pcb
+ * is visited at least every TCP_TIMER_WHEEL_SLOTS - 1 slow timer ticks,
+ * which bounds the delay until keepalive settings changed directly in the
+ * pcb take effect.
+ */
+#if !defined LWIP_TCP_TIMER_WHEEL || defined __DOXYGEN__
+#define LWIP_TCP_TIMER_WHEEL            0
+#endif
+
+/**
+ * TCP_TIMER_WHEEL_SLOTS: The number of slow timer ticks covered by the wheel
+ * of LWIP_TCP_TIMER_WHEEL (power of 2).
+ */
+#if !defined TCP_TIMER_WHEEL_SLOTS || defined __DOXYGEN__
+#define TCP_TIMER_WHEEL_SLOTS           64
+#endif
+
 /**
  * TCP_MSS: TCP Maximum segment size. (default is 536, a conservative default,
  * you might want to increase this.)
@@ -1479,6 +1738,33 @@
 #define LWIP_TCP_PCB_NUM_EXT_ARGS       0
 #endif
 
+/**
+ * LWIP_TCP_PCB_HASH==1: demultiplex incoming segments through hash tables
+ * instead of walking the active, TIME-WAIT and listen lists. Connections are
+ * hashed on their 4-tuple, listeners on their local port. This costs one
+ * pointer per pcb plus the bucket arrays and pays off once more than a few
+ * dozen connections are open at a time.
+ */
+#if !defined LWIP_TCP_PCB_HASH || defined __DOXYGEN__
+#define LWIP_TCP_PCB_HASH               0
+#endif
+
+/**
+ * TCP_PCB_HASH_SIZE: number of buckets of the connection hash table used
+ * with LWIP_TCP_PCB_HASH. Must be a power of 2.
+ */
+#if !defined TCP_PCB_HASH_SIZE || defined __DOXYGEN__
+#define TCP_PCB_HASH_SIZE               256
+#endif
+
+/**
+ * TCP_LISTEN_HASH_SIZE: number of buckets of the listener hash table used
+ * with LWIP_TCP_PCB_HASH. Must be a power of 2.
+ */
+#if !defined TCP_LISTEN_HASH_SIZE || defined __DOXYGEN__
+#define TCP_LISTEN_HASH_SIZE            16
+#endif
+
 /** LWIP_ALTCP==1: enable the altcp API.
  * altcp is an abstraction layer that prevents applications linking against the
  * tcp.h functions but provides the same functionality. It is used to e.g. add
@@ -1577,6 +1863,44 @@
 #define LWIP_SINGLE_NETIF               0
 #endif
 
+/**
+ * LWIP_ROUTE_TABLE==1: Enable the static route table (route.c). Routes are
+ * kept in a path-compressed radix trie per IP version and looked up by
+ * longest prefix match. Each route has an outgoing netif, an optional
+ * gateway and a metric; the lowest metric wins among routes with the same
+ * prefix. ip4_route() and ip6_route() consult the table when the destination
+ * is not on the subnet of a netif, and etharp/nd6 send to the gateway of the
+ * matching route.
+ */
+#if !defined LWIP_ROUTE_TABLE || defined __DOXYGEN__
+#define LWIP_ROUTE_TABLE                0
+#endif
+
+/**
+ * MEMP_NUM_ROUTE: the number of routes in the static route table.
+ * (only needed if you use LWIP_ROUTE_TABLE)
+ */
+#if !defined MEMP_NUM_ROUTE || defined __DOXYGEN__
+#define MEMP_NUM_ROUTE                  8
+#endif
+
+/**
+ * MEMP_NUM_ROUTE_NODE: the number of radix trie nodes of the route table.
+ * n distinct prefixes need at most 2n-1 nodes.
+ * (only needed if you use LWIP_ROUTE_TABLE)
+ */
+#if !defined MEMP_NUM_ROUTE_NODE || defined __DOXYGEN__
+#define MEMP_NUM_ROUTE_NODE             (2 * MEMP_NUM_ROUTE)
+#endif
+
+/**
+ * ROUTE_CACHE_SIZE: number of entries of the direct-mapped per-destination
+ * cache in front of the route table. 0 disables the cache.
+ */
+#if !defined ROUTE_CACHE_SIZE || defined __DOXYGEN__
+#define ROUTE_CACHE_SIZE                8
+#endif
+
 /**
  * LWIP_NETIF_HOSTNAME==1: use DHCP_OPTION_HOSTNAME with netif's hostname
  * field.
@@ -1775,6 +2099,24 @@
 #define TCPIP_MBOX_SIZE                 0
 #endif
 
+/**
+ * LWIP_TCPIP_BATCH_INPUT==1: Enable tcpip_inpkt_batch()/tcpip_input_batch(),
+ * which pass a whole burst of received packets to tcpip_thread in one
+ * message, and the receive rings (tcpip_rx_ring_*) a driver fills and
+ * tcpip_thread drains on one wake-up, without a message per packet.
+ */
+#if !defined LWIP_TCPIP_BATCH_INPUT || defined __DOXYGEN__
+#define LWIP_TCPIP_BATCH_INPUT          0
+#endif
+
+/**
+ * TCPIP_BATCH_INPUT_MAX: maximum number of packets in one batch input
+ * message; larger batches are split.
+ */
+#if !defined TCPIP_BATCH_INPUT_MAX || defined __DOXYGEN__
+#define TCPIP_BATCH_INPUT_MAX           16
+#endif
+
 /**
  * Define this to something that triggers a watchdog. This is called from
  * tcpip_thread after processing a message.
@@ -2078,6 +2420,28 @@
 #if !defined LWIP_SOCKET_POLL || defined __DOXYGEN__
 #define LWIP_SOCKET_POLL                1
 #endif
+
+/**
+ * LWIP_SOCKET_MMSG_BATCH: number of datagrams sendmmsg() hands to the
+ * tcpip_thread in one API message (or under one core lock). The netbufs of a
+ * batch live on the caller's stack, so this trades stack usage for fewer
+ * round-trips when sending long vectors of small datagrams.
+ */
+#if !defined LWIP_SOCKET_MMSG_BATCH || defined __DOXYGEN__
+#define LWIP_SOCKET_MMSG_BATCH          8
+#endif
+
+/**
+ * LWIP_SOCKET_EPOLL==1: enable lwip_epoll_create/ctl/wait(). Each socket
+ * keeps the list of epoll registrations interested in it and each epoll
+ * instance a list of ready registrations, so netconn events and
+ * lwip_epoll_wait() only touch ready sockets instead of rescanning every
+ * watched fd like select()/poll() do.
+ * Requires LWIP_SOCKET_SELECT or LWIP_SOCKET_POLL for the event tracking.
+ */
+#if !defined LWIP_SOCKET_EPOLL || defined __DOXYGEN__
+#define LWIP_SOCKET_EPOLL               0
+#endif
 /**
  * @}
  */
@@ -2252,6 +2616,36 @@
 #define MIB2_STATS                      0
 
 #endif /* LWIP_STATS */
+
+/**
+ * LWIP_ALLOC_PROFILE==1: Record every mem_malloc() and memp_malloc() by
+ * call site (file:line and pool): live bytes and elements, their high-water
+ * marks, failed allocations and a histogram of allocation lifetimes.
+ * alloc_profile_display() prints them together with a fragmentation map of
+ * the heap. Meant to size MEM_SIZE and MEMP_NUM_* from real loads; it costs
+ * a table lookup per allocation and free.
+ */
+#if !defined LWIP_ALLOC_PROFILE || defined __DOXYGEN__
+#define LWIP_ALLOC_PROFILE              0
+#endif
+
+/**
+ * ALLOC_PROFILE_MAX_SITES: number of call sites the profiler can tell
+ * apart. Allocations from further call sites are accounted to one
+ * overflow site.
+ */
+#if !defined ALLOC_PROFILE_MAX_SITES || defined __DOXYGEN__
+#define ALLOC_PROFILE_MAX_SITES         32
+#endif
+
+/**
+ * ALLOC_PROFILE_MAX_LIVE: number of live allocations the profiler can
+ * track (power of two). Allocations made while the table is full are only
+ * counted, their bytes and lifetime are not.
+ */
+#if !defined ALLOC_PROFILE_MAX_LIVE || defined __DOXYGEN__
+#define ALLOC_PROFILE_MAX_LIVE          256
+#endif
 /**
  * @}
  */
@@ -2568,6 +2962,17 @@
 #define LWIP_ND6_NUM_DESTINATIONS       10
 #endif
 
+/**
+ * LWIP_ND6_CACHE_HASH_SIZE: if > 0, index the IPv6 neighbor and destination
+ * caches by a hash of the address (this many buckets, must be a power of 2),
+ * so that lookups on output do not scan LWIP_ND6_NUM_NEIGHBORS and
+ * LWIP_ND6_NUM_DESTINATIONS entries. The destination cache is then kept in
+ * least-recently-used order, which replaces the per-tick aging of all its entries.
+ */
+#if !defined LWIP_ND6_CACHE_HASH_SIZE || defined __DOXYGEN__
+#define LWIP_ND6_CACHE_HASH_SIZE        0
+#endif
+
 /**
  * LWIP_ND6_NUM_PREFIXES: number of entries in IPv6 on-link prefixes cache
  */
@@ -50,9 +50,10 @@ extern "C" {
  * pbuf_alloced_custom()) and when pbuf_free gives up their last reference, they
  * are freed by calling pbuf_custom->custom_free_function().
  * Currently, the pbuf_custom code is only needed for one specific configuration
- * of IP_FRAG, unless required by external driver/application code. */
+ * of IP_FRAG and for LWIP_TCP_ZEROCOPY, unless required by external
+ * driver/application code. */
 #ifndef LWIP_SUPPORT_CUSTOM_PBUF
-#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG))
+#define LWIP_SUPPORT_CUSTOM_PBUF ((IP_FRAG && !LWIP_NETIF_TX_SINGLE_PBUF) || (LWIP_IPV6 && LWIP_IPV6_FRAG) || (LWIP_TCP && LWIP_TCP_ZEROCOPY))
 #endif
 
 /** @ingroup pbuf
@@ -181,6 +182,8 @@ typedef enum {
 #define PBUF_FLAG_LLMCAST   0x10U
 /** indicates this pbuf includes a TCP FIN flag */
 #define PBUF_FLAG_TCP_FIN   0x20U
+/** indicates this TCP segment passed GRO, which checked its TCP checksum(s) */
+#define PBUF_FLAG_GRO       0x40U
 
 /** Main packet buffer struct */
 struct pbuf {
@@ -227,6 +230,14 @@ struct pbuf {
   s32_t time_sec;
   s32_t time_nsec;
 #endif
+
+#if LWIP_TCP_GSO
+  /**
+   * For outgoing TCP super-segments, the amount of TCP data in each segment
+   * on the wire (0 for normal packets).
+   */
+  u16_t gso_size;
+#endif /* LWIP_TCP_GSO */
 };
 
 
@@ -311,6 +322,7 @@ struct pbuf *pbuf_clone(pbuf_layer l, pbuf_type type, struct pbuf *p);
 #if LWIP_CHECKSUM_ON_COPY
 err_t pbuf_fill_chksum(struct pbuf *p, u16_t start_offset, const void *dataptr,
                        u16_t len, u16_t *chksum);
+err_t pbuf_take_chksum(struct pbuf *buf, const void *dataptr, u16_t len, u16_t *chksum);
 #endif /* LWIP_CHECKSUM_ON_COPY */
 #if LWIP_TCP && TCP_QUEUE_OOSEQ && LWIP_WND_SCALE
 void pbuf_split_64k(struct pbuf *p, struct pbuf **rest);
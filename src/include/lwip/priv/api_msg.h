@@ -86,6 +86,13 @@ struct api_msg {
   union {
     /** used for lwip_netconn_do_send */
     struct netbuf *b;
+    /** used for lwip_netconn_do_send_batch */
+    struct {
+      struct netbuf *bufs;
+      u16_t cnt;
+      /** output: number of netbufs sent before the first error */
+      u16_t sent;
+    } sb;
     /** used for lwip_netconn_do_newconn */
     struct {
       u8_t proto;
@@ -199,6 +206,7 @@ void lwip_netconn_do_connect         (void *m);
 void lwip_netconn_do_disconnect      (void *m);
 void lwip_netconn_do_listen          (void *m);
 void lwip_netconn_do_send            (void *m);
+void lwip_netconn_do_send_batch      (void *m);
 void lwip_netconn_do_recv            (void *m);
 #if TCP_LISTEN_BACKLOG
 void lwip_netconn_do_accepted        (void *m);
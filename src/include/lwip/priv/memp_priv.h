@@ -127,6 +127,11 @@ struct memp_desc {
 
   /** First free element of each pool. Elements form a linked list. */
   struct memp **tab;
+#if MEMP_THREAD_CACHE
+  /** Lock-free head of the free list: index of the first element and a
+   * counter that changes with every update */
+  u64_t *shared;
+#endif /* MEMP_THREAD_CACHE */
 #endif /* MEMP_MEM_MALLOC */
 };
 
@@ -144,9 +149,17 @@ struct memp_desc {
 #define LWIP_MEMPOOL_DECLARE_STATS_REFERENCE(name)
 #endif
 
+#if MEMP_THREAD_CACHE
+#define LWIP_MEMPOOL_DECLARE_SHARED_INSTANCE(name) static u64_t name;
+#define LWIP_MEMPOOL_DECLARE_SHARED_REFERENCE(name) , &name
+#else
+#define LWIP_MEMPOOL_DECLARE_SHARED_INSTANCE(name)
+#define LWIP_MEMPOOL_DECLARE_SHARED_REFERENCE(name)
+#endif
+
 void memp_init_pool(const struct memp_desc *desc);
 
-#if MEMP_OVERFLOW_CHECK
+#if MEMP_OVERFLOW_CHECK || LWIP_ALLOC_PROFILE
 void *memp_malloc_pool_fn(const struct memp_desc* desc, const char* file, const int line);
 #define memp_malloc_pool(d) memp_malloc_pool_fn((d), __FILE__, __LINE__)
 #else
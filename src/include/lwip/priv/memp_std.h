@@ -51,11 +51,19 @@ LWIP_MEMPOOL(TCP_PCB,        MEMP_NUM_TCP_PCB,         sizeof(struct tcp_pcb),
 LWIP_MEMPOOL(TCP_PCB_LISTEN, MEMP_NUM_TCP_PCB_LISTEN,  sizeof(struct tcp_pcb_listen), "TCP_PCB_LISTEN")
 LWIP_MEMPOOL(TCP_SEG,        MEMP_NUM_TCP_SEG,         sizeof(struct tcp_seg),        "TCP_SEG")
 #endif /* LWIP_TCP */
+#if LWIP_TCP && LWIP_TCP_ZEROCOPY
+LWIP_MEMPOOL(TCP_ZC_REF,     MEMP_NUM_TCP_ZC_REF,      sizeof(struct tcp_zc_ref),     "TCP_ZC_REF")
+#endif /* LWIP_TCP && LWIP_TCP_ZEROCOPY */
 
 #if LWIP_ALTCP && LWIP_TCP
 LWIP_MEMPOOL(ALTCP_PCB,      MEMP_NUM_ALTCP_PCB,       sizeof(struct altcp_pcb),      "ALTCP_PCB")
 #endif /* LWIP_ALTCP && LWIP_TCP */
 
+#if LWIP_ROUTE_TABLE
+LWIP_MEMPOOL(ROUTE,          MEMP_NUM_ROUTE,           sizeof(struct route_entry),    "ROUTE")
+LWIP_MEMPOOL(ROUTE_NODE,     MEMP_NUM_ROUTE_NODE,      sizeof(struct route_node),     "ROUTE_NODE")
+#endif /* LWIP_ROUTE_TABLE */
+
 #if LWIP_IPV4 && IP_REASSEMBLY
 LWIP_MEMPOOL(REASSDATA,      MEMP_NUM_REASSDATA,       sizeof(struct ip_reassdata),   "REASSDATA")
 #endif /* LWIP_IPV4 && IP_REASSEMBLY */
@@ -88,6 +96,12 @@ LWIP_MEMPOOL(NETIFAPI_MSG,   MEMP_NUM_NETIFAPI_MSG,    sizeof(struct netifapi_ms
 #if !LWIP_TCPIP_CORE_LOCKING_INPUT
 LWIP_MEMPOOL(TCPIP_MSG_INPKT,MEMP_NUM_TCPIP_MSG_INPKT, sizeof(struct tcpip_msg),      "TCPIP_MSG_INPKT")
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
+#if LWIP_TCPIP_BATCH_INPUT && !LWIP_TCPIP_CORE_LOCKING_INPUT
+LWIP_MEMPOOL(TCPIP_MSG_INPKT_BATCH, MEMP_NUM_TCPIP_MSG_INPKT_BATCH, sizeof(struct tcpip_inpkt_batch_msg), "TCPIP_MSG_INPKT_BATCH")
+#endif /* LWIP_TCPIP_BATCH_INPUT && !LWIP_TCPIP_CORE_LOCKING_INPUT */
+#if LWIP_SOCKET && LWIP_SOCKET_EPOLL
+LWIP_MEMPOOL(EPOLL_ITEM,     MEMP_NUM_EPOLL_ITEM,      sizeof(struct lwip_epoll_item), "EPOLL_ITEM")
+#endif /* LWIP_SOCKET && LWIP_SOCKET_EPOLL */
 #endif /* NO_SYS==0 */
 
 #if LWIP_IPV4 && LWIP_ARP && ARP_QUEUEING
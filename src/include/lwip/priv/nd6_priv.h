@@ -88,6 +88,10 @@ struct nd6_neighbor_cache_entry {
     u32_t probes_sent;
     u32_t stale_time;     /* ticks (ND6_TMR_INTERVAL) */
   } counter;
+#if LWIP_ND6_CACHE_HASH_SIZE
+  /** next entry in the same hash bucket (index + 1, 0 terminates) */
+  u8_t hnext;
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 };
 
 struct nd6_destination_cache_entry {
@@ -95,6 +99,14 @@ struct nd6_destination_cache_entry {
   ip6_addr_t next_hop_addr;
   u16_t pmtu;
   u32_t age;
+#if LWIP_ND6_CACHE_HASH_SIZE
+  /* links are index + 1, 0 terminates */
+  /** next entry in the same hash bucket */
+  u16_t hnext;
+  /** neighbours in the LRU list (head is the most recently used entry) */
+  u16_t lru_prev;
+  u16_t lru_next;
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
 };
 
 struct nd6_prefix_list_entry {
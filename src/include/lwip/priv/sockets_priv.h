@@ -58,6 +58,46 @@ extern "C" {
 #define SELWAIT_T u8_t
 #endif
 
+#if LWIP_SOCKET_EPOLL
+struct lwip_epoll;
+struct lwip_sock;
+
+/** One socket registered with one epoll instance */
+struct lwip_epoll_item {
+  /** next registration watching the same socket */
+  struct lwip_epoll_item *sock_next;
+  /** links on the ready list of 'ep' */
+  struct lwip_epoll_item *ready_next;
+  struct lwip_epoll_item *ready_prev;
+  /** the epoll instance this registration belongs to */
+  struct lwip_epoll *ep;
+  /** the watched socket */
+  struct lwip_sock *sock;
+  /** events and data passed to lwip_epoll_ctl() */
+  u32_t events;
+  epoll_data_t data;
+  /** 1 while on the ready list of 'ep' */
+  u8_t ready;
+  /** 0 after an EPOLLONESHOT registration has fired, until EPOLL_CTL_MOD */
+  u8_t armed;
+};
+
+/** An epoll instance */
+struct lwip_epoll {
+  /** registrations that may be ready, in the order they became ready */
+  struct lwip_epoll_item *ready_first;
+  struct lwip_epoll_item *ready_last;
+  /** number of threads waiting in lwip_epoll_wait() */
+  u8_t waiting;
+  /** don't signal the semaphore twice: set to 1 when signalled */
+  u8_t sem_signalled;
+  /** 1 while allocated by lwip_epoll_create() */
+  u8_t used;
+  /** semaphore to wake up a thread waiting in lwip_epoll_wait() */
+  sys_sem_t sem;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 union lwip_sock_lastdata {
   struct netbuf *netbuf;
   struct pbuf *pbuf;
@@ -81,6 +121,10 @@ struct lwip_sock {
   /** counter of how many threads are waiting for this socket using select */
   SELWAIT_T select_waiting;
 #endif /* LWIP_SOCKET_SELECT || LWIP_SOCKET_POLL */
+#if LWIP_SOCKET_EPOLL
+  /** epoll registrations watching this socket */
+  struct lwip_epoll_item *epoll_items;
+#endif /* LWIP_SOCKET_EPOLL */
 #if LWIP_NETCONN_FULLDUPLEX
   /* counter of how many threads are using a struct lwip_sock (not the 'int') */
   u8_t fd_used;
@@ -85,6 +85,10 @@ err_t            tcp_rexmit_rto_prepare(struct tcp_pcb *pcb);
 void             tcp_rexmit_rto_commit(struct tcp_pcb *pcb);
 void             tcp_rexmit_rto  (struct tcp_pcb *pcb);
 void             tcp_rexmit_fast (struct tcp_pcb *pcb);
+#if LWIP_TCP_SACK_IN
+void             tcp_sack_rexmit_lost(struct tcp_pcb *pcb);
+void             tcp_sack_clear  (struct tcp_pcb *pcb, u8_t seg_flags);
+#endif /* LWIP_TCP_SACK_IN */
 u32_t            tcp_update_rcv_ann_wnd(struct tcp_pcb *pcb);
 err_t            tcp_process_refused_data(struct tcp_pcb *pcb);
 
@@ -270,14 +274,26 @@ struct tcp_seg {
                                                checksummed into 'chksum' */
 #define TF_SEG_OPTS_WND_SCALE   (u8_t)0x08U /* Include WND SCALE option (only used in SYN segments) */
 #define TF_SEG_OPTS_SACK_PERM   (u8_t)0x10U /* Include SACK Permitted option (only used in SYN segments) */
+#define TF_SEG_SACKED           (u8_t)0x20U /* Selectively acknowledged by the remote host */
+#define TF_SEG_SACK_RXT         (u8_t)0x40U /* Retransmitted during the current SACK loss recovery */
   struct tcp_hdr *tcphdr;  /* the TCP header */
 };
 
+#if LWIP_TCP_ZEROCOPY
+/* A PBUF_REF slice of an application pbuf enqueued by tcp_write_pbuf.
+   Holds a reference on the application pbuf until the slice is freed. */
+struct tcp_zc_ref {
+  struct pbuf_custom pc;
+  struct pbuf *owner;
+};
+#endif /* LWIP_TCP_ZEROCOPY */
+
 #define LWIP_TCP_OPT_EOL        0
 #define LWIP_TCP_OPT_NOP        1
 #define LWIP_TCP_OPT_MSS        2
 #define LWIP_TCP_OPT_WS         3
 #define LWIP_TCP_OPT_SACK_PERM  4
+#define LWIP_TCP_OPT_SACK       5
 #define LWIP_TCP_OPT_TS         8
 
 #define LWIP_TCP_OPT_LEN_MSS    4
@@ -301,6 +317,18 @@ struct tcp_seg {
 #define LWIP_TCP_OPT_LEN_SACK_PERM_OUT 0
 #endif
 
+#if LWIP_TCP_SACK_IN
+#define LWIP_TCP_OPT_LEN_SACK_BLOCK    8 /* one left/right edge pair */
+#define LWIP_TCP_OPT_MAX_SACK_BLOCKS   4 /* as many as fit in 40 bytes of options */
+
+/** Number of SACKed segments above a hole for it to be considered lost (RFC 6675) */
+#define TCP_SACK_DUPTHRESH      3
+/** RFC 6675 IsLost(): enough segments or bytes above a sequence number were SACKed */
+#define TCP_SACK_IS_LOST(pcb, sacked_segs, sacked_bytes) \
+  (((sacked_segs) >= TCP_SACK_DUPTHRESH) || \
+   ((sacked_bytes) > (u32_t)(TCP_SACK_DUPTHRESH - 1) * (pcb)->mss))
+#endif /* LWIP_TCP_SACK_IN */
+
 #define LWIP_TCP_OPT_LENGTH(flags) \
   ((flags) & TF_SEG_OPTS_MSS       ? LWIP_TCP_OPT_LEN_MSS           : 0) + \
   ((flags) & TF_SEG_OPTS_TS        ? LWIP_TCP_OPT_LEN_TS_OUT        : 0) + \
@@ -349,8 +377,47 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
    3) All PCBs in the tcp_listen_pcbs list is in LISTEN state.
    4) All PCBs in the tcp_tw_pcbs list is in TIME-WAIT state.
 */
+#if LWIP_TCP_PCB_HASH
+void tcp_pcb_hash_reg(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_pcb_hash_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+struct tcp_pcb *tcp_pcb_hash_lookup(u16_t local_port, u16_t remote_port,
+                                    const ip_addr_t *local_ip, const ip_addr_t *remote_ip,
+                                    struct netif *inp, u8_t time_wait);
+struct tcp_pcb_listen *tcp_listen_hash_lookup(u16_t local_port, const ip_addr_t *local_ip, struct netif *inp);
+#define TCP_HASH_REG(pcbs, npcb) tcp_pcb_hash_reg(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb) tcp_pcb_hash_rmv(pcbs, npcb)
+#else /* LWIP_TCP_PCB_HASH */
+#define TCP_HASH_REG(pcbs, npcb)
+#define TCP_HASH_RMV(pcbs, npcb)
+#endif /* LWIP_TCP_PCB_HASH */
+
+#if LWIP_TCP_TIMER_WHEEL
+/* pcb->wheel_state */
+#define TCP_WHEEL_NONE   0 /* not on the active list */
+#define TCP_WHEEL_BUSY   1 /* visited by every run of the TCP timers */
+#define TCP_WHEEL_PARKED 2 /* in the wheel slot of pcb->wheel_due */
+void tcp_wheel_reg(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_wheel_rmv(struct tcp_pcb **pcbs, struct tcp_pcb *pcb);
+void tcp_wheel_wake(struct tcp_pcb *pcb);
+#define TCP_WHEEL_REG(pcbs, npcb) tcp_wheel_reg(pcbs, npcb)
+#define TCP_WHEEL_RMV(pcbs, npcb) tcp_wheel_rmv(pcbs, npcb)
+/** Let the TCP timers visit a pcb again, to be called before changing
+ * anything that a parked pcb's timers depend on */
+#define TCP_WHEEL_WAKE(pcb) do { \
+    if ((pcb)->wheel_state == TCP_WHEEL_PARKED) { \
+      tcp_wheel_wake(pcb); \
+    } \
+  } while (0)
+#else /* LWIP_TCP_TIMER_WHEEL */
+#define TCP_WHEEL_REG(pcbs, npcb)
+#define TCP_WHEEL_RMV(pcbs, npcb)
+#define TCP_WHEEL_WAKE(pcb)
+#endif /* LWIP_TCP_TIMER_WHEEL */
+
 /* Define two macros, TCP_REG and TCP_RMV that registers a TCP PCB
-   with a PCB list or removes a PCB from a list, respectively. */
+   with a PCB list or removes a PCB from a list, respectively. With
+   LWIP_TCP_PCB_HASH, they also maintain the demultiplexing hash tables,
+   with LWIP_TCP_TIMER_WHEEL the list of pcbs the TCP timers visit. */
 #ifndef TCP_DEBUG_PCB_LISTS
 #define TCP_DEBUG_PCB_LISTS 0
 #endif
@@ -367,6 +434,8 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             (npcb)->next = *(pcbs); \
                             LWIP_ASSERT("TCP_REG: npcb->next != npcb", (npcb)->next != (npcb)); \
                             *(pcbs) = (npcb); \
+                            TCP_HASH_REG(pcbs, npcb); \
+                            TCP_WHEEL_REG(pcbs, npcb); \
                             LWIP_ASSERT("TCP_REG: tcp_pcbs sane", tcp_pcbs_sane()); \
               tcp_timer_needed(); \
                             } while(0)
@@ -374,6 +443,8 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
                             struct tcp_pcb *tcp_tmp_pcb; \
                             LWIP_ASSERT("TCP_RMV: pcbs != NULL", *(pcbs) != NULL); \
                             LWIP_DEBUGF(TCP_DEBUG, ("TCP_RMV: removing %p from %p\n", (void *)(npcb), (void *)(*(pcbs)))); \
+                            TCP_HASH_RMV(pcbs, npcb); \
+                            TCP_WHEEL_RMV(pcbs, npcb); \
                             if(*(pcbs) == (npcb)) { \
                                *(pcbs) = (*pcbs)->next; \
                             } else for (tcp_tmp_pcb = *(pcbs); tcp_tmp_pcb != NULL; tcp_tmp_pcb = tcp_tmp_pcb->next) { \
@@ -393,11 +464,15 @@ extern struct tcp_pcb ** const tcp_pcb_lists[NUM_TCP_PCB_LISTS];
   do {                                             \
     (npcb)->next = *pcbs;                          \
     *(pcbs) = (npcb);                              \
+    TCP_HASH_REG(pcbs, npcb);                      \
+    TCP_WHEEL_REG(pcbs, npcb);                     \
     tcp_timer_needed();                            \
   } while (0)
 
 #define TCP_RMV(pcbs, npcb)                        \
   do {                                             \
+    TCP_HASH_RMV(pcbs, npcb);                      \
+    TCP_WHEEL_RMV(pcbs, npcb);                     \
     if(*(pcbs) == (npcb)) {                        \
       (*(pcbs)) = (*pcbs)->next;                   \
     }                                              \
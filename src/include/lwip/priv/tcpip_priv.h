@@ -117,6 +117,9 @@ enum tcpip_msg_type {
 #endif /* !LWIP_TCPIP_CORE_LOCKING */
 #if !LWIP_TCPIP_CORE_LOCKING_INPUT
   TCPIP_MSG_INPKT,
+#if LWIP_TCPIP_BATCH_INPUT
+  TCPIP_MSG_INPKT_BATCH,
+#endif /* LWIP_TCPIP_BATCH_INPUT */
 #endif /* !LWIP_TCPIP_CORE_LOCKING_INPUT */
 #if LWIP_TCPIP_TIMEOUT && LWIP_TIMERS
   TCPIP_MSG_TIMEOUT,
@@ -161,6 +164,19 @@ struct tcpip_msg {
   } msg;
 };
 
+#if LWIP_TCPIP_BATCH_INPUT && !LWIP_TCPIP_CORE_LOCKING_INPUT
+/** A burst of received packets: kept apart from struct tcpip_msg so the
+ * packet array doesn't make every message bigger. Starts with the type
+ * like struct tcpip_msg. */
+struct tcpip_inpkt_batch_msg {
+  enum tcpip_msg_type type;
+  struct netif *netif;
+  netif_input_fn input_fn;
+  u16_t num;
+  struct pbuf *p[TCPIP_BATCH_INPUT_MAX];
+};
+#endif /* LWIP_TCPIP_BATCH_INPUT && !LWIP_TCPIP_CORE_LOCKING_INPUT */
+
 #ifdef __cplusplus
 }
 #endif
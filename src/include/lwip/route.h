@@ -0,0 +1,102 @@
+/**
+ * @file
+ * Static route table
+ */
+
+/*
+ * Copyright (c) 2001-2004 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+#ifndef LWIP_HDR_ROUTE_H
+#define LWIP_HDR_ROUTE_H
+
+#include "lwip/opt.h"
+
+#if LWIP_ROUTE_TABLE /* don't build if not configured for use in lwipopts.h */
+
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/netif.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of 32-bit words of a route trie key */
+#if LWIP_IPV6
+#define ROUTE_KEY_WORDS 4
+#else /* LWIP_IPV6 */
+#define ROUTE_KEY_WORDS 1
+#endif /* LWIP_IPV6 */
+
+/** A static route */
+struct route_entry {
+  /** next route with the same prefix, sorted by metric */
+  struct route_entry *next;
+  /** outgoing netif */
+  struct netif *netif;
+  /** next hop, IP_ANY for routes to directly reachable destinations */
+  ip_addr_t gw;
+  /** lower is preferred */
+  u16_t metric;
+};
+
+/** A node of the route radix trie. Nodes without routes only join two subtrees. */
+struct route_node {
+  struct route_node *child[2];
+  /** routes for this prefix, NULL for a join node */
+  struct route_entry *routes;
+  /** the prefix in host byte order, bits beyond len are 0 */
+  u32_t key[ROUTE_KEY_WORDS];
+  /** prefix length in bits */
+  u8_t len;
+};
+
+err_t route_add(const ip_addr_t *prefix, u8_t prefix_len, const ip_addr_t *gw,
+                struct netif *netif, u16_t metric);
+err_t route_remove(const ip_addr_t *prefix, u8_t prefix_len, const ip_addr_t *gw,
+                   struct netif *netif);
+void  route_remove_netif(struct netif *netif);
+void  route_cache_flush(void);
+
+#if LWIP_IPV4
+struct netif *route_lookup_ip4(const ip4_addr_t *dest);
+const ip4_addr_t *route_next_hop_ip4(struct netif *netif, const ip4_addr_t *dest);
+#endif /* LWIP_IPV4 */
+#if LWIP_IPV6
+struct netif *route_lookup_ip6(const ip6_addr_t *dest);
+const ip6_addr_t *route_next_hop_ip6(struct netif *netif, const ip6_addr_t *dest);
+#endif /* LWIP_IPV6 */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_ROUTE_TABLE */
+
+#endif /* LWIP_HDR_ROUTE_H */
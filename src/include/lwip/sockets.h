@@ -134,6 +134,12 @@ struct msghdr {
   int           msg_flags;
 };
 
+/** One entry of the vector passed to recvmmsg()/sendmmsg() */
+struct mmsghdr {
+  struct msghdr msg_hdr;
+  unsigned int  msg_len;   /* bytes received/sent for this entry */
+};
+
 /* struct msghdr->msg_flags bit field values */
 #define MSG_TRUNC   0x04
 #define MSG_CTRUNC  0x08
@@ -263,6 +269,7 @@ struct linger {
 #define MSG_DONTWAIT   0x08    /* Nonblocking i/o for this operation only */
 #define MSG_MORE       0x10    /* Sender will send more */
 #define MSG_NOSIGNAL   0x20    /* Uninmplemented: Requests not to send the SIGPIPE signal if an attempt to send is made on a stream-oriented socket that is no longer connected. */
+#define MSG_WAITFORONE 0x40    /* recvmmsg(): turn on MSG_DONTWAIT after the first datagram has been received */
 
 
 /*
@@ -281,6 +288,13 @@ struct linger {
 #define TCP_KEEPIDLE   0x03    /* set pcb->keep_idle  - Same as TCP_KEEPALIVE, but use seconds for get/setsockopt */
 #define TCP_KEEPINTVL  0x04    /* set pcb->keep_intvl - Use seconds for get/setsockopt */
 #define TCP_KEEPCNT    0x05    /* set pcb->keep_cnt   - Use number of probes sent for get/setsockopt */
+#define TCP_CONGESTION 0x06    /* set pcb->cc_ops     - Use TCP_CA_* for get/setsockopt */
+
+/*
+ * Congestion control algorithms for TCP_CONGESTION
+ */
+#define TCP_CA_NEWRENO 0       /* NewReno, always available */
+#define TCP_CA_CUBIC   1       /* CUBIC, needs LWIP_TCP_CC_CUBIC */
 #endif /* LWIP_TCP */
 
 #if LWIP_IPV6
@@ -512,6 +526,33 @@ struct pollfd
 };
 #endif
 
+#if LWIP_SOCKET_EPOLL
+/* epoll-related defines and types */
+#define EPOLLIN        0x001
+#define EPOLLOUT       0x004
+#define EPOLLERR       0x008   /* output only: reported even if not requested */
+#define EPOLLONESHOT   (1U << 30)
+#define EPOLLET        (1U << 31)
+
+#define EPOLL_CTL_ADD  1
+#define EPOLL_CTL_DEL  2
+#define EPOLL_CTL_MOD  3
+
+typedef union epoll_data {
+  void  *ptr;
+  int    fd;
+  u32_t  u32;
+#if LWIP_HAVE_INT64
+  u64_t  u64;
+#endif
+} epoll_data_t;
+
+struct epoll_event {
+  u32_t        events;
+  epoll_data_t data;
+};
+#endif /* LWIP_SOCKET_EPOLL */
+
 /** LWIP_TIMEVAL_PRIVATE: if you want to use the struct timeval provided
  * by your system, set this to 0 and include <sys/time.h> in cc.h */
 #ifndef LWIP_TIMEVAL_PRIVATE
@@ -543,9 +584,11 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #define lwip_listen       listen
 #define lwip_recv         recv
 #define lwip_recvmsg      recvmsg
+#define lwip_recvmmsg     recvmmsg
 #define lwip_recvfrom     recvfrom
 #define lwip_send         send
 #define lwip_sendmsg      sendmsg
+#define lwip_sendmmsg     sendmmsg
 #define lwip_sendto       sendto
 #define lwip_socket       socket
 #if LWIP_SOCKET_SELECT
@@ -554,6 +597,11 @@ void lwip_socket_thread_cleanup(void); /* LWIP_NETCONN_SEM_PER_THREAD==1: destro
 #if LWIP_SOCKET_POLL
 #define lwip_poll         poll
 #endif
+#if LWIP_SOCKET_EPOLL
+#define lwip_epoll_create epoll_create
+#define lwip_epoll_ctl    epoll_ctl
+#define lwip_epoll_wait   epoll_wait
+#endif
 #define lwip_ioctl        ioctlsocket
 #define lwip_inet_ntop    inet_ntop
 #define lwip_inet_pton    inet_pton
@@ -589,8 +637,11 @@ ssize_t lwip_readv(int s, const struct iovec *iov, int iovcnt);
 ssize_t lwip_recvfrom(int s, void *mem, size_t len, int flags,
       struct sockaddr *from, socklen_t *fromlen);
 ssize_t lwip_recvmsg(int s, struct msghdr *message, int flags);
+int lwip_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+      struct timeval *timeout);
 ssize_t lwip_send(int s, const void *dataptr, size_t size, int flags);
 ssize_t lwip_sendmsg(int s, const struct msghdr *message, int flags);
+int lwip_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags);
 ssize_t lwip_sendto(int s, const void *dataptr, size_t size, int flags,
     const struct sockaddr *to, socklen_t tolen);
 int lwip_socket(int domain, int type, int protocol);
@@ -603,6 +654,11 @@ int lwip_select(int maxfdp1, fd_set *readset, fd_set *writeset, fd_set *exceptse
 #if LWIP_SOCKET_POLL
 int lwip_poll(struct pollfd *fds, nfds_t nfds, int timeout);
 #endif
+#if LWIP_SOCKET_EPOLL
+int lwip_epoll_create(int size);
+int lwip_epoll_ctl(int epfd, int op, int fd, struct epoll_event *event);
+int lwip_epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout);
+#endif
 int lwip_ioctl(int s, long cmd, void *argp);
 int lwip_fcntl(int s, int cmd, int val);
 const char *lwip_inet_ntop(int af, const void *src, char *dst, socklen_t size);
@@ -635,12 +691,16 @@ int lwip_inet_pton(int af, const char *src, void *dst);
 /** @ingroup socket */
 #define recvmsg(s,message,flags)                  lwip_recvmsg(s,message,flags)
 /** @ingroup socket */
+#define recvmmsg(s,msgvec,vlen,flags,timeout)     lwip_recvmmsg(s,msgvec,vlen,flags,timeout)
+/** @ingroup socket */
 #define recvfrom(s,mem,len,flags,from,fromlen)    lwip_recvfrom(s,mem,len,flags,from,fromlen)
 /** @ingroup socket */
 #define send(s,dataptr,size,flags)                lwip_send(s,dataptr,size,flags)
 /** @ingroup socket */
 #define sendmsg(s,message,flags)                  lwip_sendmsg(s,message,flags)
 /** @ingroup socket */
+#define sendmmsg(s,msgvec,vlen,flags)             lwip_sendmmsg(s,msgvec,vlen,flags)
+/** @ingroup socket */
 #define sendto(s,dataptr,size,flags,to,tolen)     lwip_sendto(s,dataptr,size,flags,to,tolen)
 /** @ingroup socket */
 #define socket(domain,type,protocol)              lwip_socket(domain,type,protocol)
@@ -652,6 +712,14 @@ int lwip_inet_pton(int af, const char *src, void *dst);
 /** @ingroup socket */
 #define poll(fds,nfds,timeout)                    lwip_poll(fds,nfds,timeout)
 #endif
+#if LWIP_SOCKET_EPOLL
+/** @ingroup socket */
+#define epoll_create(size)                        lwip_epoll_create(size)
+/** @ingroup socket */
+#define epoll_ctl(epfd,op,fd,event)               lwip_epoll_ctl(epfd,op,fd,event)
+/** @ingroup socket */
+#define epoll_wait(epfd,events,maxevents,timeout) lwip_epoll_wait(epfd,events,maxevents,timeout)
+#endif
 /** @ingroup socket */
 #define ioctlsocket(s,cmd,argp)                   lwip_ioctl(s,cmd,argp)
 /** @ingroup socket */
@@ -203,6 +203,39 @@ struct tcp_pcb_ext_args {
 #define TCP_PCB_EXTARGS
 #endif
 
+#if LWIP_TCP_PCB_HASH
+/* Chains pcbs sharing a bucket of the demultiplexing hash tables */
+#define TCP_PCB_HASH_NEXT(type) type *hash_next;
+#else
+#define TCP_PCB_HASH_NEXT(type)
+#endif
+
+/** Congestion control algorithm: hooks called by the TCP core to update
+ * cwnd and ssthresh of a pcb (see tcp_cc.c) */
+struct tcp_cc_ops {
+  /** name of the algorithm (for debugging) */
+  const char *name;
+  /** reset the per-pcb algorithm state */
+  void (*init)(struct tcp_pcb *pcb);
+  /** new data was acknowledged (not called during fast recovery) */
+  void (*on_ack)(struct tcp_pcb *pcb, tcpwnd_size_t acked);
+  /** fast retransmit: update ssthresh, cwnd is set by fast recovery */
+  void (*on_loss)(struct tcp_pcb *pcb);
+  /** retransmission timeout: update ssthresh and cwnd */
+  void (*on_rto)(struct tcp_pcb *pcb);
+};
+
+#if LWIP_TCP_CC_CUBIC
+/** Per-pcb state of the CUBIC congestion control algorithm */
+struct tcp_cubic {
+  u32_t epoch_start;    /* sys_now() at the start of the epoch, 0: no epoch */
+  u32_t k;              /* time to grow back to origin (milliseconds) */
+  tcpwnd_size_t w_max;  /* cwnd before the last reduction */
+  tcpwnd_size_t origin; /* plateau of the cubic function */
+  tcpwnd_size_t w_est;  /* Reno-friendly window estimate */
+};
+#endif /* LWIP_TCP_CC_CUBIC */
+
 typedef u16_t tcpflags_t;
 #define TCP_ALLFLAGS 0xffffU
 
@@ -211,6 +244,7 @@ typedef u16_t tcpflags_t;
  */
 #define TCP_PCB_COMMON(type) \
   type *next; /* for the linked list */ \
+  TCP_PCB_HASH_NEXT(type) \
   void *callback_arg; \
   TCP_PCB_EXTARGS \
   enum tcp_state state; /* TCP state */ \
@@ -278,6 +312,15 @@ struct tcp_pcb {
   u8_t polltmr, pollinterval;
   u8_t last_timer;
   u32_t tmr;
+#if LWIP_TCP_TIMER_WHEEL
+  /* list of pcbs visited by the TCP timers or, if parked, of a wheel slot */
+  struct tcp_pcb *wheel_next, *wheel_prev;
+  /* previous pcb on tcp_active_pcbs, to unlink expired pcbs in O(1) */
+  struct tcp_pcb *active_prev;
+  u32_t wheel_due;    /* tcp_ticks at which a parked pcb is visited again */
+  u32_t wheel_parked; /* tcp_ticks when the pcb was parked */
+  u8_t wheel_state;
+#endif /* LWIP_TCP_TIMER_WHEEL */
 
   /* receiver variables */
   u32_t rcv_nxt;   /* next seqno expected */
@@ -315,6 +358,17 @@ struct tcp_pcb {
   /* first byte following last rto byte */
   u32_t rto_end;
 
+#if LWIP_TCP_SACK_IN
+  /* SACK loss recovery ends when this seqno is acknowledged (RFC 6675) */
+  u32_t recovery_point;
+#endif /* LWIP_TCP_SACK_IN */
+
+  /* congestion control algorithm */
+  const struct tcp_cc_ops *cc_ops;
+#if LWIP_TCP_CC_CUBIC
+  struct tcp_cubic cubic;
+#endif /* LWIP_TCP_CC_CUBIC */
+
   /* sender variables */
   u32_t snd_nxt;   /* next new seqno to be sent */
   u32_t snd_wl1, snd_wl2; /* Sequence and acknowledgement numbers of last
@@ -472,9 +526,20 @@ err_t            tcp_shutdown(struct tcp_pcb *pcb, int shut_rx, int shut_tx);
 
 err_t            tcp_write   (struct tcp_pcb *pcb, const void *dataptr, u16_t len,
                               u8_t apiflags);
+#if LWIP_TCP_ZEROCOPY
+err_t            tcp_write_pbuf(struct tcp_pcb *pcb, struct pbuf *p, u8_t apiflags);
+#endif /* LWIP_TCP_ZEROCOPY */
 
 void             tcp_setprio (struct tcp_pcb *pcb, u8_t prio);
 
+extern const struct tcp_cc_ops tcp_cc_newreno;
+#if LWIP_TCP_CC_CUBIC
+extern const struct tcp_cc_ops tcp_cc_cubic;
+#endif /* LWIP_TCP_CC_CUBIC */
+void             tcp_set_cc  (struct tcp_pcb *pcb, const struct tcp_cc_ops *ops);
+/** @ingroup tcp_raw */
+#define          tcp_get_cc(pcb) ((pcb)->cc_ops)
+
 err_t            tcp_output  (struct tcp_pcb *pcb);
 
 err_t            tcp_tcp_get_tcp_addrinfo(struct tcp_pcb *pcb, int local, ip_addr_t *addr, u16_t *port);
@@ -79,6 +79,38 @@ void   tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg);
 err_t  tcpip_inpkt(struct pbuf *p, struct netif *inp, netif_input_fn input_fn);
 err_t  tcpip_input(struct pbuf *p, struct netif *inp);
 
+#if LWIP_TCPIP_BATCH_INPUT
+u16_t  tcpip_inpkt_batch(struct pbuf **pkts, u16_t num, struct netif *inp, netif_input_fn input_fn);
+u16_t  tcpip_input_batch(struct pbuf **pkts, u16_t num, struct netif *inp);
+
+/**
+ * @ingroup lwip_os
+ * Receive ring of one netif, filled by its driver and drained by
+ * tcpip_thread. There must be only one producer; the fields are private.
+ */
+struct tcpip_rx_ring {
+  struct pbuf **slots;
+  /** number of slots, a power of two */
+  u16_t size;
+  /** next slot to fill, written by the producer only */
+  u16_t head;
+  /** next slot to drain, written by tcpip_thread only */
+  u16_t tail;
+  /** 1 while a drain is posted to or running in tcpip_thread */
+  u8_t scheduled;
+  struct netif *netif;
+  netif_input_fn input_fn;
+  struct tcpip_callback_msg *msg;
+};
+
+err_t  tcpip_rx_ring_init(struct tcpip_rx_ring *ring, struct pbuf **slots, u16_t size,
+                          struct netif *inp, netif_input_fn input_fn);
+void   tcpip_rx_ring_deinit(struct tcpip_rx_ring *ring);
+err_t  tcpip_rx_ring_put(struct tcpip_rx_ring *ring, struct pbuf *p);
+err_t  tcpip_rx_ring_kick(struct tcpip_rx_ring *ring);
+err_t  tcpip_rx_ring_kick_fromisr(struct tcpip_rx_ring *ring);
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+
 err_t  tcpip_try_callback(tcpip_callback_fn function, void *ctx);
 err_t  tcpip_callback(tcpip_callback_fn function, void *ctx);
 /**  @ingroup lwip_os
@@ -98,6 +98,14 @@ struct sys_timeo {
 #if LWIP_DEBUG_TIMERNAMES
   const char* handler_name;
 #endif /* LWIP_DEBUG_TIMERNAMES */
+#if LWIP_TIMER_WHEEL
+  /** wheel slot list (circular, next is shared with the list implementation) */
+  struct sys_timeo *prev;
+  /** next timer in the same (handler, arg) hash bucket */
+  struct sys_timeo *hnext;
+  /** index of the wheel slot this timer is linked into */
+  u16_t slot;
+#endif /* LWIP_TIMER_WHEEL */
 };
 
 void sys_timeouts_init(void);
@@ -115,7 +123,12 @@ void sys_check_timeouts(void);
 u32_t sys_timeouts_sleeptime(void);
 
 #if LWIP_TESTMODE
+#if LWIP_TIMER_WHEEL
+struct sys_timeo* sys_timeouts_detach(void);
+void sys_timeouts_attach(struct sys_timeo *list);
+#else /* LWIP_TIMER_WHEEL */
 struct sys_timeo** sys_timeouts_get_next_timeout(void);
+#endif /* LWIP_TIMER_WHEEL */
 void lwip_cyclic_timer(void *arg);
 #endif
 
@@ -101,7 +101,7 @@ void                bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_
 bridgeif_portmask_t bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr);
 void*               bridgeif_fdb_init(u16_t max_fdb_entries);
 
-#if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_CUT_THROUGH
 #ifndef BRIDGEIF_DECL_PROTECT
 /* define bridgeif protection to sys_arch_protect... */
 #include "lwip/sys.h"
@@ -111,14 +111,16 @@ void*               bridgeif_fdb_init(u16_t max_fdb_entries);
 #define BRIDGEIF_WRITE_PROTECT(lev)
 #define BRIDGEIF_WRITE_UNPROTECT(lev)
 #endif
-#else /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
-#include "lwip/tcpip.h"
+#else /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_CUT_THROUGH */
 #define BRIDGEIF_DECL_PROTECT(lev)
 #define BRIDGEIF_READ_PROTECT(lev)
 #define BRIDGEIF_READ_UNPROTECT(lev)
 #define BRIDGEIF_WRITE_PROTECT(lev)
 #define BRIDGEIF_WRITE_UNPROTECT(lev)
-#endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+#endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT || BRIDGEIF_CUT_THROUGH */
+#if !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#include "lwip/tcpip.h"
+#endif /* !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
 
 #ifdef __cplusplus
 }
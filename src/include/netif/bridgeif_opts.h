@@ -58,6 +58,20 @@
 #define BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT  NO_SYS
 #endif
 
+/** BRIDGEIF_CUT_THROUGH==1: with BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT==0, decide
+ * where a received frame goes from its Ethernet header alone in the port netif's
+ * input context: unicast frames for other stations are handed directly to the
+ * egress port's 'linkoutput' function without passing through tcpip_thread.
+ * Only frames for the bridge itself and group addressed frames are queued to
+ * tcpip_thread.
+ * ATTENTION: as with BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT, *all* bridge port netif's
+ * drivers must correctly handle concurrent access! The FDB is then protected
+ * with SYS_ARCH_PROTECT.
+ */
+#ifndef BRIDGEIF_CUT_THROUGH
+#define BRIDGEIF_CUT_THROUGH                0
+#endif
+
 /** BRIDGEIF_MAX_PORTS: this is used to create a typedef used for forwarding
  * bit-fields: the number of bits required is this + 1 (for the internal/cpu port)
  * (63 is the maximum, resulting in an u64_t for the bit mask)
@@ -68,6 +82,30 @@
 #define BRIDGEIF_MAX_PORTS                  7
 #endif
 
+/** BRIDGEIF_FDB_WHEEL_SIZE: number of one-second slots of the timer wheel
+ * used to age the dynamic FDB. Each aging tick only visits the entries filed
+ * in the current slot instead of the whole table; entries refreshed since they
+ * were filed are moved on to a later slot. Must be a power of 2.
+ */
+#ifndef BRIDGEIF_FDB_WHEEL_SIZE
+#define BRIDGEIF_FDB_WHEEL_SIZE             64
+#endif
+
+/** BRIDGEIF_FDB_BUCKET_PROTECT/BRIDGEIF_FDB_BUCKET_UNPROTECT: protection of
+ * one hash chain ('bucket' is its index) of the dynamic FDB in bridgeif_fdb.c.
+ * Lookups only take this one, so it may be mapped to a lock per bucket (or to
+ * one of a striped set of locks indexed by 'bucket') to let ports learn and
+ * look up addresses concurrently. 'lev' is declared by BRIDGEIF_DECL_PROTECT.
+ * ATTENTION: the free list and the aging wheel are shared by all buckets, so
+ * BRIDGEIF_WRITE_PROTECT must stay bridge-wide. A bucket lock is always taken
+ * first, then the write lock (never the other way round).
+ * The default is the bridge-wide BRIDGEIF_READ_PROTECT.
+ */
+#ifndef BRIDGEIF_FDB_BUCKET_PROTECT
+#define BRIDGEIF_FDB_BUCKET_PROTECT(lev, bucket)    BRIDGEIF_READ_PROTECT(lev)
+#define BRIDGEIF_FDB_BUCKET_UNPROTECT(lev, bucket)  BRIDGEIF_READ_UNPROTECT(lev)
+#endif
+
 /** BRIDGEIF_DEBUG: Enable generic debugging in bridgeif.c. */
 #ifndef BRIDGEIF_DEBUG
 #define BRIDGEIF_DEBUG                      LWIP_DBG_OFF
@@ -60,6 +60,8 @@
  *   netif_add(&bridge_netif, &my_ip, &my_netmask, &my_gw, &mybridge_initdata, bridgeif_init, tcpip_input);
  *   NOTE: the passed 'input' function depends on BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT setting,
  *         which controls where the forwarding is done (netif low level input context vs. tcpip_thread)
+ *   NOTE: with BRIDGEIF_CUT_THROUGH, unicast frames for other stations are forwarded from
+ *         the netif low level input context even if BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT==0
  * - set up all ports netifs and the bridge netif
  *
  * - When adding a port netif, NETIF_FLAG_ETHARP flag will be removed from a port
@@ -290,6 +292,20 @@ bridgeif_send_to_ports(bridgeif_private_t *br, struct pbuf *p, bridgeif_portmask
   return ret_err;
 }
 
+/** Helper function to forward a unicast frame that is not for the cpu port
+ * to its destination port (or flood it to all external ports if unknown).
+ * This consumes the pbuf.
+ */
+static void
+bridgeif_forward_ext(bridgeif_private_t *br, struct pbuf *p, struct eth_addr *dst)
+{
+  bridgeif_portmask_t dstports = bridgeif_find_dst_ports(br, dst);
+  bridgeif_send_to_ports(br, p, dstports);
+  /* no need to send to cpu, flooding is for external ports only */
+  /* by  this, we consumed the pbuf */
+  pbuf_free(p);
+}
+
 /** Output function of the application port of the bridge (the one with an ip address).
  * The forwarding port(s) where this pbuf is sent on is/are automatically selected
  * from the FDB.
@@ -319,39 +335,70 @@ bridgeif_output(struct netif *netif, struct pbuf *p)
   return err;
 }
 
-/** The actual bridge input function. Port netif's input is changed to call
- * here. This function decides where the frame is forwarded.
+/* bridgeif_rx_classify() results */
+#define BRIDGEIF_RX_GROUP 0 /* group address: flooded, maybe to the cpu port too */
+#define BRIDGEIF_RX_CPU   1 /* for the bridge or one of its ports */
+#define BRIDGEIF_RX_EXT   2 /* unicast for another station */
+
+/** Helper function returning the bridge port of a port netif, NULL if it is
+ * not (or no longer) a port of a bridge.
  */
-static err_t
-bridgeif_input(struct pbuf *p, struct netif *netif)
+static bridgeif_port_t *
+bridgeif_rx_port(struct pbuf *p, struct netif *netif)
 {
-  u8_t rx_idx;
-  bridgeif_portmask_t dstports;
-  struct eth_addr *src, *dst;
-  bridgeif_private_t *br;
   bridgeif_port_t *port;
   if (p == NULL || netif == NULL) {
-    return ERR_VAL;
+    return NULL;
   }
   port = (bridgeif_port_t *)netif_get_client_data(netif, bridgeif_netif_client_id);
   LWIP_ASSERT("port data not set", port != NULL);
   if (port == NULL || port->bridge == NULL) {
-    return ERR_VAL;
+    return NULL;
   }
-  br = (bridgeif_private_t *)port->bridge;
-  rx_idx = netif_get_index(netif);
+  return port;
+}
+
+/** Helper function shared by the input paths: stores the receive index in
+ * the pbuf, learns the source address on the receiving port and tells where
+ * the frame goes by its destination address.
+ */
+static u8_t
+bridgeif_rx_classify(bridgeif_port_t *port, struct pbuf *p, struct netif *netif)
+{
+  struct eth_addr *src, *dst;
+
   /* store receive index in pbuf */
-  p->if_idx = rx_idx;
+  p->if_idx = netif_get_index(netif);
 
   dst = (struct eth_addr *)p->payload;
   src = (struct eth_addr *)(((u8_t *)p->payload) + sizeof(struct eth_addr));
 
   if ((src->addr[0] & 1) == 0) {
     /* update src for all non-group addresses */
-    bridgeif_fdb_update_src(br->fdbd, src, port->port_num);
+    bridgeif_fdb_update_src(port->bridge->fdbd, src, port->port_num);
   }
 
   if (dst->addr[0] & 1) {
+    return BRIDGEIF_RX_GROUP;
+  }
+  /* is this for one of the local ports? */
+  if (bridgeif_is_local_mac(port->bridge, dst)) {
+    return BRIDGEIF_RX_CPU;
+  }
+  return BRIDGEIF_RX_EXT;
+}
+
+/** Helper function passing a received frame on as classified by
+ * bridgeif_rx_classify(). This consumes the pbuf unless the cpu port's input
+ * function fails on a frame for the cpu port only.
+ */
+static err_t
+bridgeif_rx_forward(bridgeif_private_t *br, struct pbuf *p, u8_t rx_class)
+{
+  bridgeif_portmask_t dstports;
+  struct eth_addr *dst = (struct eth_addr *)p->payload;
+
+  if (rx_class == BRIDGEIF_RX_GROUP) {
     /* group address -> flood + cpu? */
     dstports = bridgeif_find_dst_ports(br, dst);
     bridgeif_send_to_ports(br, p, dstports);
@@ -367,31 +414,66 @@ bridgeif_input(struct pbuf *p, struct netif *netif)
     }
     /* always return ERR_OK here to prevent the caller freeing the pbuf */
     return ERR_OK;
-  } else {
-    /* is this for one of the local ports? */
-    if (bridgeif_is_local_mac(br, dst)) {
-      /* yes, send to cpu port only */
-      LWIP_DEBUGF(BRIDGEIF_FW_DEBUG, ("br -> input(%p)\n", (void *)p));
-      return br->netif->input(p, br->netif);
-    }
+  } else if (rx_class == BRIDGEIF_RX_CPU) {
+    /* yes, send to cpu port only */
+    LWIP_DEBUGF(BRIDGEIF_FW_DEBUG, ("br -> input(%p)\n", (void *)p));
+    return br->netif->input(p, br->netif);
+  }
 
-    /* get dst port */
-    dstports = bridgeif_find_dst_ports(br, dst);
-    bridgeif_send_to_ports(br, p, dstports);
-    /* no need to send to cpu, flooding is for external ports only */
-    /* by  this, we consumed the pbuf */
-    pbuf_free(p);
-    /* always return ERR_OK here to prevent the caller freeing the pbuf */
-    return ERR_OK;
+  bridgeif_forward_ext(br, p, dst);
+  /* always return ERR_OK here to prevent the caller freeing the pbuf */
+  return ERR_OK;
+}
+
+/** The actual bridge input function. Port netif's input is changed to call
+ * here. This function decides where the frame is forwarded.
+ */
+static err_t
+bridgeif_input(struct pbuf *p, struct netif *netif)
+{
+  bridgeif_port_t *port = bridgeif_rx_port(p, netif);
+  if (port == NULL) {
+    return ERR_VAL;
   }
+  return bridgeif_rx_forward(port->bridge, p, bridgeif_rx_classify(port, p, netif));
 }
 
 #if !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+#if BRIDGEIF_CUT_THROUGH
+/** Bridge input function for the frames bridgeif_tcpip_input() has
+ * classified already and passes to tcpip_thread: group addressed frames and
+ * frames for the cpu port.
+ */
+static err_t
+bridgeif_input_classified(struct pbuf *p, struct netif *netif)
+{
+  bridgeif_port_t *port = bridgeif_rx_port(p, netif);
+  if (port == NULL) {
+    return ERR_VAL;
+  }
+  return bridgeif_rx_forward(port->bridge, p,
+                             (((u8_t *)p->payload)[0] & 1) ? BRIDGEIF_RX_GROUP : BRIDGEIF_RX_CPU);
+}
+#endif /* BRIDGEIF_CUT_THROUGH */
+
 /** Input function for port netifs used to synchronize into tcpip_thread.
  */
 static err_t
 bridgeif_tcpip_input(struct pbuf *p, struct netif *netif)
 {
+#if BRIDGEIF_CUT_THROUGH
+  /* forward unicast frames for other stations right here, only frames that
+     might be for the cpu port go through tcpip_thread */
+  bridgeif_port_t *port = bridgeif_rx_port(p, netif);
+  if ((port != NULL) && (p->len >= SIZEOF_ETH_HDR)) {
+    if (bridgeif_rx_classify(port, p, netif) == BRIDGEIF_RX_EXT) {
+      LWIP_DEBUGF(BRIDGEIF_FW_DEBUG, ("br -> cut-through(%p)\n", (void *)p));
+      bridgeif_forward_ext(port->bridge, p, (struct eth_addr *)p->payload);
+      return ERR_OK;
+    }
+    return tcpip_inpkt(p, netif, bridgeif_input_classified);
+  }
+#endif /* BRIDGEIF_CUT_THROUGH */
   return tcpip_inpkt(p, netif, bridgeif_input);
 }
 #endif /* BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
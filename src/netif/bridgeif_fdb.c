@@ -51,128 +51,190 @@
 
 #define BR_FDB_TIMEOUT_SEC  (60*5) /* 5 minutes FDB timeout */
 
+#if (BRIDGEIF_FDB_WHEEL_SIZE < 1) || ((BRIDGEIF_FDB_WHEEL_SIZE & (BRIDGEIF_FDB_WHEEL_SIZE - 1)) != 0)
+#error BRIDGEIF_FDB_WHEEL_SIZE must be a power of 2
+#endif
+
+/* Entries are linked by index + 1 so that 0 can terminate a list */
 typedef struct bridgeif_dfdb_entry_s {
-  u8_t used;
+  /** next entry in the same hash bucket */
+  u16_t next;
+  /** next entry in the same aging wheel slot or in the free list */
+  u16_t wnext;
+  /** second at which this entry expires, 0 if unused */
+  u32_t expire;
   u8_t port;
-  u32_t ts;
   struct eth_addr addr;
 } bridgeif_dfdb_entry_t;
 
 typedef struct bridgeif_dfdb_s {
   u16_t max_fdb_entries;
+  u16_t hash_mask;
+  u16_t free_list;
+  /** seconds since init, advanced by the aging timer */
+  u32_t now;
+  u16_t wheel[BRIDGEIF_FDB_WHEEL_SIZE];
+  u16_t *buckets;
   bridgeif_dfdb_entry_t *fdb;
 } bridgeif_dfdb_t;
 
+static u16_t
+bridgeif_fdb_hash(const bridgeif_dfdb_t *fdb, const struct eth_addr *addr)
+{
+  u32_t h = ((u32_t)addr->addr[2] << 24) | ((u32_t)addr->addr[3] << 16) |
+            ((u32_t)addr->addr[4] << 8) | addr->addr[5];
+  h ^= (((u32_t)addr->addr[0] << 8) | addr->addr[1]) * 0x9E3779B1UL;
+  h *= 0x9E3779B1UL;
+  return (u16_t)((h >> 16) & fdb->hash_mask);
+}
+
+/* Call with the bucket protected */
+static bridgeif_dfdb_entry_t *
+bridgeif_fdb_find(bridgeif_dfdb_t *fdb, u16_t bucket, const struct eth_addr *addr)
+{
+  u16_t idx;
+  for (idx = fdb->buckets[bucket]; idx != 0; idx = fdb->fdb[idx - 1].next) {
+    bridgeif_dfdb_entry_t *e = &fdb->fdb[idx - 1];
+    if (!memcmp(&e->addr, addr, sizeof(struct eth_addr))) {
+      return e;
+    }
+  }
+  return NULL;
+}
+
+/* Call with the bucket and the fdb protected */
+static void
+bridgeif_fdb_wheel_add(bridgeif_dfdb_t *fdb, u16_t idx)
+{
+  bridgeif_dfdb_entry_t *e = &fdb->fdb[idx - 1];
+  u32_t slot = e->expire & (BRIDGEIF_FDB_WHEEL_SIZE - 1);
+  e->wnext = fdb->wheel[slot];
+  fdb->wheel[slot] = idx;
+}
+
 /**
  * @ingroup bridgeif_fdb
- * A real simple and slow implementation of an auto-learning forwarding database that
- * remembers known src mac addresses to know which port to send frames destined for that
- * mac address.
- *
- * ATTENTION: This is meant as an example only, in real-world use, you should 
- * provide a better implementation :-)
+ * An auto-learning forwarding database that remembers known src mac addresses
+ * to know which port to send frames destined for that mac address.
+ * Entries are hashed by mac address, so learning and lookup only walk a
+ * single bucket, and new entries are taken from a free list.
  */
 void
 bridgeif_fdb_update_src(void *fdb_ptr, struct eth_addr *src_addr, u8_t port_idx)
 {
-  int i;
+  u16_t bucket, idx;
+  bridgeif_dfdb_entry_t *e;
   bridgeif_dfdb_t *fdb = (bridgeif_dfdb_t *)fdb_ptr;
   BRIDGEIF_DECL_PROTECT(lev);
-  BRIDGEIF_READ_PROTECT(lev);
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
-      if (!memcmp(&e->addr, src_addr, sizeof(struct eth_addr))) {
-        LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: update src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
-                                         src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
-                                         port_idx, i));
-        BRIDGEIF_WRITE_PROTECT(lev);
-        e->ts = BR_FDB_TIMEOUT_SEC;
-        e->port = port_idx;
-        BRIDGEIF_WRITE_UNPROTECT(lev);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return;
-      }
-    }
+
+  bucket = bridgeif_fdb_hash(fdb, src_addr);
+  BRIDGEIF_FDB_BUCKET_PROTECT(lev, bucket);
+  e = bridgeif_fdb_find(fdb, bucket, src_addr);
+  if (e != NULL) {
+    LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: update src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
+                                     src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
+                                     port_idx, (int)(e - fdb->fdb)));
+    BRIDGEIF_WRITE_PROTECT(lev);
+    /* the entry stays in its wheel slot and is moved on when that slot is aged */
+    e->expire = fdb->now + BR_FDB_TIMEOUT_SEC;
+    e->port = port_idx;
+    BRIDGEIF_WRITE_UNPROTECT(lev);
+    BRIDGEIF_FDB_BUCKET_UNPROTECT(lev, bucket);
+    return;
   }
-  /* not found, allocate new entry from free */
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (!e->used || !e->ts) {
-      BRIDGEIF_WRITE_PROTECT(lev);
-      /* check again when protected */
-      if (!e->used || !e->ts) {
-        LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: create src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
-                                         src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
-                                         port_idx, i));
-        memcpy(&e->addr, src_addr, sizeof(struct eth_addr));
-        e->ts = BR_FDB_TIMEOUT_SEC;
-        e->port = port_idx;
-        e->used = 1;
-        BRIDGEIF_WRITE_UNPROTECT(lev);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return;
-      }
-      BRIDGEIF_WRITE_UNPROTECT(lev);
-    }
+  /* not found, allocate new entry from free list */
+  BRIDGEIF_WRITE_PROTECT(lev);
+  idx = fdb->free_list;
+  if (idx != 0) {
+    e = &fdb->fdb[idx - 1];
+    fdb->free_list = e->wnext;
+    LWIP_DEBUGF(BRIDGEIF_FDB_DEBUG, ("br: create src %02x:%02x:%02x:%02x:%02x:%02x (from %d) @ idx %d\n",
+                                     src_addr->addr[0], src_addr->addr[1], src_addr->addr[2], src_addr->addr[3], src_addr->addr[4], src_addr->addr[5],
+                                     port_idx, idx - 1));
+    memcpy(&e->addr, src_addr, sizeof(struct eth_addr));
+    e->expire = fdb->now + BR_FDB_TIMEOUT_SEC;
+    e->port = port_idx;
+    bridgeif_fdb_wheel_add(fdb, idx);
+    e->next = fdb->buckets[bucket];
+    fdb->buckets[bucket] = idx;
   }
-  BRIDGEIF_READ_UNPROTECT(lev);
-  /* not found, no free entry -> flood */
+  BRIDGEIF_WRITE_UNPROTECT(lev);
+  BRIDGEIF_FDB_BUCKET_UNPROTECT(lev, bucket);
+  /* no free entry -> flood */
 }
 
-/** 
+/**
  * @ingroup bridgeif_fdb
- * Walk our list of auto-learnt fdb entries and return a port to forward or BR_FLOOD if unknown 
+ * Look up a destination in our auto-learnt fdb entries and return a port to forward or BR_FLOOD if unknown
  */
 bridgeif_portmask_t
 bridgeif_fdb_get_dst_ports(void *fdb_ptr, struct eth_addr *dst_addr)
 {
-  int i;
+  u16_t bucket;
+  bridgeif_dfdb_entry_t *e;
+  bridgeif_portmask_t ret = BR_FLOOD;
   bridgeif_dfdb_t *fdb = (bridgeif_dfdb_t *)fdb_ptr;
   BRIDGEIF_DECL_PROTECT(lev);
-  BRIDGEIF_READ_PROTECT(lev);
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
-      if (!memcmp(&e->addr, dst_addr, sizeof(struct eth_addr))) {
-        bridgeif_portmask_t ret = (bridgeif_portmask_t)(1 << e->port);
-        BRIDGEIF_READ_UNPROTECT(lev);
-        return ret;
-      }
-    }
+
+  bucket = bridgeif_fdb_hash(fdb, dst_addr);
+  BRIDGEIF_FDB_BUCKET_PROTECT(lev, bucket);
+  e = bridgeif_fdb_find(fdb, bucket, dst_addr);
+  if (e != NULL) {
+    ret = (bridgeif_portmask_t)(1 << e->port);
   }
-  BRIDGEIF_READ_UNPROTECT(lev);
-  return BR_FLOOD;
+  BRIDGEIF_FDB_BUCKET_UNPROTECT(lev, bucket);
+  return ret;
 }
 
 /**
  * @ingroup bridgeif_fdb
- * Aging implementation of our simple fdb
+ * Aging implementation of our fdb: only the entries filed in the wheel slot
+ * of the current second are visited. Those that have not been refreshed
+ * expire, the others are filed again in the slot of their new expiry time.
  */
 static void
 bridgeif_fdb_age_one_second(void *fdb_ptr)
 {
-  int i;
+  u16_t idx;
+  u32_t now;
   bridgeif_dfdb_t *fdb;
   BRIDGEIF_DECL_PROTECT(lev);
 
   fdb = (bridgeif_dfdb_t *)fdb_ptr;
+
+  /* detach the slot that is due now */
   BRIDGEIF_READ_PROTECT(lev);
+  BRIDGEIF_WRITE_PROTECT(lev);
+  now = ++fdb->now;
+  idx = fdb->wheel[now & (BRIDGEIF_FDB_WHEEL_SIZE - 1)];
+  fdb->wheel[now & (BRIDGEIF_FDB_WHEEL_SIZE - 1)] = 0;
+  BRIDGEIF_WRITE_UNPROTECT(lev);
+  BRIDGEIF_READ_UNPROTECT(lev);
+
+  while (idx != 0) {
+    bridgeif_dfdb_entry_t *e = &fdb->fdb[idx - 1];
+    u16_t next = e->wnext;
+    u16_t bucket = bridgeif_fdb_hash(fdb, &e->addr);
 
-  for (i = 0; i < fdb->max_fdb_entries; i++) {
-    bridgeif_dfdb_entry_t *e = &fdb->fdb[i];
-    if (e->used && e->ts) {
-      BRIDGEIF_WRITE_PROTECT(lev);
-      /* check again when protected */
-      if (e->used && e->ts) {
-        if (--e->ts == 0) {
-          e->used = 0;
-        }
+    BRIDGEIF_FDB_BUCKET_PROTECT(lev, bucket);
+    BRIDGEIF_WRITE_PROTECT(lev);
+    if ((s32_t)(e->expire - now) <= 0) {
+      u16_t *pidx = &fdb->buckets[bucket];
+      while (*pidx != idx) {
+        LWIP_ASSERT("fdb entry not in its bucket", *pidx != 0);
+        pidx = &fdb->fdb[*pidx - 1].next;
       }
-      BRIDGEIF_WRITE_UNPROTECT(lev);
+      *pidx = e->next;
+      e->expire = 0;
+      e->wnext = fdb->free_list;
+      fdb->free_list = idx;
+    } else {
+      bridgeif_fdb_wheel_add(fdb, idx);
     }
+    BRIDGEIF_WRITE_UNPROTECT(lev);
+    BRIDGEIF_FDB_BUCKET_UNPROTECT(lev, bucket);
+    idx = next;
   }
-  BRIDGEIF_READ_UNPROTECT(lev);
 }
 
 /** Timer callback for fdb aging, called once per second */
@@ -189,14 +251,23 @@ bridgeif_age_tmr(void *arg)
 
 /**
  * @ingroup bridgeif_fdb
- * Init our simple fdb list
+ * Init our fdb: one hash bucket per entry (rounded up to a power of 2)
  */
 void *
 bridgeif_fdb_init(u16_t max_fdb_entries)
 {
   bridgeif_dfdb_t *fdb;
-  size_t alloc_len_sizet = sizeof(bridgeif_dfdb_t) + (max_fdb_entries * sizeof(bridgeif_dfdb_entry_t));
-  mem_size_t alloc_len = (mem_size_t)alloc_len_sizet;
+  u32_t num_buckets = 1;
+  size_t alloc_len_sizet;
+  mem_size_t alloc_len;
+  u16_t i;
+
+  while (num_buckets < max_fdb_entries) {
+    num_buckets <<= 1;
+  }
+  alloc_len_sizet = sizeof(bridgeif_dfdb_t) + (max_fdb_entries * sizeof(bridgeif_dfdb_entry_t)) +
+                    (num_buckets * sizeof(u16_t));
+  alloc_len = (mem_size_t)alloc_len_sizet;
   LWIP_ASSERT("alloc_len == alloc_len_sizet", alloc_len == alloc_len_sizet);
   LWIP_DEBUGF(BRIDGEIF_DEBUG, ("bridgeif_fdb_init: allocating %d bytes for private FDB data\n", (int)alloc_len));
   fdb = (bridgeif_dfdb_t *)mem_calloc(1, alloc_len);
@@ -204,7 +275,13 @@ bridgeif_fdb_init(u16_t max_fdb_entries)
     return NULL;
   }
   fdb->max_fdb_entries = max_fdb_entries;
+  fdb->hash_mask = (u16_t)(num_buckets - 1);
   fdb->fdb = (bridgeif_dfdb_entry_t *)(fdb + 1);
+  fdb->buckets = (u16_t *)(fdb->fdb + max_fdb_entries);
+  for (i = max_fdb_entries; i > 0; i--) {
+    fdb->fdb[i - 1].wnext = fdb->free_list;
+    fdb->free_list = i;
+  }
 
   sys_timeout(BRIDGEIF_AGE_TIMER_MS, bridgeif_age_tmr, fdb);
 
@@ -48,6 +48,7 @@
 #include "lwip/etharp.h"
 #include "lwip/ip.h"
 #include "lwip/snmp.h"
+#include "lwip/gro.h"
 
 #include <string.h>
 
@@ -183,7 +184,11 @@ ethernet_input(struct pbuf *p, struct netif *netif)
         goto free_and_return;
       } else {
         /* pass to IP layer */
+#if LWIP_TCP_GRO
+        gro_input(p, netif);
+#else /* LWIP_TCP_GRO */
         ip4_input(p, netif);
+#endif /* LWIP_TCP_GRO */
       }
       break;
 
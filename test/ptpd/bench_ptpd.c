@@ -0,0 +1,287 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Micro-benchmark for the ptpd message path.
+ *
+ * For every message type this measures the cost of packing it, unpacking
+ * it, and running it through the protocol engine (ptp_do_state() -> handle()
+ * -> on_*()) in a port state where the message is actually processed. The
+ * network path and the clock are provided by ptpd_host.c, so the numbers
+ * only contain protocol work.
+ *
+ * Usage: bench_ptpd [iterations]
+ */
+
+#include "ptpd_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_ITERATIONS 1000000
+
+/* Identity of the simulated remote master */
+static const octet_t master_identity[PTPD_CLOCK_IDENTITY_LENGTH] = {
+  0x00, 0x1B, 0x19, 0xFF, 0xFE, 0x00, 0x00, 0x01
+};
+
+struct bench {
+  const char *name;
+  u8_t delay_mechanism;
+  u8_t state;
+  enum ptpd_host_port port;
+  u16_t len;
+  void (*pack)(octet_t *buf);
+  void (*unpack)(const octet_t *buf);
+  void (*prepare)(void);
+};
+
+static union {
+  msg_header_t header;
+  msg_announce_t announce;
+  msg_sync_t sync;
+  msg_followup_t follow;
+  msg_delay_req_t req;
+  msg_delay_resp_t resp;
+  msg_pdelay_req_t preq;
+  msg_pdelay_resp_t presp;
+  msg_pdelay_resp_followup_t prespfollow;
+  msg_management manage;
+} bench_msg;
+
+static timestamp_t bench_ts;
+static msg_header_t bench_req_header;
+
+static void
+set_source_master(octet_t *buf)
+{
+  memcpy(buf + 20, master_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  *(int16_t *)(buf + 28) = flip16(1);
+}
+
+/* A request as sent by this clock, answered by the master */
+static void
+init_req_header(int16_t sequence_id)
+{
+  memcpy(&bench_req_header.source_port_identity, &ptpd_host_clock.port_ds.port_identity, sizeof(port_identity_t));
+  bench_req_header.sequence_id = sequence_id;
+  bench_req_header.correction_field = 0;
+}
+
+static void pack_announce(octet_t *buf) { msg_pack_announce(&ptpd_host_clock, buf); set_source_master(buf); }
+static void pack_sync(octet_t *buf) { msg_pack_sync(&ptpd_host_clock, buf, &bench_ts); set_source_master(buf); }
+static void pack_followup(octet_t *buf) { msg_pack_followup(&ptpd_host_clock, buf, &bench_ts); set_source_master(buf); }
+static void pack_delay_req(octet_t *buf) { msg_pack_delay_req(&ptpd_host_clock, buf, &bench_ts); set_source_master(buf); }
+static void pack_pdelay_req(octet_t *buf) { msg_pack_pdelay_req(&ptpd_host_clock, buf, &bench_ts); set_source_master(buf); }
+
+static void
+pack_delay_resp(octet_t *buf)
+{
+  init_req_header(ptpd_host_clock.sent_delay_req_sequence_id - 1);
+  msg_pack_relay_resp(&ptpd_host_clock, buf, &bench_req_header, &bench_ts);
+  set_source_master(buf);
+}
+
+static void
+pack_pdelay_resp(octet_t *buf)
+{
+  init_req_header(ptpd_host_clock.sent_pdelay_req_sequence_id - 1);
+  msg_pack_pdelay_resp(buf, &bench_req_header, &bench_ts);
+  set_source_master(buf);
+}
+
+static void
+pack_pdelay_resp_followup(octet_t *buf)
+{
+  init_req_header(ptpd_host_clock.sent_pdelay_req_sequence_id - 1);
+  msg_pack_pdelay_resp_followup(buf, &bench_req_header, &bench_ts);
+  set_source_master(buf);
+}
+
+/* A management GET of the parent data set, as polled by a manager */
+static void
+pack_management_get(octet_t *buf)
+{
+  msg_management manage;
+
+  memset(&manage, 0, sizeof(manage));
+  memset(manage.target_port_identity.clock_identity, 0xFF, PTPD_CLOCK_IDENTITY_LENGTH);
+  manage.target_port_identity.port_number = (int16_t)0xFFFF;
+  manage.action_field = MM_GET;
+  manage.tlv_type = TLV_MANAGEMENT;
+  manage.length_field = 2;
+  manage.management_id = MM_PARENT_DATA_SET;
+  msg_pack_management(&ptpd_host_clock, buf, 1, &manage);
+  set_source_master(buf);
+}
+
+static void unpack_announce(const octet_t *buf) { msg_unpack_announce(buf, &bench_msg.announce); }
+static void unpack_sync(const octet_t *buf) { msg_unpack_sync(buf, &bench_msg.sync); }
+static void unpack_followup(const octet_t *buf) { msg_unpack_followup(buf, &bench_msg.follow); }
+static void unpack_delay_req(const octet_t *buf) { msg_unpack_delay_req(buf, &bench_msg.req); }
+static void unpack_delay_resp(const octet_t *buf) { msg_unpack_delay_resp(buf, &bench_msg.resp); }
+static void unpack_pdelay_req(const octet_t *buf) { msg_unpack_pdelay_req(buf, &bench_msg.preq); }
+static void unpack_pdelay_resp(const octet_t *buf) { msg_unpack_pdelay_resp(buf, &bench_msg.presp); }
+static void unpack_pdelay_resp_followup(const octet_t *buf) { msg_unpack_pdelay_resp_followup(buf, &bench_msg.prespfollow); }
+static void unpack_management(const octet_t *buf) { msg_unpack_management(buf, &bench_msg.manage); }
+
+/* Make the clock wait for the Follow_Up matching the benchmarked one */
+static void
+prepare_followup(void)
+{
+  ptpd_host_clock.waiting_for_followup = TRUE;
+  ptpd_host_clock.recv_sync_sequence_id = ptpd_host_clock.sent_sync_sequence_id - 1;
+  ptpd_host_get_time(&ptpd_host_clock.timestamp_sync_recv);
+}
+
+static void
+prepare_pdelay_resp_followup(void)
+{
+  ptpd_host_clock.waiting_for_pdelay_resp_followup = TRUE;
+}
+
+static const struct bench benches[] = {
+  { "announce", E2E, PTP_SLAVE, PTPD_HOST_GENERAL, PTPD_ANNOUNCE_LENGTH, pack_announce, unpack_announce, NULL },
+  { "sync", E2E, PTP_SLAVE, PTPD_HOST_EVENT, PTPD_SYNC_LENGTH, pack_sync, unpack_sync, NULL },
+  { "follow_up", E2E, PTP_SLAVE, PTPD_HOST_GENERAL, PTPD_FOLLOW_UP_LENGTH, pack_followup, unpack_followup, prepare_followup },
+  { "delay_req", E2E, PTP_MASTER, PTPD_HOST_EVENT, PTPD_DELAY_REQ_LENGTH, pack_delay_req, unpack_delay_req, NULL },
+  { "delay_resp", E2E, PTP_SLAVE, PTPD_HOST_GENERAL, PTPD_DELAY_RESP_LENGTH, pack_delay_resp, unpack_delay_resp, NULL },
+  { "pdelay_req", P2P, PTP_MASTER, PTPD_HOST_EVENT, PTPD_PDELAY_REQ_LENGTH, pack_pdelay_req, unpack_pdelay_req, NULL },
+  { "pdelay_resp", P2P, PTP_SLAVE, PTPD_HOST_EVENT, PTPD_PDELAY_RESP_LENGTH, pack_pdelay_resp, unpack_pdelay_resp, NULL },
+  { "pdelay_resp_fu", P2P, PTP_SLAVE, PTPD_HOST_GENERAL, PTPD_PDELAY_RESP_FOLLOW_UP_LENGTH, pack_pdelay_resp_followup, unpack_pdelay_resp_followup, prepare_pdelay_resp_followup },
+  { "management_get", E2E, PTP_SLAVE, PTPD_HOST_GENERAL, PTPD_MANAGEMENT_LENGTH + PTPD_MANAGEMENT_TLV_LENGTH, pack_management_get, unpack_management, NULL },
+};
+
+static double
+now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Bring the host clock into the state a benchmark needs, slaved to the
+   simulated master where applicable. */
+static void
+setup(const struct bench *b)
+{
+  time_interval_t t;
+
+  msg_header_t header;
+  msg_announce_t announce;
+
+  ptpd_host_init(b->delay_mechanism, b->state != PTP_MASTER);
+
+  /* the simulated master is the best (and only) foreign master */
+  memset(&header, 0, sizeof(header));
+  memset(&announce, 0, sizeof(announce));
+  memcpy(header.source_port_identity.clock_identity, master_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  header.source_port_identity.port_number = 1;
+  memcpy(announce.grandmaster_identity, master_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  announce.grandmaster_priority1 = ptpd_host_clock.default_ds.priority1;
+  announce.grandmaster_priority2 = ptpd_host_clock.default_ds.priority2;
+  announce.grandmaster_clock_quality = ptpd_host_clock.default_ds.clock_quality;
+  bmc_add_foreign(&ptpd_host_clock, &header, &announce);
+  if (b->state != PTP_MASTER) {
+    bmc_s1(&ptpd_host_clock, &header, &announce);
+  }
+  ptpd_host_clock.events = 0;
+
+  ptpd_host_run_to_state(b->state);
+  ptpd_host_clock.sent_delay_req_sequence_id = 1;
+  ptpd_host_clock.sent_pdelay_req_sequence_id = 1;
+  ptpd_host_clock.sent_sync_sequence_id = 1;
+  /* a valid offset from master makes delay responses reach the servo */
+  ptpd_host_clock.ofm_filt.n = 1;
+
+  ptpd_host_get_time(&t);
+  ptp_time_from_internal(&t, &bench_ts);
+}
+
+int
+main(int argc, char **argv)
+{
+  long iterations = BENCH_DEFAULT_ITERATIONS;
+  octet_t buf[PACKET_SIZE];
+  size_t i;
+  long n;
+
+  if (argc > 1) {
+    iterations = strtol(argv[1], NULL, 0);
+    if (iterations <= 0) {
+      fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  printf("%-16s %10s %10s %10s %14s\n", "message", "pack ns", "unpack ns", "handle ns", "handle msg/s");
+
+  for (i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+    const struct bench *b = &benches[i];
+    double t0, t_pack, t_unpack, t_handle;
+
+    setup(b);
+    memset(buf, 0, sizeof(buf));
+    msg_pack_header(&ptpd_host_clock, buf);
+
+    t0 = now_ns();
+    for (n = 0; n < iterations; n++) {
+      b->pack(buf);
+    }
+    t_pack = (now_ns() - t0) / (double)iterations;
+
+    t0 = now_ns();
+    for (n = 0; n < iterations; n++) {
+      b->unpack(buf);
+    }
+    t_unpack = (now_ns() - t0) / (double)iterations;
+
+    t0 = now_ns();
+    for (n = 0; n < iterations; n++) {
+      if (b->prepare != NULL) {
+        b->prepare();
+      }
+      ptpd_host_deliver(b->port, buf, b->len, NULL);
+      ptp_do_state(&ptpd_host_clock);
+    }
+    t_handle = (now_ns() - t0) / (double)iterations;
+
+    if (ptpd_host_clock.port_ds.port_state != b->state) {
+      fprintf(stderr, "%s: port left state %d (now %d), results not representative\n",
+              b->name, b->state, ptpd_host_clock.port_ds.port_state);
+    }
+
+    printf("%-16s %10.1f %10.1f %10.1f %14.0f\n", b->name, t_pack, t_unpack, t_handle, 1e9 / t_handle);
+  }
+
+  return 0;
+}
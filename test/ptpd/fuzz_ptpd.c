@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * libFuzzer target for the ptpd message codecs and the protocol engine.
+ *
+ * Input layout:
+ *   byte 0      configuration: bit 0 selects P2P instead of E2E, bit 1
+ *               makes the clock slave only, bits 4..7 select the port
+ *               state the messages are injected in
+ *   byte 1..n   a sequence of records: 1 byte flags (bit 0: general port,
+ *               bits 1..7: milliseconds to advance the virtual clock),
+ *               2 bytes big endian length, then the message itself
+ *
+ * Every record is first run through each msg_unpack_*() whose minimal
+ * length it satisfies, using a heap copy of exactly the record length, so
+ * that AddressSanitizer reports any field read beyond the PTPD_*_LENGTH a
+ * handler checks before unpacking. The record is then delivered to the
+ * host network path and the protocol engine is run on it.
+ *
+ * Build with 'make fuzz_ptpd' (clang, -fsanitize=fuzzer,address) or with
+ * 'make fuzz_ptpd_standalone' for a binary reading the input from a file
+ * or stdin (e.g. for afl or to reproduce a crash with gcc).
+ */
+
+#include "ptpd_host.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef void (*unpack_fn)(const octet_t *buf, void *msg);
+
+#define CODEC_WRAPPER(name, type) \
+  static void unpack_##name(const octet_t *buf, void *msg) { msg_unpack_##name(buf, (type *)msg); }
+
+CODEC_WRAPPER(header, msg_header_t)
+CODEC_WRAPPER(announce, msg_announce_t)
+CODEC_WRAPPER(sync, msg_sync_t)
+CODEC_WRAPPER(followup, msg_followup_t)
+CODEC_WRAPPER(delay_req, msg_delay_req_t)
+CODEC_WRAPPER(delay_resp, msg_delay_resp_t)
+CODEC_WRAPPER(pdelay_req, msg_pdelay_req_t)
+CODEC_WRAPPER(pdelay_resp, msg_pdelay_resp_t)
+CODEC_WRAPPER(pdelay_resp_followup, msg_pdelay_resp_followup_t)
+CODEC_WRAPPER(management, msg_management)
+
+struct codec {
+  u16_t min_len;
+  unpack_fn unpack;
+};
+
+static const struct codec codecs[] = {
+  { PTPD_HEADER_LENGTH, unpack_header },
+  { PTPD_ANNOUNCE_LENGTH, unpack_announce },
+  { PTPD_SYNC_LENGTH, unpack_sync },
+  { PTPD_FOLLOW_UP_LENGTH, unpack_followup },
+  { PTPD_DELAY_REQ_LENGTH, unpack_delay_req },
+  { PTPD_DELAY_RESP_LENGTH, unpack_delay_resp },
+  { PTPD_PDELAY_REQ_LENGTH, unpack_pdelay_req },
+  { PTPD_PDELAY_RESP_LENGTH, unpack_pdelay_resp },
+  { PTPD_PDELAY_RESP_FOLLOW_UP_LENGTH, unpack_pdelay_resp_followup },
+  { PTPD_MANAGEMENT_LENGTH + PTPD_MANAGEMENT_TLV_LENGTH, unpack_management },
+};
+
+static const u8_t states[] = {
+  PTP_LISTENING,
+  PTP_UNCALIBRATED,
+  PTP_SLAVE,
+  PTP_MASTER,
+  PTP_PASSIVE,
+  PTP_DISABLED,
+};
+
+static void
+fuzz_codecs(const u8_t *data, u16_t len)
+{
+  size_t i;
+  octet_t *buf;
+  union {
+    msg_header_t header;
+    msg_announce_t announce;
+    msg_sync_t sync;
+    msg_followup_t follow;
+    msg_delay_req_t req;
+    msg_delay_resp_t resp;
+    msg_pdelay_req_t preq;
+    msg_pdelay_resp_t presp;
+    msg_pdelay_resp_followup_t prespfollow;
+  } msg;
+
+  buf = (octet_t *)malloc(len);
+  if (buf == NULL) {
+    return;
+  }
+  memcpy(buf, data, len);
+  for (i = 0; i < sizeof(codecs) / sizeof(codecs[0]); i++) {
+    if (len >= codecs[i].min_len) {
+      codecs[i].unpack(buf, &msg);
+    }
+  }
+  free(buf);
+}
+
+int
+LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  u8_t config;
+
+  if (size < 1) {
+    return 0;
+  }
+  config = *data++;
+  size--;
+
+  ptpd_host_init((config & 0x01) ? P2P : E2E, (config & 0x02) != 0);
+  ptpd_host_run_to_state(states[(config >> 4) % sizeof(states)]);
+
+  while (size > 3) {
+    u8_t flags = data[0];
+    u16_t len = (u16_t)((data[1] << 8) | data[2]);
+
+    data += 3;
+    size -= 3;
+    if (len > size) {
+      len = (u16_t)size;
+    }
+    if (len > PACKET_SIZE) {
+      len = PACKET_SIZE;
+    }
+
+    fuzz_codecs(data, len);
+
+    ptpd_host_advance((s32_t)(flags >> 1) * 1000000);
+    ptpd_host_deliver((flags & 0x01) ? PTPD_HOST_GENERAL : PTPD_HOST_EVENT, (const octet_t *)data, len, NULL);
+    ptp_do_state(&ptpd_host_clock);
+
+    data += len;
+    size -= len;
+  }
+
+  /* let pending timers fire once more */
+  ptp_do_state(&ptpd_host_clock);
+  return 0;
+}
+
+#ifdef PTPD_FUZZ_STANDALONE
+static u8_t input[0x10000];
+
+int
+main(int argc, char **argv)
+{
+  FILE *f = stdin;
+  size_t len;
+
+  if (argc > 1) {
+    f = fopen(argv[1], "rb");
+    if (f == NULL) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+  len = fread(input, 1, sizeof(input), f);
+  if (f != stdin) {
+    fclose(f);
+  }
+  return LLVMFuzzerTestOneInput(input, len);
+}
+#endif /* PTPD_FUZZ_STANDALONE */
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#include "ptpd_host.h"
+
+struct ptpd_host_stats ptpd_host_stats;
+ptpd_opts ptpd_host_opts;
+ptp_clock_t ptpd_host_clock;
+
+static foreign_master_record_t host_foreign[PTPD_DEFAULT_MAX_FOREIGN_RECORDS];
+
+/* Virtual clock: current time and the last frequency adjustment (ppb) */
+static time_interval_t host_now;
+static s32_t host_adj;
+static u32_t host_rand_seed = 1;
+
+/* One pending message per port, plus the last message sent on it */
+struct host_msg {
+  octet_t buf[PACKET_SIZE];
+  u16_t len;
+  time_interval_t time;
+};
+static struct host_msg host_rx[PTPD_HOST_NUM_PORTS];
+static struct host_msg host_tx[PTPD_HOST_NUM_PORTS];
+
+/* Protocol timers, in milliseconds of virtual time */
+struct host_timer {
+  bool running;
+  s64_t deadline;
+  u32_t interval;
+};
+static struct host_timer host_timers[TIMER_ARRAY_SIZE];
+
+static const octet_t host_hwaddr[6] = { 0x00, 0x23, 0xC1, 0xDE, 0xD0, 0x0D };
+
+static s64_t
+host_now_ms(void)
+{
+  return (s64_t)host_now.seconds * 1000 + host_now.nanoseconds / 1000000;
+}
+
+void
+ptpd_host_init(u8_t delay_mechanism, bool slave_only)
+{
+  memset(&ptpd_host_clock, 0, sizeof(ptpd_host_clock));
+  memset(host_foreign, 0, sizeof(host_foreign));
+  memset(host_rx, 0, sizeof(host_rx));
+  memset(host_tx, 0, sizeof(host_tx));
+  memset(host_timers, 0, sizeof(host_timers));
+  memset(&ptpd_host_stats, 0, sizeof(ptpd_host_stats));
+  host_now.seconds = 1;
+  host_now.nanoseconds = 0;
+  host_adj = 0;
+  host_rand_seed = 1;
+
+  /* the defaults of the target's ptpd_opts_init() */
+  ptpd_opts_set_defaults(&ptpd_host_opts);
+  ptpd_host_opts.slave_only = slave_only;
+  ptpd_host_opts.delay_mechanism = delay_mechanism;
+
+  ptp_startup(&ptpd_host_clock, &ptpd_host_opts, host_foreign);
+
+  /* PTP_INITIALIZING -> PTP_LISTENING */
+  ptp_do_state(&ptpd_host_clock);
+}
+
+/* Force the port into 'state' and keep the state machine from leaving it
+   on its own, so that messages can be injected in any state. */
+void
+ptpd_host_run_to_state(u8_t state)
+{
+  if (ptpd_host_clock.port_ds.port_state != state) {
+    ptp_to_state(&ptpd_host_clock, state);
+  }
+  ptpd_host_clock.recommended_state = state;
+}
+
+void
+ptpd_host_set_time(const time_interval_t *time)
+{
+  host_now = *time;
+}
+
+void
+ptpd_host_get_time(time_interval_t *time)
+{
+  *time = host_now;
+}
+
+/* Advance the virtual clock by 'nanoseconds' of reference time. The last
+   frequency adjustment requested by the servo is applied on top. */
+void
+ptpd_host_advance(s32_t nanoseconds)
+{
+  time_interval_t delta;
+  s64_t ns = (s64_t)nanoseconds + ((s64_t)nanoseconds * host_adj) / 1000000000;
+
+  delta.seconds = (s32_t)(ns / 1000000000);
+  delta.nanoseconds = (s32_t)(ns % 1000000000);
+  ptp_time_add(&host_now, &host_now, &delta);
+}
+
+bool
+ptpd_host_deliver(enum ptpd_host_port port, const octet_t *buf, u16_t len, const time_interval_t *rx_time)
+{
+  struct host_msg *msg = &host_rx[port];
+
+  if ((msg->len != 0) || (len == 0) || (len > PACKET_SIZE)) {
+    return false;
+  }
+  memcpy(msg->buf, buf, len);
+  msg->len = len;
+  msg->time = (rx_time != NULL) ? *rx_time : host_now;
+  return true;
+}
+
+const octet_t *
+ptpd_host_last_sent(enum ptpd_host_port port, u16_t *len)
+{
+  *len = host_tx[port].len;
+  return host_tx[port].buf;
+}
+
+static ssize_t
+host_recv(enum ptpd_host_port port, octet_t *buf, time_interval_t *time)
+{
+  struct host_msg *msg = &host_rx[port];
+  ssize_t len = msg->len;
+
+  if (len == 0) {
+    return 0;
+  }
+  memcpy(buf, msg->buf, (size_t)len);
+  if (time != NULL) {
+    *time = msg->time;
+  }
+  msg->len = 0;
+  ptpd_host_stats.rx[port]++;
+  return len;
+}
+
+static ssize_t
+host_send(enum ptpd_host_port port, const octet_t *buf, int16_t length, time_interval_t *time)
+{
+  struct host_msg *msg = &host_tx[port];
+
+  if ((length <= 0) || (length > PACKET_SIZE)) {
+    return 0;
+  }
+  memcpy(msg->buf, buf, (size_t)length);
+  msg->len = (u16_t)length;
+  msg->time = host_now;
+  if (time != NULL) {
+    *time = host_now;
+  }
+  ptpd_host_stats.tx[port]++;
+  return length;
+}
+
+/* ptp_daemon.c replacement */
+
+bool
+ptpd_net_init(net_path_t *net_path, ptp_clock_t *clock)
+{
+  LWIP_UNUSED_ARG(net_path);
+  memcpy(clock->port_uuid_field, host_hwaddr, sizeof(host_hwaddr));
+  return true;
+}
+
+bool
+ptpd_shutdown(net_path_t *net_path)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return true;
+}
+
+int32_t
+ptpd_net_select(net_path_t *net_path, const time_interval_t *timeout)
+{
+  LWIP_UNUSED_ARG(net_path);
+  LWIP_UNUSED_ARG(timeout);
+  return (host_rx[PTPD_HOST_EVENT].len != 0) || (host_rx[PTPD_HOST_GENERAL].len != 0);
+}
+
+void
+ptpd_empty_event_queue(net_path_t *net_path)
+{
+  LWIP_UNUSED_ARG(net_path);
+  host_rx[PTPD_HOST_EVENT].len = 0;
+}
+
+ssize_t
+ptpd_recv_event(net_path_t *net_path, octet_t *buf, time_interval_t *time)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_recv(PTPD_HOST_EVENT, buf, time);
+}
+
+ssize_t
+ptpd_recv_general(net_path_t *net_path, octet_t *buf, time_interval_t *time)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_recv(PTPD_HOST_GENERAL, buf, time);
+}
+
+ssize_t
+ptpd_send_event(net_path_t *net_path, const octet_t *buf, int16_t length, time_interval_t *time)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_send(PTPD_HOST_EVENT, buf, length, time);
+}
+
+ssize_t
+ptpd_send_general(net_path_t *net_path, const octet_t *buf, int16_t length)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_send(PTPD_HOST_GENERAL, buf, length, NULL);
+}
+
+ssize_t
+ptpd_peer_send_general(net_path_t *net_path, const octet_t *buf, int16_t length)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_send(PTPD_HOST_GENERAL, buf, length, NULL);
+}
+
+ssize_t
+ptpd_peer_send_event(net_path_t *net_path, const octet_t *buf, int16_t length, time_interval_t *time)
+{
+  LWIP_UNUSED_ARG(net_path);
+  return host_send(PTPD_HOST_EVENT, buf, length, time);
+}
+
+void
+ptpd_alert(void)
+{
+}
+
+void
+sys_get_clocktime(time_interval_t *time)
+{
+  *time = host_now;
+}
+
+void
+sys_set_clocktime(const time_interval_t *time)
+{
+  host_now = *time;
+  ptpd_host_stats.set_clocktime++;
+}
+
+void
+ptpd_update_time(const time_interval_t *time)
+{
+  sys_set_clocktime(time);
+}
+
+bool
+ptpd_adj_frequency(int32_t adj)
+{
+  if (adj > ADJ_FREQ_MAX) {
+    adj = ADJ_FREQ_MAX;
+  } else if (adj < -ADJ_FREQ_MAX) {
+    adj = -ADJ_FREQ_MAX;
+  }
+  host_adj = adj;
+  ptpd_host_stats.last_adj = adj;
+  ptpd_host_stats.adj_frequency++;
+  return true;
+}
+
+uint32_t
+sys_get_rand(uint32_t rand_max)
+{
+  host_rand_seed = host_rand_seed * 1103515245 + 12345;
+  return (rand_max != 0) ? ((host_rand_seed >> 16) % rand_max) : 0;
+}
+
+/* timer.c replacement */
+
+void
+ptp_init_timer(void)
+{
+  memset(host_timers, 0, sizeof(host_timers));
+}
+
+void
+ptp_timer_stop(int32_t index)
+{
+  if ((index < 0) || (index >= TIMER_ARRAY_SIZE)) {
+    return;
+  }
+  host_timers[index].running = false;
+}
+
+void
+ptp_timer_start(int32_t index, uint32_t interval_ms)
+{
+  if ((index < 0) || (index >= TIMER_ARRAY_SIZE)) {
+    return;
+  }
+  host_timers[index].running = true;
+  host_timers[index].interval = interval_ms;
+  host_timers[index].deadline = host_now_ms() + interval_ms;
+}
+
+/* Timers are periodic like the target ones: an expired timer is re-armed
+   one interval after the current time. */
+bool
+ptp_timer_expired(int32_t index)
+{
+  s64_t now = host_now_ms();
+
+  if ((index < 0) || (index >= TIMER_ARRAY_SIZE)) {
+    return false;
+  }
+  if (!host_timers[index].running || (now < host_timers[index].deadline)) {
+    return false;
+  }
+  host_timers[index].deadline = now + host_timers[index].interval;
+  return true;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+#ifndef LWIP_HDR_PTPD_HOST_H
+#define LWIP_HDR_PTPD_HOST_H
+
+/*
+ * Host-side port of the ptpd application used by the fuzzer and the
+ * benchmark in this directory.
+ *
+ * It replaces the target specific ptp_daemon.c and timer.c: the network
+ * path is an in-memory mailbox holding at most one pending message per
+ * port, and the system clock and the protocol timers run off a virtual
+ * clock that only moves when ptpd_host_advance() is called. This makes
+ * every run deterministic and lets the protocol engine run as fast as the
+ * CPU allows.
+ */
+
+#include "lwip/apps/ptpd.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Port a message is delivered to or was sent from */
+enum ptpd_host_port {
+  PTPD_HOST_EVENT = 0,
+  PTPD_HOST_GENERAL,
+  PTPD_HOST_NUM_PORTS
+};
+
+/** Counters updated by the host network path */
+struct ptpd_host_stats {
+  u32_t rx[PTPD_HOST_NUM_PORTS];
+  u32_t tx[PTPD_HOST_NUM_PORTS];
+  u32_t adj_frequency;
+  s32_t last_adj;
+  u32_t set_clocktime;
+};
+
+extern struct ptpd_host_stats ptpd_host_stats;
+extern ptpd_opts ptpd_host_opts;
+extern ptp_clock_t ptpd_host_clock;
+
+void ptpd_host_init(u8_t delay_mechanism, bool slave_only);
+void ptpd_host_run_to_state(u8_t state);
+
+void ptpd_host_set_time(const time_interval_t *time);
+void ptpd_host_get_time(time_interval_t *time);
+void ptpd_host_advance(s32_t nanoseconds);
+
+bool ptpd_host_deliver(enum ptpd_host_port port, const octet_t *buf, u16_t len, const time_interval_t *rx_time);
+const octet_t *ptpd_host_last_sent(enum ptpd_host_port port, u16_t *len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LWIP_HDR_PTPD_HOST_H */
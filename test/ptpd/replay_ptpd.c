@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Replay a pcap of PTP traffic through the ptpd protocol engine.
+ *
+ * Every PTP message found in the capture (UDP/IPv4 ports 319 and 320, or
+ * IEEE 802.3 ethertype 0x88F7, optionally VLAN tagged) is delivered to the
+ * host network path at its capture time and handled by ptp_do_state(). The
+ * local clock is the virtual clock of ptpd_host.c: it follows the capture
+ * timestamps, starts with a configurable offset and is steered by the
+ * servo's frequency adjustments, so a replay reproduces what the servo and
+ * the BMC would have done on the captured network, as fast as the CPU
+ * allows. Protocol timers are run in between packets every tick.
+ *
+ * The trace is written to stdout as CSV, one line per event, the first
+ * column being the capture time:
+ *   <time>,state,<old state>,<new state>
+ *   <time>,parent,<parent port identity>,<grandmaster identity>
+ *   <time>,servo,<offset ns>,<mean path delay ns>,<observed drift>,<adj>
+ *   <time>,step,<offset s>,<offset ns>
+ *   <time>,asymmetry,<delay asymmetry ns>
+ *
+ * Usage: replay_ptpd [-p] [-M] [-o offset_ns] [-a asymmetry_ns] [-c samples]
+ *                    [-t tick_ms] [-s identity] file.pcap
+ *   -p  use the peer delay mechanism (default: E2E)
+ *   -M  allow the clock to become master (default: slave only)
+ *   -o  initial offset of the local clock from the capture time
+ *   -a  delay asymmetry of the port
+ *   -c  calibrate the delay asymmetry over that many Sync messages, taking
+ *       the capture time as the reference; the servo is off meanwhile
+ *   -t  timer granularity between packets, in ms (default: 10)
+ *   -s  impersonate the captured port xx:xx:xx:xx:xx:xx:xx:xx[/port]: its
+ *       Delay_Req/Pdelay_Req are taken as ours, so the delay responses in
+ *       the capture are matched and the path delay is measured
+ */
+
+#include "ptpd_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define PCAP_MAGIC_US       0xA1B2C3D4UL
+#define PCAP_MAGIC_NS       0xA1B23C4DUL
+#define PCAP_LINKTYPE_ETH   1
+#define PCAP_LINKTYPE_RAW   101
+#define PCAP_LINKTYPE_SLL   113
+
+#define ETHTYPE_IPV4        0x0800
+#define ETHTYPE_VLAN        0x8100
+#define ETHTYPE_PTP         0x88F7
+
+#define NS_PER_SEC          1000000000LL
+
+struct pcap_file {
+  FILE *f;
+  bool swapped;
+  bool nanoseconds;
+  u32_t linktype;
+};
+
+static u8_t frame[0x10000];
+
+static bool impersonate;
+static port_identity_t impersonated;
+
+static u32_t
+pcap_u32(const struct pcap_file *pcap, const u8_t *p)
+{
+  if (pcap->swapped) {
+    return ((u32_t)p[0] << 24) | ((u32_t)p[1] << 16) | ((u32_t)p[2] << 8) | p[3];
+  }
+  return ((u32_t)p[3] << 24) | ((u32_t)p[2] << 16) | ((u32_t)p[1] << 8) | p[0];
+}
+
+static u16_t
+get_u16(const u8_t *p)
+{
+  return (u16_t)((p[0] << 8) | p[1]);
+}
+
+static bool
+pcap_open(struct pcap_file *pcap, const char *filename)
+{
+  u8_t hdr[24];
+  u32_t magic;
+
+  pcap->f = fopen(filename, "rb");
+  if (pcap->f == NULL) {
+    perror(filename);
+    return false;
+  }
+  if (fread(hdr, 1, sizeof(hdr), pcap->f) != sizeof(hdr)) {
+    fprintf(stderr, "%s: short pcap header\n", filename);
+    return false;
+  }
+  pcap->swapped = false;
+  magic = pcap_u32(pcap, hdr);
+  if ((magic != PCAP_MAGIC_US) && (magic != PCAP_MAGIC_NS)) {
+    pcap->swapped = true;
+    magic = pcap_u32(pcap, hdr);
+  }
+  if ((magic != PCAP_MAGIC_US) && (magic != PCAP_MAGIC_NS)) {
+    fprintf(stderr, "%s: not a pcap file (pcapng is not supported)\n", filename);
+    return false;
+  }
+  pcap->nanoseconds = (magic == PCAP_MAGIC_NS);
+  pcap->linktype = pcap_u32(pcap, hdr + 20);
+  if ((pcap->linktype != PCAP_LINKTYPE_ETH) && (pcap->linktype != PCAP_LINKTYPE_RAW) &&
+      (pcap->linktype != PCAP_LINKTYPE_SLL)) {
+    fprintf(stderr, "%s: unsupported link type %u\n", filename, (unsigned)pcap->linktype);
+    return false;
+  }
+  return true;
+}
+
+/* Read the next record, returns its captured length or -1 at the end */
+static long
+pcap_next(struct pcap_file *pcap, s64_t *time_ns)
+{
+  u8_t hdr[16];
+  u32_t caplen;
+
+  if (fread(hdr, 1, sizeof(hdr), pcap->f) != sizeof(hdr)) {
+    return -1;
+  }
+  *time_ns = (s64_t)pcap_u32(pcap, hdr) * NS_PER_SEC +
+             (s64_t)pcap_u32(pcap, hdr + 4) * (pcap->nanoseconds ? 1 : 1000);
+  caplen = pcap_u32(pcap, hdr + 8);
+  if (caplen > sizeof(frame)) {
+    fprintf(stderr, "pcap record too big (%u bytes)\n", (unsigned)caplen);
+    return -1;
+  }
+  if (fread(frame, 1, caplen, pcap->f) != caplen) {
+    return -1;
+  }
+  return (long)caplen;
+}
+
+/* Locate the PTP message in a captured frame */
+static const u8_t *
+frame_ptp(const struct pcap_file *pcap, const u8_t *p, long len, u16_t *ptp_len, enum ptpd_host_port *port)
+{
+  u16_t ethtype = ETHTYPE_IPV4;
+  u16_t ihl, dport;
+
+  if (pcap->linktype == PCAP_LINKTYPE_ETH) {
+    if (len < 14) {
+      return NULL;
+    }
+    ethtype = get_u16(p + 12);
+    p += 14;
+    len -= 14;
+    while ((ethtype == ETHTYPE_VLAN) && (len >= 4)) {
+      ethtype = get_u16(p + 2);
+      p += 4;
+      len -= 4;
+    }
+  } else if (pcap->linktype == PCAP_LINKTYPE_SLL) {
+    if (len < 16) {
+      return NULL;
+    }
+    ethtype = get_u16(p + 14);
+    p += 16;
+    len -= 16;
+  }
+
+  if (ethtype == ETHTYPE_PTP) {
+    if (len < 1) {
+      return NULL;
+    }
+    /* message types below 8 are event messages (Table 19) */
+    *port = ((p[0] & 0x0F) < FOLLOW_UP) ? PTPD_HOST_EVENT : PTPD_HOST_GENERAL;
+    *ptp_len = (u16_t)LWIP_MIN(len, PACKET_SIZE);
+    return p;
+  }
+  if (ethtype != ETHTYPE_IPV4) {
+    return NULL;
+  }
+  /* IPv4, not fragmented, UDP */
+  if ((len < 20) || ((p[0] >> 4) != 4) || (p[9] != 17) || (get_u16(p + 6) & 0x3FFF)) {
+    return NULL;
+  }
+  ihl = (u16_t)((p[0] & 0x0F) * 4);
+  if (len < ihl + 8) {
+    return NULL;
+  }
+  p += ihl;
+  len -= ihl;
+  dport = get_u16(p + 2);
+  if (dport == PTP_EVENT_PORT) {
+    *port = PTPD_HOST_EVENT;
+  } else if (dport == PTP_GENERAL_PORT) {
+    *port = PTPD_HOST_GENERAL;
+  } else {
+    return NULL;
+  }
+  len = LWIP_MIN(len, get_u16(p + 4));
+  if (len <= 8) {
+    return NULL;
+  }
+  *ptp_len = (u16_t)LWIP_MIN(len - 8, PACKET_SIZE);
+  return p + 8;
+}
+
+static bool
+parse_identity(const char *s, port_identity_t *id)
+{
+  unsigned int b[PTPD_CLOCK_IDENTITY_LENGTH];
+  unsigned int port = 1;
+  int i, n;
+
+  n = sscanf(s, "%x:%x:%x:%x:%x:%x:%x:%x/%u", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5], &b[6], &b[7], &port);
+  if (n < PTPD_CLOCK_IDENTITY_LENGTH) {
+    return false;
+  }
+  for (i = 0; i < PTPD_CLOCK_IDENTITY_LENGTH; i++) {
+    id->clock_identity[i] = (octet_t)b[i];
+  }
+  id->port_number = (int16_t)port;
+  return true;
+}
+
+static void
+print_time(s64_t t)
+{
+  printf("%lld.%09lld", (long long)(t / NS_PER_SEC), (long long)(t % NS_PER_SEC));
+}
+
+static void
+print_identity(const octet_t *id)
+{
+  int i;
+  for (i = 0; i < PTPD_CLOCK_IDENTITY_LENGTH; i++) {
+    printf("%s%02x", i ? ":" : "", (u8_t)id[i]);
+  }
+}
+
+static const char *
+state_name(u8_t state)
+{
+  static const char *const names[] = {
+    "INITIALIZING", "FAULTY", "DISABLED", "LISTENING", "PRE_MASTER",
+    "MASTER", "PASSIVE", "UNCALIBRATED", "SLAVE"
+  };
+  return (state < sizeof(names) / sizeof(names[0])) ? names[state] : "UNKNOWN";
+}
+
+/* Last traced values, to only print changes */
+static struct {
+  u8_t state;
+  port_identity_t parent;
+  u32_t adj_frequency;
+  u32_t set_clocktime;
+  s32_t delay_asymmetry;
+} traced;
+
+static void
+trace(s64_t t)
+{
+  ptp_clock_t *clock = &ptpd_host_clock;
+
+  if (clock->port_ds.port_state != traced.state) {
+    print_time(t);
+    printf(",state,%s,%s\n", state_name(traced.state), state_name(clock->port_ds.port_state));
+    traced.state = clock->port_ds.port_state;
+  }
+  if (!bmc_is_same_poort_identity(&clock->parent_ds.parent_port_identity, &traced.parent)) {
+    traced.parent = clock->parent_ds.parent_port_identity;
+    print_time(t);
+    printf(",parent,");
+    print_identity(traced.parent.clock_identity);
+    printf("/%d,", traced.parent.port_number);
+    print_identity(clock->parent_ds.grandmaster_identity);
+    printf("\n");
+  }
+  if (ptpd_host_stats.set_clocktime != traced.set_clocktime) {
+    traced.set_clocktime = ptpd_host_stats.set_clocktime;
+    print_time(t);
+    printf(",step,%d,%d\n", (int)clock->current_ds.offset_from_master.seconds,
+           (int)clock->current_ds.offset_from_master.nanoseconds);
+  }
+  if (clock->port_ds.delay_asymmetry.nanoseconds != traced.delay_asymmetry) {
+    traced.delay_asymmetry = clock->port_ds.delay_asymmetry.nanoseconds;
+    print_time(t);
+    printf(",asymmetry,%d\n", (int)traced.delay_asymmetry);
+  }
+  if (ptpd_host_stats.adj_frequency != traced.adj_frequency) {
+    traced.adj_frequency = ptpd_host_stats.adj_frequency;
+    print_time(t);
+    printf(",servo,%d,%d,%d,%d\n", (int)clock->current_ds.offset_from_master.nanoseconds,
+           (int)((clock->port_ds.delay_mechanism == P2P) ? clock->port_ds.peer_mean_path_delay.nanoseconds :
+                 clock->current_ds.mean_path_delay.nanoseconds),
+           (int)clock->observed_drift, (int)ptpd_host_stats.last_adj);
+  }
+}
+
+/* Take the impersonated port's own requests as sent by us */
+static bool
+take_own_request(const u8_t *msg, u16_t len)
+{
+  ptp_clock_t *clock = &ptpd_host_clock;
+  msg_header_t header;
+  time_interval_t now;
+
+  if (!impersonate || (len < PTPD_HEADER_LENGTH)) {
+    return false;
+  }
+  msg_unpack_header((const octet_t *)msg, &header);
+  if (!bmc_is_same_poort_identity(&header.source_port_identity, &impersonated)) {
+    return false;
+  }
+  ptpd_host_get_time(&now);
+  ptp_time_add(&now, &now, &clock->outbound_latency);
+  if (header.message_type == DELAY_REQ) {
+    clock->sent_delay_req_sequence_id = (int16_t)(header.sequence_id + 1);
+    clock->timestamp_send_delay_req = now;
+    return true;
+  }
+  if (header.message_type == PDELAY_REQ) {
+    clock->sent_pdelay_req_sequence_id = (int16_t)(header.sequence_id + 1);
+    clock->pdelay_t1 = now;
+    return true;
+  }
+  return false;
+}
+
+/* Hand a message to the engine and run it until the message is consumed,
+   or flushed by a state transition. A timer may take a ptp_do_state() round
+   of its own before messages get handled again. */
+static bool
+replay_deliver(enum ptpd_host_port port, const u8_t *msg, u16_t len, s64_t t)
+{
+  net_path_t *net_path = &ptpd_host_clock.net_path;
+  u32_t rx = ptpd_host_stats.rx[port];
+  int rounds;
+
+  if (!ptpd_host_deliver(port, (const octet_t *)msg, len, NULL)) {
+    return false;
+  }
+  for (rounds = 0; (rounds < 4) && (ptpd_host_stats.rx[port] == rx) && ptpd_net_select(net_path, NULL); rounds++) {
+    ptp_do_state(&ptpd_host_clock);
+    trace(t);
+  }
+  if (ptpd_net_select(net_path, NULL)) {
+    /* the engine is not reading this port, e.g. in PTP_FAULTY */
+    ptpd_empty_event_queue(net_path);
+    ptpd_recv_general(net_path, ptpd_host_clock.bfr_msg_in, NULL);
+    return false;
+  }
+  return true;
+}
+
+int
+main(int argc, char **argv)
+{
+  struct pcap_file pcap;
+  u8_t delay_mechanism = E2E;
+  bool slave_only = true;
+  s64_t offset = 0;
+  s32_t asymmetry = 0;
+  u16_t calibration = 0;
+  s64_t tick = 10 * 1000000LL;
+  s64_t t, t_prev = -1;
+  time_interval_t start;
+  long len;
+  u32_t messages = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "pMo:a:c:t:s:")) != -1) {
+    switch (opt) {
+      case 'p':
+        delay_mechanism = P2P;
+        break;
+      case 'M':
+        slave_only = false;
+        break;
+      case 'o':
+        offset = strtoll(optarg, NULL, 0);
+        break;
+      case 'a':
+        asymmetry = (s32_t)strtol(optarg, NULL, 0);
+        break;
+      case 'c':
+        calibration = (u16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 't':
+        tick = strtoll(optarg, NULL, 0) * 1000000LL;
+        break;
+      case 's':
+        if (!parse_identity(optarg, &impersonated)) {
+          fprintf(stderr, "invalid port identity: %s\n", optarg);
+          return 1;
+        }
+        impersonate = true;
+        break;
+      default:
+        optind = argc;
+        break;
+    }
+  }
+  if ((optind != argc - 1) || (tick <= 0) || (tick >= NS_PER_SEC)) {
+    fprintf(stderr, "usage: %s [-p] [-M] [-o offset_ns] [-a asymmetry_ns] [-c samples] [-t tick_ms] [-s identity] file.pcap\n", argv[0]);
+    return 1;
+  }
+  if (!pcap_open(&pcap, argv[optind])) {
+    return 1;
+  }
+
+  ptpd_host_init(delay_mechanism, slave_only);
+  ptpd_host_clock.servo.no_adjust = FALSE;
+  if (slave_only) {
+    /* PTPD_DEFAULT_PRIORITY1/2 make the local clock win the BMC against any
+       captured master, which leaves a slave only clock listening forever */
+    ptpd_host_clock.default_ds.priority1 = 255;
+    ptpd_host_clock.default_ds.priority2 = 255;
+  }
+  if (impersonate) {
+    ptpd_host_clock.port_ds.port_identity = impersonated;
+  }
+  ptpd_host_clock.port_ds.delay_asymmetry.nanoseconds = asymmetry;
+  if (calibration != 0) {
+    time_interval_t reference_offset;
+    reference_offset.seconds = (s32_t)(offset / NS_PER_SEC);
+    reference_offset.nanoseconds = (s32_t)(offset % NS_PER_SEC);
+    servo_calibrate_asymmetry(&ptpd_host_clock, calibration, &reference_offset);
+  }
+  traced.state = ptpd_host_clock.port_ds.port_state;
+  traced.parent = ptpd_host_clock.parent_ds.parent_port_identity;
+  traced.adj_frequency = ptpd_host_stats.adj_frequency;
+  traced.set_clocktime = ptpd_host_stats.set_clocktime;
+  traced.delay_asymmetry = asymmetry;
+
+  printf("time,event,a,b,c,d\n");
+
+  while ((len = pcap_next(&pcap, &t)) >= 0) {
+    enum ptpd_host_port port;
+    const u8_t *msg;
+    u16_t msg_len;
+
+    msg = frame_ptp(&pcap, frame, len, &msg_len, &port);
+    if (msg == NULL) {
+      continue;
+    }
+
+    if (t_prev < 0) {
+      /* the local clock starts at the first capture time plus the offset */
+      start.seconds = (s32_t)((t + offset) / NS_PER_SEC);
+      start.nanoseconds = (s32_t)((t + offset) % NS_PER_SEC);
+      ptpd_host_set_time(&start);
+    } else if (t > t_prev) {
+      /* run the timers up to the capture time of this message */
+      while (t - t_prev > tick) {
+        ptpd_host_advance((s32_t)tick);
+        t_prev += tick;
+        ptp_do_state(&ptpd_host_clock);
+        trace(t_prev);
+      }
+      ptpd_host_advance((s32_t)(t - t_prev));
+    }
+    t_prev = LWIP_MAX(t, t_prev);
+
+    if (take_own_request(msg, msg_len)) {
+      continue;
+    }
+    messages++;
+    if (!replay_deliver(port, msg, msg_len, t_prev)) {
+      fprintf(stderr, "message of %u bytes dropped\n", (unsigned)msg_len);
+    }
+  }
+
+  fclose(pcap.f);
+  fprintf(stderr, "%u PTP messages replayed\n", (unsigned)messages);
+  return 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2001-2003 Swedish Institute of Computer Science.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modification,
+ * are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+ * SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT
+ * OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING
+ * IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY
+ * OF SUCH DAMAGE.
+ *
+ * This file is part of the lwIP TCP/IP stack.
+ *
+ */
+
+/*
+ * Checks of the ptpd protocol engine that need more than a replay or a
+ * fuzz run, on top of the host port in ptpd_host.c.
+ *
+ * 'make test_ptpd' builds it with a non zero PTPD_DEFAULT_DELAY_ASYMMETRY
+ * and PTPD_DEFAULT_CALIBRATION_SAMPLES so that the startup calibration
+ * runs from the default options. It prints the failed checks and exits
+ * with a non zero status if there are any.
+ */
+
+#include "ptpd_host.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if (PTPD_DEFAULT_DELAY_ASYMMETRY == 0) || (PTPD_DEFAULT_CALIBRATION_SAMPLES == 0)
+#error "build with 'make test_ptpd' to set the delay asymmetry and calibration defaults"
+#endif
+
+static int failed;
+
+#define CHECK(x) do { if (!(x)) { \
+  printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #x); \
+  failed++; } } while (0)
+
+/* Identity of the simulated manager */
+static const octet_t manager_identity[PTPD_CLOCK_IDENTITY_LENGTH] = {
+  0x00, 0x1B, 0x19, 0xFF, 0xFE, 0x00, 0x00, 0x02
+};
+
+/* Send a management message to all ports and return the reply, NULL if
+   there is none. 'value' is the dataField of a SET. */
+static const octet_t *
+management_request(enum4bit_t action, enum16bit_t management_id, int value, u16_t *len)
+{
+  octet_t buf[PACKET_SIZE];
+  msg_management manage;
+  u32_t tx = ptpd_host_stats.tx[PTPD_HOST_GENERAL];
+
+  memset(buf, 0, sizeof(buf));
+  memset(&manage, 0, sizeof(manage));
+  memset(manage.target_port_identity.clock_identity, 0xFF, PTPD_CLOCK_IDENTITY_LENGTH);
+  manage.target_port_identity.port_number = (int16_t)0xFFFF;
+  manage.action_field = action;
+  manage.tlv_type = TLV_MANAGEMENT;
+  manage.length_field = (value < 0) ? 2 : 4;
+  manage.management_id = management_id;
+  *len = (u16_t)msg_pack_management(&ptpd_host_clock, buf, 1, &manage);
+  if (value >= 0) {
+    buf[PTPD_MANAGEMENT_LENGTH + 6] = (octet_t)value;
+  }
+  memcpy(buf + 20, manager_identity, PTPD_CLOCK_IDENTITY_LENGTH);
+  *(int16_t *)(buf + 28) = flip16(1);
+
+  ptpd_host_deliver(PTPD_HOST_GENERAL, buf, *len, NULL);
+  ptp_do_state(&ptpd_host_clock);
+  if (ptpd_host_stats.tx[PTPD_HOST_GENERAL] == tx) {
+    return NULL;
+  }
+  return ptpd_host_last_sent(PTPD_HOST_GENERAL, len);
+}
+
+/* A MANAGEMENT_ERROR_STATUS TLV carries an empty displayData PTPText */
+static void
+test_management_error_status(void)
+{
+  const octet_t *reply;
+  u16_t len;
+  int i;
+
+  ptpd_host_init(E2E, true);
+  reply = management_request(MM_GET, 0x7FFF, -1, &len);
+  CHECK(reply != NULL);
+  if (reply == NULL) {
+    return;
+  }
+  CHECK(len == PTPD_MANAGEMENT_LENGTH + 4 + 10);
+  CHECK(flip16(*(const int16_t *)(reply + 2)) == len);
+  CHECK(flip16(*(const int16_t *)(reply + 48)) == TLV_MANAGEMENT_ERROR_STATUS);
+  CHECK(flip16(*(const int16_t *)(reply + 50)) == 10);
+  CHECK(flip16(*(const int16_t *)(reply + 52)) == MM_ERROR_NO_SUCH_ID);
+  CHECK((u16_t)flip16(*(const int16_t *)(reply + 54)) == 0x7FFF);
+  for (i = 56; i < 62; i++) {
+    CHECK(reply[i] == 0);
+  }
+}
+
+/* SET values are kept in the options and survive a reinitialization */
+static void
+test_management_set_reinit(void)
+{
+  const octet_t *reply;
+  u16_t len;
+
+  ptpd_host_init(E2E, true);
+  reply = management_request(MM_SET, MM_ANNOUNCE_RECEIPT_TIMEOUT, 5, &len);
+  CHECK((reply != NULL) && (flip16(*(const int16_t *)(reply + 48)) == TLV_MANAGEMENT));
+  reply = management_request(MM_SET, MM_LOG_MIN_PDELAY_REQ_INTERVAL, 2, &len);
+  CHECK((reply != NULL) && (flip16(*(const int16_t *)(reply + 48)) == TLV_MANAGEMENT));
+  CHECK(ptpd_host_clock.port_ds.announce_receipt_timeout == 5);
+  CHECK(ptpd_host_clock.port_ds.log_min_pdelay_req_interval == 2);
+
+  ptp_to_state(&ptpd_host_clock, PTP_INITIALIZING);
+  ptp_do_state(&ptpd_host_clock);
+  CHECK(ptpd_host_clock.port_ds.port_state == PTP_LISTENING);
+  CHECK(ptpd_host_clock.port_ds.announce_receipt_timeout == 5);
+  CHECK(ptpd_host_clock.port_ds.log_min_pdelay_req_interval == 2);
+}
+
+/* The startup calibration configured by PTPD_DEFAULT_CALIBRATION_SAMPLES
+   runs from the default options, the same ones ptpd_opts_init() uses */
+static void
+test_default_calibration(void)
+{
+  ptp_clock_t *clock = &ptpd_host_clock;
+  time_interval_t ingress, origin, correction;
+  int i;
+
+  ptpd_host_init(E2E, true);
+  CHECK(ptpd_host_opts.delay_asymmetry.nanoseconds == PTPD_DEFAULT_DELAY_ASYMMETRY);
+  CHECK(ptpd_host_opts.calibration_samples == PTPD_DEFAULT_CALIBRATION_SAMPLES);
+  CHECK(clock->port_ds.delay_asymmetry.nanoseconds == PTPD_DEFAULT_DELAY_ASYMMETRY);
+  CHECK(clock->calibration.samples == PTPD_DEFAULT_CALIBRATION_SAMPLES);
+  /* the reference steers the clock while calibrating */
+  CHECK(clock->servo.no_adjust);
+
+  /* Syncs over a path 1200 nsec longer from the master, with a valid
+     mean path delay of 0 */
+  clock->owd_filt.n = 1;
+  origin.seconds = 10;
+  origin.nanoseconds = 0;
+  ingress.seconds = 10;
+  ingress.nanoseconds = 1200;
+  correction.seconds = correction.nanoseconds = 0;
+  for (i = 0; i < PTPD_DEFAULT_CALIBRATION_SAMPLES; i++) {
+    CHECK(clock->calibration.samples != 0);
+    servo_update_offset(clock, &ingress, &origin, &correction);
+  }
+  CHECK(clock->calibration.samples == 0);
+  CHECK(clock->port_ds.delay_asymmetry.seconds == 0);
+  CHECK(clock->port_ds.delay_asymmetry.nanoseconds == 1200);
+  CHECK(clock->servo.no_adjust == ptpd_host_opts.servo.no_adjust);
+  /* the asymmetry is now taken out of the offset from master */
+  servo_update_offset(clock, &ingress, &origin, &correction);
+  CHECK(clock->current_ds.offset_from_master.seconds == 0);
+  CHECK(clock->current_ds.offset_from_master.nanoseconds == 0);
+}
+
+int
+main(void)
+{
+  test_default_calibration();
+  test_management_error_status();
+  test_management_set_reinit();
+
+  if (failed != 0) {
+    printf("%d checks failed\n", failed);
+    return 1;
+  }
+  printf("all checks passed\n");
+  return 0;
+}
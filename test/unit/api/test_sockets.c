@@ -104,6 +104,42 @@ START_TEST(test_sockets_basics)
 }
 END_TEST
 
+/* Select the TCP congestion control algorithm of a socket */
+START_TEST(test_sockets_tcp_congestion)
+{
+  int s, ret, val;
+  socklen_t len;
+  LWIP_UNUSED_ARG(_i);
+
+  s = lwip_socket(AF_INET, SOCK_STREAM, 0);
+  fail_unless(s >= 0);
+
+  len = sizeof(val);
+  ret = lwip_getsockopt(s, IPPROTO_TCP, TCP_CONGESTION, &val, &len);
+  fail_unless(ret == 0);
+  fail_unless(val == TCP_CA_NEWRENO);
+
+#if LWIP_TCP_CC_CUBIC
+  val = TCP_CA_CUBIC;
+  ret = lwip_setsockopt(s, IPPROTO_TCP, TCP_CONGESTION, &val, sizeof(val));
+  fail_unless(ret == 0);
+  len = sizeof(val);
+  ret = lwip_getsockopt(s, IPPROTO_TCP, TCP_CONGESTION, &val, &len);
+  fail_unless(ret == 0);
+  fail_unless(val == TCP_CA_CUBIC);
+#endif /* LWIP_TCP_CC_CUBIC */
+
+  /* unknown algorithms are rejected and leave the current one in place */
+  val = 42;
+  ret = lwip_setsockopt(s, IPPROTO_TCP, TCP_CONGESTION, &val, sizeof(val));
+  fail_unless(ret == -1);
+  fail_unless(errno == EINVAL);
+
+  ret = lwip_close(s);
+  fail_unless(ret == 0);
+}
+END_TEST
+
 static void test_sockets_allfunctions_basic_domain(int domain)
 {
   int s, s2, s3, ret;
@@ -634,6 +670,114 @@ static void test_sockets_msgapi_cmsg(int domain)
 }
 #endif /* LWIP_IPV4 */
 
+#define TEST_MMSG_CNT (LWIP_SOCKET_MMSG_BATCH + 3)
+
+static void test_sockets_mmsgapi_udp(int domain)
+{
+  int s, ret, i;
+  struct sockaddr_storage addr_storage;
+  socklen_t addr_size;
+  struct iovec siovs[TEST_MMSG_CNT];
+  struct mmsghdr smsgs[TEST_MMSG_CNT];
+  struct iovec riovs[TEST_MMSG_CNT + 1];
+  struct mmsghdr rmsgs[TEST_MMSG_CNT + 1];
+  u8_t snd_buf[TEST_MMSG_CNT][4];
+  u8_t rcv_buf[TEST_MMSG_CNT + 1][4];
+
+  test_sockets_init_loopback_addr(domain, &addr_storage, &addr_size);
+
+  s = test_sockets_alloc_socket_nonblocking(domain, SOCK_DGRAM);
+  fail_unless(s >= 0);
+
+  ret = lwip_bind(s, (struct sockaddr*)&addr_storage, addr_size);
+  fail_unless(ret == 0);
+
+  /* Update addr with epehermal port */
+  ret = lwip_getsockname(s, (struct sockaddr*)&addr_storage, &addr_size);
+  fail_unless(ret == 0);
+
+  /* datagram i carries i in its first byte and is i % 4 + 1 bytes long,
+     so more than one batch is needed to send them all */
+  memset(smsgs, 0, sizeof(smsgs));
+  for (i = 0; i < TEST_MMSG_CNT; i++) {
+    memset(snd_buf[i], 0xA0 + i, sizeof(snd_buf[i]));
+    snd_buf[i][0] = (u8_t)i;
+    siovs[i].iov_base = snd_buf[i];
+    siovs[i].iov_len = (size_t)(i % 4 + 1);
+    smsgs[i].msg_hdr.msg_iov = &siovs[i];
+    smsgs[i].msg_hdr.msg_iovlen = 1;
+    smsgs[i].msg_hdr.msg_name = &addr_storage;
+    smsgs[i].msg_hdr.msg_namelen = addr_size;
+  }
+  memset(rmsgs, 0, sizeof(rmsgs));
+  for (i = 0; i < TEST_MMSG_CNT + 1; i++) {
+    riovs[i].iov_base = rcv_buf[i];
+    /* the last datagram (4 bytes) does not fit */
+    riovs[i].iov_len = (i == TEST_MMSG_CNT - 1) ? 2 : sizeof(rcv_buf[i]);
+    rmsgs[i].msg_hdr.msg_iov = &riovs[i];
+    rmsgs[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  /* nothing pending yet */
+  ret = lwip_recvmmsg(s, rmsgs, TEST_MMSG_CNT + 1, 0, NULL);
+  fail_unless(ret == -1);
+  fail_unless(errno == EWOULDBLOCK);
+
+  ret = lwip_sendmmsg(s, smsgs, TEST_MMSG_CNT, 0);
+  fail_unless(ret == TEST_MMSG_CNT);
+  for (i = 0; i < TEST_MMSG_CNT; i++) {
+    fail_unless(smsgs[i].msg_len == (unsigned int)(i % 4 + 1));
+  }
+
+  while (tcpip_thread_poll_one());
+
+  /* a vector longer than the queue stops when it runs empty */
+  memset(rcv_buf, 0, sizeof(rcv_buf));
+  ret = lwip_recvmmsg(s, rmsgs, TEST_MMSG_CNT + 1, 0, NULL);
+  fail_unless(ret == TEST_MMSG_CNT);
+  for (i = 0; i < TEST_MMSG_CNT; i++) {
+    fail_unless(rmsgs[i].msg_len == (unsigned int)(i % 4 + 1));
+    fail_unless(rcv_buf[i][0] == (u8_t)i);
+    if (i == TEST_MMSG_CNT - 1) {
+      fail_unless(rmsgs[i].msg_hdr.msg_flags & MSG_TRUNC);
+      fail_unless(rcv_buf[i][2] == 0);
+    } else {
+      fail_unless(!(rmsgs[i].msg_hdr.msg_flags & MSG_TRUNC));
+      fail_unless(!memcmp(rcv_buf[i], snd_buf[i], rmsgs[i].msg_len));
+    }
+  }
+
+  /* a short vector leaves the rest queued; peeking returns one datagram */
+  ret = lwip_sendmmsg(s, smsgs, 3, 0);
+  fail_unless(ret == 3);
+  while (tcpip_thread_poll_one());
+  ret = lwip_recvmmsg(s, rmsgs, 2, MSG_PEEK, NULL);
+  fail_unless(ret == 1);
+  fail_unless(rcv_buf[0][0] == 0);
+  ret = lwip_recvmmsg(s, rmsgs, 2, MSG_WAITFORONE, NULL);
+  fail_unless(ret == 2);
+  ret = lwip_recvmmsg(s, rmsgs, 2, 0, NULL);
+  fail_unless(ret == 1);
+  fail_unless(rcv_buf[0][0] == 2);
+
+  /* a bad entry stops the send; the ones before it are sent */
+  smsgs[1].msg_hdr.msg_iovlen = 0;
+  ret = lwip_sendmmsg(s, smsgs, 3, 0);
+  fail_unless(ret == 1);
+  ret = lwip_sendmmsg(s, &smsgs[1], 2, 0);
+  fail_unless(ret == -1);
+  fail_unless(errno == EMSGSIZE);
+  while (tcpip_thread_poll_one());
+  ret = lwip_recvmmsg(s, rmsgs, 2, 0, NULL);
+  fail_unless(ret == 1);
+
+  ret = lwip_sendmmsg(s, smsgs, 0, 0);
+  fail_unless(ret == 0);
+
+  ret = lwip_close(s);
+  fail_unless(ret == 0);
+}
+
 START_TEST(test_sockets_msgapis)
 {
   LWIP_UNUSED_ARG(_i);
@@ -641,10 +785,12 @@ START_TEST(test_sockets_msgapis)
   test_sockets_msgapi_udp(AF_INET);
   test_sockets_msgapi_tcp(AF_INET);
   test_sockets_msgapi_cmsg(AF_INET);
+  test_sockets_mmsgapi_udp(AF_INET);
 #endif
 #if LWIP_IPV6
   test_sockets_msgapi_udp(AF_INET6);
   test_sockets_msgapi_tcp(AF_INET6);
+  test_sockets_mmsgapi_udp(AF_INET6);
 #endif
 }
 END_TEST
@@ -685,6 +831,148 @@ START_TEST(test_sockets_select)
 }
 END_TEST
 
+START_TEST(test_sockets_epoll)
+{
+#if LWIP_SOCKET_EPOLL && LWIP_IPV4
+  int ep, s1, s2, ret;
+  struct sockaddr_storage addr1, addr2;
+  socklen_t addr_size;
+  struct epoll_event ev, evs[4];
+  u8_t buf[4] = {0xDE, 0xAD, 0xBE, 0xEF};
+
+  ep = lwip_epoll_create(1);
+  fail_unless(ep >= 0);
+
+  test_sockets_init_loopback_addr(AF_INET, &addr1, &addr_size);
+  s1 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s1 >= 0);
+  ret = lwip_bind(s1, (struct sockaddr*)&addr1, addr_size);
+  fail_unless(ret == 0);
+  ret = lwip_getsockname(s1, (struct sockaddr*)&addr1, &addr_size);
+  fail_unless(ret == 0);
+  test_sockets_init_loopback_addr(AF_INET, &addr2, &addr_size);
+  s2 = test_sockets_alloc_socket_nonblocking(AF_INET, SOCK_DGRAM);
+  fail_unless(s2 >= 0);
+  ret = lwip_bind(s2, (struct sockaddr*)&addr2, addr_size);
+  fail_unless(ret == 0);
+
+  /* s1 is not readable yet, s2 (udp) is writable right away */
+  ev.events = EPOLLIN;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s1, &ev);
+  fail_unless((ret == -1) && (errno == EEXIST));
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s2, &ev);
+  fail_unless((ret == -1) && (errno == ENOENT));
+  ev.events = EPOLLIN | EPOLLOUT;
+  ev.data.fd = s2;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless((evs[0].data.fd == s2) && (evs[0].events == EPOLLOUT));
+  /* level-triggered: still reported */
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  /* nothing left: times out */
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, evs, 4, 10);
+  fail_unless(ret == 0);
+
+  /* datagrams make s1 readable until drained */
+  ret = lwip_sendto(s2, buf, sizeof(buf), 0, (struct sockaddr*)&addr1, addr_size);
+  fail_unless(ret == sizeof(buf));
+  ret = lwip_sendto(s2, buf, sizeof(buf), 0, (struct sockaddr*)&addr1, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  fail_unless((evs[0].data.fd == s1) && (evs[0].events == EPOLLIN));
+  ret = lwip_recv(s1, buf, sizeof(buf), 0);
+  fail_unless(ret == sizeof(buf));
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_recv(s1, buf, sizeof(buf), 0);
+  fail_unless(ret == sizeof(buf));
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 0);
+
+  /* with a small maxevents, level-triggered sockets take turns */
+  ev.events = EPOLLOUT;
+  ev.data.fd = s2;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+  ev.events = EPOLLOUT;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, evs, 1, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, &evs[1], 1, 0);
+  fail_unless(ret == 1);
+  fail_unless(evs[0].data.fd != evs[1].data.fd);
+
+  /* edge-triggered: reported once per event */
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.fd = s1;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_DEL, s2, NULL);
+  fail_unless((ret == -1) && (errno == ENOENT));
+  ret = lwip_sendto(s2, buf, sizeof(buf), 0, (struct sockaddr*)&addr1, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_sendto(s2, buf, sizeof(buf), 0, (struct sockaddr*)&addr1, addr_size);
+  fail_unless(ret == sizeof(buf));
+  while (tcpip_thread_poll_one());
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+
+  /* one-shot: disarmed after the first report until modified */
+  ev.events = EPOLLIN | EPOLLONESHOT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_MOD, s1, &ev);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 1);
+
+  /* closing a registered socket drops its registration */
+  ret = lwip_close(s1);
+  fail_unless(ret == 0);
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless(ret == 0);
+  ev.events = EPOLLOUT;
+  ret = lwip_epoll_ctl(ep, EPOLL_CTL_ADD, s2, &ev);
+  fail_unless(ret == 0);
+
+  /* closing the instance drops the remaining ones */
+  ret = lwip_close(ep);
+  fail_unless(ret == 0);
+  ret = lwip_close(ep);
+  fail_unless((ret == -1) && (errno == EBADF));
+  ret = lwip_epoll_wait(ep, evs, 4, 0);
+  fail_unless((ret == -1) && (errno == EBADF));
+  ret = lwip_close(s2);
+  fail_unless(ret == 0);
+#endif /* LWIP_SOCKET_EPOLL && LWIP_IPV4 */
+  LWIP_UNUSED_ARG(_i);
+}
+END_TEST
+
 START_TEST(test_sockets_recv_after_rst)
 {
   int sl, sact;
@@ -834,9 +1122,11 @@ sockets_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_sockets_basics),
+    TESTFUNC(test_sockets_tcp_congestion),
     TESTFUNC(test_sockets_allfunctions_basic),
     TESTFUNC(test_sockets_msgapis),
     TESTFUNC(test_sockets_select),
+    TESTFUNC(test_sockets_epoll),
     TESTFUNC(test_sockets_recv_after_rst),
   };
   return create_suite("SOCKETS", tests, sizeof(tests)/sizeof(testfunc), sockets_setup, sockets_teardown);
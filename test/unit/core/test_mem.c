@@ -1,7 +1,11 @@
 #include "test_mem.h"
 
 #include "lwip/mem.h"
+#include "lwip/memp.h"
 #include "lwip/stats.h"
+#include "lwip/def.h"
+#include "lwip/alloc_profile.h"
+#include "arch/sys_arch.h"
 
 #if !LWIP_STATS || !MEM_STATS
 #error "This tests needs MEM-statistics enabled"
@@ -210,6 +214,204 @@ START_TEST(test_mem_double_free)
 }
 END_TEST
 
+#if MEMP_THREAD_CACHE
+LWIP_MEMPOOL_DECLARE(test_mem_private_pool, 8, 32, "test pool")
+static void *test_mem_elements[PBUF_POOL_SIZE + 1];
+
+/** Allocate all elements of a pool, check they are distinct and free them */
+static void
+test_mem_memp_exhaust(memp_t type, int num)
+{
+  int i;
+
+  for (i = 0; i < num; i++) {
+    test_mem_elements[i] = memp_malloc(type);
+    fail_unless(test_mem_elements[i] != NULL);
+    *(int *)test_mem_elements[i] = i;
+  }
+  fail_unless(memp_malloc(type) == NULL);
+  fail_unless(memp_pools[type]->stats->used == num);
+  for (i = 0; i < num; i++) {
+    fail_unless(*(int *)test_mem_elements[i] == i);
+    memp_free(type, test_mem_elements[i]);
+  }
+  fail_unless(memp_pools[type]->stats->used == 0);
+}
+#endif /* MEMP_THREAD_CACHE */
+
+/** Allocate from pools with thread caches: no element may get lost in the
+ * cache, after freeing all elements the pool must be fully available again */
+START_TEST(test_memp_thread_cache)
+{
+#if MEMP_THREAD_CACHE
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* cached pool */
+  test_mem_memp_exhaust(MEMP_PBUF_POOL, PBUF_POOL_SIZE);
+  test_mem_memp_exhaust(MEMP_PBUF_POOL, PBUF_POOL_SIZE);
+  /* alternate between the thread cache and the shared pool */
+  for (i = 0; i < 3 * MEMP_THREAD_CACHE_SIZE; i++) {
+    test_mem_elements[i] = memp_malloc(MEMP_PBUF_POOL);
+    fail_unless(test_mem_elements[i] != NULL);
+  }
+  for (i = 0; i < 3 * MEMP_THREAD_CACHE_SIZE; i++) {
+    memp_free(MEMP_PBUF_POOL, test_mem_elements[i]);
+  }
+  memp_thread_cache_flush();
+  test_mem_memp_exhaust(MEMP_PBUF_POOL, PBUF_POOL_SIZE);
+
+  /* pool too small to be cached */
+  fail_unless(memp_pools[MEMP_TCP_PCB]->num < 4 * MEMP_THREAD_CACHE_SIZE);
+  test_mem_memp_exhaust(MEMP_TCP_PCB, memp_pools[MEMP_TCP_PCB]->num);
+
+  /* private pools use the shared list only */
+  LWIP_MEMPOOL_INIT(test_mem_private_pool);
+  for (i = 0; i < 8; i++) {
+    test_mem_elements[i] = LWIP_MEMPOOL_ALLOC(test_mem_private_pool);
+    fail_unless(test_mem_elements[i] != NULL);
+  }
+  fail_unless(LWIP_MEMPOOL_ALLOC(test_mem_private_pool) == NULL);
+  for (i = 0; i < 8; i++) {
+    LWIP_MEMPOOL_FREE(test_mem_private_pool, test_mem_elements[i]);
+  }
+#else /* MEMP_THREAD_CACHE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEMP_THREAD_CACHE */
+}
+END_TEST
+
+/** Mix size classes and page runs: blocks must not overlap, freed pages
+ * must merge again and trimming a run must give its tail pages back */
+START_TEST(test_mem_slab)
+{
+#if MEM_SLAB
+  static const mem_size_t sizes[] = {1, 17, 40, 100, MEM_SLAB_PAGE_SIZE / 2, MEM_SLAB_PAGE_SIZE + 1, 3 * MEM_SLAB_PAGE_SIZE};
+  u8_t *p[LWIP_ARRAYSIZE(sizes)];
+  u8_t *big;
+  mem_size_t used;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(lwip_stats.mem.used == 0);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(sizes); i++) {
+    p[i] = (u8_t *)mem_malloc(sizes[i]);
+    fail_unless(p[i] != NULL);
+    memset(p[i], (int)i, sizes[i]);
+  }
+  for (i = 0; i < LWIP_ARRAYSIZE(sizes); i++) {
+    fail_unless(p[i][0] == (u8_t)i);
+    fail_unless(p[i][sizes[i] - 1] == (u8_t)i);
+  }
+  /* a small block can't grow, a run can't grow past its pages */
+  fail_unless(mem_trim(p[0], 64) == NULL);
+  fail_unless(mem_trim(p[5], 2 * MEM_SLAB_PAGE_SIZE + 1) == NULL);
+
+  /* trimming a run gives pages back */
+  used = lwip_stats.mem.used;
+  fail_unless(mem_trim(p[6], 10) == p[6]);
+  fail_unless(lwip_stats.mem.used == used - 2 * MEM_SLAB_PAGE_SIZE);
+
+  /* freeing inside a run or a slab object twice is illegal */
+  mem_free(p[5] + MEM_SLAB_PAGE_SIZE);
+  fail_unless(lwip_stats.mem.illegal == 1);
+  mem_free(p[2] + MEM_ALIGNMENT);
+  fail_unless(lwip_stats.mem.illegal == 2);
+  lwip_stats.mem.illegal = 0;
+
+  for (i = 0; i < LWIP_ARRAYSIZE(sizes); i++) {
+    mem_free(p[i]);
+  }
+  fail_unless(lwip_stats.mem.illegal == 0);
+  fail_unless(lwip_stats.mem.used == 0);
+
+  /* after all is freed, the heap is in one piece again */
+  big = (u8_t *)mem_malloc((MEM_SIZE / MEM_SLAB_PAGE_SIZE) * MEM_SLAB_PAGE_SIZE);
+  fail_unless(big != NULL);
+  fail_unless(mem_malloc(1) == NULL);
+  mem_free(big);
+  fail_unless(lwip_stats.mem.used == 0);
+  lwip_stats.mem.err = 0;
+#else /* MEM_SLAB */
+  LWIP_UNUSED_ARG(_i);
+#endif /* MEM_SLAB */
+}
+END_TEST
+
+#if LWIP_ALLOC_PROFILE
+static const struct alloc_profile_site *
+test_mem_profile_site(u16_t pool)
+{
+  u16_t i;
+  for (i = 0; i <= ALLOC_PROFILE_MAX_SITES; i++) {
+    const struct alloc_profile_site *site = alloc_profile_get_site(i);
+    if ((site != NULL) && (site->pool == pool) && !strcmp(site->file, __FILE__)) {
+      return site;
+    }
+  }
+  return NULL;
+}
+#endif /* LWIP_ALLOC_PROFILE */
+
+/** Check the per call site accounting of the allocation profiler */
+START_TEST(test_mem_alloc_profile)
+{
+#if LWIP_ALLOC_PROFILE
+  const struct alloc_profile_site *site;
+  struct mem_frag_info info;
+  void *p[2];
+  void *pbuf;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  alloc_profile_reset();
+  for (i = 0; i < 2; i++) {
+    p[i] = mem_malloc(100);
+    fail_unless(p[i] != NULL);
+  }
+  pbuf = memp_malloc(MEMP_PBUF);
+  fail_unless(pbuf != NULL);
+
+  /* both heap allocations come from the same line */
+  site = test_mem_profile_site(ALLOC_PROFILE_HEAP);
+  fail_unless(site != NULL);
+  fail_unless(site->allocs == 2);
+  fail_unless(site->live == 2);
+  fail_unless(site->bytes == 200);
+  fail_unless(mem_trim(p[0], 40) == p[0]);
+  fail_unless(site->bytes == 140);
+
+  mem_frag_info(&info);
+  fail_unless(info.free > 0);
+  fail_unless(info.largest <= info.free);
+  fail_unless(info.blocks > 0);
+
+  lwip_sys_now += 10;
+  mem_free(p[0]);
+  mem_free(p[1]);
+  fail_unless(site->frees == 2);
+  fail_unless(site->live == 0);
+  fail_unless(site->bytes == 0);
+  fail_unless(site->live_max == 2);
+  fail_unless(site->bytes_max == 200);
+  /* 10 ms is in the bucket of lifetimes below 16 ms */
+  fail_unless(site->lifetime[2] == 2);
+
+  site = test_mem_profile_site(MEMP_PBUF);
+  fail_unless(site != NULL);
+  fail_unless(site->allocs == 1);
+  fail_unless(site->live == 1);
+  memp_free(MEMP_PBUF, pbuf);
+  fail_unless(site->live == 0);
+  fail_unless(site->lifetime[2] == 1);
+  fail_unless(alloc_profile_untracked() == 0);
+#else /* LWIP_ALLOC_PROFILE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_ALLOC_PROFILE */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 mem_suite(void)
@@ -218,7 +420,10 @@ mem_suite(void)
     TESTFUNC(test_mem_one),
     TESTFUNC(test_mem_random),
     TESTFUNC(test_mem_invalid_free),
-    TESTFUNC(test_mem_double_free)
+    TESTFUNC(test_mem_double_free),
+    TESTFUNC(test_memp_thread_cache),
+    TESTFUNC(test_mem_slab),
+    TESTFUNC(test_mem_alloc_profile)
   };
   return create_suite("MEM", tests, sizeof(tests)/sizeof(testfunc), mem_setup, mem_teardown);
 }
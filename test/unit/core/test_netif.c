@@ -4,6 +4,7 @@
 #include "lwip/stats.h"
 #include "lwip/etharp.h"
 #include "netif/ethernet.h"
+#include "lwip/tcpip.h"
 
 #if !LWIP_NETIF_EXT_STATUS_CALLBACK
 #error "This tests needs LWIP_NETIF_EXT_STATUS_CALLBACK enabled"
@@ -215,13 +216,121 @@ START_TEST(test_netif_extcallbacks)
 }
 END_TEST
 
+#if LWIP_TCPIP_BATCH_INPUT
+static int batch_input_ctr;
+
+/* consumes two of three packets, refuses the third (tcpip_thread frees it) */
+static err_t
+batch_input_fn(struct pbuf *p, struct netif *inp)
+{
+  LWIP_UNUSED_ARG(inp);
+  fail_unless(p != NULL);
+  batch_input_ctr++;
+  if ((batch_input_ctr % 3) == 0) {
+    return ERR_VAL;
+  }
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static void
+batch_poll_all(void)
+{
+  while (tcpip_thread_poll_one()) {
+  }
+}
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+
+START_TEST(test_netif_batch_input)
+{
+#if LWIP_TCPIP_BATCH_INPUT
+  struct pbuf *pkts[TCPIP_BATCH_INPUT_MAX + 4];
+  u16_t i, n;
+  LWIP_UNUSED_ARG(_i);
+
+  batch_poll_all();
+  for (i = 0; i < LWIP_ARRAYSIZE(pkts); i++) {
+    pkts[i] = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+    fail_unless(pkts[i] != NULL);
+  }
+  batch_input_ctr = 0;
+
+  /* the burst is split into two messages */
+  n = tcpip_inpkt_batch(pkts, (u16_t)LWIP_ARRAYSIZE(pkts), &net_test, batch_input_fn);
+  fail_unless(n == LWIP_ARRAYSIZE(pkts));
+  fail_unless(batch_input_ctr == 0);
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless(batch_input_ctr == TCPIP_BATCH_INPUT_MAX);
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless(batch_input_ctr == LWIP_ARRAYSIZE(pkts));
+  fail_unless(tcpip_thread_poll_one() == 0);
+
+  /* empty batch posts nothing */
+  fail_unless(tcpip_inpkt_batch(pkts, 0, &net_test, batch_input_fn) == 0);
+  fail_unless(tcpip_thread_poll_one() == 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+}
+END_TEST
+
+START_TEST(test_netif_rx_ring)
+{
+#if LWIP_TCPIP_BATCH_INPUT
+  struct tcpip_rx_ring ring;
+  struct pbuf *slots[4];
+  struct pbuf *p;
+  u16_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  batch_poll_all();
+  fail_unless(tcpip_rx_ring_init(&ring, slots, 3, &net_test, batch_input_fn) == ERR_ARG);
+  fail_unless(tcpip_rx_ring_init(&ring, slots, LWIP_ARRAYSIZE(slots), &net_test, batch_input_fn) == ERR_OK);
+  batch_input_ctr = 0;
+
+  /* fill until full, kicking after every packet posts one drain only */
+  for (i = 0; i < LWIP_ARRAYSIZE(slots); i++) {
+    p = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+    fail_unless(p != NULL);
+    fail_unless(tcpip_rx_ring_put(&ring, p) == ERR_OK);
+    fail_unless(tcpip_rx_ring_kick(&ring) == ERR_OK);
+  }
+  p = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+  fail_unless(p != NULL);
+  fail_unless(tcpip_rx_ring_put(&ring, p) == ERR_MEM);
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless(batch_input_ctr == LWIP_ARRAYSIZE(slots));
+  fail_unless(tcpip_thread_poll_one() == 0);
+
+  /* the drained ring is usable again and wraps around */
+  fail_unless(tcpip_rx_ring_put(&ring, p) == ERR_OK);
+  fail_unless(tcpip_rx_ring_kick(&ring) == ERR_OK);
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless(batch_input_ctr == LWIP_ARRAYSIZE(slots) + 1);
+
+  /* packets left over are freed on deinit */
+  for (i = 0; i < 2; i++) {
+    p = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+    fail_unless(p != NULL);
+    fail_unless(tcpip_rx_ring_put(&ring, p) == ERR_OK);
+  }
+  tcpip_rx_ring_deinit(&ring);
+  fail_unless(batch_input_ctr == LWIP_ARRAYSIZE(slots) + 1);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCPIP_BATCH_INPUT */
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
 netif_suite(void)
 {
   testfunc tests[] = {
-    TESTFUNC(test_netif_extcallbacks)
+    TESTFUNC(test_netif_extcallbacks),
+    TESTFUNC(test_netif_batch_input),
+    TESTFUNC(test_netif_rx_ring)
   };
   return create_suite("NETIF", tests, sizeof(tests)/sizeof(testfunc), netif_setup, netif_teardown);
 }
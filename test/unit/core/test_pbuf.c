@@ -2,6 +2,7 @@
 
 #include "lwip/pbuf.h"
 #include "lwip/stats.h"
+#include "lwip/inet_chksum.h"
 
 #if !LWIP_STATS || !MEM_STATS ||!MEMP_STATS
 #error "This tests needs MEM- and MEMP-statistics enabled"
@@ -37,6 +38,8 @@ static u8_t testbuf_2[TESTBUFSIZE_2];
 static u8_t testbuf_2a[TESTBUFSIZE_2];
 static u8_t testbuf_3[TESTBUFSIZE_3];
 static u8_t testbuf_3a[TESTBUFSIZE_3];
+#define TESTBUFSIZE_CHKSUM 140000
+static u8_t testbuf_chksum[TESTBUFSIZE_CHKSUM];
 
 /* Test functions */
 START_TEST(test_pbuf_alloc_zero_pbufs)
@@ -255,6 +258,151 @@ START_TEST(test_pbuf_get_put_at_edge)
 }
 END_TEST
 
+/** Reference checksum: sum of big-endian 16-bit words, returned in host
+ * order like LWIP_CHKSUM */
+static u16_t
+test_pbuf_chksum_ref(const u8_t *data, u32_t len)
+{
+  u32_t acc = 0;
+  u32_t i;
+
+  for (i = 0; i + 1 < len; i += 2) {
+    acc += ((u32_t)data[i] << 8) | data[i + 1];
+    acc = FOLD_U32T(acc);
+  }
+  if (len & 1) {
+    acc += (u32_t)data[len - 1] << 8;
+  }
+  acc = FOLD_U32T(acc);
+  acc = FOLD_U32T(acc);
+  return lwip_htons((u16_t)acc);
+}
+
+static void
+test_pbuf_fill_random(u8_t *data, u32_t len)
+{
+  u32_t seed = 0x1234567;
+  u32_t i;
+
+  for (i = 0; i < len; i++) {
+    seed = seed * 1103515245UL + 12345;
+    data[i] = (u8_t)(seed >> 16);
+  }
+}
+
+/* Verify the checksum routine at every alignment and for lengths that hit
+ * the head, bulk and tail paths
+ */
+START_TEST(test_pbuf_chksum)
+{
+  static const u32_t lens[] = { 0, 1, 2, 3, 7, 8, 9, 31, 32, 33, 63, 64, 65, 127, 128, 129, 1459, 1460, 1500, 65535 };
+  size_t i;
+  u32_t offset;
+  LWIP_UNUSED_ARG(_i);
+
+  test_pbuf_fill_random(testbuf_chksum, TESTBUFSIZE_CHKSUM);
+  for (offset = 0; offset < 8; offset++) {
+    for (i = 0; i < LWIP_ARRAYSIZE(lens); i++) {
+      u16_t expected = test_pbuf_chksum_ref(&testbuf_chksum[offset], lens[i]);
+      u16_t inverted = (u16_t)(expected ^ 0xffff);
+      u16_t chksum = inet_chksum(&testbuf_chksum[offset], (u16_t)lens[i]);
+      fail_unless(chksum == inverted,
+        "bad checksum for len %d at offset %d", lens[i], offset);
+    }
+  }
+#if LWIP_CHKSUM_ALGORITHM
+  /* longer than one block of the vector routines */
+  for (offset = 0; offset < 2; offset++) {
+    u32_t len = TESTBUFSIZE_CHKSUM - offset;
+    fail_unless(lwip_standard_chksum(&testbuf_chksum[offset], (int)len) ==
+                test_pbuf_chksum_ref(&testbuf_chksum[offset], len));
+  }
+#endif /* LWIP_CHKSUM_ALGORITHM */
+}
+END_TEST
+
+/* Verify each compiled-in checksum kernel the CPU supports, not only the one
+ * lwip_chksum_init() selected
+ */
+START_TEST(test_pbuf_chksum_kernels)
+{
+#if (LWIP_CHKSUM_ALGORITHM == 4) && LWIP_TESTMODE
+  static const u32_t lens[] = { 0, 1, 2, 31, 32, 33, 63, 64, 65, 127, 128, 129, 1460, 1500, 65535 };
+  lwip_chksum_kernel_fn kernel;
+  size_t i;
+  u32_t offset;
+  int k;
+  LWIP_UNUSED_ARG(_i);
+
+  test_pbuf_fill_random(testbuf_chksum, TESTBUFSIZE_CHKSUM);
+  for (k = 0; (kernel = lwip_chksum_get_kernel(k)) != NULL; k++) {
+    for (offset = 0; offset < 8; offset++) {
+      for (i = 0; i < LWIP_ARRAYSIZE(lens); i++) {
+        fail_unless(kernel(&testbuf_chksum[offset], (int)lens[i]) ==
+                    test_pbuf_chksum_ref(&testbuf_chksum[offset], lens[i]),
+          "kernel %d: bad checksum for len %d at offset %d", k, lens[i], offset);
+      }
+    }
+    /* longer than one block of the vector routines */
+    fail_unless(kernel(&testbuf_chksum[1], TESTBUFSIZE_CHKSUM - 1) ==
+                test_pbuf_chksum_ref(&testbuf_chksum[1], TESTBUFSIZE_CHKSUM - 1),
+      "kernel %d: bad checksum for the whole buffer", k);
+  }
+  fail_unless(k > 0);
+#else /* (LWIP_CHKSUM_ALGORITHM == 4) && LWIP_TESTMODE */
+  LWIP_UNUSED_ARG(_i);
+#endif /* (LWIP_CHKSUM_ALGORITHM == 4) && LWIP_TESTMODE */
+}
+END_TEST
+
+/* Verify pbuf_take_chksum() copies the data and sums it like
+ * inet_chksum_pbuf(), also over pbufs of odd length
+ */
+START_TEST(test_pbuf_take_chksum)
+{
+#if LWIP_CHECKSUM_ON_COPY
+  static const u16_t lens[] = { 1, 3, 64, 100, 1, 2, 1500 };
+  struct pbuf *p = NULL, *q;
+  u16_t chksum, inverted, tot_len = 0;
+  size_t i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  test_pbuf_fill_random(testbuf_chksum, TESTBUFSIZE_CHKSUM);
+  for (i = 0; i < LWIP_ARRAYSIZE(lens); i++) {
+    q = pbuf_alloc(PBUF_RAW, lens[i], PBUF_RAM);
+    fail_unless(q != NULL);
+    if (p == NULL) {
+      p = q;
+    } else {
+      pbuf_cat(p, q);
+    }
+    tot_len = (u16_t)(tot_len + lens[i]);
+  }
+
+  /* from an odd source address, too */
+  for (i = 0; i < 2; i++) {
+    const u8_t *data = &testbuf_chksum[i];
+    for (q = p; q != NULL; q = q->next) {
+      memset(q->payload, 0, q->len);
+    }
+    err = pbuf_take_chksum(p, data, tot_len, &chksum);
+    fail_unless(err == ERR_OK);
+    fail_unless(pbuf_memcmp(p, 0, data, tot_len) == 0);
+    inverted = (u16_t)(inet_chksum_pbuf(p) ^ 0xffff);
+    fail_unless(chksum == inverted);
+    fail_unless(chksum == test_pbuf_chksum_ref(data, tot_len));
+  }
+
+  err = pbuf_take_chksum(p, testbuf_chksum, (u16_t)(tot_len + 1), &chksum);
+  fail_unless(err == ERR_MEM);
+  pbuf_free(p);
+#else /* LWIP_CHECKSUM_ON_COPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_CHECKSUM_ON_COPY */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 pbuf_suite(void)
@@ -265,7 +413,10 @@ pbuf_suite(void)
     TESTFUNC(test_pbuf_split_64k_on_small_pbufs),
     TESTFUNC(test_pbuf_queueing_bigger_than_64k),
     TESTFUNC(test_pbuf_take_at_edge),
-    TESTFUNC(test_pbuf_get_put_at_edge)
+    TESTFUNC(test_pbuf_get_put_at_edge),
+    TESTFUNC(test_pbuf_chksum),
+    TESTFUNC(test_pbuf_chksum_kernels),
+    TESTFUNC(test_pbuf_take_chksum)
   };
   return create_suite("PBUF", tests, sizeof(tests)/sizeof(testfunc), pbuf_setup, pbuf_teardown);
 }
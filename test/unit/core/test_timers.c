@@ -2,6 +2,7 @@
 
 #include "lwip/def.h"
 #include "lwip/timeouts.h"
+#include "lwip/memp.h"
 #include "arch/sys_arch.h"
 
 /* Setups/teardown functions */
@@ -11,19 +12,44 @@ static struct sys_timeo* old_list_head;
 static void
 timers_setup(void)
 {
+#if LWIP_TIMER_WHEEL
+  old_list_head = sys_timeouts_detach();
+#else
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
   old_list_head = *list_head;
   *list_head = NULL;
+#endif
 }
 
 static void
 timers_teardown(void)
 {
+#if LWIP_TIMER_WHEEL
+  struct sys_timeo* t = sys_timeouts_detach();
+  while (t != NULL) {
+    struct sys_timeo* next = t->next;
+    memp_free(MEMP_SYS_TIMEOUT, t);
+    t = next;
+  }
+  sys_timeouts_attach(old_list_head);
+#else
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
   *list_head = old_list_head;
+#endif
   lwip_sys_now = 0;
 }
 
+/* expiry time of the first timer */
+static u32_t
+next_timer_time(void)
+{
+#if LWIP_TIMER_WHEEL
+  return (u32_t)(lwip_sys_now + sys_timeouts_sleeptime());
+#else
+  return (*sys_timeouts_get_next_timeout())->time;
+#endif
+}
+
 static int fired[3];
 static void
 dummy_handler(void* arg)
@@ -46,8 +72,6 @@ struct lwip_cyclic_timer test_cyclic = {10, dummy_cyclic_handler};
 static void
 do_test_cyclic_timers(u32_t offset)
 {
-  struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
-
   /* verify normal timer expiration */
   lwip_sys_now = offset + 0;
   sys_timeout(test_cyclic.interval_ms, lwip_cyclic_timer, &test_cyclic);
@@ -60,7 +84,7 @@ do_test_cyclic_timers(u32_t offset)
   sys_check_timeouts();
   fail_unless(cyclic_fired == 1);
 
-  fail_unless((*list_head)->time == (u32_t)(lwip_sys_now + test_cyclic.interval_ms - HANDLER_EXECUTION_TIME));
+  fail_unless(next_timer_time() == (u32_t)(lwip_sys_now + test_cyclic.interval_ms - HANDLER_EXECUTION_TIME));
   
   sys_untimeout(lwip_cyclic_timer, &test_cyclic);
 
@@ -77,7 +101,7 @@ do_test_cyclic_timers(u32_t offset)
   sys_check_timeouts();
   fail_unless(cyclic_fired == 1);
 
-  fail_unless((*list_head)->time == (u32_t)(lwip_sys_now + test_cyclic.interval_ms));
+  fail_unless(next_timer_time() == (u32_t)(lwip_sys_now + test_cyclic.interval_ms));
 }
 
 START_TEST(test_cyclic_timers)
@@ -127,8 +151,10 @@ END_TEST
 static void
 do_test_timers(u32_t offset)
 {
+#if !LWIP_TIMER_WHEEL
   struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
-  
+#endif
+
   lwip_sys_now = offset + 0;
 
   sys_timeout(10, dummy_handler, LWIP_PTR_NUMERIC_CAST(void*, 0));
@@ -138,10 +164,12 @@ do_test_timers(u32_t offset)
   sys_timeout( 5, dummy_handler, LWIP_PTR_NUMERIC_CAST(void*, 2));
   fail_unless(sys_timeouts_sleeptime() == 5);
 
+#if !LWIP_TIMER_WHEEL
   /* linked list correctly sorted? */
   fail_unless((*list_head)->time             == (u32_t)(lwip_sys_now + 5));
   fail_unless((*list_head)->next->time       == (u32_t)(lwip_sys_now + 10));
   fail_unless((*list_head)->next->next->time == (u32_t)(lwip_sys_now + 20));
+#endif
   
   /* check timers expire in correct order */
   memset(&fired, 0, sizeof(fired));
@@ -219,6 +247,169 @@ START_TEST(test_long_timer)
 }
 END_TEST
 
+#if LWIP_TIMER_WHEEL
+#define WHEEL_TIMERS 8
+static u32_t wheel_fired_at[WHEEL_TIMERS];
+static int wheel_fired_seq[WHEEL_TIMERS];
+static int wheel_seq;
+static void
+wheel_handler(void* arg)
+{
+  int index = LWIP_PTR_NUMERIC_CAST(int, arg);
+  wheel_fired_at[index] = lwip_sys_now;
+  wheel_fired_seq[index] = ++wheel_seq;
+}
+
+/* start the timers in random order, cancel some and check each fires
+   exactly when due (also when the clock skips ahead) */
+static void
+do_test_timer_wheel(u32_t offset, const u32_t *msecs, u32_t cancelled)
+{
+  int i, j;
+  int last_seq = 0;
+
+  memset(wheel_fired_at, 0, sizeof(wheel_fired_at));
+  memset(wheel_fired_seq, 0, sizeof(wheel_fired_seq));
+  wheel_seq = 0;
+  lwip_sys_now = offset;
+  for (i = 0; i < WHEEL_TIMERS; i++) {
+    sys_timeout(msecs[i], wheel_handler, LWIP_PTR_NUMERIC_CAST(void*, i));
+  }
+  for (i = 0; i < WHEEL_TIMERS; i++) {
+    if (cancelled & (1U << i)) {
+      sys_untimeout(wheel_handler, LWIP_PTR_NUMERIC_CAST(void*, i));
+    }
+  }
+
+  /* visit the expiry times in ascending order */
+  for (i = 0; i < WHEEL_TIMERS; i++) {
+    u32_t due = 0xffffffff;
+    for (j = 0; j < WHEEL_TIMERS; j++) {
+      if (!(cancelled & (1U << j)) && (wheel_fired_seq[j] == 0) && (msecs[j] < due)) {
+        due = msecs[j];
+      }
+    }
+    if (due == 0xffffffff) {
+      break;
+    }
+    fail_unless(sys_timeouts_sleeptime() == (u32_t)(offset + due - lwip_sys_now));
+    lwip_sys_now = offset + due - 1;
+    sys_check_timeouts();
+    lwip_sys_now = offset + due;
+    sys_check_timeouts();
+    for (j = 0; j < WHEEL_TIMERS; j++) {
+      if (cancelled & (1U << j)) {
+        fail_unless(wheel_fired_seq[j] == 0);
+      } else if (msecs[j] <= due) {
+        fail_unless(wheel_fired_seq[j] != 0);
+        fail_unless(wheel_fired_at[j] == (u32_t)(offset + msecs[j]));
+        if (msecs[j] == due) {
+          fail_unless(wheel_fired_seq[j] > last_seq);
+        }
+      } else {
+        fail_unless(wheel_fired_seq[j] == 0);
+      }
+    }
+    last_seq = wheel_seq;
+  }
+  fail_unless(sys_timeouts_sleeptime() == SYS_TIMEOUTS_SLEEPTIME_INFINITE);
+}
+
+static void
+do_test_timer_wheel_jump(u32_t offset, const u32_t *msecs)
+{
+  int i;
+
+  /* checking only late fires everything in order of expiry */
+  memset(wheel_fired_seq, 0, sizeof(wheel_fired_seq));
+  wheel_seq = 0;
+  lwip_sys_now = offset;
+  for (i = 0; i < WHEEL_TIMERS; i++) {
+    sys_timeout(msecs[i], wheel_handler, LWIP_PTR_NUMERIC_CAST(void*, i));
+  }
+  lwip_sys_now = offset + LWIP_UINT32_MAX / 4;
+  sys_check_timeouts();
+  for (i = 0; i < WHEEL_TIMERS; i++) {
+    int j;
+    fail_unless(wheel_fired_seq[i] != 0);
+    for (j = 0; j < WHEEL_TIMERS; j++) {
+      if (msecs[j] < msecs[i]) {
+        fail_unless(wheel_fired_seq[j] < wheel_fired_seq[i]);
+      }
+    }
+  }
+}
+#endif /* LWIP_TIMER_WHEEL */
+
+START_TEST(test_timer_wheel)
+{
+#if LWIP_TIMER_WHEEL
+  /* times around the slot boundaries of the wheel levels */
+  static const u32_t short_msecs[WHEEL_TIMERS] = {33, 1, 1024, 31, 32, 1023, 1025, 64};
+  static const u32_t long_msecs[WHEEL_TIMERS] = {1048576, 40000, 3600000, LWIP_UINT32_MAX / 4,
+                                                 1048575, 33554432, 5000, 1073741823};
+  static const u32_t offsets[] = {0, 0x3fffffe0, 0x7ffffff0, 0xfffffff0};
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < LWIP_ARRAYSIZE(offsets); i++) {
+    do_test_timer_wheel(offsets[i], short_msecs, 0);
+    do_test_timer_wheel(offsets[i], long_msecs, 0);
+    do_test_timer_wheel(offsets[i], short_msecs, 0x25);
+    do_test_timer_wheel(offsets[i], long_msecs, 0x92);
+    do_test_timer_wheel_jump(offsets[i], long_msecs);
+  }
+
+  /* going backwards in time keeps timers pending */
+  lwip_sys_now = 1000;
+  sys_timeout(100, wheel_handler, LWIP_PTR_NUMERIC_CAST(void*, 0));
+  lwip_sys_now = 500;
+  sys_check_timeouts();
+  fail_unless(sys_timeouts_sleeptime() == 600);
+  lwip_sys_now = 1100;
+  wheel_fired_seq[0] = 0;
+  sys_check_timeouts();
+  fail_unless(wheel_fired_seq[0] != 0);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif
+}
+END_TEST
+
+static int rearm_fired;
+static u32_t rearm_msecs;
+static void
+rearm_handler(void* arg)
+{
+  LWIP_UNUSED_ARG(arg);
+  rearm_fired++;
+  lwip_sys_now += 2;
+  sys_timeout(rearm_msecs, rearm_handler, NULL);
+}
+
+START_TEST(test_timer_rearm)
+{
+  static const u32_t msecs[] = {100, 1, 0};
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  /* a handler taking time and re-arming itself fires once per check */
+  for (i = 0; i < LWIP_ARRAYSIZE(msecs); i++) {
+    rearm_msecs = msecs[i];
+    lwip_sys_now = 1000;
+    sys_timeout(rearm_msecs, rearm_handler, NULL);
+    lwip_sys_now += rearm_msecs;
+    rearm_fired = 0;
+    sys_check_timeouts();
+    fail_unless(rearm_fired == 1);
+    lwip_sys_now += rearm_msecs;
+    sys_check_timeouts();
+    fail_unless(rearm_fired == 2);
+    sys_untimeout(rearm_handler, NULL);
+  }
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 timers_suite(void)
@@ -228,6 +419,8 @@ timers_suite(void)
     TESTFUNC(test_cyclic_timers),
     TESTFUNC(test_timers),
     TESTFUNC(test_long_timer),
+    TESTFUNC(test_timer_wheel),
+    TESTFUNC(test_timer_rearm),
   };
   return create_suite("TIMERS", tests, LWIP_ARRAYSIZE(tests), timers_setup, timers_teardown);
 }
@@ -260,13 +260,87 @@ START_TEST(test_etharp_table)
 }
 END_TEST
 
+START_TEST(test_etharp_hash_aging)
+{
+#if ETHARP_TABLE_HASH_SIZE
+  ip4_addr_t adrs[ETHARP_TABLE_HASH_SIZE + 2];
+  const ip4_addr_t *unused_ipaddr;
+  struct eth_addr *unused_ethaddr;
+  struct udp_pcb *pcb;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = udp_new();
+  fail_unless(pcb != NULL);
+  linkoutput_ctr = 0;
+  /* more entries than buckets, so that chains are used */
+  for (i = 0; i < ETHARP_TABLE_HASH_SIZE + 2; i++) {
+    struct pbuf *p = pbuf_alloc(PBUF_TRANSPORT, 10, PBUF_RAM);
+    ip_addr_t dst;
+    fail_unless(p != NULL);
+    IP4_ADDR(&adrs[i], 192,168,1,i+2);
+    ip_addr_copy_from_ip4(dst, adrs[i]);
+    fail_unless(udp_sendto(pcb, p, &dst, 123) == ERR_OK);
+    pbuf_free(p);
+  }
+  fail_unless(linkoutput_ctr == ETHARP_TABLE_HASH_SIZE + 2);
+
+  /* pending entries re-send their request */
+  etharp_tmr();
+  fail_unless(linkoutput_ctr == 2 * (ETHARP_TABLE_HASH_SIZE + 2));
+
+  /* resolve all but the last one */
+  for (i = 0; i < ETHARP_TABLE_HASH_SIZE + 1; i++) {
+    create_arp_response(&adrs[i]);
+    fail_unless(etharp_find_addr(NULL, &adrs[i], &unused_ethaddr, &unused_ipaddr) >= 0);
+#if ETHARP_LOCKLESS_READ
+    {
+      struct eth_addr ethaddr;
+      fail_unless(etharp_lookup_nolock(&test_netif, &adrs[i], &ethaddr) == 1);
+      fail_unless(memcmp(&ethaddr, &test_ethaddr2, ETH_HWADDR_LEN) == 0);
+    }
+#endif /* ETHARP_LOCKLESS_READ */
+  }
+  /* queued packets were sent */
+  fail_unless(linkoutput_ctr == 3 * (ETHARP_TABLE_HASH_SIZE + 2) - 1);
+
+  /* the unresolved entry expires, the others don't re-send requests */
+  linkoutput_ctr = 0;
+  for (i = 0; i < 10; i++) {
+    etharp_tmr();
+  }
+  fail_unless(linkoutput_ctr == 3);
+  fail_unless(etharp_find_addr(NULL, &adrs[ETHARP_TABLE_HASH_SIZE + 1], &unused_ethaddr, &unused_ipaddr) == -1);
+  fail_unless(etharp_find_addr(NULL, &adrs[0], &unused_ethaddr, &unused_ipaddr) >= 0);
+
+  /* stable entries expire after ARP_MAXAGE */
+  for (i = 10; i < ARP_MAXAGE; i++) {
+    etharp_tmr();
+  }
+  for (i = 0; i < ETHARP_TABLE_HASH_SIZE + 1; i++) {
+    fail_unless(etharp_find_addr(NULL, &adrs[i], &unused_ethaddr, &unused_ipaddr) == -1);
+#if ETHARP_LOCKLESS_READ
+    {
+      struct eth_addr ethaddr;
+      fail_unless(etharp_lookup_nolock(&test_netif, &adrs[i], &ethaddr) == 0);
+    }
+#endif /* ETHARP_LOCKLESS_READ */
+  }
+  udp_remove(pcb);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* ETHARP_TABLE_HASH_SIZE */
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
 etharp_suite(void)
 {
   testfunc tests[] = {
-    TESTFUNC(test_etharp_table)
+    TESTFUNC(test_etharp_table),
+    TESTFUNC(test_etharp_hash_aging)
   };
   return create_suite("ETHARP", tests, sizeof(tests)/sizeof(testfunc), etharp_setup, etharp_teardown);
 }
@@ -5,6 +5,7 @@
 #include "lwip/stats.h"
 #include "lwip/prot/ip.h"
 #include "lwip/prot/ip4.h"
+#include "lwip/route.h"
 
 #include "lwip/tcpip.h"
 
@@ -52,6 +53,68 @@ create_ip4_input_fragment(u16_t ip_id, u16_t start, u16_t len, int last)
   }
 }
 
+#if LWIP_ROUTE_TABLE
+static err_t
+route_netif_init(struct netif *netif)
+{
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST;
+  return ERR_OK;
+}
+
+static struct netif *
+route_netif_add(struct netif *netif, const char *addr, const char *mask)
+{
+  ip4_addr_t ip, nm;
+  fail_unless(ip4addr_aton(addr, &ip));
+  fail_unless(ip4addr_aton(mask, &nm));
+  fail_unless(netif_add(netif, &ip, &nm, IP4_ADDR_ANY4, NULL, route_netif_init, ip4_input) == netif);
+  netif_set_up(netif);
+  netif_set_link_up(netif);
+  return netif;
+}
+
+static struct netif *
+route_ip4(const char *dest)
+{
+  ip4_addr_t addr;
+  fail_unless(ip4addr_aton(dest, &addr));
+  return route_lookup_ip4(&addr);
+}
+
+/** Returns 1 if the next hop to dest over netif is hop ("-" for none) */
+static int
+route_next_hop_is(struct netif *netif, const char *dest, const char *hop)
+{
+  ip4_addr_t addr, expected;
+  const ip4_addr_t *next;
+  fail_unless(ip4addr_aton(dest, &addr));
+  next = route_next_hop_ip4(netif, &addr);
+  if (hop[0] == '-') {
+    return next == NULL;
+  }
+  fail_unless(ip4addr_aton(hop, &expected));
+  return (next != NULL) && ip4_addr_cmp(next, &expected);
+}
+
+static err_t
+route_add_ip4(const char *prefix, u8_t len, const char *gw, struct netif *netif, u16_t metric)
+{
+  ip_addr_t p, g;
+  fail_unless(ipaddr_aton(prefix, &p));
+  fail_unless(ipaddr_aton(gw, &g));
+  return route_add(&p, len, &g, netif, metric);
+}
+
+static err_t
+route_remove_ip4(const char *prefix, u8_t len, struct netif *netif)
+{
+  ip_addr_t p;
+  fail_unless(ipaddr_aton(prefix, &p));
+  return route_remove(&p, len, NULL, netif);
+}
+#endif /* LWIP_ROUTE_TABLE */
+
 /* Setups/teardown functions */
 
 static void
@@ -148,6 +211,75 @@ START_TEST(test_ip4_reass)
 }
 END_TEST
 
+START_TEST(test_ip4_route_table)
+{
+#if LWIP_ROUTE_TABLE
+  struct netif na, nb;
+  ip4_addr_t dest;
+  LWIP_UNUSED_ARG(_i);
+
+  route_netif_add(&na, "192.168.0.1", "255.255.255.0");
+  route_netif_add(&nb, "10.0.0.1", "255.0.0.0");
+  fail_unless(route_ip4("172.16.1.1") == NULL);
+
+  fail_unless(route_add_ip4("172.16.0.0", 12, "192.168.0.254", &na, 10) == ERR_OK);
+  fail_unless(route_ip4("172.16.1.1") == &na);
+  fail_unless(route_ip4("172.32.0.1") == NULL);
+  fail_unless(route_next_hop_is(&na, "172.16.1.1", "192.168.0.254"));
+  fail_unless(route_next_hop_is(&nb, "172.16.1.1", "-"));
+
+  /* longest prefix match */
+  fail_unless(route_add_ip4("172.16.1.0", 24, "10.0.0.254", &nb, 5) == ERR_OK);
+  fail_unless(route_add_ip4("172.17.0.0", 16, "10.0.0.253", &nb, 5) == ERR_OK);
+  fail_unless(route_ip4("172.16.1.1") == &nb);
+  fail_unless(route_ip4("172.16.2.1") == &na);
+  fail_unless(route_ip4("172.17.2.1") == &nb);
+  fail_unless(route_next_hop_is(&nb, "172.16.1.1", "10.0.0.254"));
+  fail_unless(route_next_hop_is(&nb, "172.17.2.1", "10.0.0.253"));
+  fail_unless(route_next_hop_is(&na, "172.16.1.1", "192.168.0.254"));
+
+  /* lowest metric among usable routes wins */
+  fail_unless(route_add_ip4("172.16.1.0", 24, "192.168.0.253", &na, 1) == ERR_OK);
+  fail_unless(route_ip4("172.16.1.1") == &na);
+  fail_unless(route_next_hop_is(&na, "172.16.1.1", "192.168.0.253"));
+  netif_set_link_down(&na);
+  fail_unless(route_ip4("172.16.1.1") == &nb);
+  netif_set_link_up(&na);
+  fail_unless(route_ip4("172.16.1.1") == &na);
+  /* re-adding a route updates its metric */
+  fail_unless(route_add_ip4("172.16.1.0", 24, "192.168.0.253", &na, 9) == ERR_OK);
+  fail_unless(route_ip4("172.16.1.1") == &nb);
+
+  /* default route without gateway */
+  fail_unless(route_add_ip4("0.0.0.0", 0, "0.0.0.0", &nb, 0) == ERR_OK);
+  fail_unless(route_ip4("8.8.8.8") == &nb);
+  fail_unless(route_next_hop_is(&nb, "8.8.8.8", "8.8.8.8"));
+  fail_unless(ip4addr_aton("172.32.0.1", &dest));
+  fail_unless(ip4_route(&dest) == &nb);
+  /* connected subnets come first */
+  fail_unless(ip4addr_aton("192.168.0.7", &dest));
+  fail_unless(ip4_route(&dest) == &na);
+
+  fail_unless(route_add_ip4("1.2.3.4", 33, "0.0.0.0", &na, 0) == ERR_ARG);
+  fail_unless(route_remove_ip4("172.16.1.0", 24, &na) == ERR_OK);
+  fail_unless(route_remove_ip4("172.16.1.0", 24, &na) == ERR_VAL);
+  fail_unless(route_remove_ip4("172.16.0.0", 16, NULL) == ERR_VAL);
+  fail_unless(route_ip4("172.16.1.1") == &nb);
+
+  /* removing a netif removes its routes */
+  netif_remove(&nb);
+  fail_unless(route_ip4("172.16.1.1") == &na);
+  fail_unless(route_ip4("172.17.2.1") == &na);
+  fail_unless(route_ip4("8.8.8.8") == NULL);
+  fail_unless(route_remove_ip4("172.16.0.0", 12, NULL) == ERR_OK);
+  fail_unless(route_ip4("172.16.1.1") == NULL);
+  netif_remove(&na);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_ROUTE_TABLE */
+}
+END_TEST
+
 
 /** Create the suite including all tests for this module */
 Suite *
@@ -155,6 +287,7 @@ ip4_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_ip4_reass),
+    TESTFUNC(test_ip4_route_table),
   };
   return create_suite("IPv4", tests, sizeof(tests)/sizeof(testfunc), ip4_setup, ip4_teardown);
 }
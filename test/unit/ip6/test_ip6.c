@@ -5,9 +5,11 @@
 #include "lwip/inet_chksum.h"
 #include "lwip/nd6.h"
 #include "lwip/stats.h"
+#include "lwip/route.h"
 #include "lwip/prot/ethernet.h"
 #include "lwip/prot/ip.h"
 #include "lwip/prot/ip6.h"
+#include "lwip/prot/icmp6.h"
 
 #include "lwip/tcpip.h"
 
@@ -287,6 +289,144 @@ START_TEST(test_ip6_lladdr)
 }
 END_TEST
 
+START_TEST(test_ip6_route_table)
+{
+#if LWIP_ROUTE_TABLE
+  ip_addr_t prefix, gw1, gw2;
+  ip6_addr_t dest;
+  const ip6_addr_t *hop;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  fail_unless(ipaddr_aton("fe80::1", &gw1));
+  fail_unless(ipaddr_aton("fe80::2", &gw2));
+  fail_unless(ipaddr_aton("2001:db8::", &prefix));
+  fail_unless(route_add(&prefix, 32, &gw1, &test_netif6, 1) == ERR_OK);
+  fail_unless(ipaddr_aton("2001:db8:1::", &prefix));
+  fail_unless(route_add(&prefix, 48, &gw2, &test_netif6, 1) == ERR_OK);
+  fail_unless(route_add(&prefix, 129, &gw2, &test_netif6, 1) == ERR_ARG);
+
+  fail_unless(ip6addr_aton("2001:db8:1::5", &dest));
+  fail_unless(route_lookup_ip6(&dest) == &test_netif6);
+  fail_unless(ip6_route(IP6_ADDR_ANY6, &dest) == &test_netif6);
+  hop = route_next_hop_ip6(&test_netif6, &dest);
+  fail_unless((hop != NULL) && ip6_addr_cmp_zoneless(hop, ip_2_ip6(&gw2)));
+  fail_unless(ip6addr_aton("2001:db8:2::5", &dest));
+  hop = route_next_hop_ip6(&test_netif6, &dest);
+  fail_unless((hop != NULL) && ip6_addr_cmp_zoneless(hop, ip_2_ip6(&gw1)));
+  fail_unless(ip6addr_aton("2001:db9::5", &dest));
+  fail_unless(route_lookup_ip6(&dest) == NULL);
+
+  /* netif down: no usable route */
+  netif_set_down(&test_netif6);
+  fail_unless(ip6addr_aton("2001:db8:1::5", &dest));
+  fail_unless(route_lookup_ip6(&dest) == NULL);
+
+  fail_unless(route_remove(&prefix, 48, NULL, NULL) == ERR_OK);
+  fail_unless(ipaddr_aton("2001:db8::", &prefix));
+  fail_unless(route_remove(&prefix, 32, &gw2, NULL) == ERR_VAL);
+  fail_unless(route_remove(&prefix, 32, &gw1, NULL) == ERR_OK);
+  netif_set_link_down(&test_netif6);
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_ROUTE_TABLE */
+}
+END_TEST
+
+#if LWIP_ND6_CACHE_HASH_SIZE
+/* fe80::host on the test netif */
+static void
+test_ip6_nd6_addr(ip6_addr_t *dest, u32_t host)
+{
+  IP6_ADDR(dest, PP_HTONL(0xfe800000UL), 0, 0, lwip_htonl(host));
+  ip6_addr_assign_zone(dest, IP6_UNICAST, &test_netif6);
+}
+
+static void
+test_ip6_nd6_next_hop(u32_t host)
+{
+  ip6_addr_t dest;
+  const u8_t *hwaddr;
+  test_ip6_nd6_addr(&dest, host);
+  nd6_get_next_hop_addr_or_queue(&test_netif6, NULL, &dest, &hwaddr);
+}
+
+/* input an ICMPv6 packet too big message for fe80::host */
+static void
+test_ip6_nd6_ptb(u32_t host)
+{
+  ip6_addr_t dest;
+  struct icmp6_hdr *icmp6hdr;
+  struct ip6_hdr *ip6hdr;
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, sizeof(struct icmp6_hdr) + IP6_HLEN, PBUF_RAM);
+  fail_unless(p != NULL);
+  memset(p->payload, 0, p->len);
+  icmp6hdr = (struct icmp6_hdr *)p->payload;
+  ip6hdr = (struct ip6_hdr *)(icmp6hdr + 1);
+  icmp6hdr->type = ICMP6_TYPE_PTB;
+  icmp6hdr->data = lwip_htonl(1280);
+  test_ip6_nd6_addr(&dest, host);
+  ip6_addr_copy_to_packed(ip6hdr->dest, dest);
+  nd6_input(p, &test_netif6);
+}
+
+static u16_t
+test_ip6_nd6_mtu(u32_t host)
+{
+  ip6_addr_t dest;
+  test_ip6_nd6_addr(&dest, host);
+  return nd6_get_destination_mtu(&dest, &test_netif6);
+}
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+
+START_TEST(test_ip6_nd6_cache_hash)
+{
+#if LWIP_ND6_CACHE_HASH_SIZE
+  u32_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  netif_set_up(&test_netif6);
+  netif_set_link_up(&test_netif6);
+  linkoutput_ctr = 0;
+
+  /* one solicitation per new neighbor, none for a known one */
+  for (i = 1; i <= LWIP_ND6_NUM_DESTINATIONS; i++) {
+    test_ip6_nd6_next_hop(i);
+  }
+  fail_unless(linkoutput_ctr == LWIP_ND6_NUM_DESTINATIONS);
+  test_ip6_nd6_next_hop(5);
+  fail_unless(linkoutput_ctr == LWIP_ND6_NUM_DESTINATIONS);
+
+  /* path MTU is kept per destination entry */
+  test_ip6_nd6_ptb(1);
+  test_ip6_nd6_ptb(2);
+  fail_unless(test_ip6_nd6_mtu(1) == 1280);
+  fail_unless(test_ip6_nd6_mtu(2) == 1280);
+  fail_unless(test_ip6_nd6_mtu(3) == 1500);
+
+  /* a new destination recycles the least recently used entry */
+  test_ip6_nd6_next_hop(1);
+  test_ip6_nd6_next_hop(0x100);
+  fail_unless(test_ip6_nd6_mtu(1) == 1280);
+  fail_unless(test_ip6_nd6_mtu(2) == 1500);
+
+  nd6_clear_destination_cache();
+  fail_unless(test_ip6_nd6_mtu(1) == 1500);
+  test_ip6_nd6_next_hop(1);
+  test_ip6_nd6_ptb(1);
+  fail_unless(test_ip6_nd6_mtu(1) == 1280);
+
+  nd6_clear_destination_cache();
+  netif_set_down(&test_netif6);
+  netif_set_link_down(&test_netif6);
+  linkoutput_ctr = 0;
+#else
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_ND6_CACHE_HASH_SIZE */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 ip6_suite(void)
@@ -296,7 +436,9 @@ ip6_suite(void)
     TESTFUNC(test_ip6_aton_ipv4mapped),
     TESTFUNC(test_ip6_ntoa_ipv4mapped),
     TESTFUNC(test_ip6_ntoa),
-    TESTFUNC(test_ip6_lladdr)
+    TESTFUNC(test_ip6_lladdr),
+    TESTFUNC(test_ip6_route_table),
+    TESTFUNC(test_ip6_nd6_cache_hash)
   };
   return create_suite("IPv6", tests, sizeof(tests)/sizeof(testfunc), ip6_setup, ip6_teardown);
 }
@@ -14,6 +14,7 @@
 #include "dhcp/test_dhcp.h"
 #include "mdns/test_mdns.h"
 #include "mqtt/test_mqtt.h"
+#include "netif/test_bridgeif.h"
 #include "api/test_sockets.h"
 
 #include "lwip/init.h"
@@ -76,6 +77,7 @@ int main(void)
     dhcp_suite,
     mdns_suite,
     mqtt_suite,
+    bridgeif_suite,
     sockets_suite
   };
   size_t num = sizeof(suites)/sizeof(void*);
@@ -39,6 +39,7 @@
 #define LWIP_CHECKSUM_ON_COPY           1
 #define TCP_CHECKSUM_ON_COPY_SANITY_CHECK 1
 #define TCP_CHECKSUM_ON_COPY_SANITY_CHECK_FAIL(printfmsg) LWIP_ASSERT("TCP_CHECKSUM_ON_COPY_SANITY_CHECK_FAIL", 0)
+#define LWIP_CHKSUM_ALGORITHM           4
 
 /* We link to special sys_arch.c (for basic non-waiting API layers unit tests) */
 #define NO_SYS                          0
@@ -61,15 +62,65 @@
 #define TCP_WND                         (10 * TCP_MSS)
 #define LWIP_WND_SCALE                  1
 #define TCP_RCV_SCALE                   0
+#define LWIP_TCP_SACK_OUT               1
+#define LWIP_TCP_SACK_IN                1
+#define LWIP_TCP_CC_CUBIC               1
+#define LWIP_TCP_ZEROCOPY               1
+#define LWIP_TCP_GSO                    1
+#define LWIP_TCP_GRO                    1
 #define PBUF_POOL_SIZE                  400 /* pbuf tests need ~200KByte */
+/* Demultiplex through the hash tables with small tables to get collisions */
+#define LWIP_TCP_PCB_HASH               1
+#define TCP_PCB_HASH_SIZE               2
+#define LWIP_UDP_PCB_HASH               1
+#define UDP_PCB_HASH_SIZE               2
 
 /* Enable IGMP and MDNS for MDNS tests */
 #define LWIP_IGMP                       1
 #define LWIP_MDNS_RESPONDER             1
-#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_MDNS_RESPONDER)
+/* one more client data slot for the bridgeif ports */
+#define LWIP_NUM_NETIF_CLIENT_DATA      (LWIP_MDNS_RESPONDER + 1)
+
+/* Forward unicast frames between bridge ports without tcpip_thread */
+#define BRIDGEIF_CUT_THROUGH            1
+
+/* Cache pool elements per thread, small caches to move batches often */
+#define MEMP_THREAD_CACHE               1
+#define MEMP_THREAD_CACHE_SIZE          4
+
+/* Size-class heap, small pages so that runs of pages get exercised */
+#define MEM_SLAB                        1
+#define MEM_SLAB_PAGE_SIZE              256
+
+/* Account allocations per call site */
+#define LWIP_ALLOC_PROFILE              1
+
+/* Pass packets to tcpip_thread in batches and through rx rings */
+#define LWIP_TCPIP_BATCH_INPUT          1
+#define TCPIP_BATCH_INPUT_MAX           8
+
+/* Keep timers in wheels, a small TCP wheel so that its slots wrap often */
+#define LWIP_TIMER_WHEEL                1
+#define LWIP_TCP_TIMER_WHEEL            1
+#define TCP_TIMER_WHEEL_SLOTS           8
+
+/* Small sendmmsg() batches; enough netbufs to queue several of them */
+#define LWIP_SOCKET_MMSG_BATCH          4
+#define MEMP_NUM_NETBUF                 16
+#define LWIP_SOCKET_EPOLL               1
+
+/* Static route table with a tiny cache so that slots are shared */
+#define LWIP_ROUTE_TABLE                1
+#define ROUTE_CACHE_SIZE                2
+
+/* Hash-indexed nd6 caches with fewer buckets than entries */
+#define LWIP_ND6_CACHE_HASH_SIZE        4
 
 /* Minimal changes to opt.h required for etharp unit tests: */
 #define ETHARP_SUPPORT_STATIC_ENTRIES   1
+/* Hashed ARP table with fewer buckets than entries */
+#define ETHARP_TABLE_HASH_SIZE          4
+#define ETHARP_LOCKLESS_READ            1
 
 #define MEMP_NUM_SYS_TIMEOUT            (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 8)
 
@@ -0,0 +1,329 @@
+#include "test_bridgeif.h"
+
+#include "netif/bridgeif.h"
+#include "netif/ethernet.h"
+#include "lwip/mem.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/tcpip.h"
+#include "lwip/timeouts.h"
+#include "arch/sys_arch.h"
+
+#include <string.h>
+
+#if !LWIP_STATS || !MEM_STATS || !MEMP_STATS
+#error "This tests needs MEM- and MEMP-statistics enabled"
+#endif
+
+/* BR_FDB_TIMEOUT_SEC in bridgeif_fdb.c */
+#define TEST_FDB_TIMEOUT_SEC  (60*5)
+
+#define TEST_NUM_PORTS  3
+
+static struct sys_timeo* old_list_head;
+static struct netif test_bridge;
+static struct netif test_ports[TEST_NUM_PORTS];
+static int port_tx[TEST_NUM_PORTS];
+
+/* Helper functions */
+static struct eth_addr
+test_station(u8_t n)
+{
+  struct eth_addr addr = {{2, 0, 0, 0, 0, 0}};
+  addr.addr[5] = n;
+  return addr;
+}
+
+/** Advance the time so that the FDB aging timer runs once per second */
+static void
+bridgeif_age_seconds(u32_t secs)
+{
+  while (secs-- > 0) {
+    lwip_sys_now += 1000;
+    sys_check_timeouts();
+  }
+}
+
+static err_t
+test_port_linkoutput(struct netif *netif, struct pbuf *p)
+{
+  int idx = (int)(netif - test_ports);
+  fail_unless((idx >= 0) && (idx < TEST_NUM_PORTS));
+  fail_unless(p != NULL);
+  port_tx[idx]++;
+  return ERR_OK;
+}
+
+static err_t
+test_port_init(struct netif *netif)
+{
+  fail_unless(netif != NULL);
+  netif->linkoutput = test_port_linkoutput;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_BROADCAST | NETIF_FLAG_ETHARP | NETIF_FLAG_ETHERNET | NETIF_FLAG_LINK_UP;
+  netif->hwaddr_len = ETH_HWADDR_LEN;
+  netif->hwaddr[0] = 2;
+  netif->hwaddr[4] = 1;
+  netif->hwaddr[5] = (u8_t)(netif - test_ports);
+  return ERR_OK;
+}
+
+/** Receive a frame on a bridge port */
+static void
+test_port_input(int port, const struct eth_addr *dst, const struct eth_addr *src)
+{
+  struct eth_hdr *ethhdr;
+  struct pbuf *p = pbuf_alloc(PBUF_RAW, 60, PBUF_RAM);
+  if (p == NULL) {
+    FAIL_RET();
+  }
+  memset(p->payload, 0, p->len);
+  ethhdr = (struct eth_hdr *)p->payload;
+  ethhdr->dest = *dst;
+  ethhdr->src = *src;
+  if (test_ports[port].input(p, &test_ports[port]) != ERR_OK) {
+    pbuf_free(p);
+  }
+}
+
+/* Setups/teardown functions */
+
+static void
+bridgeif_setup(void)
+{
+#if LWIP_TIMER_WHEEL
+  old_list_head = sys_timeouts_detach();
+#else
+  struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
+  old_list_head = *list_head;
+  *list_head = NULL;
+#endif
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+static void
+bridgeif_teardown(void)
+{
+  struct sys_timeo* t;
+  /* the only timers left are the FDB aging timers, their arg is the FDB
+     (which has no deinit function) */
+#if LWIP_TIMER_WHEEL
+  t = sys_timeouts_detach();
+#else
+  struct sys_timeo** list_head = sys_timeouts_get_next_timeout();
+  t = *list_head;
+  *list_head = NULL;
+#endif
+  while (t != NULL) {
+    struct sys_timeo* next = t->next;
+    mem_free(t->arg);
+    memp_free(MEMP_SYS_TIMEOUT, t);
+    t = next;
+  }
+#if LWIP_TIMER_WHEEL
+  sys_timeouts_attach(old_list_head);
+#else
+  *sys_timeouts_get_next_timeout() = old_list_head;
+#endif
+  lwip_sys_now = 0;
+  lwip_check_ensure_no_alloc(SKIP_POOL(MEMP_SYS_TIMEOUT));
+}
+
+
+/* Test functions */
+
+/** Learn addresses until the FDB is full: further addresses are not learnt
+ * and frames to them are flooded */
+START_TEST(test_bridgeif_fdb_full)
+{
+  void *fdb;
+  struct eth_addr addr;
+  u8_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(4);
+  fail_unless(fdb != NULL);
+
+  for (i = 0; i < 4; i++) {
+    addr = test_station(i);
+    bridgeif_fdb_update_src(fdb, &addr, i);
+  }
+  for (i = 0; i < 4; i++) {
+    addr = test_station(i);
+    fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == (bridgeif_portmask_t)(1 << i));
+  }
+
+  addr = test_station(4);
+  bridgeif_fdb_update_src(fdb, &addr, 1);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == BR_FLOOD);
+  /* ...without displacing a known entry */
+  for (i = 0; i < 4; i++) {
+    addr = test_station(i);
+    fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == (bridgeif_portmask_t)(1 << i));
+  }
+}
+END_TEST
+
+/** A learnt entry expires exactly BR_FDB_TIMEOUT_SEC seconds after it was
+ * last seen */
+START_TEST(test_bridgeif_fdb_expiry)
+{
+  void *fdb;
+  struct eth_addr addr = test_station(1);
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(4);
+  fail_unless(fdb != NULL);
+
+  bridgeif_fdb_update_src(fdb, &addr, 1);
+  bridgeif_age_seconds(TEST_FDB_TIMEOUT_SEC - 1);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == 2);
+  bridgeif_age_seconds(1);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == BR_FLOOD);
+}
+END_TEST
+
+/** Seeing a station again keeps its entry alive past the original expiry
+ * time (and moves it to the port it was seen on last) */
+START_TEST(test_bridgeif_fdb_refresh)
+{
+  void *fdb;
+  struct eth_addr addr = test_station(1);
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(4);
+  fail_unless(fdb != NULL);
+
+  bridgeif_fdb_update_src(fdb, &addr, 1);
+  bridgeif_age_seconds(200);
+  bridgeif_fdb_update_src(fdb, &addr, 2);
+  /* past the original expiry */
+  bridgeif_age_seconds(100);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == 4);
+  bridgeif_age_seconds(TEST_FDB_TIMEOUT_SEC - 100 - 1);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == 4);
+  bridgeif_age_seconds(1);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == BR_FLOOD);
+}
+END_TEST
+
+/** The entry of an expired station is reused for a new one without
+ * allocating memory */
+START_TEST(test_bridgeif_fdb_reuse)
+{
+  void *fdb;
+  struct eth_addr addr;
+  mem_size_t used;
+  u8_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  fdb = bridgeif_fdb_init(4);
+  fail_unless(fdb != NULL);
+  used = lwip_stats.mem.used;
+
+  for (i = 0; i < 4; i++) {
+    addr = test_station(i);
+    bridgeif_fdb_update_src(fdb, &addr, i);
+  }
+  /* all but station 0 stay alive */
+  bridgeif_age_seconds(100);
+  for (i = 1; i < 4; i++) {
+    addr = test_station(i);
+    bridgeif_fdb_update_src(fdb, &addr, i);
+  }
+  bridgeif_age_seconds(TEST_FDB_TIMEOUT_SEC - 100);
+  addr = test_station(0);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == BR_FLOOD);
+
+  /* the free entry takes station 4, then the table is full again */
+  addr = test_station(4);
+  bridgeif_fdb_update_src(fdb, &addr, 0);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == 1);
+  addr = test_station(5);
+  bridgeif_fdb_update_src(fdb, &addr, 0);
+  fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == BR_FLOOD);
+  for (i = 1; i < 4; i++) {
+    addr = test_station(i);
+    fail_unless(bridgeif_fdb_get_dst_ports(fdb, &addr) == (bridgeif_portmask_t)(1 << i));
+  }
+  fail_unless(lwip_stats.mem.used == used);
+}
+END_TEST
+
+/** With BRIDGEIF_CUT_THROUGH, unicast frames for other stations are forwarded
+ * in the port's input context, frames for the bridge itself and group
+ * addressed frames go through tcpip_thread. Source addresses are learnt in
+ * the port's input context for all of them. */
+START_TEST(test_bridgeif_cut_through)
+{
+#if BRIDGEIF_CUT_THROUGH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT
+  bridgeif_initdata_t initdata = BRIDGEIF_INITDATA1(TEST_NUM_PORTS, 8, 2, ETH_ADDR(2, 0, 0, 0, 0x99, 0x99));
+  struct eth_addr sta_a = test_station(0xa);
+  struct eth_addr sta_b = test_station(0xb);
+  struct eth_addr sta_c = test_station(0xc);
+  struct eth_addr bcast = {{0xff, 0xff, 0xff, 0xff, 0xff, 0xff}};
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  fail_unless(netif_add_noaddr(&test_bridge, &initdata, bridgeif_init, netif_input) == &test_bridge);
+  for (i = 0; i < TEST_NUM_PORTS; i++) {
+    fail_unless(netif_add_noaddr(&test_ports[i], NULL, test_port_init, netif_input) == &test_ports[i]);
+    fail_unless(bridgeif_add_port(&test_bridge, &test_ports[i]) == ERR_OK);
+    netif_set_up(&test_ports[i]);
+  }
+  while (tcpip_thread_poll_one());
+  memset(port_tx, 0, sizeof(port_tx));
+
+  /* unknown destination: flooded to the other ports right away */
+  test_port_input(0, &sta_b, &sta_a);
+  fail_unless((port_tx[0] == 0) && (port_tx[1] == 1) && (port_tx[2] == 1));
+  fail_unless(tcpip_thread_poll_one() == 0);
+
+  /* learnt destination: sent to its port only */
+  test_port_input(2, &sta_a, &sta_b);
+  fail_unless((port_tx[0] == 1) && (port_tx[1] == 1) && (port_tx[2] == 1));
+  fail_unless(tcpip_thread_poll_one() == 0);
+
+  /* for the bridge: passed to tcpip_thread and not forwarded */
+  test_port_input(0, (const struct eth_addr *)test_bridge.hwaddr, &sta_a);
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless((port_tx[0] == 1) && (port_tx[1] == 1) && (port_tx[2] == 1));
+
+  /* broadcast: flooded from tcpip_thread */
+  test_port_input(1, &bcast, &sta_c);
+  fail_unless((port_tx[0] == 1) && (port_tx[1] == 1) && (port_tx[2] == 1));
+
+  /* the broadcast taught the bridge where station C is before it got to
+     tcpip_thread */
+  test_port_input(0, &sta_c, &sta_a);
+  fail_unless((port_tx[0] == 1) && (port_tx[1] == 2) && (port_tx[2] == 1));
+  fail_unless(tcpip_thread_poll_one() == 1);
+  fail_unless((port_tx[0] == 2) && (port_tx[1] == 2) && (port_tx[2] == 2));
+  fail_unless(tcpip_thread_poll_one() == 0);
+
+  for (i = 0; i < TEST_NUM_PORTS; i++) {
+    netif_remove(&test_ports[i]);
+  }
+  netif_remove(&test_bridge);
+  /* the bridge's private data (the FDB is freed with its timer) */
+  mem_free(test_bridge.state);
+#else /* BRIDGEIF_CUT_THROUGH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+  LWIP_UNUSED_ARG(_i);
+#endif /* BRIDGEIF_CUT_THROUGH && !BRIDGEIF_PORT_NETIFS_OUTPUT_DIRECT */
+}
+END_TEST
+
+
+/** Create the suite including all tests for this module */
+Suite *
+bridgeif_suite(void)
+{
+  testfunc tests[] = {
+    TESTFUNC(test_bridgeif_fdb_full),
+    TESTFUNC(test_bridgeif_fdb_expiry),
+    TESTFUNC(test_bridgeif_fdb_refresh),
+    TESTFUNC(test_bridgeif_fdb_reuse),
+    TESTFUNC(test_bridgeif_cut_through)
+  };
+  return create_suite("BRIDGEIF", tests, sizeof(tests)/sizeof(testfunc), bridgeif_setup, bridgeif_teardown);
+}
@@ -42,25 +42,28 @@ tcp_remove_all(void)
   fail_unless(MEMP_STATS_GET(used, MEMP_PBUF_POOL) == 0);
 }
 
-/** Create a TCP segment usable for passing to tcp_input */
+/** Create a TCP segment with options usable for passing to tcp_input */
 static struct pbuf*
-tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+tcp_create_segment_opts(ip_addr_t* src_ip, ip_addr_t* dst_ip,
                    u16_t src_port, u16_t dst_port, void* data, size_t data_len,
-                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd)
+                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd,
+                   const u8_t* opts, u8_t optlen)
 {
   struct pbuf *p, *q;
   struct ip_hdr* iphdr;
   struct tcp_hdr* tcphdr;
-  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + sizeof(struct tcp_hdr) + data_len);
+  u16_t hdr_len = (u16_t)(sizeof(struct tcp_hdr) + optlen);
+  u16_t pbuf_len = (u16_t)(sizeof(struct ip_hdr) + hdr_len + data_len);
   LWIP_ASSERT("data_len too big", data_len <= 0xFFFF);
+  LWIP_ASSERT("optlen must be a multiple of 4", (optlen & 3) == 0);
 
   p = pbuf_alloc(PBUF_RAW, pbuf_len, PBUF_POOL);
   EXPECT_RETNULL(p != NULL);
   /* first pbuf must be big enough to hold the headers */
-  EXPECT_RETNULL(p->len >= (sizeof(struct ip_hdr) + sizeof(struct tcp_hdr)));
+  EXPECT_RETNULL(p->len >= (sizeof(struct ip_hdr) + hdr_len));
   if (data_len > 0) {
     /* first pbuf must be big enough to hold at least 1 data byte, too */
-    EXPECT_RETNULL(p->len > (sizeof(struct ip_hdr) + sizeof(struct tcp_hdr)));
+    EXPECT_RETNULL(p->len > (sizeof(struct ip_hdr) + hdr_len));
   }
 
   for(q = p; q != NULL; q = q->next) {
@@ -84,17 +87,20 @@ tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
   tcphdr->dest  = htons(dst_port);
   tcphdr->seqno = htonl(seqno);
   tcphdr->ackno = htonl(ackno);
-  TCPH_HDRLEN_SET(tcphdr, sizeof(struct tcp_hdr)/4);
+  TCPH_HDRLEN_SET(tcphdr, hdr_len/4);
   TCPH_FLAGS_SET(tcphdr, headerflags);
   tcphdr->wnd   = htons(wnd);
+  if (optlen > 0) {
+    memcpy(tcphdr + 1, opts, optlen);
+  }
 
   if (data_len > 0) {
     /* let p point to TCP data */
-    pbuf_header(p, -(s16_t)sizeof(struct tcp_hdr));
+    pbuf_header(p, -(s16_t)hdr_len);
     /* copy data */
     pbuf_take(p, data, (u16_t)data_len);
     /* let p point to TCP header again */
-    pbuf_header(p, sizeof(struct tcp_hdr));
+    pbuf_header(p, (s16_t)hdr_len);
   }
 
   /* calculate checksum */
@@ -107,6 +113,16 @@ tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
   return p;
 }
 
+/** Create a TCP segment usable for passing to tcp_input */
+static struct pbuf*
+tcp_create_segment_wnd(ip_addr_t* src_ip, ip_addr_t* dst_ip,
+                   u16_t src_port, u16_t dst_port, void* data, size_t data_len,
+                   u32_t seqno, u32_t ackno, u8_t headerflags, u16_t wnd)
+{
+  return tcp_create_segment_opts(src_ip, dst_ip, src_port, dst_port, data,
+    data_len, seqno, ackno, headerflags, wnd, NULL, 0);
+}
+
 /** Create a TCP segment usable for passing to tcp_input */
 struct pbuf*
 tcp_create_segment(ip_addr_t* src_ip, ip_addr_t* dst_ip,
@@ -141,6 +157,34 @@ struct pbuf* tcp_create_rx_segment_wnd(struct tcp_pcb* pcb, void* data, size_t d
     data, data_len, pcb->rcv_nxt + seqno_offset, pcb->lastack + ackno_offset, headerflags, wnd);
 }
 
+/** Create an ACK segment carrying a SACK option usable for passing to tcp_input
+ * - IP-addresses, ports, seqno and ackno are taken from pcb
+ * - ackno can be altered with an offset
+ * - sack_offsets holds num_blocks left/right edge pairs relative to pcb->lastack
+ */
+struct pbuf*
+tcp_create_rx_segment_sack(struct tcp_pcb* pcb, u32_t ackno_offset,
+                   const u32_t* sack_offsets, u8_t num_blocks)
+{
+  u8_t opts[40];
+  u8_t optlen = 0;
+  u8_t i, j;
+  LWIP_ASSERT("too many SACK blocks", num_blocks <= 4);
+
+  opts[optlen++] = 1; /* NOP */
+  opts[optlen++] = 1; /* NOP */
+  opts[optlen++] = 5; /* SACK */
+  opts[optlen++] = (u8_t)(2 + 8 * num_blocks);
+  for (i = 0; i < 2 * num_blocks; i++) {
+    u32_t edge = pcb->lastack + sack_offsets[i];
+    for (j = 0; j < 4; j++) {
+      opts[optlen++] = (u8_t)(edge >> (24 - 8 * j));
+    }
+  }
+  return tcp_create_segment_opts(&pcb->remote_ip, &pcb->local_ip, pcb->remote_port, pcb->local_port,
+    NULL, 0, pcb->rcv_nxt, pcb->lastack + ackno_offset, TCP_ACK, TCP_WND, opts, optlen);
+}
+
 /** Safely bring a tcp_pcb into the requested state */
 void
 tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, const ip_addr_t* local_ip,
@@ -158,22 +202,23 @@ tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, const ip_addr_t* local_
   pcb->lastack = iss;
   pcb->snd_lbb = iss;
   
+  /* set the addresses first: the pcb is hashed on them when registered */
   if (state == ESTABLISHED) {
-    TCP_REG(&tcp_active_pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
     ip_addr_copy(pcb->remote_ip, *remote_ip);
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_active_pcbs, pcb);
   } else if(state == LISTEN) {
-    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
+    TCP_REG(&tcp_listen_pcbs.pcbs, pcb);
   } else if(state == TIME_WAIT) {
-    TCP_REG(&tcp_tw_pcbs, pcb);
     ip_addr_copy(pcb->local_ip, *local_ip);
     pcb->local_port = local_port;
     ip_addr_copy(pcb->remote_ip, *remote_ip);
     pcb->remote_port = remote_port;
+    TCP_REG(&tcp_tw_pcbs, pcb);
   } else {
     fail();
   }
@@ -42,6 +42,8 @@ struct pbuf* tcp_create_rx_segment(struct tcp_pcb* pcb, void* data, size_t data_
                    u32_t seqno_offset, u32_t ackno_offset, u8_t headerflags);
 struct pbuf* tcp_create_rx_segment_wnd(struct tcp_pcb* pcb, void* data, size_t data_len,
                    u32_t seqno_offset, u32_t ackno_offset, u8_t headerflags, u16_t wnd);
+struct pbuf* tcp_create_rx_segment_sack(struct tcp_pcb* pcb, u32_t ackno_offset,
+                   const u32_t* sack_offsets, u8_t num_blocks);
 void tcp_set_state(struct tcp_pcb* pcb, enum tcp_state state, const ip_addr_t* local_ip,
                    const ip_addr_t* remote_ip, u16_t local_port, u16_t remote_port);
 void test_tcp_counters_err(void* arg, err_t err);
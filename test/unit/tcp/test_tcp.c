@@ -4,6 +4,8 @@
 #include "lwip/stats.h"
 #include "tcp_helper.h"
 #include "lwip/inet_chksum.h"
+#include "lwip/gro.h"
+#include "arch/sys_arch.h"
 
 #ifdef _MSC_VER
 #pragma warning(disable: 4307) /* we explicitly wrap around TCP seqnos */
@@ -96,6 +98,71 @@ START_TEST(test_tcp_new_abort)
 }
 END_TEST
 
+/** Create several ESTABLISHED pcbs differing only in the remote port and
+ * check that each segment is delivered to the connection it belongs to */
+START_TEST(test_tcp_demux)
+{
+  struct test_tcp_counters counters[3];
+  struct tcp_pcb* pcbs[3];
+  struct tcp_pcb* pcb_tw;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  int i, j;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+
+  for (i = 0; i < 3; i++) {
+    memset(&counters[i], 0, sizeof(counters[i]));
+    counters[i].expected_data_len = sizeof(data);
+    counters[i].expected_data = data;
+    pcbs[i] = test_tcp_new_counters_pcb(&counters[i]);
+    EXPECT_RET(pcbs[i] != NULL);
+    tcp_set_state(pcbs[i], ESTABLISHED, &test_local_ip, &test_remote_ip,
+                  TEST_LOCAL_PORT, (u16_t)(TEST_REMOTE_PORT + i));
+  }
+  /* a TIME-WAIT pcb sharing the local port must not catch the segments */
+  pcb_tw = tcp_new();
+  EXPECT_RET(pcb_tw != NULL);
+  tcp_set_state(pcb_tw, TIME_WAIT, &test_local_ip, &test_remote_ip,
+                TEST_LOCAL_PORT, (u16_t)(TEST_REMOTE_PORT + 3));
+
+  /* deliver in reverse order of creation */
+  for (i = 2; i >= 0; i--) {
+    p = tcp_create_rx_segment(pcbs[i], data, sizeof(data), 0, 0, 0);
+    EXPECT(p != NULL);
+    if (p != NULL) {
+      test_tcp_input(p, &netif);
+    }
+    for (j = 0; j < 3; j++) {
+      EXPECT(counters[j].recv_calls == ((j >= i) ? 1U : 0U));
+      EXPECT(counters[j].err_calls == 0);
+    }
+  }
+  EXPECT(pcb_tw->state == TIME_WAIT);
+
+  /* once removed, a pcb does not receive anymore: the segment is answered with RST */
+  tcp_abort(pcbs[1]);
+  txcounters.num_tx_calls = 0;
+  p = tcp_create_segment((ip_addr_t *)&test_remote_ip, (ip_addr_t *)&test_local_ip,
+                         TEST_REMOTE_PORT + 1, TEST_LOCAL_PORT, data, sizeof(data), 1, 1, TCP_ACK);
+  EXPECT(p != NULL);
+  if (p != NULL) {
+    test_tcp_input(p, &netif);
+  }
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(counters[0].recv_calls == 1);
+  EXPECT(counters[2].recv_calls == 1);
+
+  tcp_abort(pcbs[0]);
+  tcp_abort(pcbs[2]);
+  tcp_abort(pcb_tw);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
 /** Call tcp_new() and tcp_abort() and test memp stats */
 START_TEST(test_tcp_listen_passive_open)
 {
@@ -548,92 +615,792 @@ START_TEST(test_tcp_fast_retx_recover)
   EXPECT_RET(txcounters.num_tx_bytes == 0);*/
   memset(&txcounters, 0, sizeof(txcounters));
 
-  /* send even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
-  EXPECT_RET(err == ERR_OK);
-  err = tcp_output(pcb);
-  EXPECT_RET(err == ERR_OK);
-  /* ...and even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
-  EXPECT_RET(err == ERR_OK);
-  err = tcp_output(pcb);
-  EXPECT_RET(err == ERR_OK);
-  /* ...and even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
-  EXPECT_RET(err == ERR_OK);
-  err = tcp_output(pcb);
-  EXPECT_RET(err == ERR_OK);
-  /* ...and even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
-  EXPECT_RET(err == ERR_OK);
-  err = tcp_output(pcb);
-  EXPECT_RET(err == ERR_OK);
+  /* send even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  /* ...and even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  /* ...and even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  /* ...and even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+
+  /* send ACKs for data2 and data3 */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 12, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  /*EXPECT_RET(txcounters.num_tx_calls == 0);*/
+
+  /* ...and even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  /* ...and even more data */
+  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+
+#if 0
+  /* create expected segment */
+  p1 = tcp_create_rx_segment(pcb, counters.expected_data, data_len, 0, 0, 0);
+  EXPECT_RET(p != NULL);
+  if (p != NULL) {
+    /* pass the segment to tcp_input */
+    test_tcp_input(p, &netif);
+    /* check if counters are as expected */
+    EXPECT_RET(counters.close_calls == 0);
+    EXPECT_RET(counters.recv_calls == 1);
+    EXPECT_RET(counters.recved_bytes == data_len);
+    EXPECT_RET(counters.err_calls == 0);
+  }
+#endif
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+static u8_t tx_data[TCP_WND*2];
+
+static void
+check_seqnos(struct tcp_seg *segs, int num_expected, u32_t *seqnos_expected)
+{
+  struct tcp_seg *s = segs;
+  int i;
+  for (i = 0; i < num_expected; i++, s = s->next) {
+    EXPECT_RET(s != NULL);
+    EXPECT(s->tcphdr->seqno == htonl(seqnos_expected[i]));
+  }
+  EXPECT(s == NULL);
+}
+
+/** Receive a burst of segments through GRO and check that they reach the
+ * pcb as one segment and are acknowledged at once. */
+START_TEST(test_tcp_gro)
+{
+#if LWIP_TCP_GRO
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  struct ip_hdr *iphdr;
+  u32_t i;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = 4 * TCP_MSS;
+  counters.expected_data = (char *)tx_data;
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+
+  /* 3 full segments are held */
+  for (i = 0; i < 3; i++) {
+    p = tcp_create_rx_segment(pcb, &tx_data[i * TCP_MSS], TCP_MSS, i * TCP_MSS, 0, TCP_ACK);
+    EXPECT_RET(p != NULL);
+    iphdr = (struct ip_hdr *)p->payload;
+    IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+    IPH_CHKSUM_SET(iphdr, 0);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+    err = gro_input(p, &netif);
+    EXPECT(err == ERR_OK);
+  }
+  EXPECT(gro_pending());
+  EXPECT(counters.recv_calls == 0);
+  EXPECT(txcounters.num_tx_calls == 0);
+
+  /* ...and passed on as one segment that is acked immediately */
+  gro_flush(NULL);
+  EXPECT(!gro_pending());
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == 3 * TCP_MSS);
+  EXPECT(counters.err_calls == 0);
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  /* a pushed segment is not held */
+  p = tcp_create_rx_segment(pcb, &tx_data[3 * TCP_MSS], TCP_MSS, 0, 0, TCP_ACK | TCP_PSH);
+  EXPECT_RET(p != NULL);
+  iphdr = (struct ip_hdr *)p->payload;
+  IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+  IPH_CHKSUM_SET(iphdr, 0);
+  IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(!gro_pending());
+  EXPECT(counters.recv_calls == 2);
+  EXPECT(counters.recved_bytes == 4 * TCP_MSS);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_GRO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_GRO */
+}
+END_TEST
+
+#if LWIP_TCP_GRO
+/** Create a received segment for gro_input (tcp_create_rx_segment leaves the
+ * IP header to tcp_input)
+ * - offset is relative to rcv_start, not to the current pcb->rcv_nxt */
+static struct pbuf *
+gro_create_rx_segment(struct tcp_pcb *pcb, u32_t rcv_start, u32_t offset, u8_t headerflags)
+{
+  struct ip_hdr *iphdr;
+  struct pbuf *p = tcp_create_rx_segment(pcb, &tx_data[offset], TCP_MSS,
+                                         rcv_start + offset - pcb->rcv_nxt, 0, headerflags);
+  if (p != NULL) {
+    iphdr = (struct ip_hdr *)p->payload;
+    IPH_PROTO_SET(iphdr, IP_PROTO_TCP);
+    IPH_CHKSUM_SET(iphdr, 0);
+    IPH_CHKSUM_SET(iphdr, inet_chksum(iphdr, IP_HLEN));
+  }
+  return p;
+}
+#endif /* LWIP_TCP_GRO */
+
+/** A segment that does not continue the held one (out of order) flushes the
+ * held segment instead of being merged into it. */
+START_TEST(test_tcp_gro_ooseq)
+{
+#if LWIP_TCP_GRO
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  u32_t i, rcv_start;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = 3 * TCP_MSS;
+  counters.expected_data = (char *)tx_data;
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  rcv_start = pcb->rcv_nxt;
+
+  /* segment 0 is held */
+  p = gro_create_rx_segment(pcb, rcv_start, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(gro_pending());
+  EXPECT(counters.recv_calls == 0);
+
+  /* segment 2 skips segment 1: segment 0 is passed on alone */
+  p = gro_create_rx_segment(pcb, rcv_start, 2 * TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == TCP_MSS);
+
+  /* segment 2 is held on its own and goes to the ooseq queue */
+  EXPECT(gro_pending());
+  gro_flush(NULL);
+  EXPECT(!gro_pending());
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == TCP_MSS);
+
+  /* a retransmission of segment 0 does not continue the held segment 1 */
+  p = gro_create_rx_segment(pcb, rcv_start, TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(gro_pending());
+  p = gro_create_rx_segment(pcb, rcv_start, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  gro_flush(NULL);
+  EXPECT(!gro_pending());
+  EXPECT(counters.err_calls == 0);
+#if TCP_QUEUE_OOSEQ
+  /* segment 1 filled the hole: segments 1 and 2 are received */
+  EXPECT(counters.recved_bytes == 3 * TCP_MSS);
+#endif /* TCP_QUEUE_OOSEQ */
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_GRO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_GRO */
+}
+END_TEST
+
+/** A segment with a bad TCP checksum is never held or merged: it flushes the
+ * held segment of its flow and is dropped by tcp_input. */
+START_TEST(test_tcp_gro_bad_chksum)
+{
+#if LWIP_TCP_GRO && CHECKSUM_CHECK_TCP
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf *p;
+  struct tcp_hdr *tcphdr;
+  u32_t i, rcv_start;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = 2 * TCP_MSS;
+  counters.expected_data = (char *)tx_data;
+
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  rcv_start = pcb->rcv_nxt;
+
+  /* a corrupted first segment is not held */
+  p = gro_create_rx_segment(pcb, rcv_start, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  tcphdr->chksum ^= PP_HTONS(0x0101);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(!gro_pending());
+  EXPECT(counters.recv_calls == 0);
+
+  /* segment 0 is held, a corrupted segment 1 flushes it and is dropped */
+  p = gro_create_rx_segment(pcb, rcv_start, 0, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(gro_pending());
+  p = gro_create_rx_segment(pcb, rcv_start, TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  tcphdr = (struct tcp_hdr *)((u8_t *)p->payload + IP_HLEN);
+  tcphdr->chksum ^= PP_HTONS(0x0101);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(!gro_pending());
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(counters.recved_bytes == TCP_MSS);
+
+  /* the retransmitted segment 1 is received */
+  p = gro_create_rx_segment(pcb, rcv_start, TCP_MSS, TCP_ACK | TCP_PSH);
+  EXPECT_RET(p != NULL);
+  err = gro_input(p, &netif);
+  EXPECT(err == ERR_OK);
+  EXPECT(counters.recv_calls == 2);
+  EXPECT(counters.recved_bytes == 2 * TCP_MSS);
+  EXPECT(counters.err_calls == 0);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_GRO && CHECKSUM_CHECK_TCP */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_GRO && CHECKSUM_CHECK_TCP */
+}
+END_TEST
+
+/** Send data with sequence numbers that wrap around the u32_t range.
+ * Then, provoke fast retransmission by duplicate ACKs and check that all
+ * segment lists are still properly sorted. */
+START_TEST(test_tcp_fast_rexmit_wraparound)
+{
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  err_t err;
+  size_t i;
+  u16_t sent_total = 0;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb */
+  tcp_ticks = SEQNO1 - ISS;
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = 2*TCP_MSS;
+  /* start in congestion advoidance */
+  pcb->ssthresh = pcb->cwnd;
+
+  /* send 6 mss-sized segments */
+  for (i = 0; i < 6; i++) {
+    err = tcp_write(pcb, &tx_data[sent_total], TCP_MSS, TCP_WRITE_FLAG_COPY);
+    EXPECT_RET(err == ERR_OK);
+    sent_total += TCP_MSS;
+  }
+  check_seqnos(pcb->unsent, 6, seqnos);
+  EXPECT(pcb->unacked == NULL);
+  err = tcp_output(pcb);
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(txcounters.num_tx_bytes == 2 * (TCP_MSS + 40U));
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  check_seqnos(pcb->unacked, 2, seqnos);
+  check_seqnos(pcb->unsent, 4, &seqnos[2]);
+
+  /* ACK the first segment */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK);
+  test_tcp_input(p, &netif);
+  /* ensure this didn't trigger a retransmission. Only one
+  segment should be transmitted because cwnd opened up by
+  TCP_MSS and a fraction since we are in congestion avoidance */
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(txcounters.num_tx_bytes == TCP_MSS + 40U);
+  memset(&txcounters, 0, sizeof(txcounters));
+  check_seqnos(pcb->unacked, 2, &seqnos[1]);
+  check_seqnos(pcb->unsent, 3, &seqnos[3]);
+
+  /* 3 dupacks */
+  EXPECT(pcb->dupacks == 0);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->dupacks == 1);
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(pcb->dupacks == 2);
+  /* 3rd dupack -> fast rexmit */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 3);
+  EXPECT(txcounters.num_tx_calls == 4);
+  memset(&txcounters, 0, sizeof(txcounters));
+  EXPECT(pcb->unsent == NULL);
+  check_seqnos(pcb->unacked, 5, &seqnos[1]);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+/** Lose three segments of one window and report the holes with SACK blocks.
+ * Check that all holes are retransmitted within one round trip (RFC 6675)
+ * and that recovery only ends once everything sent before it is acked. */
+START_TEST(test_tcp_sack_loss_recovery)
+{
+#if LWIP_TCP_SACK_IN
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  err_t err;
+  size_t i;
+  u32_t recovery_point;
+  /* offsets relative to the first lost segment (segment 1) */
+  const u32_t sacks1[] = { 1 * TCP_MSS, 2 * TCP_MSS };
+  const u32_t sacks2[] = { 1 * TCP_MSS, 2 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS };
+  const u32_t sacks3[] = { 1 * TCP_MSS, 2 * TCP_MSS, 3 * TCP_MSS, 4 * TCP_MSS, 5 * TCP_MSS, 9 * TCP_MSS };
+  /* offsets relative to segment 3 */
+  const u32_t sacks4[] = { 1 * TCP_MSS, 2 * TCP_MSS, 3 * TCP_MSS, 7 * TCP_MSS };
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  /* create and initialize the pcb, sequence numbers wrap during the test */
+  tcp_ticks = SEQNO1 - ISS;
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  tcp_set_flags(pcb, TF_SACK);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = pcb->snd_wnd;
+  pcb->ssthresh = pcb->cwnd;
+
+  /* send 10 mss-sized segments, segments 1, 3 and 5 get lost */
+  for (i = 0; i < 10; i++) {
+    err = tcp_write(pcb, &tx_data[i * TCP_MSS], TCP_MSS, TCP_WRITE_FLAG_COPY);
+    EXPECT_RET(err == ERR_OK);
+  }
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 10);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* ACK segment 0 */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT_RET(txcounters.num_tx_calls == 0);
+
+  /* two dupacks SACKing segments 2 and 4 don't start recovery */
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks1, 1);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 1);
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks2, 2);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 2);
+  EXPECT(txcounters.num_tx_calls == 0);
+  EXPECT(!(pcb->flags & TF_INFR));
+  /* a dupack repeating known SACK blocks is no dupack */
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks2, 2);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->dupacks == 0);
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks1, 1);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(txcounters.num_tx_calls == 0);
+
+  /* SACKing segments 6 to 9 shows all three holes lost: all of them are
+     retransmitted at once */
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks3, 3);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->cwnd == 5 * TCP_MSS);
+  EXPECT(pcb->ssthresh == 5 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 3);
+  EXPECT(txcounters.num_tx_bytes == 3 * (TCP_MSS + 40U));
+  EXPECT(pcb->unsent == NULL);
+  recovery_point = pcb->snd_nxt;
+  EXPECT(pcb->recovery_point == recovery_point);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* partial ACK up to segment 3: still in recovery, nothing left to resend */
+  p = tcp_create_rx_segment_sack(pcb, 2 * TCP_MSS, sacks4, 2);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->cwnd == 5 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 0);
+
+  /* ACK everything: recovery ends */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, recovery_point - pcb->lastack, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(!(pcb->flags & TF_INFR));
+  EXPECT(pcb->ssthresh == 5 * TCP_MSS);
+  EXPECT(pcb->cwnd <= pcb->ssthresh + TCP_MSS);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(pcb->unsent == NULL);
+
+  /* make sure the pcb is freed */
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_SACK_IN */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_SACK_IN */
+}
+END_TEST
+
+/** Lose the first segment and one beyond the reduced congestion window.
+ * The second hole must be retransmitted as soon as the pipe allows it,
+ * not only once a partial ACK moves the window past it. */
+START_TEST(test_tcp_sack_rexmit_beyond_cwnd)
+{
+#if LWIP_TCP_SACK_IN
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  err_t err;
+  size_t i;
+  /* offsets relative to the first (lost) segment, segment 5 is lost, too */
+  const u32_t sacks1[] = { 1 * TCP_MSS, 5 * TCP_MSS };
+  const u32_t sacks2[] = { 1 * TCP_MSS, 5 * TCP_MSS, 6 * TCP_MSS, 9 * TCP_MSS };
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  tcp_set_flags(pcb, TF_SACK);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = pcb->snd_wnd;
+  pcb->ssthresh = pcb->cwnd;
+
+  /* send 9 mss-sized segments, segments 0 and 5 get lost */
+  for (i = 0; i < 9; i++) {
+    err = tcp_write(pcb, &tx_data[i * TCP_MSS], TCP_MSS, TCP_WRITE_FLAG_COPY);
+    EXPECT_RET(err == ERR_OK);
+  }
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.num_tx_calls == 9);
+  memset(&txcounters, 0, sizeof(txcounters));
+
+  /* SACKing four segments above the first one shows it lost: recovery
+     starts and the reduced cwnd ends where segment 5 starts */
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks1, 1);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->cwnd == 5 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 1);
+
+  /* SACKing segments 6 to 8 shows segment 5 lost, too: the pipe (only the
+     retransmitted first segment) is below cwnd, so it is resent at once */
+  p = tcp_create_rx_segment_sack(pcb, 0, sacks2, 2);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->flags & TF_INFR);
+  EXPECT(pcb->cwnd == 5 * TCP_MSS);
+  EXPECT(txcounters.num_tx_calls == 2);
+  EXPECT(txcounters.num_tx_bytes == 2 * (TCP_MSS + 40U));
+  EXPECT(pcb->unsent == NULL);
+
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
+  tcp_abort(pcb);
+  EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_SACK_IN */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_SACK_IN */
+}
+END_TEST
+
+/** Run CUBIC through a congestion event: ssthresh drops to 0.7 * cwnd, cwnd
+ * grows back to the previous maximum in K seconds independent of the RTT,
+ * then probes beyond it. */
+START_TEST(test_tcp_cc_cubic)
+{
+#if LWIP_TCP_CC_CUBIC
+  struct tcp_pcb* pcb;
+  int i;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb = tcp_new();
+  EXPECT_RET(pcb != NULL);
+  EXPECT(tcp_get_cc(pcb) == &tcp_cc_newreno);
+  tcp_set_cc(pcb, &tcp_cc_cubic);
+  EXPECT(tcp_get_cc(pcb) == &tcp_cc_cubic);
+  pcb->state = ESTABLISHED;
+  pcb->mss = TCP_MSS;
+  pcb->cwnd = 100 * TCP_MSS;
+  pcb->snd_wnd = 100 * TCP_MSS;
+
+  /* loss at 100 segments: multiplicative decrease by beta = 0.7 */
+  pcb->cc_ops->on_loss(pcb);
+  EXPECT(pcb->ssthresh == (100 * TCP_MSS * 717) / 1024);
+  pcb->cwnd = pcb->ssthresh;
+
+  /* the first ACK starts the epoch, then one window is acked per second,
+     K = cbrt(30 / 0.4) = 4.2 seconds */
+  lwip_sys_now = 1000;
+  pcb->cc_ops->on_ack(pcb, pcb->cwnd);
+  for (i = 0; i < 4; i++) {
+    lwip_sys_now += 1000;
+    pcb->cc_ops->on_ack(pcb, pcb->cwnd);
+  }
+  /* concave region: close to, but still below the previous maximum */
+  EXPECT(pcb->cwnd > 99 * TCP_MSS);
+  EXPECT(pcb->cwnd < 100 * TCP_MSS);
+  for (i = 0; i < 6; i++) {
+    lwip_sys_now += 1000;
+    pcb->cc_ops->on_ack(pcb, pcb->cwnd);
+  }
+  /* convex region: 100 + 0.4 * (10 - 4.2)^3 = 177 segments */
+  EXPECT(pcb->cwnd > 170 * TCP_MSS);
+  EXPECT(pcb->cwnd < 180 * TCP_MSS);
+
+  /* a loss below the previous maximum triggers fast convergence */
+  pcb->cwnd = 90 * TCP_MSS;
+  pcb->cc_ops->on_loss(pcb);
+  EXPECT(pcb->cubic.w_max < 90 * TCP_MSS);
+  /* RTO falls back to one segment */
+  pcb->cc_ops->on_rto(pcb);
+  EXPECT(pcb->cwnd == TCP_MSS);
+
+  tcp_abort(pcb);
+  lwip_sys_now = 0;
+#else /* LWIP_TCP_CC_CUBIC */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_CC_CUBIC */
+}
+END_TEST
+
+#if LWIP_TCP_ZEROCOPY
+static int test_tcp_zc_freed;
+
+static void
+test_tcp_zc_free(struct pbuf *p)
+{
+  LWIP_UNUSED_ARG(p);
+  test_tcp_zc_freed++;
+}
+#endif /* LWIP_TCP_ZEROCOPY */
+
+/** Send an application pbuf chain with tcp_write_pbuf and check that it is
+ * released exactly once, after all of its data has been acknowledged. */
+START_TEST(test_tcp_write_pbuf_zerocopy)
+{
+#if LWIP_TCP_ZEROCOPY
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf_custom pc;
+  struct pbuf *p, *p2;
+  err_t err;
+  size_t i;
+  LWIP_UNUSED_ARG(_i);
+
+  for (i = 0; i < sizeof(tx_data); i++) {
+    tx_data[i] = (u8_t)i;
+  }
+  test_tcp_zc_freed = 0;
+
+  /* initialize local vars */
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
 
-  /* send ACKs for data2 and data3 */
-  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 12, TCP_ACK);
+  /* create and initialize the pcb */
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = pcb->snd_wnd;
+
+  /* a chain of two buffers whose boundary lies inside the second segment */
+  pc.custom_free_function = test_tcp_zc_free;
+  p = pbuf_alloced_custom(PBUF_RAW, TCP_MSS + 50, PBUF_REF, &pc, tx_data, TCP_MSS + 50);
   EXPECT_RET(p != NULL);
-  test_tcp_input(p, &netif);
-  /*EXPECT_RET(txcounters.num_tx_calls == 0);*/
+  p2 = pbuf_alloc(PBUF_RAW, 2 * TCP_MSS + 50, PBUF_REF);
+  EXPECT_RET(p2 != NULL);
+  p2->payload = &tx_data[TCP_MSS + 50];
+  pbuf_cat(p, p2);
+
+  /* data that does not fit into the send buffer is refused, the caller
+     keeps the pbuf */
+  pcb->snd_buf = 3 * TCP_MSS;
+  err = tcp_write_pbuf(pcb, p, 0);
+  EXPECT_RET(err == ERR_MEM);
+  EXPECT(pcb->unsent == NULL);
+  EXPECT(test_tcp_zc_freed == 0);
+  pcb->snd_buf = TCP_SND_BUF;
 
-  /* ...and even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
-  EXPECT_RET(err == ERR_OK);
-  err = tcp_output(pcb);
-  EXPECT_RET(err == ERR_OK);
-  /* ...and even more data */
-  err = tcp_write(pcb, data5, sizeof(data5), TCP_WRITE_FLAG_COPY);
+  err = tcp_write_pbuf(pcb, p, 0);
   EXPECT_RET(err == ERR_OK);
+  /* one slice per segment, two for the segment crossing the boundary */
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 5);
+  EXPECT(pcb->snd_buf == TCP_SND_BUF - (3 * TCP_MSS + 100));
   err = tcp_output(pcb);
   EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 4);
+  EXPECT(txcounters.num_tx_bytes == 3 * TCP_MSS + 100 + 4 * 40U);
+  EXPECT(test_tcp_zc_freed == 0);
+  memset(&txcounters, 0, sizeof(txcounters));
 
-#if 0
-  /* create expected segment */
-  p1 = tcp_create_rx_segment(pcb, counters.expected_data, data_len, 0, 0, 0);
+  /* a partial ACK releases the acked slices only */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 2 * TCP_MSS, TCP_ACK);
   EXPECT_RET(p != NULL);
-  if (p != NULL) {
-    /* pass the segment to tcp_input */
-    test_tcp_input(p, &netif);
-    /* check if counters are as expected */
-    EXPECT_RET(counters.close_calls == 0);
-    EXPECT_RET(counters.recv_calls == 1);
-    EXPECT_RET(counters.recved_bytes == data_len);
-    EXPECT_RET(counters.err_calls == 0);
-  }
-#endif
+  test_tcp_input(p, &netif);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 2);
+  EXPECT(test_tcp_zc_freed == 0);
+
+  /* ACKing the rest releases the application pbuf */
+  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS + 100, TCP_ACK);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(pcb->unacked == NULL);
+  EXPECT(pcb->snd_queuelen == 0);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_ZC_REF) == 0);
+  EXPECT(test_tcp_zc_freed == 1);
+
   /* make sure the pcb is freed */
   EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
   tcp_abort(pcb);
   EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+  EXPECT(test_tcp_zc_freed == 1);
+#else /* LWIP_TCP_ZEROCOPY */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_ZEROCOPY */
 }
 END_TEST
 
-static u8_t tx_data[TCP_WND*2];
-
-static void
-check_seqnos(struct tcp_seg *segs, int num_expected, u32_t *seqnos_expected)
-{
-  struct tcp_seg *s = segs;
-  int i;
-  for (i = 0; i < num_expected; i++, s = s->next) {
-    EXPECT_RET(s != NULL);
-    EXPECT(s->tcphdr->seqno == htonl(seqnos_expected[i]));
-  }
-  EXPECT(s == NULL);
-}
-
-/** Send data with sequence numbers that wrap around the u32_t range.
- * Then, provoke fast retransmission by duplicate ACKs and check that all
- * segment lists are still properly sorted. */
-START_TEST(test_tcp_fast_rexmit_wraparound)
+/** Send data as super-segments over a netif with NETIF_FLAG_GSO: they are
+ * split to fit the window, and into MSS-sized packets in software when the
+ * netif cannot take them. */
+START_TEST(test_tcp_gso)
 {
+#if LWIP_TCP_GSO
   struct netif netif;
   struct test_tcp_txcounters txcounters;
   struct test_tcp_counters counters;
   struct tcp_pcb* pcb;
-  struct pbuf* p;
+  struct pbuf *q;
   err_t err;
   size_t i;
-  u16_t sent_total = 0;
+  u32_t seqno;
+  u16_t id = 0;
   LWIP_UNUSED_ARG(_i);
 
   for (i = 0; i < sizeof(tx_data); i++) {
@@ -642,70 +1409,112 @@ START_TEST(test_tcp_fast_rexmit_wraparound)
 
   /* initialize local vars */
   test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  netif.flags |= NETIF_FLAG_GSO;
   memset(&counters, 0, sizeof(counters));
 
   /* create and initialize the pcb */
-  tcp_ticks = SEQNO1 - ISS;
   pcb = test_tcp_new_counters_pcb(&counters);
   EXPECT_RET(pcb != NULL);
   tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
   pcb->mss = TCP_MSS;
   /* disable initial congestion window (we don't send a SYN here...) */
-  pcb->cwnd = 2*TCP_MSS;
-  /* start in congestion advoidance */
-  pcb->ssthresh = pcb->cwnd;
+  pcb->cwnd = pcb->snd_wnd;
 
-  /* send 6 mss-sized segments */
-  for (i = 0; i < 6; i++) {
-    err = tcp_write(pcb, &tx_data[sent_total], TCP_MSS, TCP_WRITE_FLAG_COPY);
-    EXPECT_RET(err == ERR_OK);
-    sent_total += TCP_MSS;
-  }
-  check_seqnos(pcb->unsent, 6, seqnos);
-  EXPECT(pcb->unacked == NULL);
+  /* 4 segments of data are queued as one super-segment */
+  err = tcp_write(pcb, tx_data, 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(pcb->unsent != NULL);
+  EXPECT(pcb->unsent->next == NULL);
+  EXPECT(pcb->unsent->len == 4 * TCP_MSS);
+
+  /* only the part fitting into cwnd is sent, in one packet */
+  pcb->cwnd = 2 * TCP_MSS + TCP_MSS / 2;
   err = tcp_output(pcb);
-  EXPECT(txcounters.num_tx_calls == 2);
-  EXPECT(txcounters.num_tx_bytes == 2 * (TCP_MSS + 40U));
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(txcounters.num_tx_bytes == 2 * TCP_MSS + 40U);
+  EXPECT_RET(pcb->unsent != NULL);
+  EXPECT(pcb->unsent->len == 2 * TCP_MSS);
   memset(&txcounters, 0, sizeof(txcounters));
 
-  check_seqnos(pcb->unacked, 2, seqnos);
-  check_seqnos(pcb->unsent, 4, &seqnos[2]);
-
-  /* ACK the first segment */
-  p = tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK);
-  test_tcp_input(p, &netif);
-  /* ensure this didn't trigger a retransmission. Only one
-  segment should be transmitted because cwnd opened up by
-  TCP_MSS and a fraction since we are in congestion avoidance */
+  pcb->cwnd = pcb->snd_wnd;
+  err = tcp_output(pcb);
+  EXPECT_RET(err == ERR_OK);
   EXPECT(txcounters.num_tx_calls == 1);
-  EXPECT(txcounters.num_tx_bytes == TCP_MSS + 40U);
+  EXPECT(txcounters.num_tx_bytes == 2 * TCP_MSS + 40U);
+  EXPECT(pcb->unsent == NULL);
   memset(&txcounters, 0, sizeof(txcounters));
-  check_seqnos(pcb->unacked, 2, &seqnos[1]);
-  check_seqnos(pcb->unsent, 3, &seqnos[3]);
 
-  /* 3 dupacks */
-  EXPECT(pcb->dupacks == 0);
-  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
-  test_tcp_input(p, &netif);
-  EXPECT(txcounters.num_tx_calls == 0);
-  EXPECT(pcb->dupacks == 1);
-  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
-  test_tcp_input(p, &netif);
-  EXPECT(txcounters.num_tx_calls == 0);
-  EXPECT(pcb->dupacks == 2);
-  /* 3rd dupack -> fast rexmit */
-  p = tcp_create_rx_segment(pcb, NULL, 0, 0, 0, TCP_ACK);
-  test_tcp_input(p, &netif);
-  EXPECT(pcb->dupacks == 3);
+  /* a super-segment sent over a netif without GSO is split in software */
+  err = tcp_write(pcb, &tx_data[4 * TCP_MSS], 4 * TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(pcb->unsent != NULL);
+  EXPECT(pcb->unsent->len == 4 * TCP_MSS);
+  netif.flags &= (u8_t)~NETIF_FLAG_GSO;
+  seqno = pcb->snd_nxt;
+  txcounters.copy_tx_packets = 1;
+  err = tcp_output(pcb);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(err == ERR_OK);
   EXPECT(txcounters.num_tx_calls == 4);
-  memset(&txcounters, 0, sizeof(txcounters));
-  EXPECT(pcb->unsent == NULL);
-  check_seqnos(pcb->unacked, 5, &seqnos[1]);
+  EXPECT(txcounters.num_tx_bytes == 4 * (TCP_MSS + 40U));
+  i = 0;
+  for (q = txcounters.tx_packets; q != NULL; q = q->next, i++) {
+    struct pbuf *seg = pbuf_alloc(PBUF_RAW, q->len, PBUF_RAM);
+    struct ip_hdr *iphdr = (struct ip_hdr *)q->payload;
+    struct tcp_hdr *tcphdr = (struct tcp_hdr *)(iphdr + 1);
+    EXPECT_RET(seg != NULL);
+    EXPECT(q->len == TCP_MSS + 40U);
+    EXPECT(lwip_ntohs(IPH_LEN(iphdr)) == TCP_MSS + 40U);
+    EXPECT(inet_chksum(iphdr, IP_HLEN) == 0);
+    if (i > 0) {
+      EXPECT(lwip_ntohs(IPH_ID(iphdr)) == (u16_t)(id + i));
+    } else {
+      id = lwip_ntohs(IPH_ID(iphdr));
+    }
+    EXPECT(lwip_ntohl(tcphdr->seqno) == seqno + i * TCP_MSS);
+    EXPECT(((TCPH_FLAGS(tcphdr) & TCP_PSH) != 0) == (i == 3));
+    EXPECT(memcmp(tcphdr + 1, &tx_data[(4 + i) * TCP_MSS], TCP_MSS) == 0);
+    /* the TCP checksum is valid for each packet */
+    MEMCPY(seg->payload, tcphdr, TCP_HLEN + TCP_MSS);
+    pbuf_realloc(seg, TCP_HLEN + TCP_MSS);
+    EXPECT(ip_chksum_pseudo(seg, IP_PROTO_TCP, seg->tot_len, &test_local_ip, &test_remote_ip) == 0);
+    pbuf_free(seg);
+  }
+  EXPECT(i == 4);
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* the next packet does not reuse the IDs of the split packets */
+  tcp_ack_now(pcb);
+  txcounters.copy_tx_packets = 1;
+  err = tcp_output(pcb);
+  txcounters.copy_tx_packets = 0;
+  EXPECT_RET(err == ERR_OK);
+  EXPECT_RET(txcounters.tx_packets != NULL);
+  EXPECT(lwip_ntohs(IPH_ID((struct ip_hdr *)txcounters.tx_packets->payload)) == (u16_t)(id + 4));
+  pbuf_free(txcounters.tx_packets);
+  txcounters.tx_packets = NULL;
+
+  /* a clone of a super-segment is still segmented */
+  q = pbuf_alloc(PBUF_RAW, 4 * TCP_MSS, PBUF_RAM);
+  EXPECT_RET(q != NULL);
+  q->gso_size = TCP_MSS;
+  {
+    struct pbuf *clone = pbuf_clone(PBUF_RAW, PBUF_POOL, q);
+    EXPECT_RET(clone != NULL);
+    EXPECT(clone->gso_size == TCP_MSS);
+    pbuf_free(clone);
+  }
+  pbuf_free(q);
 
   /* make sure the pcb is freed */
   EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 1);
   tcp_abort(pcb);
   EXPECT_RET(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_GSO */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_GSO */
 }
 END_TEST
 
@@ -1664,12 +2473,227 @@ START_TEST(test_tcp_persist_split)
 }
 END_TEST
 
+#if LWIP_TCP_KEEPALIVE
+#define TEST_KEEP_INTVL(pcb) ((pcb)->keep_intvl)
+#else
+#define TEST_KEEP_INTVL(pcb) TCP_KEEPINTVL_DEFAULT
+#endif
+
+static u32_t wheel_polls;
+static u32_t wheel_poll_ticks[4];
+static err_t
+test_tcp_wheel_poll(void *arg, struct tcp_pcb *pcb)
+{
+  LWIP_UNUSED_ARG(arg);
+  LWIP_UNUSED_ARG(pcb);
+  if (wheel_polls < LWIP_ARRAYSIZE(wheel_poll_ticks)) {
+    wheel_poll_ticks[wheel_polls] = tcp_ticks;
+  }
+  wheel_polls++;
+  return ERR_OK;
+}
+
+/** Check that an idle pcb is polled and sends keepalives at the same ticks
+ * whether or not LWIP_TCP_TIMER_WHEEL parks it, and that input wakes it up */
+START_TEST(test_tcp_timer_wheel)
+{
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct pbuf* p;
+  char data[] = {1, 2, 3, 4};
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  u32_t start, i;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  counters.expected_data_len = sizeof(data);
+  counters.expected_data = data;
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+
+  /* poll interval shorter than the wheel */
+  wheel_polls = 0;
+  tcp_poll(pcb, test_tcp_wheel_poll, 3);
+  start = tcp_ticks;
+  for (i = 0; i < 12; i++) {
+    tcp_slowtmr();
+  }
+  EXPECT(wheel_polls == 4);
+  for (i = 0; i < 4; i++) {
+    EXPECT(wheel_poll_ticks[i] == start + 3 * (i + 1));
+  }
+#if LWIP_TCP_TIMER_WHEEL
+  EXPECT(pcb->wheel_state == TCP_WHEEL_PARKED);
+#endif
+
+  /* poll interval longer than the wheel */
+  wheel_polls = 0;
+  tcp_poll(pcb, test_tcp_wheel_poll, 3 * TCP_TIMER_WHEEL_SLOTS);
+  start = tcp_ticks;
+  for (i = 0; i < 6 * TCP_TIMER_WHEEL_SLOTS; i++) {
+    tcp_slowtmr();
+  }
+  EXPECT(wheel_polls == 2);
+  EXPECT(wheel_poll_ticks[0] == start + 3 * TCP_TIMER_WHEEL_SLOTS);
+  EXPECT(wheel_poll_ticks[1] == start + 6 * TCP_TIMER_WHEEL_SLOTS);
+
+  /* keepalive without poll callback */
+  ip_set_option(pcb, SOF_KEEPALIVE);
+  pcb->keep_idle = 3000;
+  pcb->tmr = tcp_ticks;
+  tcp_poll(pcb, NULL, 0);
+  txcounters.num_tx_calls = 0;
+  for (i = 1; i <= (3000 + TEST_KEEP_INTVL(pcb)) / TCP_SLOW_INTERVAL + 1; i++) {
+    tcp_slowtmr();
+    if (i < 3000 / TCP_SLOW_INTERVAL + 1) {
+      EXPECT(txcounters.num_tx_calls == 0);
+    } else if (i < (3000 + TEST_KEEP_INTVL(pcb)) / TCP_SLOW_INTERVAL + 1) {
+      EXPECT(txcounters.num_tx_calls == 1);
+    } else {
+      EXPECT(txcounters.num_tx_calls == 2);
+    }
+  }
+  EXPECT(pcb->keep_cnt_sent == 2);
+  EXPECT(wheel_polls == 2);
+
+  /* data received by a parked pcb is acknowledged by the fast timer */
+  tcp_slowtmr();
+#if LWIP_TCP_TIMER_WHEEL
+  EXPECT(pcb->wheel_state == TCP_WHEEL_PARKED);
+#endif
+  txcounters.num_tx_calls = 0;
+  p = tcp_create_rx_segment(pcb, data, sizeof(data), 0, 0, 0);
+  EXPECT_RET(p != NULL);
+  test_tcp_input(p, &netif);
+  EXPECT(counters.recv_calls == 1);
+  EXPECT(txcounters.num_tx_calls == 0);
+#if LWIP_TCP_TIMER_WHEEL
+  EXPECT(pcb->wheel_state == TCP_WHEEL_BUSY);
+#endif
+  tcp_fasttmr();
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->keep_cnt_sent == 0);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+}
+END_TEST
+
+/** Check that queueing data or a FIN wakes a parked pcb, so that unsent data
+ * is not left alone until the pcb is next due in the wheel */
+START_TEST(test_tcp_timer_wheel_write)
+{
+#if LWIP_TCP_TIMER_WHEEL
+  struct test_tcp_counters counters;
+  struct tcp_pcb* pcb;
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  err_t err;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  pcb = test_tcp_new_counters_pcb(&counters);
+  EXPECT_RET(pcb != NULL);
+  tcp_set_state(pcb, ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT, TEST_REMOTE_PORT);
+  pcb->mss = TCP_MSS;
+  /* disable initial congestion window (we don't send a SYN here...) */
+  pcb->cwnd = pcb->snd_wnd;
+
+  tcp_slowtmr();
+  EXPECT(pcb->wheel_state == TCP_WHEEL_PARKED);
+  err = tcp_write(pcb, tx_data, TCP_MSS, TCP_WRITE_FLAG_COPY);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(pcb->wheel_state == TCP_WHEEL_BUSY);
+  EXPECT(txcounters.num_tx_calls == 0);
+  /* the next poll tick sends it */
+  tcp_slowtmr();
+  EXPECT(txcounters.num_tx_calls == 1);
+  EXPECT(pcb->wheel_state == TCP_WHEEL_BUSY);
+
+  /* the ACK lets it park again */
+  test_tcp_input(tcp_create_rx_segment(pcb, NULL, 0, 0, TCP_MSS, TCP_ACK), &netif);
+  EXPECT(pcb->unacked == NULL);
+  tcp_slowtmr();
+  EXPECT(pcb->wheel_state == TCP_WHEEL_PARKED);
+  err = tcp_enqueue_flags(pcb, TCP_FIN);
+  EXPECT_RET(err == ERR_OK);
+  EXPECT(pcb->wheel_state == TCP_WHEEL_BUSY);
+
+  tcp_abort(pcb);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_TIMER_WHEEL */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_TIMER_WHEEL */
+}
+END_TEST
+
+/** Check that pcbs expiring in the same tick are all removed, whatever their
+ * place in the active list, and that the other pcbs are still visited */
+START_TEST(test_tcp_timer_wheel_expire)
+{
+#if LWIP_TCP_TIMER_WHEEL
+  struct test_tcp_counters counters;
+  struct tcp_pcb *pcbs[MEMP_NUM_TCP_PCB];
+  struct tcp_pcb *pcb, *prev;
+  struct netif netif;
+  struct test_tcp_txcounters txcounters;
+  int i, n;
+  LWIP_UNUSED_ARG(_i);
+
+  test_tcp_init_netif(&netif, &txcounters, &test_local_ip, &test_netmask);
+  memset(&counters, 0, sizeof(counters));
+  for (i = 0; i < MEMP_NUM_TCP_PCB; i++) {
+    pcbs[i] = test_tcp_new_counters_pcb(&counters);
+    EXPECT_RET(pcbs[i] != NULL);
+    tcp_set_state(pcbs[i], ESTABLISHED, &test_local_ip, &test_remote_ip, TEST_LOCAL_PORT,
+                  (u16_t)(TEST_REMOTE_PORT + i));
+  }
+  /* every other pcb is out of retries, the first and last in the active list
+     among them */
+  for (i = 0; i < MEMP_NUM_TCP_PCB; i += 2) {
+    pcbs[i]->nrtx = TCP_MAXRTX;
+  }
+  tcp_slowtmr();
+  EXPECT(counters.err_calls == (MEMP_NUM_TCP_PCB + 1) / 2);
+  n = 0;
+  prev = NULL;
+  for (pcb = tcp_active_pcbs; pcb != NULL; pcb = pcb->next) {
+    EXPECT(pcb == pcbs[1] || pcb == pcbs[3]);
+    EXPECT(pcb->active_prev == prev);
+    EXPECT(pcb->wheel_state == TCP_WHEEL_PARKED);
+    prev = pcb;
+    n++;
+  }
+  EXPECT(n == MEMP_NUM_TCP_PCB / 2);
+
+  /* the survivors still time out */
+  pcbs[1]->nrtx = TCP_MAXRTX;
+  tcp_wheel_wake(pcbs[1]);
+  tcp_slowtmr();
+  EXPECT(counters.err_calls == (MEMP_NUM_TCP_PCB + 3) / 2);
+  EXPECT(tcp_active_pcbs == pcbs[3]);
+  EXPECT(pcbs[3]->active_prev == NULL);
+  EXPECT(pcbs[3]->next == NULL);
+
+  tcp_abort(pcbs[3]);
+  EXPECT(MEMP_STATS_GET(used, MEMP_TCP_PCB) == 0);
+#else /* LWIP_TCP_TIMER_WHEEL */
+  LWIP_UNUSED_ARG(_i);
+#endif /* LWIP_TCP_TIMER_WHEEL */
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 tcp_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_tcp_new_abort),
+    TESTFUNC(test_tcp_demux),
     TESTFUNC(test_tcp_listen_passive_open),
     TESTFUNC(test_tcp_recv_inseq),
     TESTFUNC(test_tcp_recv_inseq_trim),
@@ -1678,6 +2702,14 @@ tcp_suite(void)
     TESTFUNC(test_tcp_malformed_header),
     TESTFUNC(test_tcp_fast_retx_recover),
     TESTFUNC(test_tcp_fast_rexmit_wraparound),
+    TESTFUNC(test_tcp_sack_loss_recovery),
+    TESTFUNC(test_tcp_sack_rexmit_beyond_cwnd),
+    TESTFUNC(test_tcp_cc_cubic),
+    TESTFUNC(test_tcp_write_pbuf_zerocopy),
+    TESTFUNC(test_tcp_gso),
+    TESTFUNC(test_tcp_gro),
+    TESTFUNC(test_tcp_gro_ooseq),
+    TESTFUNC(test_tcp_gro_bad_chksum),
     TESTFUNC(test_tcp_rto_rexmit_wraparound),
     TESTFUNC(test_tcp_tx_full_window_lost_from_unacked),
     TESTFUNC(test_tcp_tx_full_window_lost_from_unsent),
@@ -1689,7 +2721,10 @@ tcp_suite(void)
     TESTFUNC(test_tcp_rto_timeout_syn_sent_link_down),
     TESTFUNC(test_tcp_zwp_timeout),
     TESTFUNC(test_tcp_zwp_timeout_link_down),
-    TESTFUNC(test_tcp_persist_split)
+    TESTFUNC(test_tcp_persist_split),
+    TESTFUNC(test_tcp_timer_wheel),
+    TESTFUNC(test_tcp_timer_wheel_write),
+    TESTFUNC(test_tcp_timer_wheel_expire)
   };
   return create_suite("TCP", tests, sizeof(tests)/sizeof(testfunc), tcp_setup, tcp_teardown);
 }
@@ -335,13 +335,109 @@ START_TEST(test_udp_broadcast_rx_with_2_netifs)
 }
 END_TEST
 
+/* bind pcbs to specific and any addresses, check conflicts and which one gets unicasts */
+START_TEST(test_udp_bind_rx)
+{
+  err_t err;
+  struct udp_pcb *pcb_any, *pcb1, *pcb_eph1, *pcb_eph2;
+  const u16_t port = 12345;
+  struct test_udp_rxdata ctr_any, ctr1;
+  struct pbuf *p;
+  LWIP_UNUSED_ARG(_i);
+
+  pcb_any = udp_new();
+  fail_unless(pcb_any != NULL);
+  pcb1 = udp_new();
+  fail_unless(pcb1 != NULL);
+
+  err = udp_bind(pcb_any, NULL, port);
+  fail_unless(err == ERR_OK);
+#if !SO_REUSE
+  /* the port is taken for all addresses */
+  err = udp_bind(pcb1, &test_netif1.ip_addr, port);
+  fail_unless(err == ERR_USE);
+#endif
+  err = udp_bind(pcb1, &test_netif1.ip_addr, port + 1);
+  fail_unless(err == ERR_OK);
+  /* rebinding to the same address and port is allowed */
+  err = udp_bind(pcb1, &test_netif1.ip_addr, port + 1);
+  fail_unless(err == ERR_OK);
+#if !SO_REUSE
+  err = udp_bind(pcb_any, NULL, port + 1);
+  fail_unless(err == ERR_USE);
+#endif
+  /* a failed rebind keeps the previous binding */
+  fail_unless(pcb_any->local_port == port);
+
+  memset(&ctr_any, 0, sizeof(ctr_any));
+  ctr_any.pcb = pcb_any;
+  memset(&ctr1, 0, sizeof(ctr1));
+  ctr1.pcb = pcb1;
+  udp_recv(pcb_any, test_recv, &ctr_any);
+  udp_recv(pcb1, test_recv, &ctr1);
+
+  p = test_udp_create_test_packet(16, port, test_ipaddr2.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif2);
+  fail_unless(err == ERR_OK);
+  fail_unless(ctr_any.rx_cnt == 1);
+  fail_unless(ctr1.rx_cnt == 0);
+
+  p = test_udp_create_test_packet(16, port + 1, test_ipaddr1.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif1);
+  fail_unless(err == ERR_OK);
+  fail_unless(ctr_any.rx_cnt == 1);
+  fail_unless(ctr1.rx_cnt == 1);
+
+  /* pcb1 is bound to netif1's address only */
+  p = test_udp_create_test_packet(16, port + 1, test_ipaddr2.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif2);
+  fail_unless(err == ERR_OK);
+  fail_unless(ctr1.rx_cnt == 1);
+
+  /* after moving pcb1 to another port, it does not get the old port anymore */
+  err = udp_bind(pcb1, &test_netif1.ip_addr, port + 2);
+  fail_unless(err == ERR_OK);
+  p = test_udp_create_test_packet(16, port + 1, test_ipaddr1.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif1);
+  fail_unless(err == ERR_OK);
+  fail_unless(ctr1.rx_cnt == 1);
+  p = test_udp_create_test_packet(16, port + 2, test_ipaddr1.addr);
+  EXPECT_RET(p != NULL);
+  err = ip4_input(p, &test_netif1);
+  fail_unless(err == ERR_OK);
+  fail_unless(ctr1.rx_cnt == 2);
+
+  /* local ports are allocated from the local range and are unique */
+  pcb_eph1 = udp_new();
+  fail_unless(pcb_eph1 != NULL);
+  pcb_eph2 = udp_new();
+  fail_unless(pcb_eph2 != NULL);
+  err = udp_bind(pcb_eph1, NULL, 0);
+  fail_unless(err == ERR_OK);
+  err = udp_bind(pcb_eph2, NULL, 0);
+  fail_unless(err == ERR_OK);
+  fail_unless(pcb_eph1->local_port >= 0xc000);
+  fail_unless(pcb_eph2->local_port >= 0xc000);
+  fail_unless(pcb_eph1->local_port != pcb_eph2->local_port);
+#if !SO_REUSE
+  err = udp_bind(pcb1, NULL, pcb_eph1->local_port);
+  fail_unless(err == ERR_USE);
+#endif
+}
+END_TEST
+
 /** Create the suite including all tests for this module */
 Suite *
 udp_suite(void)
 {
   testfunc tests[] = {
     TESTFUNC(test_udp_new_remove),
-    TESTFUNC(test_udp_broadcast_rx_with_2_netifs)
+    TESTFUNC(test_udp_broadcast_rx_with_2_netifs),
+    TESTFUNC(test_udp_bind_rx)
   };
   return create_suite("UDP", tests, sizeof(tests)/sizeof(testfunc), udp_setup, udp_teardown);
 }